@@ -0,0 +1,88 @@
+/**
+ * HostTest.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ * What the host tests and benchmarks share: CHECK, a clock, and starting
+ * the SwitchBoard.
+ *
+ * A test is a program - it runs its checks, and 'hostTestResult' (its exit
+ * code) is non-zero if any failed. A failed check is reported, and the
+ * test carries on.
+ */
+
+#ifndef HOST_HOSTTEST_H_
+#define HOST_HOSTTEST_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include <atomic>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+
+inline std::atomic<int> hostChecks(0);
+inline std::atomic<int> hostFailures(0);
+
+inline void hostCheckFailed(const char *file, int line, const char *what)
+{
+	hostFailures++;
+	printf ("FAILED %s:%d: %s\n", file, line, what );
+	fflush (stdout );
+}
+
+#define CHECK(cond) do {                                                      \
+		hostChecks++;                                                         \
+		if (!(cond)) hostCheckFailed(__FILE__, __LINE__, #cond);              \
+	} while (0)
+
+#define CHECK_EQ(a, b) do {                                                   \
+		hostChecks++;                                                         \
+		long long a_ = (long long) (a), b_ = (long long) (b);                 \
+		if (a_ != b_) {                                                       \
+			printf ("  (%lld != %lld)\n", a_, b_ );                           \
+			hostCheckFailed(__FILE__, __LINE__, #a " == " #b);                \
+		}                                                                     \
+	} while (0)
+
+// Report, and @return the exit code
+inline int hostTestResult(const char *name)
+{
+	printf ("%s: %d checks, %d failed\n", name, hostChecks.load (), hostFailures.load () );
+	return ((hostFailures.load () == 0) ? 0 : 1);
+}
+
+// A monotonic clock, in nanoseconds (for timing things that take less
+// than esp_timer's microsecond)
+inline int64_t hostNowNsec()
+{
+	struct timespec now;
+	clock_gettime (CLOCK_MONOTONIC, &now );
+	return ((int64_t) now.tv_sec * 1000000000LL + now.tv_nsec);
+}
+
+// Stop the compiler throwing away work a benchmark doesn't use
+template<typename T>
+inline void hostKeep(const T &value)
+{
+	asm volatile("" : : "g"(&value) : "memory");
+}
+
+#ifdef MAIN_SWITCHBOARD_H_
+/**
+ * Start the delivery task (as main.cpp does), and wait until it is ready.
+ */
+inline void hostStartSwitchBoard()
+{
+	xTaskCreatePinnedToCore (SwitchBoard::runDelivery, "SwitchBoard", 8192, nullptr, 2, nullptr,
+			ASSIGN_SWITCHBOARD_CORE );
+	while (!SwitchBoard::isRunning ())
+	{
+		vTaskDelay (1 );
+	}
+}
+#endif
+
+#endif /* HOST_HOSTTEST_H_ */
@@ -0,0 +1,258 @@
+/**
+ * DecoderBench.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ * What each decoder costs, for the same sound: the MP3 file is decoded,
+ * then made into a 16 bit PCM WAV and an IMA-ADPCM WAV (256 byte blocks,
+ * encoded here) in memory, and each is decoded the way playMusic does it -
+ * a frame at a time, from at most AUDIO_WINDOW_GUARD bytes. Prints the
+ * size of each, nsec per sample, and msec of CPU for each second of sound
+ * (best of 'rounds').
+ *
+ * The PCM must come back exactly as it went in, and the ADPCM exactly as
+ * the encoder worked it out (and close to the PCM - the SNR is printed).
+ *
+ *     decoder_bench file.mp3 [rounds]
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "config.h"
+#include "audio/Decoders.h"
+#include "HostTest.h"
+
+#define TAG_PCM 0x0001
+#define TAG_IMA 0x0011
+#define ADPCM_BLOCK 256
+
+typedef std::vector<uint8_t> Bytes;
+
+static const int stepTable[89] = {
+	7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+	50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+	253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+	1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+	3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487,
+	12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767 };
+
+static const int indexTable[16] = {
+	-1, -1, -1, -1, 2, 4, 6, 8,
+	-1, -1, -1, -1, 2, 4, 6, 8 };
+
+
+// One sample -> the 4 bit code (and what the decoder will make of it)
+static int imaEncode(int sample, int *predictor, int *index)
+{
+	int step = stepTable[*index];
+	int diff = sample - *predictor;
+	int code = 0;
+	if (diff < 0)
+	{
+		code = 8;
+		diff = -diff;
+	}
+	int delta = step >> 3;
+	if (diff >= step)
+	{
+		code |= 4;
+		diff -= step;
+		delta += step;
+	}
+	if (diff >= (step >> 1))
+	{
+		code |= 2;
+		diff -= step >> 1;
+		delta += step >> 1;
+	}
+	if (diff >= (step >> 2))
+	{
+		code |= 1;
+		delta += step >> 2;
+	}
+	int pred = (code & 8) ? *predictor - delta : *predictor + delta;
+	*predictor = (pred > 32767) ? 32767 : (pred < -32768) ? -32768 : pred;
+	int idx = *index + indexTable[code];
+	*index = (idx < 0) ? 0 : (idx > 88) ? 88 : idx;
+	return (code);
+}
+
+
+static void put16(Bytes *file, int value)
+{
+	file->push_back ((uint8_t) value );
+	file->push_back ((uint8_t) (value >> 8) );
+}
+
+
+static void put32(Bytes *file, uint32_t value)
+{
+	put16 (file, (int) (value & 0xFFFF) );
+	put16 (file, (int) (value >> 16) );
+}
+
+
+static Bytes wavFile(int tag, int hz, int bits, int blockAlign, const Bytes &data)
+{
+	Bytes file = { 'R', 'I', 'F', 'F' };
+	put32 (&file, (uint32_t) (36 + data.size ()) );
+	file.insert (file.end (), { 'W', 'A', 'V', 'E', 'f', 'm', 't', ' ' } );
+	put32 (&file, 16 );
+	put16 (&file, tag );
+	put16 (&file, 1 );
+	put32 (&file, (uint32_t) hz );
+	put32 (&file, (uint32_t) (hz * blockAlign) );
+	put16 (&file, blockAlign );
+	put16 (&file, bits );
+	file.insert (file.end (), { 'd', 'a', 't', 'a' } );
+	put32 (&file, (uint32_t) data.size () );
+	file.insert (file.end (), data.begin (), data.end () );
+	return (file);
+}
+
+
+/**
+ * Mono 'pcm' as IMA-ADPCM blocks - and in 'decoded', what the decoder
+ * should make of them.
+ */
+static Bytes adpcmEncode(const std::vector<int16_t> &pcm, std::vector<int16_t> *decoded)
+{
+	const int perBlock = (ADPCM_BLOCK - 4) * 2 + 1;
+	Bytes data;
+	int index = 0;
+	for (size_t start = 0; start < pcm.size (); start += perBlock)
+	{
+		int predictor = pcm[start];
+		put16 (&data, predictor );
+		data.push_back ((uint8_t) index );
+		data.push_back (0 );
+		decoded->push_back ((int16_t) predictor );
+		for (int idx = 1; idx < perBlock; idx += 2)
+		{
+			int16_t low = ((start + idx) < pcm.size ()) ? pcm[start + idx] : 0;
+			int16_t high = ((start + idx + 1) < pcm.size ()) ? pcm[start + idx + 1] : 0;
+			int code = imaEncode (low, &predictor, &index );
+			decoded->push_back ((int16_t) predictor );
+			code |= imaEncode (high, &predictor, &index ) << 4;
+			decoded->push_back ((int16_t) predictor );
+			data.push_back ((uint8_t) code );
+		}
+	}
+	return (data);
+}
+
+
+/**
+ * Decode all of 'file' - the samples go in 'out' (if there is one).
+ * @return the best nsec for the whole file
+ */
+static double decodeFile(const Bytes &file, int rounds, std::vector<int16_t> *out, int *hz)
+{
+	FILE *fp = fmemopen ((void *) file.data (), file.size (), "rb" );
+	AudioFormat format;
+	bool ok = Decoder::probe (fp, &format );
+	fclose (fp );
+	CHECK(ok);
+	if (!ok) return (0);
+
+	static Decoders decoders;
+	static int16_t pcm[MINIMP3_MAX_SAMPLES_PER_FRAME];
+	double best = 0;
+	for (int round = 0; round < rounds; round++)
+	{
+		Decoder *decoder = decoders.start (&format, format.dataStart );
+		size_t pos = (format.codec == CODEC_MP3) ? 0 : format.dataStart;
+		int64_t start = hostNowNsec ();
+		while (pos < file.size ())
+		{
+			size_t len = file.size () - pos;
+			if (len > AUDIO_WINDOW_GUARD) len = AUDIO_WINDOW_GUARD;
+			DecodeInfo info;
+			int samples = decoder->decode (&file[pos], len, pcm, &info );
+			if (info.bytes == 0) break;
+			pos += info.bytes;
+			if (samples == 0) continue;
+			*hz = info.hz;
+			if ((out != nullptr) && (round == 0)) out->insert (out->end (), pcm, pcm + samples * info.channels );
+			hostKeep (pcm[0] );
+		}
+		double nsec = (double) (hostNowNsec () - start);
+		if ((round == 0) || (nsec < best)) best = nsec;
+	}
+	return (best);
+}
+
+
+static void report(const char *name, const Bytes &file, double nsec, size_t samples, int hz)
+{
+	double seconds = (double) samples / hz;
+	printf ("  %-10s %9u %10.2f %12.3f\n", name, (unsigned) file.size (), nsec / samples,
+			nsec / 1e6 / seconds );
+}
+
+
+int main(int argc, char **argv)
+{
+	if (argc < 2)
+	{
+		printf ("usage: decoder_bench file.mp3 [rounds]\n" );
+		return (2);
+	}
+	int rounds = (argc > 2) ? atoi (argv[2] ) : 20;
+	FILE *fp = fopen (argv[1], "rb" );
+	CHECK(fp != nullptr);
+	if (fp == nullptr) return (hostTestResult ("decoder_bench" ));
+	Bytes mp3;
+	uint8_t block[4096];
+	size_t len;
+	while ((len = fread (block, 1, sizeof(block), fp )) > 0)
+	{
+		mp3.insert (mp3.end (), block, block + len );
+	}
+	fclose (fp );
+
+	int hz = 0;
+	std::vector<int16_t> pcm;
+	double mp3Nsec = decodeFile (mp3, rounds, &pcm, &hz );
+	CHECK(!pcm.empty ());
+	if (pcm.empty ()) return (hostTestResult ("decoder_bench" ));
+	printf ("%s: %u samples at %d Hz (%.1f sec, mono)\n", argv[1], (unsigned) pcm.size (), hz,
+			(double) pcm.size () / hz );
+
+	Bytes raw ((const uint8_t *) pcm.data (), (const uint8_t *) (pcm.data () + pcm.size ()));
+	Bytes wav = wavFile (TAG_PCM, hz, 16, 2, raw );
+	std::vector<int16_t> pcmBack;
+	int pcmHz = 0;
+	double pcmNsec = decodeFile (wav, rounds, &pcmBack, &pcmHz );
+	CHECK_EQ(pcmHz, hz);
+	CHECK(pcmBack == pcm);
+
+	std::vector<int16_t> expect;
+	Bytes adpcm = wavFile (TAG_IMA, hz, 4, ADPCM_BLOCK, adpcmEncode (pcm, &expect ) );
+	std::vector<int16_t> adpcmBack;
+	int adpcmHz = 0;
+	double adpcmNsec = decodeFile (adpcm, rounds, &adpcmBack, &adpcmHz );
+	CHECK_EQ(adpcmHz, hz);
+	CHECK(adpcmBack == expect);
+
+	double noise = 0;
+	double signal = 0;
+	for (size_t idx = 0; idx < pcm.size (); idx++)
+	{
+		double error = (double) pcm[idx] - adpcmBack[idx];
+		noise += error * error;
+		signal += (double) pcm[idx] * pcm[idx];
+	}
+	double snr = 10.0 * log10 (signal / noise);
+	CHECK(snr > 15.0);
+
+	printf ("  codec          bytes  nsec/sample  CPU msec/sec\n" );
+	report ("MP3", mp3, mp3Nsec, pcm.size (), hz );
+	report ("PCM 16", wav, pcmNsec, pcm.size (), hz );
+	report ("IMA-ADPCM", adpcm, adpcmNsec, expect.size (), hz );
+	printf ("  (ADPCM SNR %.1f dB)\n", snr );
+	return (hostTestResult ("decoder_bench" ));
+}
@@ -0,0 +1,107 @@
+/**
+ * EnvelopeFollowerBench.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ * What following the sound costs, per sample - the block average playMusic
+ * used to work out (abs, add, and a divide per block) against the
+ * EnvelopeFollower, peak and RMS, mono and stereo. Decoded frames of 1152
+ * samples, a level every EYE_AVG_SIZE, as playMusic does.
+ *
+ *     envelope_follower_bench [frames]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "config.h"
+#include "audio/EnvelopeFollower.h"
+#include "HostTest.h"
+
+#define FRAME_SAMPLES 1152
+
+static std::vector<int16_t> pcm (FRAME_SAMPLES * 2);
+
+// The old way - as playMusic had it
+struct BlockAverage
+{
+	uint32_t sum = 0;
+	int count = 0;
+
+	int process(const int16_t *in, int samples, int stride, uint16_t *levels)
+	{
+		int made = 0;
+		for (int idx = 0; idx < samples; idx++)
+		{
+			sum += abs (in[idx * stride] );
+			if (++count < EYE_AVG_SIZE) continue;
+			levels[made++] = (uint16_t) (sum / EYE_AVG_SIZE);
+			sum = 0;
+			count = 0;
+		}
+		return (made);
+	}
+};
+
+
+// @return nsec per sample
+template<typename FOLLOW>
+static double timeIt(FOLLOW *follow, int frames, int stride)
+{
+	uint16_t levels[FRAME_SAMPLES / EYE_AVG_SIZE + 1];
+	int made = 0;
+	int64_t start = hostNowNsec ();
+	for (int frame = 0; frame < frames; frame++)
+	{
+		made += follow->process (pcm.data (), FRAME_SAMPLES, stride, levels );
+		hostKeep (levels[0] );
+	}
+	double nsec = (double) (hostNowNsec () - start) / ((double) frames * FRAME_SAMPLES);
+	CHECK_EQ(made, (int) ((int64_t) frames * FRAME_SAMPLES / EYE_AVG_SIZE));
+	return (nsec);
+}
+
+
+// (EnvelopeFollower::process, with the room for levels filled in)
+struct Follower
+{
+	EnvelopeFollower env;
+
+	Follower (EnvMode mode)
+	{
+		env.configure (mode, EYE_ATTACK_MSEC, EYE_RELEASE_MSEC, EYE_AVG_SIZE );
+		env.setSampleRate (44100 );
+	}
+
+	int process(const int16_t *in, int samples, int stride, uint16_t *levels)
+	{
+		return (env.process (in, samples, stride, levels, FRAME_SAMPLES / EYE_AVG_SIZE + 1 ));
+	}
+};
+
+
+int main(int argc, char **argv)
+{
+	int frames = (argc > 1) ? atoi (argv[1] ) : 20000;
+	uint32_t seed = 77;
+	for (int16_t &sample : pcm)
+	{
+		seed = seed * 1103515245 + 12345;
+		sample = (int16_t) (seed >> 16);
+	}
+
+	printf ("nsec per sample    block average    peak     rms\n" );
+	for (int stride = 1; stride <= 2; stride++)
+	{
+		BlockAverage average;
+		Follower peak(ENV_PEAK);
+		Follower rms(ENV_RMS);
+		double averageNs = timeIt (&average, frames, stride );
+		double peakNs = timeIt (&peak, frames, stride );
+		double rmsNs = timeIt (&rms, frames, stride );
+		printf ("  %-8s         %10.2f  %6.2f  %6.2f\n", (stride == 1) ? "mono" : "stereo", averageNs, peakNs,
+				rmsNs );
+	}
+	return (hostTestResult ("envelope_follower_bench" ));
+}
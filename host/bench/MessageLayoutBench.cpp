@@ -0,0 +1,151 @@
+/**
+ * MessageLayoutBench.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ * The message layout against the one it replaced (a vtable, an int event,
+ * and 128 bytes of text in every message) - the size of each, and the
+ * nanoseconds to create + delete, and to copy, a message with no text,
+ * short text, and long text.
+ *
+ *     message_layout_bench [rounds]
+ *
+ * NOTE: Longs and pointers are 64 bits here, so both layouts are bigger
+ *       than on the ESP32 - the ESP32 sizes are worked out and printed too.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <new>
+#include "Sequencer/Message.h"
+#include "HostTest.h"
+
+/**
+ * The old message, as it was
+ */
+class OldMessage
+{
+public:
+	virtual ~OldMessage () { }
+	OldMessage ()
+	{
+		event = EVENT_ACTION_NONE;
+		destination = TASK_NAME::IDLER;
+		response = TASK_NAME::IDLER;
+		value = 0L;
+		rate = 0L;
+		bzero (text, sizeof(text) );
+	}
+	OldMessage (const OldMessage &oldObj)
+	{
+		destination = oldObj.destination;
+		event = oldObj.event;
+		response = oldObj.response;
+		value = oldObj.value;
+		rate = oldObj.rate;
+		memcpy (text, oldObj.text, sizeof(text) );
+	}
+
+	static OldMessage *create_message(TASK_NAME _target, TASK_NAME _from, int _event,
+			long int _value, long int _rate, const char *txt = nullptr)
+	{
+		OldMessage *m = new OldMessage();
+		m->destination = _target;
+		m->response = _from;
+		m->event = _event;
+		m->value = _value;
+		m->rate = _rate;
+		bzero (m->text, sizeof(m->text) );
+		if ((txt != nullptr) && (*txt != '\0'))
+		{
+			strncpy (m->text, txt, sizeof(m->text) - 1 );
+		}
+		return (m);
+	}
+
+	TASK_NAME destination;
+	TASK_NAME response;
+	int event;
+	long int value;
+	long int rate;
+	char text[128];
+};
+
+// On the ESP32: vtable pointer, 2 task names (+2 padding), event, value, rate, text
+#define OLD_ESP32_SIZE (4 + 4 + 4 + 4 + 4 + 128)
+#define NEW_ESP32_SIZE (MSG_HEADER_SIZE + MSG_INLINE_TEXT_SIZE)
+
+static const char *texts[] = { nullptr, "eyes.on", "/sdcard/sounds/a-much-longer-file-name.mp3" };
+static const char *textNames[] = { "no text", "short text", "long text" };
+
+
+/**
+ * @return nsec per create_message + delete
+ */
+template<typename MSG>
+static double timeCreate(int rounds, const char *txt)
+{
+	int64_t start = hostNowNsec ();
+	for (int round = 0; round < rounds; round++)
+	{
+		MSG *msg = MSG::create_message (TASK_NAME::EYES, TASK_NAME::IDLER, 100, round, 0, txt );
+		hostKeep (msg );
+		delete msg;
+	}
+	return ((double) (hostNowNsec () - start) / rounds);
+}
+
+
+/**
+ * @return nsec per copy (into memory we already have) + destroy
+ */
+template<typename MSG>
+static double timeCopy(int rounds, const char *txt)
+{
+	MSG *from = MSG::create_message (TASK_NAME::EYES, TASK_NAME::IDLER, 100, 1, 0, txt );
+	alignas(MSG) static uint8_t space[sizeof(MSG)];
+	int64_t start = hostNowNsec ();
+	for (int round = 0; round < rounds; round++)
+	{
+		// (::new - Message has its own new, which hides placement new)
+		MSG *copy = ::new (space) MSG(*from);
+		hostKeep (copy );
+		copy->~MSG ();
+	}
+	double nsec = (double) (hostNowNsec () - start) / rounds;
+	delete from;
+	return (nsec);
+}
+
+
+int main(int argc, char **argv)
+{
+	int rounds = (argc > 1) ? atoi (argv[1] ) : 1000000;
+
+	esp_log_level_set ("*", ESP_LOG_ERROR );
+	printf ("bytes per message   old  new\n" );
+	printf ("  host            %5u %4u\n", (unsigned) sizeof(OldMessage), (unsigned) sizeof(Message) );
+	printf ("  ESP32           %5u %4u\n", OLD_ESP32_SIZE, NEW_ESP32_SIZE );
+	printf ("  ESP32, pool of %d  %5u %4u\n", MESSAGE_POOL_SIZE, OLD_ESP32_SIZE * MESSAGE_POOL_SIZE,
+			NEW_ESP32_SIZE * MESSAGE_POOL_SIZE );
+	CHECK(sizeof(Message) < sizeof(OldMessage));
+
+	printf ("\n              create+delete ns       copy ns\n" );
+	printf ("                  old      new      old      new\n" );
+	for (int idx = 0; idx < 3; idx++)
+	{
+		double oldCreate = timeCreate<OldMessage> (rounds, texts[idx] );
+		double newCreate = timeCreate<Message> (rounds, texts[idx] );
+		double oldCopy = timeCopy<OldMessage> (rounds, texts[idx] );
+		double newCopy = timeCopy<Message> (rounds, texts[idx] );
+		printf ("  %-10s  %7.1f  %7.1f  %7.1f  %7.1f\n", textNames[idx], oldCreate, newCreate, oldCopy, newCopy );
+	}
+
+	MessagePoolStats stats;
+	Message::getPoolStats (&stats );
+	CHECK_EQ(stats.inUse, 0);
+	return (hostTestResult ("message_layout_bench" ));
+}
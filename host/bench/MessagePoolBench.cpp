@@ -0,0 +1,112 @@
+/**
+ * MessagePoolBench.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ * The message pool against new/delete - nanoseconds for one allocation
+ * and its free, one at a time and in bursts of SWITCHBOARD_BATCH_MAX (as
+ * the delivery task frees them), from 1 and 2 tasks at once.
+ *
+ *     message_pool_bench [rounds]
+ *
+ * NOTE: glibc keeps a cache of free blocks for each thread, so new/delete
+ *       is far cheaper here than on the ESP32, where every call takes the
+ *       heap lock (and the other core may be holding it). The pool costs
+ *       the same on both.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+#include "Sequencer/MessagePool.h"
+#include "Sequencer/Message.h"
+#include "HostTest.h"
+
+static MessagePool<sizeof(Message), MESSAGE_POOL_SIZE> pool;
+
+struct PoolAlloc
+{
+	static void *alloc() { return (pool.alloc ()); }
+	static void release(void *ptr) { pool.free (ptr ); }
+};
+
+struct HeapAlloc
+{
+	static void *alloc() { return (::operator new (sizeof(Message) )); }
+	static void release(void *ptr) { ::operator delete (ptr ); }
+};
+
+struct MessageAlloc
+{
+	static void *alloc() { return (Message::create_message (TASK_NAME::EYES, TASK_NAME::IDLER, 1, 2, 3 )); }
+	static void release(void *ptr) { delete (Message *) ptr; }
+};
+
+
+/**
+ * @return nsec per allocate + free, for each of 'threads' doing 'rounds'
+ *         bursts of 'burst'.
+ */
+template<typename ALLOC>
+static double timeIt(int threads, int rounds, int burst)
+{
+	std::vector<std::thread> running;
+	std::atomic<int> failed(0);
+	int64_t start = hostNowNsec ();
+	for (int id = 0; id < threads; id++)
+	{
+		running.emplace_back ([rounds, burst, &failed] {
+			void *held[SWITCHBOARD_BATCH_MAX];
+			for (int round = 0; round < rounds; round++)
+			{
+				for (int idx = 0; idx < burst; idx++)
+				{
+					held[idx] = ALLOC::alloc ();
+					hostKeep (held[idx] );
+				}
+				for (int idx = 0; idx < burst; idx++)
+				{
+					if (held[idx] == nullptr) failed++;
+					else ALLOC::release (held[idx] );
+				}
+			}
+		} );
+	}
+	for (std::thread &thread : running)
+	{
+		thread.join ();
+	}
+	CHECK_EQ(failed.load (), 0);
+	return ((double) (hostNowNsec () - start) / ((double) rounds * burst));
+}
+
+
+int main(int argc, char **argv)
+{
+	int rounds = (argc > 1) ? atoi (argv[1] ) : 20000;
+	static const int burstSizes[] = { 1, SWITCHBOARD_BATCH_MAX };
+
+	esp_log_level_set ("*", ESP_LOG_ERROR );
+	printf ("sizeof(Message) = %u bytes, pool of %d\n", (unsigned) sizeof(Message), MESSAGE_POOL_SIZE );
+	printf ("tasks  burst   pool ns   new/delete ns   create_message+delete ns\n" );
+	for (int threads = 1; threads <= 2; threads++)
+	{
+		for (int burst : burstSizes)
+		{
+			// (with 2 tasks, the pool must hold both bursts)
+			double poolNs = timeIt<PoolAlloc> (threads, rounds, burst );
+			double heapNs = timeIt<HeapAlloc> (threads, rounds, burst );
+			double msgNs = timeIt<MessageAlloc> (threads, rounds, burst );
+			printf ("%5d  %5d  %8.1f  %14.1f  %25.1f\n", threads, burst, poolNs, heapNs, msgNs );
+		}
+	}
+
+	MessagePoolStats stats;
+	Message::getPoolStats (&stats );
+	CHECK_EQ(stats.inUse, 0);
+	CHECK_EQ(stats.exhaustedCount, 0);
+	CHECK_EQ(stats.badFreeCount, 0);
+	return (hostTestResult ("message_pool_bench" ));
+}
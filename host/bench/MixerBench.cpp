@@ -0,0 +1,140 @@
+/**
+ * MixerBench.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ * Mixer::mix - nsec per frame, MIXER_BLOCK frames at a time (as the player
+ * writes them), with no voices, one, and all MIXER_VOICES, for mono and
+ * stereo music. First it checks the mix against a plain sample by sample
+ * one (every voice, loud enough to clip, some ending part way through a
+ * block).
+ *
+ * It is built twice (see CMakeLists.txt): as mixer_bench, with the host
+ * build's -O2, and as mixer_bench_o3, with the mixer at -O3 - where gcc
+ * vectorizes its loops. Compare the two for what SIMD buys (Mixer.h).
+ *
+ *     mixer_bench [rounds]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "audio/Mixer.h"
+#include "HostTest.h"
+
+#ifndef BENCH_NAME
+#define BENCH_NAME "mixer_bench"
+#endif
+
+#define SOUND_FRAMES 20000
+
+static std::vector<int16_t> music (MIXER_MAX_SAMPLES);
+static std::vector<int16_t> sounds[MIXER_VOICES];
+static const int32_t gains[] = { MIXER_UNITY_GAIN, MIXER_UNITY_GAIN / 2, MIXER_MAX_GAIN, 8000 };
+
+
+static void noise(std::vector<int16_t> *pcm, uint32_t seed)
+{
+	for (int16_t &sample : *pcm)
+	{
+		seed = seed * 1103515245 + 12345;
+		sample = (int16_t) (seed >> 16);
+	}
+}
+
+
+/**
+ * Mix 'blocks' blocks of 'frames' - and check every sample.
+ * @return how many were wrong
+ */
+static int checkMix(int channels, int frames, int blocks)
+{
+	Mixer mixer;
+	int lengths[MIXER_VOICES];
+	for (int voice = 0; voice < MIXER_VOICES; voice++)
+	{	// (they finish at different places - most not at the end of a block)
+		lengths[voice] = SOUND_FRAMES / 4 - voice * 777;
+		mixer.start (sounds[voice].data (), lengths[voice], gains[voice % 4] );
+	}
+
+	int wrong = 0;
+	int pos = 0;
+	for (int block = 0; block < blocks; block++)
+	{
+		const int16_t *out = mixer.mix (music.data (), frames, channels );
+		for (int idx = 0; idx < frames; idx++)
+		{
+			for (int ch = 0; ch < channels; ch++)
+			{
+				int64_t sum = music[idx * channels + ch];
+				for (int voice = 0; voice < MIXER_VOICES; voice++)
+				{
+					if (pos + idx < lengths[voice])
+					{
+						sum += ((int32_t) sounds[voice][pos + idx] * gains[voice % 4]) >> 15;
+					}
+				}
+				sum = (sum > 32767) ? 32767 : (sum < -32768) ? -32768 : sum;
+				if (out[idx * channels + ch] != sum) wrong++;
+			}
+		}
+		pos += frames;
+	}
+	CHECK_EQ(mixer.active (), 0);
+	CHECK(mixer.mix (music.data (), frames, channels ) == music.data ());
+	return (wrong);
+}
+
+
+// @return nsec per frame
+static double timeIt(int channels, int voices, int rounds)
+{
+	Mixer mixer;
+	int64_t start = hostNowNsec ();
+	for (int round = 0; round < rounds; round++)
+	{
+		if (mixer.active () < voices)
+		{	// (keep them all playing)
+			mixer.reset ();
+			for (int voice = 0; voice < voices; voice++)
+			{
+				mixer.start (sounds[voice].data (), SOUND_FRAMES, gains[voice % 4] );
+			}
+		}
+		const int16_t *out = mixer.mix (music.data (), MIXER_BLOCK, channels );
+		hostKeep (out[5] );
+	}
+	return ((double) (hostNowNsec () - start) / ((double) rounds * MIXER_BLOCK));
+}
+
+
+int main(int argc, char **argv)
+{
+	int rounds = (argc > 1) ? atoi (argv[1] ) : 200000;
+	noise (&music, 3 );
+	for (int voice = 0; voice < MIXER_VOICES; voice++)
+	{
+		sounds[voice].resize (SOUND_FRAMES );
+		noise (&sounds[voice], 100 + voice );
+	}
+
+	for (int channels = 1; channels <= 2; channels++)
+	{
+		int wrong = checkMix (channels, MIXER_BLOCK, 30 );
+		if (wrong != 0) printf ("%d channels: %d samples wrong\n", channels, wrong );
+		CHECK_EQ(wrong, 0);
+		CHECK_EQ(checkMix (channels, MIXER_MAX_SAMPLES / channels, 5 ), 0);
+	}
+
+	printf ("%s: nsec per frame   no voices   1 voice   %d voices\n", BENCH_NAME, MIXER_VOICES );
+	for (int channels = 1; channels <= 2; channels++)
+	{
+		double none = timeIt (channels, 0, rounds );
+		double one = timeIt (channels, 1, rounds );
+		double all = timeIt (channels, MIXER_VOICES, rounds );
+		printf ("  %-8s                  %8.3f  %8.2f  %8.2f\n", (channels == 1) ? "mono" : "stereo", none, one,
+				all );
+	}
+	return (hostTestResult (BENCH_NAME ));
+}
@@ -0,0 +1,198 @@
+/**
+ * OutputConvertBench.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ * Output::convert_block against the way samples used to be converted (a
+ * float multiply and a virtual process_sample for every sample) - Msamples
+ * a second, 256 frames at a time, for the DAC (mono in, both sides out)
+ * and I2S (stereo, and mono). First it checks convert_block against a 64
+ * bit reference for every possible sample, at gains up to (and past) the
+ * most it allows - the product must never overflow.
+ *
+ * Then all of Output::write, into the shim's DMA buffers: converting into a
+ * buffer of our own for i2s_write to copy in (as it used to), against
+ * converting straight into a leased DMA buffer.
+ *
+ *     output_convert_bench [rounds]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "audio/DACOutput.h"
+#include "audio/I2SOutput.h"
+#include "HostI2S.h"
+#include "HostTest.h"
+
+#define BLOCK_FRAMES 256
+
+static i2s_pin_config_t pins = { };
+
+
+// What a sample should come out as, worked out in 64 bits
+static int16_t reference(int16_t in, float volume, bool isUnsigned)
+{
+	int64_t gain = (int64_t) (volume * OUTPUT_UNITY_GAIN + 0.5f);
+	if (gain > OUTPUT_MAX_GAIN) gain = OUTPUT_MAX_GAIN;
+	int64_t v = ((int64_t) in * gain) >> 15;
+	v = (v < -32768) ? -32768 : (v > 32767) ? 32767 : v;
+	return (isUnsigned ? (int16_t) (v ^ 0x8000) : (int16_t) v);
+}
+
+
+/**
+ * Every sample, through 'out' as mono - each side of the output must match.
+ */
+static void checkGains(Output *out, bool isUnsigned)
+{
+	static const float volumes[] = { 0.25f, 0.5f, 1.0f, 1.5f, 1.999f, 2.0f, 4.0f };
+	std::vector<int16_t> in (65536);
+	std::vector<int16_t> got (65536 * 2);
+	for (int idx = 0; idx < 65536; idx++)
+	{
+		in[idx] = (int16_t) (idx - 32768);
+	}
+	for (float volume : volumes)
+	{
+		out->set_volume (volume );
+		out->convert_block (in.data (), got.data (), 65536, 1 );
+		int wrong = 0;
+		for (int idx = 0; idx < 65536; idx++)
+		{
+			int16_t expect = reference (in[idx], volume, isUnsigned );
+			for (int side = 0; side < out->channels (); side++)
+			{
+				if (got[idx * out->channels () + side] != expect) wrong++;
+			}
+		}
+		if (wrong != 0) printf ("volume %.3f: %d samples wrong\n", volume, wrong );
+		CHECK_EQ(wrong, 0);
+	}
+}
+
+
+// The old way - for every sample of every side
+static void oldConvert(Output *out, float volume, const int16_t *in, int16_t *buf, int frames, int channels)
+{
+	int outChannels = out->channels ();
+	for (int idx = 0; idx < frames; idx++)
+	{
+		for (int side = 0; side < outChannels; side++)
+		{
+			buf[idx * outChannels + side] = out->process_sample (
+					volume * float(in[idx * channels + ((side < channels) ? side : 0)]) );
+		}
+	}
+}
+
+
+/**
+ * @return Msamples (output samples) a second - the old way and the new.
+ */
+static void timeIt(const char *name, Output *out, int channels, int rounds)
+{
+	std::vector<int16_t> in (BLOCK_FRAMES * 2);
+	std::vector<int16_t> buf (BLOCK_FRAMES * 2);
+	uint32_t seed = 1;
+	for (int16_t &sample : in)
+	{
+		seed = seed * 1103515245 + 12345;
+		sample = (int16_t) (seed >> 16);
+	}
+	float volume = 0.5f;
+	out->set_volume (volume );
+	double samples = (double) rounds * BLOCK_FRAMES * out->channels ();
+
+	int64_t start = hostNowNsec ();
+	for (int round = 0; round < rounds; round++)
+	{
+		oldConvert (out, volume, in.data (), buf.data (), BLOCK_FRAMES, channels );
+		hostKeep (buf[0] );
+	}
+	double oldRate = samples * 1000.0 / (double) (hostNowNsec () - start);
+
+	start = hostNowNsec ();
+	for (int round = 0; round < rounds; round++)
+	{
+		out->convert_block (in.data (), buf.data (), BLOCK_FRAMES, channels );
+		hostKeep (buf[0] );
+	}
+	double newRate = samples * 1000.0 / (double) (hostNowNsec () - start);
+	printf ("%-28s %8.0f %8.0f  (x%.1f)\n", name, oldRate, newRate, newRate / oldRate );
+}
+
+
+/**
+ * Msamples (output samples) a second through 'write' - converted into a
+ * buffer of our own then copied in by i2s_write, and converted in place.
+ */
+static void timeWrite(const char *name, Output *out, i2s_port_t port, int rounds)
+{
+	std::vector<int16_t> in (BLOCK_FRAMES);
+	std::vector<int16_t> staging (BLOCK_FRAMES * 2);
+	for (int idx = 0; idx < BLOCK_FRAMES; idx++)
+	{
+		in[idx] = (int16_t) (idx * 97);
+	}
+	out->set_volume (0.5f );
+	hostI2SCapture (port, false );
+	double samples = (double) rounds * BLOCK_FRAMES * out->channels ();
+	size_t bytes = BLOCK_FRAMES * out->channels () * sizeof(int16_t);
+
+	int64_t start = hostNowNsec ();
+	for (int round = 0; round < rounds; round++)
+	{
+		size_t written;
+		out->convert_block (in.data (), staging.data (), BLOCK_FRAMES, 1 );
+		i2s_write (port, staging.data (), bytes, &written, portMAX_DELAY );
+	}
+	double oldRate = samples * 1000.0 / (double) (hostNowNsec () - start);
+
+	hostI2SClear (port );
+	start = hostNowNsec ();
+	for (int round = 0; round < rounds; round++)
+	{
+		out->write_mono (in.data (), BLOCK_FRAMES );
+	}
+	double newRate = samples * 1000.0 / (double) (hostNowNsec () - start);
+	CHECK_EQ(hostI2SDmaCopied (port ), 0u);
+	CHECK_EQ(hostI2SDmaInPlace (port ), (uint64_t) rounds * bytes);
+	hostI2SCapture (port, true );
+	printf ("%-28s %8.0f %8.0f  (x%.1f)\n", name, oldRate, newRate, newRate / oldRate );
+}
+
+
+int main(int argc, char **argv)
+{
+	int rounds = (argc > 1) ? atoi (argv[1] ) : 100000;
+
+	esp_log_level_set ("*", ESP_LOG_WARN );
+	DACOutput dac;
+	dac.start (44100, 1 );
+	I2SOutput i2sMono(I2S_NUM_1, pins);
+	i2sMono.start (44100, 1 );
+
+	checkGains (&dac, true );
+	checkGains (&i2sMono, false );
+
+	printf ("Msamples/sec                     old      new\n" );
+	timeIt ("DAC, mono in", &dac, 1, rounds );
+	timeIt ("DAC, stereo in", &dac, 2, rounds );
+	timeIt ("I2S mono, mono in", &i2sMono, 1, rounds );
+	I2SOutput i2sStereo(I2S_NUM_1, pins);
+	i2sMono.stop ();
+	i2sStereo.start (44100, 2 );
+	timeIt ("I2S stereo, stereo in", &i2sStereo, 2, rounds );
+	i2sStereo.stop ();
+
+	printf ("write, Msamples/sec          copied  in place\n" );
+	timeWrite ("DAC, mono in", &dac, I2S_NUM_0, rounds );
+	i2sMono.start (44100, 1 );
+	timeWrite ("I2S mono, mono in", &i2sMono, I2S_NUM_1, rounds );
+	i2sMono.stop ();
+
+	dac.stop ();
+	return (hostTestResult ("output_convert_bench" ));
+}
@@ -0,0 +1,91 @@
+/**
+ * ResamplerBench.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ * What each ResampleQuality costs - nsec per output frame, and msec of CPU
+ * for each second of sound at the output rate, for mono and stereo, from
+ * the rates clips usually are to 44100 Hz. The input is pushed a decoded
+ * frame at a time, and pulled RESAMPLE_BLOCK frames at a time, as the
+ * player does (best of 'rounds').
+ *
+ *     resampler_bench [rounds]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "audio/Resampler.h"
+#include "HostTest.h"
+
+#define OUT_RATE 44100
+// One second of input a round
+#define FRAME 1152
+
+static const char *names[] = { "FAST", "BALANCED", "BEST" };
+static const int inRates[] = { 8000, 22050, 48000 };
+
+static Resampler resampler;
+static std::vector<int16_t> input (FRAME * 2);
+
+
+// @return the best nsec for a second of input - and how many frames it made
+static double timeIt(int quality, int inRate, int channels, int rounds, long *made)
+{
+	resampler.configure (inRate, OUT_RATE, channels, (ResampleQuality) quality );
+	double best = 0;
+	for (int round = 0; round < rounds; round++)
+	{
+		resampler.reset ();
+		long count = 0;
+		int64_t start = hostNowNsec ();
+		for (int done = 0; done < inRate; done += FRAME)
+		{
+			int frames = (inRate - done < FRAME) ? (inRate - done) : FRAME;
+			resampler.push (input.data (), frames );
+			const int16_t *block;
+			int got;
+			while ((got = resampler.pull (&block )) > 0)
+			{
+				count += got;
+				hostKeep (block[0] );
+			}
+		}
+		double nsec = (double) (hostNowNsec () - start);
+		if ((round == 0) || (nsec < best)) best = nsec;
+		*made = count;
+	}
+	return (best);
+}
+
+
+int main(int argc, char **argv)
+{
+	int rounds = (argc > 1) ? atoi (argv[1] ) : 20;
+	esp_log_level_set ("*", ESP_LOG_WARN );
+	uint32_t seed = 7;
+	for (int16_t &sample : input)
+	{
+		seed = seed * 1103515245 + 12345;
+		sample = (int16_t) (seed >> 16);
+	}
+
+	printf ("resampler_bench: to %d Hz   nsec/frame  CPU msec/sec\n", OUT_RATE );
+	for (int quality = RESAMPLE_FAST; quality <= RESAMPLE_BEST; quality++)
+	{
+		for (int channels = 1; channels <= 2; channels++)
+		{
+			for (int inRate : inRates)
+			{
+				long made = 0;
+				double nsec = timeIt (quality, inRate, channels, rounds, &made );
+				// (all but the last few - up to RESAMPLE_MAX_TAPS / 2 input frames are held back)
+				CHECK((made <= OUT_RATE) && (made > OUT_RATE - (RESAMPLE_MAX_TAPS / 2) * OUT_RATE / inRate - 1));
+				printf ("  %-8s %-6s %5d  %10.2f %12.3f\n", names[quality], (channels == 1) ? "mono" : "stereo",
+						inRate, nsec / made, nsec / 1e6 * OUT_RATE / made );
+			}
+		}
+	}
+	return (hostTestResult ("resampler_bench" ));
+}
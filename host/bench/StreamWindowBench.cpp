@@ -0,0 +1,259 @@
+/**
+ * StreamWindowBench.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ * Feeding minimp3 from a StreamWindow against the way it used to be fed -
+ * file blocks copied into a 1 KB buffer, and the rest of the buffer moved
+ * down (memmove) after every frame. The file is read into memory first, and
+ * 'fread' is a memcpy from there, so only the buffering differs.
+ *
+ * Both must decode the file to exactly the same samples. Then each is
+ * timed decoding the whole file, and again just moving the bytes about
+ * (the frame sizes from the first decode, no decoding) - that is the part
+ * the window saves.
+ *
+ *     stream_window_bench file.mp3 [rounds]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "config.h"
+#include "audio/minimp3.h"
+#include "audio/StreamWindow.h"
+#include "HostTest.h"
+
+// What the decoder used to copy the file into
+#define OLD_BUFFER_SIZE 1024
+
+typedef StreamWindow<AUDIO_READ_WINDOW_SIZE, AUDIO_WINDOW_GUARD> Window;
+
+static std::vector<uint8_t> file;
+static std::vector<int> frameSizes;
+static uint64_t copiedBytes;    // Moved about, beyond the 'fread'
+
+
+/**
+ * Decode with minimp3 - and keep count of the samples, and a hash of them.
+ * Replays the frame sizes instead if 'replay' is set.
+ */
+class Decode
+{
+public:
+	Decode (bool _replay) : replay(_replay)
+	{
+		mp3dec_init (&mp3d );
+	}
+
+	// @return the bytes used - zero if there isn't a whole frame
+	int frame(const uint8_t *in, int len)
+	{
+		if (replay)
+		{
+			if ((next >= frameSizes.size ()) || (len < frameSizes[next])) return (0);
+			hostKeep (in[0] );
+			return (frameSizes[next++]);
+		}
+		mp3dec_frame_info_t info = { };
+		int count = mp3dec_decode_frame (&mp3d, in, len, pcm, &info );
+		if (count > 0)
+		{
+			for (int idx = 0; idx < count * info.channels; idx++)
+			{
+				hash = (hash ^ (uint16_t) pcm[idx]) * 16777619u;
+			}
+			samples += count;
+		}
+		return (info.frame_bytes);
+	}
+
+	bool replay;
+	size_t next = 0;
+	mp3dec_t mp3d;
+	int16_t pcm[MINIMP3_MAX_SAMPLES_PER_FRAME];
+	uint32_t samples = 0;
+	uint32_t hash = 2166136261u;
+};
+
+
+// 'fread' from the file in memory
+static size_t readFile(size_t *pos, uint8_t *dest, size_t len)
+{
+	if (len > file.size () - *pos) len = file.size () - *pos;
+	memcpy (dest, &file[*pos], len );
+	*pos += len;
+	return (len);
+}
+
+
+/**
+ * The old way: a block at a time from the file, copied into the buffer as
+ * there is room, and whatever is left after a frame moved to the front.
+ */
+static void runOld(Decode *decode)
+{
+	static uint8_t chunk[AUDIO_READ_CHUNK_SIZE];
+	static uint8_t input[OLD_BUFFER_SIZE];
+	size_t filePos = 0;
+	size_t chunkLen = 0;
+	size_t chunkPos = 0;
+	int buffered = 0;
+	bool eof = false;
+
+	while (true)
+	{
+		// top up the buffer from the file
+		while (!eof && (buffered < OLD_BUFFER_SIZE))
+		{
+			if (chunkPos == chunkLen)
+			{
+				chunkLen = readFile (&filePos, chunk, AUDIO_READ_CHUNK_SIZE );
+				chunkPos = 0;
+				if (chunkLen == 0)
+				{
+					eof = true;
+					break;
+				}
+			}
+			size_t count = chunkLen - chunkPos;
+			if (count > (size_t) (OLD_BUFFER_SIZE - buffered)) count = OLD_BUFFER_SIZE - buffered;
+			memcpy (input + buffered, chunk + chunkPos, count );
+			copiedBytes += count;
+			buffered += count;
+			chunkPos += count;
+		}
+		if (buffered == 0) break;
+
+		int used = decode->frame (input, buffered );
+		if (used == 0)
+		{	// Not enough data for a frame - if there won't be any more, we're done.
+			if (eof || (buffered == OLD_BUFFER_SIZE)) break;
+			continue;
+		}
+		buffered -= used;
+		memmove (input, input + used, buffered );
+		copiedBytes += buffered;
+	}
+}
+
+
+/**
+ * The window: blocks straight from the file into the window, and the
+ * decoder reads them where they are.
+ */
+static void runWindow(Window *window, Decode *decode)
+{
+	size_t filePos = 0;
+	bool readerDone = false;
+	window->reset ();
+
+	while (true)
+	{
+		// (the reader - as much as there is room for)
+		size_t space;
+		uint8_t *dest;
+		while (!readerDone && ((dest = window->writePtr (&space )), space >= AUDIO_READ_CHUNK_SIZE))
+		{
+			uint32_t pos = (uint32_t) (filePos % AUDIO_READ_WINDOW_SIZE);
+			size_t len = readFile (&filePos, dest, AUDIO_READ_CHUNK_SIZE );
+			if (pos < AUDIO_WINDOW_GUARD)
+			{	// (what commitWrite copies to the guard area)
+				copiedBytes += ((AUDIO_WINDOW_GUARD - pos) < len) ? (AUDIO_WINDOW_GUARD - pos) : len;
+			}
+			window->commitWrite (len );
+			if (len < AUDIO_READ_CHUNK_SIZE)
+			{
+				window->setEof ();
+				readerDone = true;
+			}
+		}
+
+		bool eof = window->eofSeen ();
+		size_t buffered;
+		const uint8_t *input = window->readPtr (&buffered );
+		if ((buffered == 0) || (!eof && (buffered < AUDIO_WINDOW_GUARD))) break;
+		int used = decode->frame (input, (int) buffered );
+		if (used == 0) break;
+		window->consume (used );
+	}
+}
+
+
+template<typename RUN>
+static double timeIt(int rounds, bool replay, RUN run)
+{
+	int64_t start = hostNowNsec ();
+	for (int round = 0; round < rounds; round++)
+	{
+		Decode decode(replay);
+		run (&decode );
+		hostKeep (decode.hash );
+	}
+	return ((double) (hostNowNsec () - start) / ((double) rounds * frameSizes.size ()));
+}
+
+
+int main(int argc, char **argv)
+{
+	if (argc < 2)
+	{
+		printf ("usage: stream_window_bench file.mp3 [rounds]\n" );
+		return (2);
+	}
+	int rounds = (argc > 2) ? atoi (argv[2] ) : 20;
+	FILE *fp = fopen (argv[1], "rb" );
+	CHECK(fp != nullptr);
+	if (fp == nullptr) return (hostTestResult ("stream_window_bench" ));
+	uint8_t block[4096];
+	size_t len;
+	while ((len = fread (block, 1, sizeof(block), fp )) > 0)
+	{
+		file.insert (file.end (), block, block + len );
+	}
+	fclose (fp );
+
+	// The frame sizes - from a plain decode of the whole file
+	{
+		mp3dec_t mp3d;
+		mp3dec_init (&mp3d );
+		static int16_t pcm[MINIMP3_MAX_SAMPLES_PER_FRAME];
+		mp3dec_frame_info_t info;
+		size_t pos = 0;
+		while ((pos < file.size ()) && (mp3dec_decode_frame (&mp3d, &file[pos], file.size () - pos, pcm, &info ),
+				info.frame_bytes > 0))
+		{
+			frameSizes.push_back (info.frame_bytes );
+			pos += info.frame_bytes;
+		}
+	}
+
+	Window *window = new Window();
+	Decode before(false);
+	Decode after(false);
+	copiedBytes = 0;
+	runOld (&before );
+	uint64_t oldCopied = copiedBytes;
+	copiedBytes = 0;
+	runWindow (window, &after );
+	uint64_t newCopied = copiedBytes;
+	printf ("%s: %u bytes, %u frames, %u samples\n", argv[1], (unsigned) file.size (),
+			(unsigned) frameSizes.size (), after.samples );
+	CHECK(after.samples > 0);
+	CHECK_EQ(after.samples, before.samples);
+	CHECK_EQ(after.hash, before.hash);
+	printf ("bytes copied besides the reads: memmove %llu, window %llu\n",
+			(unsigned long long) oldCopied, (unsigned long long) newCopied );
+
+	double oldDecode = timeIt (rounds, false, [] (Decode *decode) { runOld (decode ); } );
+	double newDecode = timeIt (rounds, false, [window] (Decode *decode) { runWindow (window, decode ); } );
+	double oldFeed = timeIt (rounds, true, [] (Decode *decode) { runOld (decode ); } );
+	double newFeed = timeIt (rounds, true, [window] (Decode *decode) { runWindow (window, decode ); } );
+	printf ("nsec per frame          memmove   window\n" );
+	printf ("  decoding             %8.0f %8.0f\n", oldDecode, newDecode );
+	printf ("  buffering only       %8.0f %8.0f\n", oldFeed, newFeed );
+	delete window;
+	return (hostTestResult ("stream_window_bench" ));
+}
@@ -0,0 +1,40 @@
+/**
+ * SwitchBoardThroughput.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ * Messages/second and send-to-callBack latency through the SwitchBoard,
+ * for 1, 2 and 4 producers (the same run as the 'bench' command on the
+ * board - see Sequencer/SwitchBoardBench.h).
+ *
+ *     switchboard_bench [messages per producer]
+ *
+ * Fails if any message is lost.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "Sequencer/SwitchBoard.h"
+#include "Sequencer/SwitchBoardBench.h"
+#include "HostTest.h"
+
+int main(int argc, char **argv)
+{
+	int perProducer = (argc > 1) ? atoi (argv[1] ) : 1000;
+	static const int producerCounts[] = { 1, 2, 4 };
+
+	esp_log_level_set ("*", ESP_LOG_WARN );
+	hostStartSwitchBoard ();
+
+	printf ("producers  messages   msgs/sec  p50 usec  p99 usec  max usec  dropped\n" );
+	for (int producers : producerCounts)
+	{
+		BenchResult result;
+		CHECK(SwitchBoardBench::run (producers, perProducer, &result ));
+		printf ("%9d  %8u  %9u  %8u  %8u  %8u  %7u\n", producers, result.sent, result.msgsPerSec,
+				result.p50Usec, result.p99Usec, result.maxUsec, result.dropped );
+		CHECK_EQ(result.received, result.sent);
+	}
+	return (hostTestResult ("switchboard_bench" ));
+}
@@ -0,0 +1,193 @@
+/**
+ * EspShim.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ * esp_log and esp_timer for the host.
+ *
+ * The timers are run by one task (started by the first esp_timer_create),
+ * which sleeps until the earliest one is due - the same as ESP_TIMER_TASK
+ * dispatch on the board.
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+struct esp_timer
+{
+	esp_timer_cb_t callback;
+	void *arg;
+	const char *name;
+	bool active;
+	int64_t dueUsec;
+	uint64_t periodUsec;    // zero - one shot
+};
+
+static const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+static volatile esp_log_level_t logLevel = ESP_LOG_INFO;
+static std::mutex logLock;
+
+// (never destroyed - the timer task is still waiting on them when main returns)
+static std::mutex &timerLock = *new std::mutex();
+static std::condition_variable &timerWake = *new std::condition_variable();
+static std::vector<esp_timer *> &timers = *new std::vector<esp_timer *>();
+static TaskHandle_t timerTask = nullptr;
+
+
+/* = = = = = = = = = = LOG = = = = = = = = = = */
+
+void esp_log_level_set(const char *tag, esp_log_level_t level)
+{
+	logLevel = level;
+}
+
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...)
+{
+	static const char letters[] = "NEWIDV";
+	if (level > logLevel) return;
+
+	va_list args;
+	va_start (args, format );
+	std::lock_guard<std::mutex> held (logLock );
+	printf ("%c (%u) %s ", letters[level], (unsigned) (esp_timer_get_time () / 1000), tag );
+	vprintf (format, args );
+	printf ("\n" );
+	va_end (args );
+}
+
+
+/* = = = = = = = = = = TIMER = = = = = = = = = = */
+
+int64_t esp_timer_get_time()
+{
+	return (std::chrono::duration_cast<std::chrono::microseconds> (
+			std::chrono::steady_clock::now () - startTime ).count ());
+}
+
+
+static void runTimers(void *arg)
+{
+	std::unique_lock<std::mutex> held (timerLock );
+	while (true)
+	{
+		esp_timer *next = nullptr;
+		for (esp_timer *timer : timers)
+		{
+			if (timer->active && ((next == nullptr) || (timer->dueUsec < next->dueUsec))) next = timer;
+		}
+		if (next == nullptr)
+		{
+			timerWake.wait (held );
+			continue;
+		}
+		int64_t wait = next->dueUsec - esp_timer_get_time ();
+		if (wait > 0)
+		{
+			timerWake.wait_for (held, std::chrono::microseconds (wait ) );
+			continue;   // (it may have been stopped, or an earlier one started)
+		}
+
+		if (next->periodUsec != 0) next->dueUsec += next->periodUsec;
+		else next->active = false;
+		held.unlock ();
+		next->callback (next->arg );
+		held.lock ();
+	}
+}
+
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *handle)
+{
+	if ((args == nullptr) || (args->callback == nullptr) || (handle == nullptr))
+	{
+		return (ESP_ERR_INVALID_ARG);
+	}
+	esp_timer *timer = new esp_timer();
+	timer->callback = args->callback;
+	timer->arg = args->arg;
+	timer->name = args->name;
+	timer->active = false;
+	timer->dueUsec = 0;
+	timer->periodUsec = 0;
+
+	std::lock_guard<std::mutex> held (timerLock );
+	timers.push_back (timer );
+	if (timerTask == nullptr)
+	{
+		xTaskCreate (&runTimers, "esp_timer", 4096, nullptr, 22, &timerTask );
+	}
+	*handle = timer;
+	return (ESP_OK);
+}
+
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+	std::lock_guard<std::mutex> held (timerLock );
+	if (timer->active) return (ESP_ERR_INVALID_STATE);
+	for (size_t idx = 0; idx < timers.size (); idx++ )
+	{
+		if (timers[idx] == timer)
+		{
+			timers.erase (timers.begin () + idx );
+			break;
+		}
+	}
+	delete timer;
+	return (ESP_OK);
+}
+
+
+static esp_err_t startTimer(esp_timer_handle_t timer, uint64_t usec, uint64_t period)
+{
+	{
+		std::lock_guard<std::mutex> held (timerLock );
+		if (timer->active) return (ESP_ERR_INVALID_STATE);
+		timer->active = true;
+		timer->dueUsec = esp_timer_get_time () + (int64_t) usec;
+		timer->periodUsec = period;
+	}
+	timerWake.notify_all ();
+	return (ESP_OK);
+}
+
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeoutUsec)
+{
+	return (startTimer (timer, timeoutUsec, 0 ));
+}
+
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t periodUsec)
+{
+	return (startTimer (timer, periodUsec, periodUsec ));
+}
+
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+	{
+		std::lock_guard<std::mutex> held (timerLock );
+		if (!timer->active) return (ESP_ERR_INVALID_STATE);
+		timer->active = false;
+	}
+	timerWake.notify_all ();
+	return (ESP_OK);
+}
+
+
+bool esp_timer_is_active(esp_timer_handle_t timer)
+{
+	std::lock_guard<std::mutex> held (timerLock );
+	return (timer->active);
+}
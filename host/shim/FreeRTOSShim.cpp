@@ -0,0 +1,426 @@
+/**
+ * FreeRTOSShim.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ * FreeRTOS tasks, notifications, semaphores and queues on pthreads.
+ *
+ * A task's handle lives for the rest of the program (so a late
+ * xTaskNotifyGive to a task that has gone is harmless, not a crash).
+ */
+
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+
+static const char *TAG = "SHIM:";
+
+struct HostTask
+{
+	std::string name;
+	UBaseType_t priority;
+	BaseType_t core;
+	TaskFunction_t code;
+	void *parameters;
+
+	std::mutex lock;
+	std::condition_variable wake;
+	uint32_t notifyValue;
+	bool notified;
+};
+
+struct HostSemaphore
+{
+	std::mutex lock;
+	std::condition_variable wake;
+	UBaseType_t count;
+	UBaseType_t maxCount;
+};
+
+struct HostQueue
+{
+	std::mutex lock;
+	std::condition_variable wake;
+	std::deque<std::vector<uint8_t>> items;
+	UBaseType_t length;
+	UBaseType_t itemSize;
+};
+
+static thread_local HostTask *currentTask = nullptr;
+static std::recursive_mutex criticalLock;
+static const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+
+/**
+ * Wait on 'wake' until 'ready' is true, or for 'ticks' (one per msec).
+ * @return the last value of 'ready'
+ */
+template<typename Ready>
+static bool waitFor(std::condition_variable &wake, std::unique_lock<std::mutex> &held,
+		TickType_t ticks, Ready ready)
+{
+	if (ticks == portMAX_DELAY)
+	{
+		wake.wait (held, ready );
+		return (true);
+	}
+	return (wake.wait_for (held, std::chrono::milliseconds (ticks ), ready ));
+}
+
+
+/* = = = = = = = = = = TASKS = = = = = = = = = = */
+
+static void *taskEntry(void *arg)
+{
+	HostTask *task = (HostTask *) arg;
+	currentTask = task;
+	task->code (task->parameters );
+	// (a FreeRTOS task must not return - it deletes itself)
+	ESP_LOGE(TAG, "Task '%s' returned", task->name.c_str () );
+	abort ();
+	return (nullptr);
+}
+
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t code, const char *name, uint32_t stackDepth,
+		void *parameters, UBaseType_t priority, TaskHandle_t *created, BaseType_t core)
+{
+	HostTask *task = new HostTask();
+	task->name = (name != nullptr) ? name : "";
+	task->priority = priority;
+	task->core = core;
+	task->code = code;
+	task->parameters = parameters;
+	task->notifyValue = 0;
+	task->notified = false;
+	// (before it runs - the new task may well use it)
+	if (created != nullptr) *created = task;
+
+	pthread_attr_t attr;
+	pthread_attr_init (&attr );
+	pthread_attr_setdetachstate (&attr, PTHREAD_CREATE_DETACHED );
+	// The ESP32 stack sizes are far too small for host code (and glibc)
+	size_t stack = (stackDepth < 65536) ? 256 * 1024 : stackDepth * 4;
+	pthread_attr_setstacksize (&attr, stack );
+	pthread_t thread;
+	int rc = pthread_create (&thread, &attr, &taskEntry, task );
+	pthread_attr_destroy (&attr );
+	if (rc != 0)
+	{
+		ESP_LOGE(TAG, "Can't start task '%s' (%s)", task->name.c_str (), strerror (rc ) );
+		if (created != nullptr) *created = nullptr;
+		delete task;
+		return (pdFAIL);
+	}
+	return (pdPASS);
+}
+
+
+BaseType_t xTaskCreate(TaskFunction_t code, const char *name, uint32_t stackDepth,
+		void *parameters, UBaseType_t priority, TaskHandle_t *created)
+{
+	return (xTaskCreatePinnedToCore (code, name, stackDepth, parameters, priority, created,
+			tskNO_AFFINITY ));
+}
+
+
+void vTaskDelete(TaskHandle_t task)
+{
+	if ((task != nullptr) && (task != currentTask))
+	{
+		ESP_LOGE(TAG, "vTaskDelete of another task ('%s') isn't supported on the host",
+				task->name.c_str () );
+		abort ();
+	}
+	pthread_exit (nullptr );
+}
+
+
+void vTaskDelay(TickType_t ticks)
+{
+	struct timespec delay;
+	delay.tv_sec = ticks / 1000;
+	delay.tv_nsec = (long) (ticks % 1000) * 1000000L;
+	// (a zero delay still gives the others a turn)
+	if (ticks == 0) sched_yield ();
+	else nanosleep (&delay, nullptr );
+}
+
+
+TaskHandle_t xTaskGetCurrentTaskHandle()
+{
+	if (currentTask == nullptr)
+	{	// A thread we didn't start (main) - give it a handle the first time
+		currentTask = new HostTask();
+		currentTask->name = "main";
+		currentTask->priority = 1;
+		currentTask->core = 0;
+		currentTask->code = nullptr;
+		currentTask->parameters = nullptr;
+		currentTask->notifyValue = 0;
+		currentTask->notified = false;
+	}
+	return (currentTask);
+}
+
+
+TickType_t xTaskGetTickCount()
+{
+	return ((TickType_t) std::chrono::duration_cast<std::chrono::milliseconds> (
+			std::chrono::steady_clock::now () - startTime ).count ());
+}
+
+
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task)
+{
+	if (task == nullptr) task = xTaskGetCurrentTaskHandle ();
+	return (task->priority);
+}
+
+
+BaseType_t xPortGetCoreID()
+{
+	TaskHandle_t task = xTaskGetCurrentTaskHandle ();
+	return ((task->core == tskNO_AFFINITY) ? 0 : task->core);
+}
+
+
+/* = = = = = = = = = = NOTIFICATIONS = = = = = = = = = = */
+
+uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticksToWait)
+{
+	HostTask *task = xTaskGetCurrentTaskHandle ();
+	std::unique_lock<std::mutex> held (task->lock );
+	waitFor (task->wake, held, ticksToWait, [task] { return (task->notifyValue != 0); } );
+	uint32_t value = task->notifyValue;
+	if (value != 0)
+	{
+		task->notifyValue = (clearCountOnExit == pdTRUE) ? 0 : value - 1;
+	}
+	task->notified = false;
+	return (value);
+}
+
+
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action)
+{
+	BaseType_t result = pdPASS;
+	{
+		std::lock_guard<std::mutex> held (task->lock );
+		switch (action)
+		{
+			case eSetBits:
+				task->notifyValue |= value;
+				break;
+			case eIncrement:
+				task->notifyValue++;
+				break;
+			case eSetValueWithOverwrite:
+				task->notifyValue = value;
+				break;
+			case eSetValueWithoutOverwrite:
+				if (task->notified) result = pdFAIL;
+				else task->notifyValue = value;
+				break;
+			case eNoAction:
+				break;
+		}
+		task->notified = true;
+	}
+	task->wake.notify_all ();
+	return (result);
+}
+
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+	return (xTaskNotify (task, 0, eIncrement ));
+}
+
+
+BaseType_t xTaskNotifyWait(uint32_t clearOnEntry, uint32_t clearOnExit, uint32_t *value,
+		TickType_t ticksToWait)
+{
+	HostTask *task = xTaskGetCurrentTaskHandle ();
+	std::unique_lock<std::mutex> held (task->lock );
+	if (!task->notified) task->notifyValue &= ~clearOnEntry;
+	bool got = waitFor (task->wake, held, ticksToWait, [task] { return (task->notified); } );
+	if (value != nullptr) *value = task->notifyValue;
+	if (got) task->notifyValue &= ~clearOnExit;
+	task->notified = false;
+	return (got ? pdTRUE : pdFALSE);
+}
+
+
+BaseType_t xTaskNotifyFromISR(TaskHandle_t task, uint32_t value, eNotifyAction action,
+		BaseType_t *woken)
+{
+	if (woken != nullptr) *woken = pdFALSE;
+	return (xTaskNotify (task, value, action ));
+}
+
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken)
+{
+	if (woken != nullptr) *woken = pdFALSE;
+	xTaskNotifyGive (task );
+}
+
+
+void hostEnterCritical()
+{
+	criticalLock.lock ();
+}
+
+
+void hostExitCritical()
+{
+	criticalLock.unlock ();
+}
+
+
+/* = = = = = = = = = = SEMAPHORES = = = = = = = = = = */
+
+static SemaphoreHandle_t createSemaphore(UBaseType_t maxCount, UBaseType_t initialCount)
+{
+	HostSemaphore *semaphore = new HostSemaphore();
+	semaphore->maxCount = maxCount;
+	semaphore->count = initialCount;
+	return (semaphore);
+}
+
+
+SemaphoreHandle_t xSemaphoreCreateBinary()
+{
+	return (createSemaphore (1, 0 ));
+}
+
+
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t *buffer)
+{
+	return (createSemaphore (1, 0 ));
+}
+
+
+SemaphoreHandle_t xSemaphoreCreateMutex()
+{
+	return (createSemaphore (1, 1 ));
+}
+
+
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *buffer)
+{
+	return (createSemaphore (1, 1 ));
+}
+
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maxCount, UBaseType_t initialCount)
+{
+	return (createSemaphore (maxCount, initialCount ));
+}
+
+
+SemaphoreHandle_t xSemaphoreCreateCountingStatic(UBaseType_t maxCount, UBaseType_t initialCount,
+		StaticSemaphore_t *buffer)
+{
+	return (createSemaphore (maxCount, initialCount ));
+}
+
+
+void vSemaphoreDelete(SemaphoreHandle_t semaphore)
+{
+	delete semaphore;
+}
+
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticksToWait)
+{
+	std::unique_lock<std::mutex> held (semaphore->lock );
+	if (!waitFor (semaphore->wake, held, ticksToWait, [semaphore] { return (semaphore->count > 0); } ))
+	{
+		return (pdFALSE);
+	}
+	semaphore->count--;
+	return (pdTRUE);
+}
+
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore)
+{
+	{
+		std::lock_guard<std::mutex> held (semaphore->lock );
+		if (semaphore->count >= semaphore->maxCount) return (pdFALSE);
+		semaphore->count++;
+	}
+	semaphore->wake.notify_one ();
+	return (pdTRUE);
+}
+
+
+/* = = = = = = = = = = QUEUES = = = = = = = = = = */
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize)
+{
+	HostQueue *queue = new HostQueue();
+	queue->length = length;
+	queue->itemSize = itemSize;
+	return (queue);
+}
+
+
+void vQueueDelete(QueueHandle_t queue)
+{
+	delete queue;
+}
+
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticksToWait)
+{
+	{
+		std::unique_lock<std::mutex> held (queue->lock );
+		if (!waitFor (queue->wake, held, ticksToWait,
+				[queue] { return (queue->items.size () < queue->length); } ))
+		{
+			return (pdFALSE);
+		}
+		const uint8_t *bytes = (const uint8_t *) item;
+		queue->items.emplace_back (bytes, bytes + queue->itemSize );
+	}
+	queue->wake.notify_all ();
+	return (pdTRUE);
+}
+
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticksToWait)
+{
+	{
+		std::unique_lock<std::mutex> held (queue->lock );
+		if (!waitFor (queue->wake, held, ticksToWait, [queue] { return (!queue->items.empty ()); } ))
+		{
+			return (pdFALSE);
+		}
+		memcpy (item, queue->items.front ().data (), queue->itemSize );
+		queue->items.pop_front ();
+	}
+	queue->wake.notify_all ();
+	return (pdTRUE);
+}
+
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue)
+{
+	std::lock_guard<std::mutex> held (queue->lock );
+	return ((UBaseType_t) queue->items.size ());
+}
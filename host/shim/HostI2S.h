@@ -0,0 +1,42 @@
+/**
+ * HostI2S.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ * Host only - what the code under test wrote to an I2S port.
+ *
+ * Everything put in the DMA buffers (by i2s_write, or leased and committed -
+ * see I2SDma.h) is kept, in order, until the port is uninstalled or cleared -
+ * turn that off with 'hostI2SCapture' for long benchmarks; the counts are
+ * always kept.
+ *
+ * A sample put in the DMA buffers has been touched once there: copied in by
+ * i2s_write, or made where it was leased. Together the two counts are every
+ * byte that reached the DMA buffers - neither counts a staging buffer.
+ */
+
+#ifndef HOST_SHIM_HOSTI2S_H_
+#define HOST_SHIM_HOSTI2S_H_
+
+#include <stdint.h>
+#include <vector>
+#include "driver/i2s.h"
+
+// The bytes written since the port was installed (or cleared)
+const std::vector<uint8_t> &hostI2SWritten(i2s_port_t port);
+// How many times i2s_write was called, and how many bytes it was given
+uint32_t hostI2SWriteCalls(i2s_port_t port);
+uint64_t hostI2SWriteBytes(i2s_port_t port);
+// What the port was installed with (zero if it isn't)
+// Bytes i2s_write copied into the DMA buffers, and bytes committed where
+// they were leased
+uint64_t hostI2SDmaCopied(i2s_port_t port);
+uint64_t hostI2SDmaInPlace(i2s_port_t port);
+// Is 'buf' in the port's DMA buffers?
+bool hostI2SDmaOwns(i2s_port_t port, const void *buf);
+const i2s_config_t &hostI2SConfig(i2s_port_t port);
+void hostI2SClear(i2s_port_t port);
+void hostI2SCapture(i2s_port_t port, bool keep);
+
+#endif /* HOST_SHIM_HOSTI2S_H_ */
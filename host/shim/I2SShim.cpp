@@ -0,0 +1,283 @@
+/**
+ * I2SShim.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ * The I2S driver, with nothing on the end of it (see HostI2S.h).
+ *
+ * Each port has a ring of DMA buffers, made as the real driver makes them
+ * (dma_buf_count buffers of dma_buf_len frames). i2s_write copies into the
+ * one being filled, and i2s_dma_lease hands out the rest of it (see
+ * I2SDma.h). The DMA plays a buffer as soon as it is full - it never
+ * waits - so what goes in the ring is kept (as it was put there) instead.
+ */
+
+#include <string.h>
+#include <algorithm>
+#include <mutex>
+#include <vector>
+#include "driver/i2s.h"
+#include "audio/I2SDma.h"
+#include "HostI2S.h"
+
+struct HostI2SPort
+{
+	bool installed;
+	bool started;
+	bool capture;
+	i2s_config_t config;
+	std::vector<uint8_t> written;
+	uint32_t writeCalls;
+	uint64_t writeBytes;
+
+	std::vector<uint8_t> dma;  // The DMA buffers, one after another
+	size_t bufBytes;
+	size_t filling;            // Where the next byte goes in 'dma'
+	size_t leased;             // Bytes leased at 'filling' (0 - none)
+	uint64_t dmaCopied;
+	uint64_t dmaInPlace;
+};
+
+static std::mutex portLock;
+static HostI2SPort ports[I2S_NUM_MAX] = { };
+
+
+static bool valid(i2s_port_t port)
+{
+	return ((port >= I2S_NUM_0) && (port < I2S_NUM_MAX));
+}
+
+
+// Bytes left in the DMA buffer being filled - moving on to the next one if
+// it is full (the last one has been played)
+static size_t dmaRoom(HostI2SPort *dest)
+{
+	if ((dest->filling % dest->bufBytes) == 0) dest->filling %= dest->dma.size ();
+	return (dest->bufBytes - (dest->filling % dest->bufBytes));
+}
+
+
+// 'len' bytes have been put in the DMA buffer at 'filling'
+static void dmaFilled(HostI2SPort *dest, size_t len)
+{
+	if (dest->capture)
+	{
+		const uint8_t *bytes = &dest->dma[dest->filling];
+		dest->written.insert (dest->written.end (), bytes, bytes + len );
+	}
+	dest->filling += len;
+}
+
+
+esp_err_t i2s_driver_install(i2s_port_t port, const i2s_config_t *config, int queueSize, void *queue)
+{
+	if (!valid (port ) || (config == nullptr)) return (ESP_ERR_INVALID_ARG);
+	std::lock_guard<std::mutex> held (portLock );
+	if (ports[port].installed) return (ESP_FAIL);
+	ports[port].installed = true;
+	ports[port].started = true;     // (as the real driver does)
+	ports[port].capture = true;
+	ports[port].config = *config;
+	ports[port].written.clear ();
+	ports[port].writeCalls = 0;
+	ports[port].writeBytes = 0;
+
+	// (as the real driver works out the size of a frame)
+	int channels = ((config->channel_format == I2S_CHANNEL_FMT_RIGHT_LEFT)
+			|| (config->channel_format == I2S_CHANNEL_FMT_ALL_RIGHT)
+			|| (config->channel_format == I2S_CHANNEL_FMT_ALL_LEFT)) ? 2 : 1;
+	int count = (config->dma_buf_count > 0) ? config->dma_buf_count : 2;
+	int len = (config->dma_buf_len > 0) ? config->dma_buf_len : 64;
+	ports[port].bufBytes = (size_t) len * channels * (config->bits_per_sample / 8);
+	ports[port].dma.assign (ports[port].bufBytes * count, 0 );
+	ports[port].filling = 0;
+	ports[port].leased = 0;
+	ports[port].dmaCopied = 0;
+	ports[port].dmaInPlace = 0;
+	return (ESP_OK);
+}
+
+
+esp_err_t i2s_driver_uninstall(i2s_port_t port)
+{
+	if (!valid (port )) return (ESP_ERR_INVALID_ARG);
+	std::lock_guard<std::mutex> held (portLock );
+	if (!ports[port].installed) return (ESP_ERR_INVALID_STATE);
+	ports[port].installed = false;
+	ports[port].started = false;
+	memset (&ports[port].config, 0, sizeof(i2s_config_t) );
+	ports[port].written.clear ();
+	ports[port].written.shrink_to_fit ();
+	ports[port].dma.clear ();
+	ports[port].dma.shrink_to_fit ();
+	return (ESP_OK);
+}
+
+
+esp_err_t i2s_set_pin(i2s_port_t port, const i2s_pin_config_t *pins)
+{
+	return (valid (port ) ? ESP_OK : ESP_ERR_INVALID_ARG);
+}
+
+
+esp_err_t i2s_set_dac_mode(i2s_dac_mode_t mode)
+{
+	return (ESP_OK);
+}
+
+
+esp_err_t i2s_set_clk(i2s_port_t port, uint32_t rate, i2s_bits_per_sample_t bits, i2s_channel_t channels)
+{
+	if (!valid (port )) return (ESP_ERR_INVALID_ARG);
+	std::lock_guard<std::mutex> held (portLock );
+	ports[port].config.sample_rate = (int) rate;
+	return (ESP_OK);
+}
+
+
+esp_err_t i2s_zero_dma_buffer(i2s_port_t port)
+{
+	if (!valid (port )) return (ESP_ERR_INVALID_ARG);
+	std::lock_guard<std::mutex> held (portLock );
+	std::fill (ports[port].dma.begin (), ports[port].dma.end (), 0 );
+	return (ESP_OK);
+}
+
+
+esp_err_t i2s_start(i2s_port_t port)
+{
+	if (!valid (port )) return (ESP_ERR_INVALID_ARG);
+	std::lock_guard<std::mutex> held (portLock );
+	if (!ports[port].installed) return (ESP_ERR_INVALID_STATE);
+	ports[port].started = true;
+	return (ESP_OK);
+}
+
+
+esp_err_t i2s_stop(i2s_port_t port)
+{
+	if (!valid (port )) return (ESP_ERR_INVALID_ARG);
+	std::lock_guard<std::mutex> held (portLock );
+	if (!ports[port].installed) return (ESP_ERR_INVALID_STATE);
+	ports[port].started = false;
+	return (ESP_OK);
+}
+
+
+esp_err_t i2s_write(i2s_port_t port, const void *src, size_t size, size_t *bytesWritten,
+		TickType_t ticksToWait)
+{
+	if (bytesWritten != nullptr) *bytesWritten = 0;
+	if (!valid (port ) || (src == nullptr)) return (ESP_ERR_INVALID_ARG);
+	std::lock_guard<std::mutex> held (portLock );
+	HostI2SPort *dest = &ports[port];
+	if (!dest->installed || (dest->leased != 0)) return (ESP_ERR_INVALID_STATE);
+
+	const uint8_t *bytes = (const uint8_t *) src;
+	for (size_t done = 0; done < size;)
+	{
+		size_t len = dmaRoom (dest );
+		if (len > size - done) len = size - done;
+		memcpy (&dest->dma[dest->filling], bytes + done, len );
+		dmaFilled (dest, len );
+		done += len;
+	}
+	dest->dmaCopied += size;
+	dest->writeCalls++;
+	dest->writeBytes += size;
+	if (bytesWritten != nullptr) *bytesWritten = size;
+	return (ESP_OK);
+}
+
+
+int16_t *i2s_dma_lease(i2s_port_t port, size_t bytes, size_t *granted, TickType_t ticks_to_wait)
+{
+	*granted = 0;
+	if (!valid (port )) return (nullptr);
+	std::lock_guard<std::mutex> held (portLock );
+	HostI2SPort *dest = &ports[port];
+	if (!dest->installed) return (nullptr);
+
+	size_t room = dmaRoom (dest );
+	*granted = (bytes < room) ? bytes : room;
+	dest->leased = *granted;
+	return ((int16_t *) &dest->dma[dest->filling]);
+}
+
+
+esp_err_t i2s_dma_commit(i2s_port_t port, size_t bytes)
+{
+	if (!valid (port )) return (ESP_ERR_INVALID_ARG);
+	std::lock_guard<std::mutex> held (portLock );
+	HostI2SPort *dest = &ports[port];
+	if (!dest->installed) return (ESP_ERR_INVALID_STATE);
+	if (bytes > dest->leased) return (ESP_ERR_INVALID_ARG);
+	dest->leased = 0;
+	dmaFilled (dest, bytes );
+	dest->dmaInPlace += bytes;
+	return (ESP_OK);
+}
+
+
+const std::vector<uint8_t> &hostI2SWritten(i2s_port_t port)
+{
+	return (ports[port].written);
+}
+
+
+uint32_t hostI2SWriteCalls(i2s_port_t port)
+{
+	return (ports[port].writeCalls);
+}
+
+
+uint64_t hostI2SWriteBytes(i2s_port_t port)
+{
+	return (ports[port].writeBytes);
+}
+
+
+const i2s_config_t &hostI2SConfig(i2s_port_t port)
+{
+	return (ports[port].config);
+}
+
+
+uint64_t hostI2SDmaCopied(i2s_port_t port)
+{
+	return (ports[port].dmaCopied);
+}
+
+
+uint64_t hostI2SDmaInPlace(i2s_port_t port)
+{
+	return (ports[port].dmaInPlace);
+}
+
+
+bool hostI2SDmaOwns(i2s_port_t port, const void *buf)
+{
+	std::lock_guard<std::mutex> held (portLock );
+	const uint8_t *at = (const uint8_t *) buf;
+	const std::vector<uint8_t> &dma = ports[port].dma;
+	return (!dma.empty () && (at >= dma.data ()) && (at < dma.data () + dma.size ()));
+}
+
+
+void hostI2SClear(i2s_port_t port)
+{
+	std::lock_guard<std::mutex> held (portLock );
+	ports[port].written.clear ();
+	ports[port].writeCalls = 0;
+	ports[port].writeBytes = 0;
+	ports[port].dmaCopied = 0;
+	ports[port].dmaInPlace = 0;
+}
+
+
+void hostI2SCapture(i2s_port_t port, bool keep)
+{
+	std::lock_guard<std::mutex> held (portLock );
+	ports[port].capture = keep;
+}
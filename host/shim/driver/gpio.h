@@ -0,0 +1,30 @@
+/**
+ * gpio.h (host shim)
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ * Only the pin numbers (config.h names them).
+ */
+
+#ifndef HOST_SHIM_GPIO_H_
+#define HOST_SHIM_GPIO_H_
+
+typedef enum
+{
+	GPIO_NUM_NC = -1,
+	GPIO_NUM_0 = 0, GPIO_NUM_1, GPIO_NUM_2, GPIO_NUM_3, GPIO_NUM_4, GPIO_NUM_5, GPIO_NUM_6,
+	GPIO_NUM_7, GPIO_NUM_8, GPIO_NUM_9, GPIO_NUM_10, GPIO_NUM_11, GPIO_NUM_12, GPIO_NUM_13,
+	GPIO_NUM_14, GPIO_NUM_15, GPIO_NUM_16, GPIO_NUM_17, GPIO_NUM_18, GPIO_NUM_19,
+	GPIO_NUM_21 = 21, GPIO_NUM_22, GPIO_NUM_23,
+	GPIO_NUM_25 = 25, GPIO_NUM_26, GPIO_NUM_27,
+	GPIO_NUM_32 = 32, GPIO_NUM_33, GPIO_NUM_34, GPIO_NUM_35, GPIO_NUM_36, GPIO_NUM_37,
+	GPIO_NUM_38, GPIO_NUM_39
+} gpio_num_t;
+
+typedef enum
+{
+	DAC_CHANNEL_1 = 0, DAC_CHANNEL_2
+} dac_channel_t;
+
+#endif /* HOST_SHIM_GPIO_H_ */
@@ -0,0 +1,96 @@
+/**
+ * i2s.h (host shim)
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ * There is no sound - i2s_write never blocks, and what is written can be
+ * looked at (see HostI2S.h).
+ */
+
+#ifndef HOST_SHIM_I2S_H_
+#define HOST_SHIM_I2S_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "driver/gpio.h"
+
+typedef enum
+{
+	I2S_NUM_0 = 0, I2S_NUM_1, I2S_NUM_MAX
+} i2s_port_t;
+
+typedef enum
+{
+	I2S_MODE_MASTER = 1, I2S_MODE_SLAVE = 2, I2S_MODE_TX = 4, I2S_MODE_RX = 8,
+	I2S_MODE_DAC_BUILT_IN = 16, I2S_MODE_ADC_BUILT_IN = 32, I2S_MODE_PDM = 64
+} i2s_mode_t;
+
+typedef enum
+{
+	I2S_BITS_PER_SAMPLE_8BIT = 8, I2S_BITS_PER_SAMPLE_16BIT = 16,
+	I2S_BITS_PER_SAMPLE_24BIT = 24, I2S_BITS_PER_SAMPLE_32BIT = 32
+} i2s_bits_per_sample_t;
+
+typedef enum
+{
+	I2S_CHANNEL_FMT_RIGHT_LEFT = 0, I2S_CHANNEL_FMT_ALL_RIGHT, I2S_CHANNEL_FMT_ALL_LEFT,
+	I2S_CHANNEL_FMT_ONLY_RIGHT, I2S_CHANNEL_FMT_ONLY_LEFT
+} i2s_channel_fmt_t;
+
+typedef enum
+{
+	I2S_COMM_FORMAT_STAND_I2S = 1, I2S_COMM_FORMAT_STAND_MSB = 3
+} i2s_comm_format_t;
+
+typedef enum
+{
+	I2S_DAC_CHANNEL_DISABLE = 0, I2S_DAC_CHANNEL_RIGHT_EN, I2S_DAC_CHANNEL_LEFT_EN,
+	I2S_DAC_CHANNEL_BOTH_EN
+} i2s_dac_mode_t;
+
+typedef enum
+{
+	I2S_CHANNEL_MONO = 1, I2S_CHANNEL_STEREO = 2
+} i2s_channel_t;
+
+#define I2S_PIN_NO_CHANGE (-1)
+
+typedef struct
+{
+	int bck_io_num;
+	int ws_io_num;
+	int data_out_num;
+	int data_in_num;
+} i2s_pin_config_t;
+
+// (the same fields, in the same order, as IDF v4.2)
+typedef struct
+{
+	i2s_mode_t mode;
+	int sample_rate;
+	i2s_bits_per_sample_t bits_per_sample;
+	i2s_channel_fmt_t channel_format;
+	i2s_comm_format_t communication_format;
+	int intr_alloc_flags;
+	int dma_buf_count;
+	int dma_buf_len;
+	bool use_apll;
+	bool tx_desc_auto_clear;
+	int fixed_mclk;
+} i2s_config_t;
+
+esp_err_t i2s_driver_install(i2s_port_t port, const i2s_config_t *config, int queueSize, void *queue);
+esp_err_t i2s_driver_uninstall(i2s_port_t port);
+esp_err_t i2s_set_pin(i2s_port_t port, const i2s_pin_config_t *pins);
+esp_err_t i2s_set_dac_mode(i2s_dac_mode_t mode);
+esp_err_t i2s_set_clk(i2s_port_t port, uint32_t rate, i2s_bits_per_sample_t bits, i2s_channel_t channels);
+esp_err_t i2s_zero_dma_buffer(i2s_port_t port);
+esp_err_t i2s_start(i2s_port_t port);
+esp_err_t i2s_stop(i2s_port_t port);
+esp_err_t i2s_write(i2s_port_t port, const void *src, size_t size, size_t *bytesWritten,
+		TickType_t ticksToWait);
+
+#endif /* HOST_SHIM_I2S_H_ */
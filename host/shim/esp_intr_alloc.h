@@ -0,0 +1,15 @@
+/**
+ * esp_intr_alloc.h (host shim)
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ */
+
+#ifndef HOST_SHIM_ESP_INTR_ALLOC_H_
+#define HOST_SHIM_ESP_INTR_ALLOC_H_
+
+#define ESP_INTR_FLAG_LEVEL1 (1 << 1)
+#define ESP_INTR_FLAG_IRAM   (1 << 10)
+
+#endif /* HOST_SHIM_ESP_INTR_ALLOC_H_ */
@@ -0,0 +1,32 @@
+/**
+ * esp_log.h (host shim)
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ * Log lines go to stdout, in the same form as on the board:
+ *     W (1234) TAG: message
+ * Only the global level ("*") is kept.
+ */
+
+#ifndef HOST_SHIM_ESP_LOG_H_
+#define HOST_SHIM_ESP_LOG_H_
+
+#include <stdint.h>
+
+typedef enum
+{
+	ESP_LOG_NONE, ESP_LOG_ERROR, ESP_LOG_WARN, ESP_LOG_INFO, ESP_LOG_DEBUG, ESP_LOG_VERBOSE
+} esp_log_level_t;
+
+void esp_log_level_set(const char *tag, esp_log_level_t level);
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...)
+		__attribute__ ((format (printf, 3, 4)));
+
+#define ESP_LOGE(tag, format, ...) esp_log_write(ESP_LOG_ERROR, tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) esp_log_write(ESP_LOG_WARN, tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) esp_log_write(ESP_LOG_INFO, tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) esp_log_write(ESP_LOG_DEBUG, tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) esp_log_write(ESP_LOG_VERBOSE, tag, format, ##__VA_ARGS__)
+
+#endif /* HOST_SHIM_ESP_LOG_H_ */
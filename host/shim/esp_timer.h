@@ -0,0 +1,45 @@
+/**
+ * esp_timer.h (host shim)
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ * As on the board, every callback runs on one 'esp_timer' task - so a
+ * callback that blocks holds up all the others.
+ */
+
+#ifndef HOST_SHIM_ESP_TIMER_H_
+#define HOST_SHIM_ESP_TIMER_H_
+
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef struct esp_timer *esp_timer_handle_t;
+typedef void (*esp_timer_cb_t)(void *arg);
+
+typedef enum
+{
+	ESP_TIMER_TASK
+} esp_timer_dispatch_t;
+
+typedef struct
+{
+	esp_timer_cb_t callback;
+	void *arg;
+	esp_timer_dispatch_t dispatch_method;
+	const char *name;
+	bool skip_unhandled_events;
+} esp_timer_create_args_t;
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *handle);
+esp_err_t esp_timer_delete(esp_timer_handle_t timer);
+// (ESP_ERR_INVALID_STATE if the timer is already running - as on the board)
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeoutUsec);
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t periodUsec);
+// (ESP_ERR_INVALID_STATE if the timer isn't running)
+esp_err_t esp_timer_stop(esp_timer_handle_t timer);
+bool esp_timer_is_active(esp_timer_handle_t timer);
+// Microseconds since the program started
+int64_t esp_timer_get_time();
+
+#endif /* HOST_SHIM_ESP_TIMER_H_ */
@@ -0,0 +1,65 @@
+/**
+ * FreeRTOS.h (host shim)
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ * Just enough of FreeRTOS, on pthreads, to run the Sequencer layer (and the
+ * parts of the audio code that don't touch the hardware) on a Linux box.
+ * See FreeRTOSShim.cpp.
+ *
+ * A tick is one millisecond. Priorities and cores are remembered, but the
+ * host scheduler does what it likes with them - so anything that only
+ * works because of priorities on the ESP32 won't be caught here.
+ */
+
+#ifndef HOST_SHIM_FREERTOS_H_
+#define HOST_SHIM_FREERTOS_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+typedef struct HostTask *TaskHandle_t;
+typedef struct HostQueue *QueueHandle_t;
+typedef struct HostSemaphore *SemaphoreHandle_t;
+
+// The 'static' create functions ignore the buffer (the shim allocates)
+typedef struct
+{
+	void *unused;
+} StaticSemaphore_t;
+
+typedef struct
+{
+	int unused;
+} portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED { 0 }
+
+#define configTICK_RATE_HZ 1000
+#define portTICK_PERIOD_MS 1
+#define portMAX_DELAY ((TickType_t) 0xffffffffUL)
+#define pdMS_TO_TICKS(xTimeInMs) ((TickType_t) (xTimeInMs))
+
+#define pdPASS  1
+#define pdFAIL  0
+#define pdTRUE  1
+#define pdFALSE 0
+#define tskIDLE_PRIORITY 0
+#define tskNO_AFFINITY 0x7FFFFFFF
+
+#define IRAM_ATTR
+#define portYIELD_FROM_ISR()
+#define configASSERT(x) do { if (!(x)) abort(); } while (0)
+
+// One lock for every 'critical section' (there are no interrupts here)
+void hostEnterCritical();
+void hostExitCritical();
+#define portENTER_CRITICAL(mux) hostEnterCritical()
+#define portEXIT_CRITICAL(mux) hostExitCritical()
+
+#endif /* HOST_SHIM_FREERTOS_H_ */
@@ -0,0 +1,20 @@
+/**
+ * queue.h (host shim)
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ */
+
+#ifndef HOST_SHIM_QUEUE_H_
+#define HOST_SHIM_QUEUE_H_
+
+#include "FreeRTOS.h"
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize);
+void vQueueDelete(QueueHandle_t queue);
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticksToWait);
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticksToWait);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue);
+
+#endif /* HOST_SHIM_QUEUE_H_ */
@@ -0,0 +1,28 @@
+/**
+ * semphr.h (host shim)
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ * A mutex is just a binary semaphore that starts 'given' - no priority
+ * inheritance, and no check that the taker is the one that gives it back.
+ */
+
+#ifndef HOST_SHIM_SEMPHR_H_
+#define HOST_SHIM_SEMPHR_H_
+
+#include "FreeRTOS.h"
+#include "queue.h"
+
+SemaphoreHandle_t xSemaphoreCreateBinary();
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t *buffer);
+SemaphoreHandle_t xSemaphoreCreateMutex();
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *buffer);
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maxCount, UBaseType_t initialCount);
+SemaphoreHandle_t xSemaphoreCreateCountingStatic(UBaseType_t maxCount, UBaseType_t initialCount,
+		StaticSemaphore_t *buffer);
+void vSemaphoreDelete(SemaphoreHandle_t semaphore);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticksToWait);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore);
+
+#endif /* HOST_SHIM_SEMPHR_H_ */
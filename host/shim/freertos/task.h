@@ -0,0 +1,43 @@
+/**
+ * task.h (host shim)
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ * Tasks are (detached) threads, and each one has a notification value.
+ */
+
+#ifndef HOST_SHIM_TASK_H_
+#define HOST_SHIM_TASK_H_
+
+#include "FreeRTOS.h"
+
+typedef void (*TaskFunction_t)(void *);
+
+typedef enum
+{
+	eNoAction = 0, eSetBits, eIncrement, eSetValueWithOverwrite, eSetValueWithoutOverwrite
+} eNotifyAction;
+
+BaseType_t xTaskCreate(TaskFunction_t code, const char *name, uint32_t stackDepth,
+		void *parameters, UBaseType_t priority, TaskHandle_t *created);
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t code, const char *name, uint32_t stackDepth,
+		void *parameters, UBaseType_t priority, TaskHandle_t *created, BaseType_t core);
+// Only a task can delete itself (nullptr) on the host
+void vTaskDelete(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+TaskHandle_t xTaskGetCurrentTaskHandle();
+TickType_t xTaskGetTickCount();
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task);
+BaseType_t xPortGetCoreID();
+
+uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticksToWait);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action);
+BaseType_t xTaskNotifyWait(uint32_t clearOnEntry, uint32_t clearOnExit, uint32_t *value,
+		TickType_t ticksToWait);
+BaseType_t xTaskNotifyFromISR(TaskHandle_t task, uint32_t value, eNotifyAction action,
+		BaseType_t *woken);
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken);
+
+#endif /* HOST_SHIM_TASK_H_ */
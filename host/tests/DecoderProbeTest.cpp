@@ -0,0 +1,219 @@
+/**
+ * DecoderProbeTest.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ * Decoder::probe, on WAV files made up in memory. The ones we can play
+ * must come back with the right format, and the file at the sound (an
+ * ADPCM block must decode to just 'samplesPerBlock' samples). The ones
+ * we can't must be turned down - not played as noise: a block size that
+ * doesn't fit the samples, 24 and 32 bit PCM, more than two channels,
+ * formats we don't know, and files without a 'fmt ' or 'data' chunk.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "audio/Decoders.h"
+#include "HostTest.h"
+
+#define TAG_PCM   0x0001
+#define TAG_FLOAT 0x0003
+#define TAG_IMA   0x0011
+
+typedef std::vector<uint8_t> Bytes;
+
+static void put16(Bytes *file, int value)
+{
+	file->push_back ((uint8_t) value );
+	file->push_back ((uint8_t) (value >> 8) );
+}
+
+
+static void put32(Bytes *file, uint32_t value)
+{
+	put16 (file, (int) (value & 0xFFFF) );
+	put16 (file, (int) (value >> 16) );
+}
+
+
+static void putChunk(Bytes *file, const char *id, const Bytes &body)
+{
+	file->insert (file->end (), id, id + 4 );
+	put32 (file, (uint32_t) body.size () );
+	file->insert (file->end (), body.begin (), body.end () );
+	if (body.size () & 1) file->push_back (0 );
+}
+
+
+static Bytes fmtChunk(int tag, int channels, int hz, int bits, int blockAlign)
+{
+	Bytes fmt;
+	put16 (&fmt, tag );
+	put16 (&fmt, channels );
+	put32 (&fmt, (uint32_t) hz );
+	put32 (&fmt, (uint32_t) (hz * blockAlign) );
+	put16 (&fmt, blockAlign );
+	put16 (&fmt, bits );
+	return (fmt);
+}
+
+
+// A RIFF/WAVE file of 'chunks' (they are already made up)
+static Bytes wavFile(const Bytes &chunks)
+{
+	Bytes file = { 'R', 'I', 'F', 'F' };
+	put32 (&file, (uint32_t) (4 + chunks.size ()) );
+	file.insert (file.end (), { 'W', 'A', 'V', 'E' } );
+	file.insert (file.end (), chunks.begin (), chunks.end () );
+	return (file);
+}
+
+
+// The usual - 'fmt ', then 'data' with 'dataBytes' of sound
+static Bytes wavFile(int tag, int channels, int bits, int blockAlign, int dataBytes)
+{
+	Bytes chunks;
+	putChunk (&chunks, "fmt ", fmtChunk (tag, channels, 22050, bits, blockAlign ) );
+	putChunk (&chunks, "data", Bytes (dataBytes, 0x11) );
+	return (wavFile (chunks ));
+}
+
+
+/**
+ * Probe 'file' - and if it took it, check that the file was left at the
+ * sound.
+ * @return what probe said
+ */
+static bool probe(const Bytes &file, AudioFormat *format)
+{
+	FILE *fp = fmemopen ((void *) file.data (), file.size (), "rb" );
+	CHECK(fp != nullptr);
+	bool ok = Decoder::probe (fp, format );
+	if (ok) CHECK_EQ(ftell (fp ), (long) ((format->codec == CODEC_MP3) ? 0 : format->dataStart));
+	fclose (fp );
+	return (ok);
+}
+
+
+static void expectRejected(const char *what, const Bytes &file)
+{
+	AudioFormat format;
+	bool ok = probe (file, &format );
+	if (ok) printf ("%s: not rejected\n", what );
+	CHECK(!ok);
+}
+
+
+static void testPlayable()
+{
+	AudioFormat format;
+
+	// Not a WAV file - MP3
+	Bytes mp3 = { 'I', 'D', '3', 4, 0, 0, 0, 0, 0, 0, 0xFF, 0xFB, 0x90, 0x64 };
+	CHECK(probe (mp3, &format ));
+	CHECK_EQ(format.codec, CODEC_MP3);
+
+	Bytes file = wavFile (TAG_PCM, 1, 16, 2, 1000 );
+	CHECK(probe (file, &format ));
+	CHECK_EQ(format.codec, CODEC_PCM);
+	CHECK_EQ(format.channels, 1);
+	CHECK_EQ(format.hz, 22050);
+	CHECK_EQ(format.bitsPerSample, 16);
+	CHECK_EQ(format.dataStart, 44u);
+	CHECK_EQ(format.dataEnd, 1044u);
+
+	file = wavFile (TAG_PCM, 2, 8, 2, 1000 );
+	CHECK(probe (file, &format ));
+	CHECK_EQ(format.codec, CODEC_PCM);
+	CHECK_EQ(format.channels, 2);
+	CHECK_EQ(format.bitsPerSample, 8);
+
+	// Another chunk first - of an odd size, so it is padded
+	Bytes chunks;
+	putChunk (&chunks, "fmt ", fmtChunk (TAG_PCM, 1, 22050, 16, 2 ) );
+	putChunk (&chunks, "LIST", Bytes (7, 'x') );
+	putChunk (&chunks, "data", Bytes (100, 0) );
+	CHECK(probe (wavFile (chunks ), &format ));
+	CHECK_EQ(format.dataStart, 44u + 16u);
+	CHECK_EQ(format.dataEnd, 44u + 16u + 100u);
+
+	// ADPCM - and a whole block must be 'samplesPerBlock'
+	static const int blocks[][2] = { { 1, 256 }, { 1, 1024 }, { 2, 512 }, { 2, 1024 } };
+	Decoders decoders;
+	static int16_t pcm[MINIMP3_MAX_SAMPLES_PER_FRAME];
+	for (auto &block : blocks)
+	{
+		int channels = block[0];
+		int blockAlign = block[1];
+		file = wavFile (TAG_IMA, channels, 4, blockAlign, blockAlign * 3 );
+		CHECK(probe (file, &format ));
+		CHECK_EQ(format.codec, CODEC_IMA_ADPCM);
+		CHECK_EQ(format.samplesPerBlock, (blockAlign - 4 * channels) * 2 / channels + 1);
+
+		Decoder *decoder = decoders.start (&format, format.dataStart );
+		DecodeInfo info;
+		int samples = decoder->decode (&file[format.dataStart], file.size () - format.dataStart, pcm, &info );
+		CHECK_EQ(info.bytes, blockAlign);
+		CHECK_EQ(samples, format.samplesPerBlock);
+	}
+}
+
+
+static void testRejected()
+{
+	// Block sizes that don't fit the samples
+	expectRejected ("PCM 16 bit mono, block 3", wavFile (TAG_PCM, 1, 16, 3, 999 ) );
+	expectRejected ("PCM 16 bit stereo, block 2", wavFile (TAG_PCM, 2, 16, 2, 1000 ) );
+	expectRejected ("PCM 8 bit mono, block 0", wavFile (TAG_PCM, 1, 8, 0, 1000 ) );
+	expectRejected ("ADPCM mono, block 255", wavFile (TAG_IMA, 1, 4, 255, 765 ) );
+	expectRejected ("ADPCM mono, block 258", wavFile (TAG_IMA, 1, 4, 258, 774 ) );
+	expectRejected ("ADPCM stereo, block 1028", wavFile (TAG_IMA, 2, 4, 1028, 3084 ) );
+	expectRejected ("ADPCM mono, header only", wavFile (TAG_IMA, 1, 4, 4, 12 ) );
+	expectRejected ("ADPCM stereo, block 2048", wavFile (TAG_IMA, 2, 4, 2048, 4096 ) );
+	expectRejected ("ADPCM mono, block 4096", wavFile (TAG_IMA, 1, 4, 4096, 4096 ) );
+	expectRejected ("ADPCM, 3 bit", wavFile (TAG_IMA, 1, 3, 256, 512 ) );
+
+	// Samples we can't play
+	expectRejected ("PCM 24 bit", wavFile (TAG_PCM, 1, 24, 3, 999 ) );
+	expectRejected ("PCM 24 bit stereo", wavFile (TAG_PCM, 2, 24, 6, 996 ) );
+	expectRejected ("PCM 32 bit", wavFile (TAG_PCM, 1, 32, 4, 1000 ) );
+	expectRejected ("float", wavFile (TAG_FLOAT, 1, 32, 4, 1000 ) );
+	expectRejected ("3 channels", wavFile (TAG_PCM, 3, 16, 6, 1002 ) );
+	expectRejected ("no channels", wavFile (TAG_PCM, 0, 16, 0, 1000 ) );
+
+	// Chunks missing (or in the wrong order, or cut short)
+	Bytes chunks;
+	putChunk (&chunks, "fmt ", fmtChunk (TAG_PCM, 1, 22050, 16, 2 ) );
+	expectRejected ("no 'data'", wavFile (chunks ) );
+	putChunk (&chunks, "LIST", Bytes (20, 'x') );
+	expectRejected ("no 'data', another chunk", wavFile (chunks ) );
+
+	chunks.clear ();
+	putChunk (&chunks, "data", Bytes (100, 0) );
+	expectRejected ("no 'fmt '", wavFile (chunks ) );
+	putChunk (&chunks, "fmt ", fmtChunk (TAG_PCM, 1, 22050, 16, 2 ) );
+	expectRejected ("'data' before 'fmt '", wavFile (chunks ) );
+
+	chunks.clear ();
+	Bytes shortFmt = fmtChunk (TAG_PCM, 1, 22050, 16, 2 );
+	shortFmt.resize (14 );
+	putChunk (&chunks, "fmt ", shortFmt );
+	putChunk (&chunks, "data", Bytes (100, 0) );
+	expectRejected ("short 'fmt '", wavFile (chunks ) );
+
+	Bytes cut = wavFile (TAG_PCM, 1, 16, 2, 1000 );
+	cut.resize (30 );
+	expectRejected ("cut off in 'fmt '", cut );
+	expectRejected ("nothing after the header", wavFile (Bytes () ) );
+}
+
+
+int main()
+{
+	esp_log_level_set ("*", ESP_LOG_NONE );
+	testPlayable ();
+	testRejected ();
+	return (hostTestResult ("decoder_probe_test" ));
+}
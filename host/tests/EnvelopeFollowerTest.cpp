@@ -0,0 +1,311 @@
+/**
+ * EnvelopeFollowerTest.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ * audio/EnvelopeFollower - against a double precision version of the same
+ * filter (within a few LSB), the same levels however the samples are split
+ * up, and against the block average it replaced: on a steady tone each
+ * settles where it should, and on a real file (DaysMono.mp3) the levels
+ * rise and fall together - and, mapped with ENV_FULL_SCALE, move the jaw
+ * about as far as the old ones did (mapped from 3200).
+ *
+ *     envelope_follower_test [file.mp3]
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "config.h"
+#include "audio/EnvelopeFollower.h"
+#include "audio/minimp3.h"
+#include "HostTest.h"
+
+#define RATE 44100
+
+static uint32_t seed = 4321;
+
+static uint32_t nextRandom()
+{
+	seed = seed * 1103515245 + 12345;
+	return ((seed >> 8) & 0xFFFFFF);
+}
+
+
+// Bursts of noise and tones, with gaps - something to follow
+static std::vector<int16_t> testSignal(int samples)
+{
+	std::vector<int16_t> pcm (samples);
+	for (int idx = 0; idx < samples; idx++)
+	{
+		int section = (idx / 3000) % 4;
+		double amp = (section == 3) ? 0.0 : 4000.0 * (1 + section * 2);
+		double tone = sin (idx * 2.0 * M_PI * 220.0 / RATE);
+		double noise = ((int) (nextRandom () % 2001) - 1000) / 1000.0;
+		pcm[idx] = (int16_t) (amp * ((section == 1) ? noise : tone));
+	}
+	return (pcm);
+}
+
+
+// The Q16 coefficient, worked out as EnvelopeFollower does
+static double coefficient(uint32_t msec)
+{
+	if (msec == 0) return (1.0);
+	float c = 1.0f - expf (-1000.0f / ((float) msec * (float) RATE));
+	int32_t q = (int32_t) (c * 65536.0f + 0.5f);
+	return (((q < 1) ? 1 : q) / 65536.0);
+}
+
+
+/**
+ * The same filter, in double precision.
+ */
+static std::vector<int> reference(EnvMode mode, uint32_t attackMsec, uint32_t releaseMsec,
+		uint32_t interval, const std::vector<int16_t> &pcm)
+{
+	std::vector<int> levels;
+	double attack = coefficient (attackMsec );
+	double release = coefficient (releaseMsec );
+	double env = 0;
+	for (size_t idx = 0; idx < pcm.size (); idx++)
+	{
+		double x = (mode == ENV_PEAK) ? fabs ((double) pcm[idx]) : (double) pcm[idx] * pcm[idx];
+		env += (x - env) * ((x < env) ? release : attack);
+		if (((idx + 1) % interval) == 0)
+		{
+			levels.push_back ((int) ((mode == ENV_PEAK) ? env : sqrt (env )));
+		}
+	}
+	return (levels);
+}
+
+
+static void testReference()
+{
+	static const EnvMode modes[] = { ENV_PEAK, ENV_RMS };
+	static const uint32_t times[][2] = { { 0, 0 }, { 5, 60 }, { 10, 150 }, { 1, 1000 } };
+	std::vector<int16_t> pcm = testSignal (RATE * 2 );
+
+	for (EnvMode mode : modes)
+	{
+		for (const uint32_t *time : times)
+		{
+			EnvelopeFollower env;
+			env.configure (mode, time[0], time[1], EYE_AVG_SIZE );
+			env.setSampleRate (RATE );
+			std::vector<uint16_t> levels (pcm.size () / EYE_AVG_SIZE + 1);
+			int count = env.process (pcm.data (), (int) pcm.size (), 1, levels.data (), (int) levels.size () );
+			std::vector<int> expect = reference (mode, time[0], time[1], EYE_AVG_SIZE, pcm );
+
+			CHECK_EQ(count, (int) expect.size ());
+			int worst = 0;
+			for (int idx = 0; idx < count; idx++)
+			{
+				int diff = abs ((int) levels[idx] - expect[idx] );
+				if (diff > worst) worst = diff;
+			}
+			printf ("%s %4u/%4u msec: %d levels, worst %d LSB from the reference\n",
+					(mode == ENV_PEAK) ? "peak" : "rms ", time[0], time[1], count, worst );
+			CHECK(worst <= 4);
+		}
+	}
+}
+
+
+/**
+ * However the samples arrive (frame sizes, stereo) the levels are the same.
+ */
+static void testChunks()
+{
+	std::vector<int16_t> mono = testSignal (RATE );
+	std::vector<int16_t> stereo (mono.size () * 2);
+	for (size_t idx = 0; idx < mono.size (); idx++)
+	{
+		stereo[idx * 2] = mono[idx];
+		stereo[idx * 2 + 1] = (int16_t) -12345;   // (the right side is ignored)
+	}
+
+	EnvelopeFollower whole;
+	whole.configure (ENV_RMS, JAW_ATTACK_MSEC, JAW_RELEASE_MSEC, JAW_AVG_SIZE );
+	whole.setSampleRate (RATE );
+	std::vector<uint16_t> expect (mono.size () / JAW_AVG_SIZE + 1);
+	int expectCount = whole.process (mono.data (), (int) mono.size (), 1, expect.data (), (int) expect.size () );
+
+	EnvelopeFollower pieces;
+	pieces.configure (ENV_RMS, JAW_ATTACK_MSEC, JAW_RELEASE_MSEC, JAW_AVG_SIZE );
+	pieces.setSampleRate (RATE );
+	std::vector<uint16_t> got;
+	uint16_t levels[8];
+	size_t done = 0;
+	while (done < mono.size ())
+	{
+		size_t todo = 1 + nextRandom () % 1500;
+		if (todo > mono.size () - done) todo = mono.size () - done;
+		int count = pieces.process (&stereo[done * 2], (int) todo, 2, levels, 8 );
+		got.insert (got.end (), levels, levels + count );
+		done += todo;
+	}
+	CHECK_EQ((int) got.size (), expectCount);
+	int differ = 0;
+	for (size_t idx = 0; (idx < got.size ()) && ((int) idx < expectCount); idx++)
+	{
+		if (got[idx] != expect[idx]) differ++;
+	}
+	CHECK_EQ(differ, 0);
+}
+
+
+// The old way - the average of abs(sample) over each block
+static std::vector<int> blockAverage(const int16_t *pcm, size_t samples, int stride, int block)
+{
+	std::vector<int> levels;
+	uint32_t sum = 0;
+	int count = 0;
+	for (size_t idx = 0; idx < samples; idx++)
+	{
+		sum += abs (pcm[idx * stride] );
+		if (++count < block) continue;
+		levels.push_back (sum / block );
+		sum = 0;
+		count = 0;
+	}
+	return (levels);
+}
+
+
+/**
+ * A steady tone: the old average settles at 2A/pi, the new peak level at
+ * about A, and the RMS level (with the same attack and release) at
+ * A/sqrt(2). With a faster attack than release, it sits above that.
+ */
+static void testSteadyTone()
+{
+	const double amp = 10000.0;
+	std::vector<int16_t> pcm (RATE);
+	for (size_t idx = 0; idx < pcm.size (); idx++)
+	{
+		pcm[idx] = (int16_t) (amp * sin (idx * 2.0 * M_PI * 441.0 / RATE ));
+	}
+	std::vector<int> old = blockAverage (pcm.data (), pcm.size (), 1, EYE_AVG_SIZE );
+
+	EnvelopeFollower rms;
+	rms.configure (ENV_RMS, 20, 20, EYE_AVG_SIZE );
+	rms.setSampleRate (RATE );
+	EnvelopeFollower peak;
+	peak.configure (ENV_PEAK, EYE_ATTACK_MSEC, EYE_RELEASE_MSEC, EYE_AVG_SIZE );
+	peak.setSampleRate (RATE );
+	std::vector<uint16_t> rmsLevels (old.size () + 1);
+	std::vector<uint16_t> peakLevels (old.size () + 1);
+	rms.process (pcm.data (), (int) pcm.size (), 1, rmsLevels.data (), (int) rmsLevels.size () );
+	peak.process (pcm.data (), (int) pcm.size (), 1, peakLevels.data (), (int) peakLevels.size () );
+
+	// (after the first 100 msec)
+	for (size_t idx = (RATE / 10) / EYE_AVG_SIZE; idx < old.size (); idx++)
+	{
+		CHECK(fabs (old[idx] - amp * 2 / M_PI) < amp * 0.02);
+		CHECK(fabs (rmsLevels[idx] - amp / M_SQRT2) < amp * 0.03);
+		CHECK(peakLevels[idx] > amp * 0.85);
+		CHECK(peakLevels[idx] <= amp);
+	}
+	printf ("steady tone of %.0f: average %d, rms %u, peak %u\n", amp, old.back (), rmsLevels[old.size () - 1],
+			peakLevels[old.size () - 1] );
+}
+
+
+// As SndPlayer maps it: 0...1000 for shut...fully open (past that is still fully open)
+static int jawPosition(int level, int fullScale)
+{
+	int pos = level * 1000 / fullScale;
+	return ((pos > 1000) ? 1000 : pos);
+}
+
+
+/**
+ * A real file: the new levels follow the old ones (correlation), and once
+ * mapped to a jaw position they are about the same on average, and hardly
+ * ever pinned at fully open.
+ */
+static void testFile(const char *path)
+{
+	FILE *fp = fopen (path, "rb" );
+	CHECK(fp != nullptr);
+	if (fp == nullptr) return;
+	std::vector<uint8_t> mp3;
+	uint8_t block[4096];
+	size_t len;
+	while ((len = fread (block, 1, sizeof(block), fp )) > 0)
+	{
+		mp3.insert (mp3.end (), block, block + len );
+	}
+	fclose (fp );
+
+	mp3dec_t mp3d;
+	mp3dec_init (&mp3d );
+	mp3dec_frame_info_t info;
+	static int16_t pcm[MINIMP3_MAX_SAMPLES_PER_FRAME];
+	std::vector<int16_t> left;
+	size_t pos = 0;
+	int hz = 0;
+	while (pos < mp3.size ())
+	{
+		int samples = mp3dec_decode_frame (&mp3d, &mp3[pos], (int) (mp3.size () - pos), pcm, &info );
+		if (info.frame_bytes == 0) break;
+		pos += info.frame_bytes;
+		for (int idx = 0; idx < samples; idx++)
+		{
+			left.push_back (pcm[idx * info.channels] );
+		}
+		hz = info.hz;
+	}
+	CHECK(left.size () > 0);
+
+	std::vector<int> old = blockAverage (left.data (), left.size (), 1, EYE_AVG_SIZE );
+	EnvelopeFollower env;
+	env.configure (ENV_MODE, EYE_ATTACK_MSEC, EYE_RELEASE_MSEC, EYE_AVG_SIZE );
+	env.setSampleRate (hz );
+	std::vector<uint16_t> levels (old.size () + 1);
+	int count = env.process (left.data (), (int) left.size (), 1, levels.data (), (int) levels.size () );
+	CHECK_EQ(count, (int) old.size ());
+
+	double sumOld = 0, sumNew = 0, sumOld2 = 0, sumNew2 = 0, sumBoth = 0;
+	double oldPositions = 0, newPositions = 0;
+	int oldPinned = 0, newPinned = 0;
+	for (int idx = 0; idx < count; idx++)
+	{
+		int oldPos = jawPosition (old[idx], 3200 );
+		int newPos = jawPosition (levels[idx], ENV_FULL_SCALE );
+		oldPositions += oldPos;
+		newPositions += newPos;
+		if (oldPos == 1000) oldPinned++;
+		if (newPos == 1000) newPinned++;
+
+		sumOld += old[idx];
+		sumNew += levels[idx];
+		sumOld2 += (double) old[idx] * old[idx];
+		sumNew2 += (double) levels[idx] * levels[idx];
+		sumBoth += (double) old[idx] * levels[idx];
+	}
+	double n = count;
+	double correlation = (n * sumBoth - sumOld * sumNew)
+			/ sqrt ((n * sumOld2 - sumOld * sumOld) * (n * sumNew2 - sumNew * sumNew));
+	printf ("%s: %d levels, mean %.0f (average) vs %.0f (%s), correlation %.3f\n", path, count,
+			sumOld / n, sumNew / n, (ENV_MODE == ENV_RMS) ? "rms" : "peak", correlation );
+	printf ("jaw position: mean %.0f (average) vs %.0f, fully open %d vs %d times\n", oldPositions / n,
+			newPositions / n, oldPinned, newPinned );
+	CHECK(correlation > 0.9);
+	CHECK(fabs (newPositions - oldPositions) < oldPositions * 0.15);
+	CHECK(newPinned <= count / 100);
+}
+
+
+int main(int argc, char **argv)
+{
+	testReference ();
+	testChunks ();
+	testSteadyTone ();
+	if (argc > 1) testFile (argv[1] );
+	return (hostTestResult ("envelope_follower_test" ));
+}
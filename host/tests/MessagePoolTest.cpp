@@ -0,0 +1,252 @@
+/**
+ * MessagePoolTest.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ * Sequencer/MessagePool.h - running dry, bad frees, the tag wrapping
+ * round, and several tasks allocating at once. Then the same through
+ * Message's own new and delete.
+ */
+
+#include <string.h>
+#include <thread>
+#include <vector>
+#include "Sequencer/MessagePool.h"
+#include "Sequencer/Message.h"
+#include "HostTest.h"
+
+#define TEST_BLOCKS 8
+
+typedef MessagePool<40, TEST_BLOCKS> TestPool;
+
+
+static void testExhaustion()
+{
+	TestPool *pool = new TestPool();
+	MessagePoolStats stats;
+	void *blocks[TEST_BLOCKS];
+
+	for (int idx = 0; idx < TEST_BLOCKS; idx++)
+	{
+		blocks[idx] = pool->alloc ();
+		CHECK(blocks[idx] != nullptr);
+		CHECK(pool->owns (blocks[idx] ));
+		CHECK_EQ(((uintptr_t) blocks[idx]) % 8, 0);
+		for (int other = 0; other < idx; other++)
+		{
+			CHECK(blocks[other] != blocks[idx]);
+		}
+	}
+	CHECK(pool->alloc () == nullptr);
+	CHECK(pool->alloc () == nullptr);
+	pool->getStats (&stats );
+	CHECK_EQ(stats.capacity, TEST_BLOCKS);
+	CHECK_EQ(stats.inUse, TEST_BLOCKS);
+	CHECK_EQ(stats.highWater, TEST_BLOCKS);
+	CHECK_EQ(stats.allocCount, TEST_BLOCKS);
+	CHECK_EQ(stats.exhaustedCount, 2);
+
+	// The last one freed is the next one out
+	CHECK(pool->free (blocks[3] ));
+	CHECK(pool->alloc () == blocks[3]);
+
+	for (int idx = 0; idx < TEST_BLOCKS; idx++)
+	{
+		CHECK(pool->free (blocks[idx] ));
+	}
+	pool->getStats (&stats );
+	CHECK_EQ(stats.inUse, 0);
+	CHECK_EQ(stats.highWater, TEST_BLOCKS);
+	CHECK_EQ(stats.badFreeCount, 0);
+
+	pool->resetStats ();
+	pool->getStats (&stats );
+	CHECK_EQ(stats.highWater, 0);
+	CHECK_EQ(stats.allocCount, 0);
+	CHECK_EQ(stats.exhaustedCount, 0);
+	delete pool;
+}
+
+
+static void testBadFree()
+{
+	TestPool *pool = new TestPool();
+	MessagePoolStats stats;
+	int notOurs;
+
+	void *first = pool->alloc ();
+	void *second = pool->alloc ();
+	CHECK(!pool->free (&notOurs ));
+	CHECK(pool->free (first ));
+
+	// Twice - ignored (and counted), so 'first' can only come out once
+	CHECK(pool->free (first ));
+	// Part way into a block
+	CHECK(pool->free ((uint8_t *) second + 4 ));
+	pool->getStats (&stats );
+	CHECK_EQ(stats.badFreeCount, 2);
+	CHECK_EQ(stats.inUse, 1);
+
+	void *blocks[TEST_BLOCKS];
+	int got = 0;
+	while ((got < TEST_BLOCKS) && ((blocks[got] = pool->alloc ()) != nullptr))
+	{
+		got++;
+	}
+	CHECK_EQ(got, TEST_BLOCKS - 1);
+	for (int idx = 0; idx < got; idx++)
+	{
+		CHECK(blocks[idx] != second);
+		for (int other = 0; other < idx; other++)
+		{
+			CHECK(blocks[other] != blocks[idx]);
+		}
+	}
+	delete pool;
+}
+
+
+/**
+ * The tag is 16 bits - it wraps every 65536 changes to the head. Go round
+ * a few times, and make sure the free list is still whole.
+ */
+static void testTagWrap()
+{
+	TestPool *pool = new TestPool();
+	MessagePoolStats stats;
+	void *held[3];
+
+	for (int round = 0; round < 3 * 65536 + 17; round++)
+	{
+		int count = 1 + (round % 3);
+		for (int idx = 0; idx < count; idx++) held[idx] = pool->alloc ();
+		for (int idx = count - 1; idx >= 0; idx--) pool->free (held[idx] );
+	}
+	pool->getStats (&stats );
+	CHECK_EQ(stats.inUse, 0);
+	CHECK_EQ(stats.highWater, 3);
+	CHECK_EQ(stats.badFreeCount, 0);
+
+	void *blocks[TEST_BLOCKS];
+	for (int idx = 0; idx < TEST_BLOCKS; idx++)
+	{
+		blocks[idx] = pool->alloc ();
+		CHECK(blocks[idx] != nullptr);
+		for (int other = 0; other < idx; other++)
+		{
+			CHECK(blocks[other] != blocks[idx]);
+		}
+	}
+	CHECK(pool->alloc () == nullptr);
+	delete pool;
+}
+
+
+/**
+ * Several tasks allocate and free as fast as they can (with the pool
+ * nearly empty, so blocks are popped and pushed back under each other -
+ * the ABA case). Each one writes its mark all over a block while it holds
+ * it; if two ever hold the same block, one of them sees the other's mark.
+ */
+static void testContention()
+{
+	static const int THREADS = 4;
+	static const int ROUNDS = 200000;
+	TestPool *pool = new TestPool();
+	std::atomic<int> clashes(0);
+	std::atomic<int> dry(0);
+	std::vector<std::thread> threads;
+
+	for (int id = 0; id < THREADS; id++)
+	{
+		threads.emplace_back ([pool, id, &clashes, &dry] {
+			uint8_t mark = (uint8_t) (0x10 + id);
+			uint8_t *held[2];
+			for (int round = 0; round < ROUNDS; round++)
+			{
+				int count = 0;
+				for (int idx = 0; idx < 2; idx++)
+				{
+					held[count] = (uint8_t *) pool->alloc ();
+					if (held[count] == nullptr)
+					{
+						dry++;
+						continue;
+					}
+					memset (held[count], mark, 40 );
+					count++;
+				}
+				for (int idx = 0; idx < count; idx++)
+				{
+					for (int byte = 0; byte < 40; byte++)
+					{
+						if (held[idx][byte] != mark)
+						{
+							clashes++;
+							break;
+						}
+					}
+					pool->free (held[idx] );
+				}
+			}
+		} );
+	}
+	for (std::thread &thread : threads)
+	{
+		thread.join ();
+	}
+
+	MessagePoolStats stats;
+	pool->getStats (&stats );
+	CHECK_EQ(clashes.load (), 0);
+	CHECK_EQ(stats.inUse, 0);
+	CHECK_EQ(stats.badFreeCount, 0);
+	CHECK_EQ(stats.allocCount + dry.load (), THREADS * ROUNDS * 2);
+	CHECK(stats.highWater <= TEST_BLOCKS);
+	printf ("contention: %u allocations, %d dry, high water %u\n", stats.allocCount, dry.load (),
+			stats.highWater );
+	delete pool;
+}
+
+
+/**
+ * Message's new and delete - from the pool until it runs out, then the heap.
+ */
+static void testMessages()
+{
+	MessagePoolStats stats;
+	Message *msgs[MESSAGE_POOL_SIZE + 4];
+
+	Message::resetPoolStats ();
+	for (int idx = 0; idx < MESSAGE_POOL_SIZE + 4; idx++)
+	{
+		msgs[idx] = Message::create_message (TASK_NAME::TEST, TASK_NAME::IDLER, 1, idx, 0,
+				"A message with some text" );
+		CHECK(msgs[idx] != nullptr);
+	}
+	Message::getPoolStats (&stats );
+	CHECK_EQ(stats.inUse, MESSAGE_POOL_SIZE);
+	CHECK_EQ(stats.exhaustedCount, 4);
+	for (int idx = 0; idx < MESSAGE_POOL_SIZE + 4; idx++)
+	{
+		CHECK_EQ(msgs[idx]->value, idx);
+		CHECK(strcmp (msgs[idx]->text (), "A message with some text" ) == 0);
+		delete msgs[idx];
+	}
+	Message::getPoolStats (&stats );
+	CHECK_EQ(stats.inUse, 0);
+	CHECK_EQ(stats.badFreeCount, 0);
+}
+
+
+int main()
+{
+	esp_log_level_set ("*", ESP_LOG_ERROR );
+	testExhaustion ();
+	testBadFree ();
+	testTagWrap ();
+	testContention ();
+	testMessages ();
+	return (hostTestResult ("message_pool_test" ));
+}
@@ -0,0 +1,147 @@
+/**
+ * MsgRingTest.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ * Sequencer/MsgRing.h - the basics, then several producer threads against
+ * one consumer (the SwitchBoard), and against two (a sender dropping the
+ * oldest entry pops too). Every item says who sent it and its number, so
+ * the consumers can check that nothing is lost, nothing turns up twice,
+ * and each producer's items come out in the order they went in.
+ *
+ *     msg_ring_test [items per producer]
+ */
+
+#include <stdlib.h>
+#include <sched.h>
+#include <thread>
+#include <vector>
+#include "Sequencer/MsgRing.h"
+#include "HostTest.h"
+
+#define PRODUCERS 4
+#define ITEM(producer, seq) (((uint32_t) (producer) << 24) | (uint32_t) (seq))
+#define ITEM_PRODUCER(item) ((item) >> 24)
+#define ITEM_SEQ(item) ((item) & 0xFFFFFF)
+
+
+static void testBasics()
+{
+	MsgRing<uint32_t, 8> ring;
+	uint32_t item;
+
+	CHECK(!ring.tryPop (&item ));
+	CHECK_EQ(ring.size (), 0);
+	for (uint32_t idx = 0; idx < 8; idx++)
+	{
+		CHECK(ring.tryPush (idx ));
+	}
+	CHECK(!ring.tryPush (99 ));
+	CHECK_EQ(ring.size (), 8);
+	CHECK_EQ(ring.getHighWater (), 8);
+
+	// Round and round - always in order
+	for (uint32_t idx = 8; idx < 1000; idx++)
+	{
+		CHECK(ring.tryPop (&item ));
+		CHECK_EQ(item, idx - 8);
+		CHECK(ring.tryPush (idx ));
+	}
+	for (uint32_t idx = 992; idx < 1000; idx++)
+	{
+		CHECK(ring.tryPop (&item ));
+		CHECK_EQ(item, idx);
+	}
+	CHECK(!ring.tryPop (&item ));
+	ring.resetHighWater ();
+	CHECK_EQ(ring.getHighWater (), 0);
+}
+
+
+/**
+ * PRODUCERS threads push 'perProducer' items each (waiting whenever the
+ * ring is full), while 'consumers' threads pop them.
+ */
+static void testStress(int consumers, int perProducer)
+{
+	MsgRing<uint32_t, 8> ring;
+	std::atomic<int> producing(PRODUCERS);
+	std::vector<std::atomic<uint8_t>> seen (PRODUCERS * perProducer);
+	std::atomic<int> outOfOrder(0);
+	std::atomic<int> duplicates(0);
+	std::atomic<uint32_t> fullCount(0);
+	std::vector<std::thread> threads;
+
+	for (int id = 0; id < PRODUCERS; id++)
+	{
+		threads.emplace_back ([&ring, &producing, &fullCount, id, perProducer] {
+			for (int seq = 0; seq < perProducer; seq++)
+			{
+				while (!ring.tryPush (ITEM(id, seq )))
+				{
+					fullCount++;
+					sched_yield ();
+				}
+			}
+			producing--;
+		} );
+	}
+	for (int id = 0; id < consumers; id++)
+	{
+		threads.emplace_back ([&] {
+			// (each consumer sees a producer's items in order - just not all of them)
+			int last[PRODUCERS];
+			for (int idx = 0; idx < PRODUCERS; idx++) last[idx] = -1;
+			uint32_t item;
+			while (true)
+			{
+				if (!ring.tryPop (&item ))
+				{
+					if (producing.load () != 0)
+					{
+						sched_yield ();
+						continue;
+					}
+					if (!ring.tryPop (&item )) break;   // They are done, and it is empty
+				}
+				uint32_t producer = ITEM_PRODUCER(item );
+				int seq = (int) ITEM_SEQ(item );
+				if ((producer >= PRODUCERS) || (seq >= perProducer) || (seq <= last[producer]))
+				{
+					outOfOrder++;
+					continue;
+				}
+				last[producer] = seq;
+				if (seen[producer * perProducer + seq].fetch_add (1 ) != 0) duplicates++;
+			}
+		} );
+	}
+	for (std::thread &thread : threads)
+	{
+		thread.join ();
+	}
+
+	int lost = 0;
+	for (std::atomic<uint8_t> &count : seen)
+	{
+		if (count.load () == 0) lost++;
+	}
+	printf ("%d producer(s), %d consumer(s): %d items, ring full %u times, high water %u\n",
+			PRODUCERS, consumers, PRODUCERS * perProducer, fullCount.load (), ring.getHighWater () );
+	CHECK_EQ(lost, 0);
+	CHECK_EQ(duplicates.load (), 0);
+	CHECK_EQ(outOfOrder.load (), 0);
+	CHECK_EQ(ring.size (), 0);
+	CHECK(ring.getHighWater () <= 8);
+}
+
+
+int main(int argc, char **argv)
+{
+	int perProducer = (argc > 1) ? atoi (argv[1] ) : 50000;
+	testBasics ();
+	testStress (1, perProducer );
+	testStress (2, perProducer );
+	return (hostTestResult ("msg_ring_test" ));
+}
@@ -0,0 +1,178 @@
+/**
+ * OutputLeaseTest.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ * Output::lease and commit, for the DAC (mono in, both sides out) and I2S
+ * (mono), against the shim's DMA buffers (see HostI2S.h). A lease is in
+ * the DMA buffer being filled - for as much as was asked, or what is left
+ * of that buffer; a commit of fewer frames than were leased sends just
+ * those (the next lease carries on after them), and a commit of more than
+ * were leased sends no more than were.
+ *
+ * Then 'write' - each sample must be touched once on its way to the DMA
+ * buffers: converted straight into them (the DAC, or any change of volume),
+ * or copied in by i2s_write (I2S at full volume) - never both, and never
+ * through a buffer of our own.
+ */
+
+#include <string.h>
+#include <vector>
+#include "audio/DACOutput.h"
+#include "audio/I2SOutput.h"
+#include "HostI2S.h"
+#include "HostTest.h"
+
+#define BIG_WRITE 5000
+
+static i2s_pin_config_t pins = { };
+
+
+// Fill a leased buffer - frame 'idx' side 'side' is (idx * 4 + side)
+static void fill(int16_t *buf, int frames, int channels)
+{
+	for (int idx = 0; idx < frames; idx++)
+	{
+		for (int side = 0; side < channels; side++)
+		{
+			buf[idx * channels + side] = (int16_t) (idx * 4 + side);
+		}
+	}
+}
+
+
+// Do the bytes sent match 'expect'?
+static bool sentIs(i2s_port_t port, const int16_t *expect, int samples)
+{
+	const std::vector<uint8_t> &sent = hostI2SWritten (port );
+	return ((sent.size () == samples * sizeof(int16_t)) && (memcmp (sent.data (), expect, sent.size () ) == 0));
+}
+
+
+static void testLease(const char *name, Output *out, i2s_port_t port)
+{
+	int channels = out->channels ();
+	int bufFrames = out->get_geometry ().buf_len;
+	int granted = -1;
+
+	// More than a DMA buffer - cut down to the (empty) first one
+	hostI2SClear (port );
+	out->reset_counters ();
+	int16_t *buf = out->lease (bufFrames + 100, &granted );
+	CHECK(hostI2SDmaOwns (port, buf ));
+	CHECK_EQ(granted, bufFrames);
+	fill (buf, granted, channels );
+	std::vector<int16_t> expect(buf, buf + granted * channels);
+	out->commit (granted );
+	CHECK(sentIs (port, expect.data (), bufFrames * channels ));
+	CHECK_EQ(hostI2SDmaInPlace (port ), (uint64_t) (bufFrames * channels * sizeof(int16_t)));
+	CHECK_EQ(hostI2SDmaCopied (port ), 0u);
+	CHECK_EQ(hostI2SWriteCalls (port ), 0u);
+	CHECK_EQ(out->get_frames_converted (), (uint32_t) bufFrames);
+
+	// Less - as asked for (in the next DMA buffer); then only some of it sent
+	hostI2SClear (port );
+	out->reset_counters ();
+	int16_t *next = out->lease (200, &granted );
+	CHECK(hostI2SDmaOwns (port, next ));
+	CHECK(next != buf);
+	CHECK_EQ(granted, 200);
+	fill (next, granted, channels );
+	expect.assign (next, next + 50 * channels );
+	out->commit (50 );
+	CHECK(sentIs (port, expect.data (), 50 * channels ));
+	CHECK_EQ(out->get_frames_converted (), 50u);
+
+	// ...the next lease carries on after them - for the rest of the buffer
+	buf = out->lease (bufFrames, &granted );
+	CHECK(buf == next + 50 * channels);
+	CHECK_EQ(granted, bufFrames - 50);
+
+	// More than was leased - only what was
+	hostI2SClear (port );
+	out->reset_counters ();
+	buf = out->lease (10, &granted );
+	CHECK_EQ(granted, 10);
+	fill (buf, granted, channels );
+	expect.assign (buf, buf + 10 * channels );
+	out->commit (bufFrames );
+	CHECK(sentIs (port, expect.data (), 10 * channels ));
+	CHECK_EQ(out->get_frames_converted (), 10u);
+
+	// ...and a commit without a lease sends nothing
+	hostI2SClear (port );
+	out->commit (10 );
+	CHECK_EQ(hostI2SDmaInPlace (port ), 0u);
+	CHECK_EQ(out->get_frames_converted (), 10u);
+	printf ("%s: lease and commit done (DMA buffers of %d frames)\n", name, bufFrames );
+}
+
+
+/**
+ * 'write' of mono samples, at half volume (converted) and at full (copied
+ * by the driver if the output is I2S mono) - one touch a sample.
+ */
+static void testWrite(const char *name, Output *out, i2s_port_t port)
+{
+	int channels = out->channels ();
+	uint64_t bytes = (uint64_t) BIG_WRITE * channels * sizeof(int16_t);
+	std::vector<int16_t> in (BIG_WRITE);
+	uint32_t seed = 5;
+	for (int16_t &sample : in)
+	{
+		seed = seed * 1103515245 + 12345;
+		sample = (int16_t) (seed >> 16);
+	}
+
+	out->set_volume (0.5f );
+	std::vector<int16_t> expect (BIG_WRITE * channels);
+	out->convert_block (in.data (), expect.data (), BIG_WRITE, 1 );
+	hostI2SClear (port );
+	out->reset_counters ();
+	out->write_mono (in.data (), BIG_WRITE );
+	CHECK(sentIs (port, expect.data (), BIG_WRITE * channels ));
+	CHECK_EQ(hostI2SDmaInPlace (port ), bytes);
+	CHECK_EQ(hostI2SDmaCopied (port ), 0u);
+	CHECK_EQ(out->get_frames_converted (), (uint32_t) BIG_WRITE);
+	CHECK_EQ(out->get_frames_direct (), 0u);
+
+	out->set_volume (1.0f );
+	bool direct = out->is_passthrough (1 );
+	if (!direct) out->convert_block (in.data (), expect.data (), BIG_WRITE, 1 );
+	hostI2SClear (port );
+	out->reset_counters ();
+	out->write_mono (in.data (), BIG_WRITE );
+	CHECK(sentIs (port, direct ? in.data () : expect.data (), BIG_WRITE * channels ));
+	CHECK_EQ(hostI2SDmaCopied (port ), direct ? bytes : 0u);
+	CHECK_EQ(hostI2SDmaInPlace (port ), direct ? 0u : bytes);
+	CHECK_EQ(out->get_frames_direct (), direct ? (uint32_t) BIG_WRITE : 0u);
+	CHECK_EQ(out->get_frames_converted (), direct ? 0u : (uint32_t) BIG_WRITE);
+	printf ("%s: write done - %s at full volume, one touch a sample\n", name,
+			direct ? "copied by the driver" : "converted in place" );
+}
+
+
+int main()
+{
+	esp_log_level_set ("*", ESP_LOG_NONE );
+	DACOutput dac;
+	dac.start (44100, 1 );
+	testLease ("DAC", &dac, I2S_NUM_0 );
+	testWrite ("DAC", &dac, I2S_NUM_0 );
+	dac.stop ();
+
+	// Nothing goes anywhere once it has stopped
+	int granted = -1;
+	CHECK(dac.lease (100, &granted ) == nullptr);
+	CHECK_EQ(granted, 0);
+	std::vector<int16_t> quiet (100);
+	dac.write_mono (quiet.data (), 100 );
+
+	I2SOutput i2sMono(I2S_NUM_1, pins);
+	i2sMono.start (44100, 1 );
+	testLease ("I2S mono", &i2sMono, I2S_NUM_1 );
+	testWrite ("I2S mono", &i2sMono, I2S_NUM_1 );
+	i2sMono.stop ();
+	return (hostTestResult ("output_lease_test" ));
+}
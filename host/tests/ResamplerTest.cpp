@@ -0,0 +1,207 @@
+/**
+ * ResamplerTest.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ * audio/Resampler.h, for each ResampleQuality:
+ *
+ *  - No drift: 'seconds' of input, pushed a decoded frame at a time (then
+ *    enough silence to flush the filter) make in x out/in frames (+/- 1).
+ *  - A sine comes out as the same sine at the new rate - the SNR (against
+ *    the exact one) must be above a floor for each preset.
+ *  - The output doesn't depend on how the input is pushed - one frame at
+ *    a time, odd sizes, or whole MP3 frames - mono or stereo.
+ *
+ *     resampler_test [seconds]
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "audio/Resampler.h"
+#include "HostTest.h"
+
+#define TONE_HZ 800
+#define TONE_LEVEL 16000.0
+// Leave out the start (the filter filling up)
+#define SETTLE_FRAMES 64
+
+static const char *names[] = { "FAST", "BALANCED", "BEST" };
+// (the taps for each preset - see Resampler.cpp)
+static const int taps[] = { 2, 8, 16 };
+// The SNR each must beat - with some room below what they get
+static const double snrFloor[] = { 25.0, 40.0, 46.0 };
+
+static const int rates[][2] = { { 8000, 44100 }, { 22050, 44100 }, { 48000, 44100 }, { 44100, 22050 } };
+
+static Resampler resampler;
+
+
+// Channel 'ch' of input frame 'idx' - a different tone on each side
+static int16_t tone(long idx, int ch, int inRate)
+{
+	double hz = (ch == 0) ? TONE_HZ : TONE_HZ * 1.5;
+	return ((int16_t) lrint (TONE_LEVEL * sin (2.0 * M_PI * hz * idx / inRate )));
+}
+
+
+static void toneBlock(std::vector<int16_t> *block, long start, int frames, int channels, int inRate)
+{
+	block->resize (frames * channels );
+	for (int idx = 0; idx < frames; idx++)
+	{
+		for (int ch = 0; ch < channels; ch++)
+		{
+			(*block)[idx * channels + ch] = tone (start + idx, ch, inRate );
+		}
+	}
+}
+
+
+// Push, then take everything it can give
+static void feed(const int16_t *in, int frames, int channels, std::vector<int16_t> *out, long *count)
+{
+	resampler.push (in, frames );
+	const int16_t *block;
+	int got;
+	while ((got = resampler.pull (&block )) > 0)
+	{
+		if (out != nullptr) out->insert (out->end (), block, block + got * channels );
+		*count += got;
+	}
+}
+
+
+/**
+ * A long run - the tone, a decoded frame at a time, then silence for the
+ * filter's taps after the last sample.
+ */
+static void testDrift(int quality, int inRate, int outRate, int seconds)
+{
+	resampler.configure (inRate, outRate, 1, (ResampleQuality) quality );
+	std::vector<int16_t> block;
+	long in = (long) inRate * seconds;
+	long count = 0;
+	for (long start = 0; start < in; start += MINIMP3_MAX_SAMPLES_PER_FRAME / 2)
+	{
+		int frames = (in - start < MINIMP3_MAX_SAMPLES_PER_FRAME / 2) ? (int) (in - start)
+				: MINIMP3_MAX_SAMPLES_PER_FRAME / 2;
+		toneBlock (&block, start, frames, 1, inRate );
+		feed (block.data (), frames, 1, nullptr, &count );
+	}
+	std::vector<int16_t> silence (taps[quality] / 2);
+	feed (silence.data (), (int) silence.size (), 1, nullptr, &count );
+
+	double expect = (double) in * outRate / inRate;
+	CHECK(fabs (count - expect ) <= 1.0);
+	if (fabs (count - expect ) > 1.0)
+	{
+		printf ("  %s %d -> %d: %ld frames, expected %.1f\n", names[quality], inRate, outRate, count, expect );
+	}
+}
+
+
+/**
+ * One second of the tone - how close is it to the exact one at 'outRate'?
+ * @return the SNR in dB
+ */
+static double toneSnr(int quality, int inRate, int outRate)
+{
+	resampler.configure (inRate, outRate, 1, (ResampleQuality) quality );
+	std::vector<int16_t> block;
+	std::vector<int16_t> out;
+	long count = 0;
+	toneBlock (&block, 0, inRate, 1, inRate );
+	for (int start = 0; start < inRate; start += MINIMP3_MAX_SAMPLES_PER_FRAME / 2)
+	{
+		int frames = (inRate - start < MINIMP3_MAX_SAMPLES_PER_FRAME / 2) ? (inRate - start)
+				: MINIMP3_MAX_SAMPLES_PER_FRAME / 2;
+		feed (&block[start], frames, 1, &out, &count );
+	}
+
+	double signal = 0;
+	double noise = 0;
+	for (long idx = SETTLE_FRAMES; idx < count; idx++)
+	{
+		double exact = TONE_LEVEL * sin (2.0 * M_PI * TONE_HZ * idx / outRate );
+		double error = out[idx] - exact;
+		signal += exact * exact;
+		noise += error * error;
+	}
+	return (10.0 * log10 (signal / noise ));
+}
+
+
+/**
+ * The same input, pushed in pieces of 'sizes' (round and round) - the
+ * output, all of it.
+ */
+static std::vector<int16_t> pushedAs(const std::vector<int> &sizes, const std::vector<int16_t> &in, int channels)
+{
+	std::vector<int16_t> out;
+	long count = 0;
+	int frames = (int) in.size () / channels;
+	size_t next = 0;
+	for (int start = 0; start < frames;)
+	{
+		int len = sizes[next++ % sizes.size ()];
+		if (len > frames - start) len = frames - start;
+		feed (&in[start * channels], len, channels, &out, &count );
+		start += len;
+	}
+	return (out);
+}
+
+
+static void testPushSizes(int quality, int inRate, int outRate, int channels)
+{
+	std::vector<int16_t> in;
+	toneBlock (&in, 0, inRate / 4, channels, inRate );
+
+	resampler.configure (inRate, outRate, channels, (ResampleQuality) quality );
+	std::vector<int16_t> whole = pushedAs ( { MINIMP3_MAX_SAMPLES_PER_FRAME / 2 }, in, channels );
+	CHECK(!whole.empty ());
+
+	const std::vector<int> pieces[] = { { 1 }, { 7, 300, 1, 1152, 33 }, { 576 } };
+	for (const std::vector<int> &sizes : pieces)
+	{
+		resampler.reset ();
+		CHECK(pushedAs (sizes, in, channels ) == whole);
+	}
+}
+
+
+int main(int argc, char **argv)
+{
+	int seconds = (argc > 1) ? atoi (argv[1] ) : 600;
+	esp_log_level_set ("*", ESP_LOG_WARN );
+
+	printf ("SNR of a %d Hz tone (dB)\n  %-10s", TONE_HZ, "" );
+	for (const int *pair : rates)
+	{
+		printf (" %6d->%-6d", pair[0], pair[1] );
+	}
+	printf ("\n" );
+	for (int quality = RESAMPLE_FAST; quality <= RESAMPLE_BEST; quality++)
+	{
+		printf ("  %-10s", names[quality] );
+		for (const int *pair : rates)
+		{
+			double snr = toneSnr (quality, pair[0], pair[1] );
+			printf (" %13.1f", snr );
+			CHECK(snr > snrFloor[quality]);
+		}
+		printf ("\n" );
+
+		for (const int *pair : rates)
+		{
+			testDrift (quality, pair[0], pair[1], seconds );
+			testPushSizes (quality, pair[0], pair[1], 1 );
+			testPushSizes (quality, pair[0], pair[1], 2 );
+		}
+	}
+	printf ("%d seconds of each, pushed a frame at a time - no drift\n", seconds );
+	return (hostTestResult ("resampler_test" ));
+}
@@ -0,0 +1,214 @@
+/**
+ * SwitchBoardInboxTest.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ * Drivers with their own delivery task (SwitchBoard::registerDriver with
+ * a core). Several senders flood a slow driver on its own task and a fast
+ * one on the SwitchBoard task: each sender's messages must reach each
+ * driver in the order they were sent, and none may be lost - while the
+ * slow driver's callBack sends (and takes the SwitchBoard lock) with its
+ * inbox full. Then de-registering: it must not return while the driver's
+ * callBack is still running, and a driver can de-register itself.
+ */
+
+#include "Sequencer/SwitchBoard.h"
+#include "HostTest.h"
+
+#define EVENT_SEQ    100
+#define EVENT_ECHO   101
+#define EVENT_SLOW   102
+#define EVENT_QUIT   103
+#define EVENT_STATE  104
+
+#define SENDERS 3
+#define PER_SENDER 400
+
+// 'value' is who sent it, and its number
+#define SEQ_VALUE(sender, seq) (((long) (sender) << 16) | (long) (seq))
+#define SEQ_SENDER(value) ((int) ((value) >> 16))
+#define SEQ_NUMBER(value) ((int) ((value) & 0xFFFF))
+
+class OrderSink : public DeviceDef
+{
+public:
+	OrderSink (bool _slow) : DeviceDef("OrderSink"), slow(_slow)
+	{
+		for (int idx = 0; idx < SENDERS; idx++) last[idx] = -1;
+	}
+
+	void callBack(const Message *msg)
+	{
+		if (gone.load ()) afterGone++;
+		switch (msg->event)
+		{
+			case EVENT_SEQ:
+			{
+				int sender = SEQ_SENDER(msg->value );
+				int seq = SEQ_NUMBER(msg->value );
+				if ((sender < 0) || (sender >= SENDERS) || (seq != last[sender] + 1)) outOfOrder++;
+				else last[sender] = seq;
+				received++;
+				if (slow)
+				{   // Hold things up (so the inbox fills), and talk back while we do
+					if ((seq % 8) == 0) vTaskDelay (1 );
+					SwitchBoard::send (Message::create_message (TASK_NAME::UDP, TASK_NAME::TEST, EVENT_ECHO, 0, 0 ));
+					echoesSent++;
+					if ((seq % 50) == 0) SwitchBoard::registerStateEvent (TASK_NAME::UDP, EVENT_STATE );
+				}
+				break;
+			}
+			case EVENT_ECHO:
+				echoes++;
+				break;
+			case EVENT_SLOW:
+				inSlow.store (true );
+				vTaskDelay (30 );
+				slowDone.store (true );
+				inSlow.store (false );
+				break;
+			case EVENT_QUIT:
+				SwitchBoard::deRegisterDriver (TASK_NAME::TEST );
+				quit.store (true );
+				break;
+		}
+	}
+
+	bool slow;
+	int last[SENDERS];
+	std::atomic<int> received { 0 };
+	std::atomic<int> outOfOrder { 0 };
+	std::atomic<int> echoes { 0 };
+	std::atomic<int> echoesSent { 0 };
+	std::atomic<bool> inSlow { false };
+	std::atomic<bool> slowDone { false };
+	std::atomic<bool> quit { false };
+	std::atomic<bool> gone { false };
+	std::atomic<int> afterGone { 0 };
+};
+
+static std::atomic<int> sendersDone(0);
+
+
+// Wait (up to 'msec') for 'done' to be true
+template<typename Done>
+static bool waitFor(int msec, Done done)
+{
+	for (int idx = 0; (idx < msec) && !done (); idx++)
+	{
+		vTaskDelay (1 );
+	}
+	return (done ());
+}
+
+
+static void senderTask(void *arg)
+{
+	int sender = (int) (intptr_t) arg;
+	for (int seq = 0; seq < PER_SENDER; seq++)
+	{
+		SwitchBoard::send (Message::create_message (TASK_NAME::TEST, TASK_NAME::IDLER, EVENT_SEQ,
+				SEQ_VALUE(sender, seq ), 0 ));
+		SwitchBoard::send (Message::create_message (TASK_NAME::UDP, TASK_NAME::IDLER, EVENT_SEQ,
+				SEQ_VALUE(sender, seq ), 0 ));
+	}
+	sendersDone++;
+	vTaskDelete (nullptr );
+}
+
+
+static void testOrder()
+{
+	OrderSink *slow = new OrderSink(true);
+	OrderSink *fast = new OrderSink(false);
+	SwitchBoard::registerDriver (TASK_NAME::TEST, slow, 0 );
+	SwitchBoard::registerDriver (TASK_NAME::UDP, fast );
+	uint32_t dropsBefore = SwitchBoard::getDropCount ();
+
+	for (int sender = 0; sender < SENDERS; sender++)
+	{
+		xTaskCreate (&senderTask, "sender", 4096, (void *) (intptr_t) sender, 2, nullptr );
+	}
+	bool finished = waitFor (10000, [slow, fast] {
+		return ((sendersDone.load () == SENDERS) && (slow->received.load () == SENDERS * PER_SENDER)
+				&& (fast->received.load () == SENDERS * PER_SENDER)); } );
+	CHECK(finished);
+	if (!finished)
+	{   // (Stuck - the rest would just wait for ever)
+		printf ("order: stuck after %d / %d messages\n", slow->received.load (), fast->received.load () );
+		return;
+	}
+	waitFor (1000, [slow, fast, dropsBefore] {
+		return (fast->echoes.load () + SwitchBoard::getDropCount () - dropsBefore >= (uint32_t) slow->echoesSent.load ()); } );
+
+	uint32_t drops = SwitchBoard::getDropCount () - dropsBefore;
+	printf ("order: %d messages each, %d echoes (%u dropped)\n", slow->received.load (),
+			fast->echoes.load (), drops );
+	CHECK_EQ(slow->outOfOrder.load (), 0);
+	CHECK_EQ(fast->outOfOrder.load (), 0);
+	for (int sender = 0; sender < SENDERS; sender++)
+	{
+		CHECK_EQ(slow->last[sender], PER_SENDER - 1);
+		CHECK_EQ(fast->last[sender], PER_SENDER - 1);
+	}
+	// Only the driver task's own sends may be dropped (it can't BLOCK)
+	CHECK_EQ(fast->echoes.load () + (int) drops, slow->echoesSent.load ());
+
+	SwitchBoard::deRegisterDriver (TASK_NAME::TEST );
+	SwitchBoard::deRegisterDriver (TASK_NAME::UDP );
+	delete slow;
+	delete fast;
+}
+
+
+static void testDeRegister()
+{
+	OrderSink *sink = new OrderSink(false);
+	SwitchBoard::registerDriver (TASK_NAME::TEST, sink, 0 );
+
+	SwitchBoard::send (Message::create_message (TASK_NAME::TEST, TASK_NAME::IDLER, EVENT_SLOW, 0, 0 ));
+	for (int idx = 0; idx < 8; idx++)
+	{
+		SwitchBoard::send (Message::create_message (TASK_NAME::TEST, TASK_NAME::IDLER, EVENT_ECHO, 0, 0 ));
+	}
+	CHECK(waitFor (1000, [sink] { return (sink->inSlow.load ()); } ));
+
+	// Must wait for the callBack - and deliver nothing after it
+	SwitchBoard::deRegisterDriver (TASK_NAME::TEST );
+	CHECK(sink->slowDone.load ());
+	CHECK(!sink->inSlow.load ());
+	sink->gone.store (true );
+	vTaskDelay (20 );
+	CHECK_EQ(sink->afterGone.load (), 0);
+	delete sink;
+
+	// A driver that de-registers itself (it can't wait for itself)
+	sink = new OrderSink(false);
+	SwitchBoard::registerDriver (TASK_NAME::TEST, sink, 0 );
+	SwitchBoard::send (Message::create_message (TASK_NAME::TEST, TASK_NAME::IDLER, EVENT_QUIT, 0, 0 ));
+	CHECK(waitFor (1000, [sink] { return (sink->quit.load ()); } ));
+	CHECK(!SwitchBoard::isRegistered (TASK_NAME::TEST ));
+	vTaskDelay (20 );
+
+	// ...and it can come back
+	SwitchBoard::registerDriver (TASK_NAME::TEST, sink, 0 );
+	SwitchBoard::send (Message::create_message (TASK_NAME::TEST, TASK_NAME::IDLER, EVENT_ECHO, 0, 0 ));
+	CHECK(waitFor (1000, [sink] { return (sink->echoes.load () == 1); } ));
+	SwitchBoard::deRegisterDriver (TASK_NAME::TEST );
+	delete sink;
+
+	MessagePoolStats stats;
+	Message::getPoolStats (&stats );
+	CHECK_EQ(stats.inUse, 0);
+}
+
+
+int main()
+{
+	esp_log_level_set ("*", ESP_LOG_ERROR );
+	hostStartSwitchBoard ();
+	testOrder ();
+	testDeRegister ();
+	return (hostTestResult ("switchboard_inbox_test" ));
+}
@@ -0,0 +1,250 @@
+/**
+ * SwitchBoardTimerTest.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ * SwitchBoard::sendAt on the (real) host clock - timed messages arrive in
+ * deadline order and never early. Then with the queue full and the
+ * delivery task stuck in a callBack: the esp_timer task must carry on (the
+ * playback clock shares it), and nothing is lost once things get going
+ * again.
+ *
+ * Last, requests: each one answered in turn, for many more than fit in the
+ * timer queue - an answered request's timeout must not stay there - and
+ * one that isn't answered times out.
+ */
+
+#include <algorithm>
+#include "freertos/semphr.h"
+#include "Sequencer/SwitchBoard.h"
+#include "HostTest.h"
+
+#define EVENT_TIMED 100
+#define EVENT_STALL 101
+#define EVENT_FILL  102
+#define EVENT_ASK   103
+
+#define TIMED_COUNT 16
+#define FILL_COUNT (SWITCHBOARD_QUEUE_SIZE + 8)
+#define ASK_COUNT (SWITCHBOARD_TIMER_QUEUE_SIZE * 3)
+#define ASK_TIMEOUT_MSEC 300
+
+class TimedSink : public DeviceDef
+{
+public:
+	TimedSink () : DeviceDef("TimedSink")
+	{
+		gate = xSemaphoreCreateBinary ();
+	}
+
+	void callBack(const Message *msg)
+	{
+		if (msg->event == EVENT_STALL)
+		{
+			xSemaphoreTake (gate, portMAX_DELAY );
+		}
+		else if (msg->event == EVENT_TIMED)
+		{
+			int idx = timed.load ();
+			if (idx < TIMED_COUNT)
+			{
+				deadline[idx] = (TIME_t) msg->value;
+				arrived[idx] = (TIME_t) esp_timer_get_time ();
+			}
+			timed++;
+		}
+		else if (msg->event == EVENT_FILL)
+		{
+			filled++;
+		}
+		else if ((msg->event == EVENT_ASK) && answer)
+		{
+			SwitchBoard::send (Message::create_reply (msg, msg->value * 2, 0 ));
+		}
+	}
+
+	SemaphoreHandle_t gate;
+	std::atomic<int> timed { 0 };
+	std::atomic<int> filled { 0 };
+	std::atomic<bool> answer { true };
+	TIME_t deadline[TIMED_COUNT];
+	TIME_t arrived[TIMED_COUNT];
+};
+
+static TimedSink *sink;
+static std::atomic<uint32_t> probeTicks(0);
+
+
+// Wait (up to 'msec') for 'done' to be true
+template<typename Done>
+static bool waitFor(int msec, Done done)
+{
+	for (int idx = 0; (idx < msec) && !done (); idx++)
+	{
+		vTaskDelay (1 );
+	}
+	return (done ());
+}
+
+
+static void sendTimed(int idx, TIME_t due)
+{
+	CHECK(SwitchBoard::sendAt (Message::create_message (TASK_NAME::TEST, TASK_NAME::IDLER,
+			EVENT_TIMED, (long) due, idx ), due ));
+}
+
+
+static void testOrder()
+{
+	uint32_t seed = 99;
+	TIME_t now = esp_timer_get_time ();
+	sink->timed = 0;
+	SwitchBoard::resetTimerJitter ();
+
+	for (int idx = 0; idx < TIMED_COUNT; idx++)
+	{
+		seed = seed * 1103515245 + 12345;
+		sendTimed (idx, now + 2000 + ((seed >> 8) % 30000) );
+	}
+	CHECK(waitFor (2000, [] { return (sink->timed.load () >= TIMED_COUNT); } ));
+	CHECK_EQ(sink->timed.load (), TIMED_COUNT);
+	for (int idx = 0; idx < TIMED_COUNT; idx++)
+	{
+		CHECK(sink->arrived[idx] >= sink->deadline[idx]);
+		if (idx > 0) CHECK(sink->deadline[idx] >= sink->deadline[idx - 1]);
+	}
+
+	TimerJitterStats jitter;
+	SwitchBoard::getTimerJitter (&jitter );
+	CHECK_EQ(jitter.count, TIMED_COUNT);
+	printf ("timed: late by min %u, avg %u, max %u usec\n", jitter.minUsec,
+			(uint32_t) (jitter.totalUsec / jitter.count), jitter.maxUsec );
+}
+
+
+static void fillTask(void *arg)
+{
+	for (int idx = 0; idx < FILL_COUNT; idx++)
+	{   // (blocks when the queue is full - the default policy)
+		SwitchBoard::send (Message::create_message (TASK_NAME::TEST, TASK_NAME::IDLER, EVENT_FILL, idx, 0 ));
+	}
+	vTaskDelete (nullptr );
+}
+
+
+static void probe(void *arg)
+{
+	probeTicks++;
+}
+
+
+static void testStalled()
+{
+	esp_timer_handle_t probeTimer;
+	esp_timer_create_args_t args = { };
+	args.callback = &probe;
+	args.name = "probe";
+	ESP_ERROR_CHECK(esp_timer_create (&args, &probeTimer ));
+	ESP_ERROR_CHECK(esp_timer_start_periodic (probeTimer, 1000 ));
+
+	uint32_t dropsBefore = SwitchBoard::getDropCount ();
+	sink->timed = 0;
+	sink->filled = 0;
+
+	// Stop the delivery task, and fill the queue behind it
+	SwitchBoard::send (Message::create_message (TASK_NAME::TEST, TASK_NAME::IDLER, EVENT_STALL, 0, 0 ));
+	xTaskCreate (&fillTask, "fill", 4096, nullptr, 2, nullptr );
+	vTaskDelay (20 );
+
+	TIME_t now = esp_timer_get_time ();
+	for (int idx = 0; idx < TIMED_COUNT; idx++)
+	{
+		sendTimed (idx, now + 5000 + idx * 100 );
+	}
+
+	// The timed messages fall due while everything is stuck...
+	uint32_t ticksBefore = probeTicks.load ();
+	vTaskDelay (50 );
+	uint32_t ticks = probeTicks.load () - ticksBefore;
+	printf ("stalled: the probe timer ran %u times in 50 msec\n", ticks );
+	CHECK(ticks >= 20);
+	CHECK_EQ(sink->timed.load (), 0);
+
+	// ...and they all get through once it is going again
+	xSemaphoreGive (sink->gate );
+	CHECK(waitFor (2000, [] { return ((sink->filled.load () >= FILL_COUNT)
+			&& (sink->timed.load () >= TIMED_COUNT)); } ));
+	CHECK_EQ(sink->filled.load (), FILL_COUNT);
+	CHECK_EQ(sink->timed.load (), TIMED_COUNT);
+	CHECK_EQ(SwitchBoard::getDropCount () - dropsBefore, 0);
+	for (int idx = 1; idx < TIMED_COUNT; idx++)
+	{
+		CHECK(sink->deadline[idx] >= sink->deadline[idx - 1]);
+	}
+	esp_timer_stop (probeTimer );
+}
+
+
+static void testRequests()
+{
+	std::atomic<int> answered(0);
+	std::atomic<int> timedOut(0);
+	std::atomic<int> wrong(0);
+	uint32_t dropsBefore = SwitchBoard::getDropCount ();
+
+	// One after another - each waits for the last to be answered
+	for (int idx = 0; idx < ASK_COUNT; idx++)
+	{
+		uint16_t corrId = SwitchBoard::request (Message::create_message (TASK_NAME::TEST, TASK_NAME::IDLER,
+				EVENT_ASK, idx, 0 ), [&, idx](const Message *reply)
+		{
+			if (reply->event == EVENT_ACTION_TIMEOUT) timedOut++;
+			else if (reply->value != idx * 2) wrong++;
+			answered++;
+		}, ASK_TIMEOUT_MSEC );
+		CHECK(corrId != 0);
+		if (corrId == 0) break;
+		CHECK(waitFor (1000, [&] { return (answered.load () > idx); } ));
+	}
+	CHECK_EQ(answered.load (), ASK_COUNT);
+	CHECK_EQ(wrong.load (), 0);
+
+	// None of the timeouts should still be to come
+	vTaskDelay (ASK_TIMEOUT_MSEC + 100 );
+	CHECK_EQ(answered.load (), ASK_COUNT);
+	CHECK_EQ(timedOut.load (), 0);
+	CHECK_EQ(SwitchBoard::getDropCount () - dropsBefore, 0);
+	printf ("requests: %d answered in turn, no timeouts left behind\n", answered.load () );
+
+	// An unanswered one times out - once
+	sink->answer = false;
+	answered = 0;
+	CHECK(SwitchBoard::request (Message::create_message (TASK_NAME::TEST, TASK_NAME::IDLER,
+			EVENT_ASK, 0, 0 ), [&](const Message *reply)
+	{
+		if (reply->event == EVENT_ACTION_TIMEOUT) timedOut++;
+		answered++;
+	}, 20 ) != 0);
+	CHECK(waitFor (1000, [&] { return (answered.load () > 0); } ));
+	vTaskDelay (50 );
+	CHECK_EQ(answered.load (), 1);
+	CHECK_EQ(timedOut.load (), 1);
+	sink->answer = true;
+}
+
+
+int main()
+{
+	esp_log_level_set ("*", ESP_LOG_WARN );
+	hostStartSwitchBoard ();
+	sink = new TimedSink();
+	SwitchBoard::registerDriver (TASK_NAME::TEST, sink );
+
+	testOrder ();
+	testStalled ();
+	testRequests ();
+
+	SwitchBoard::deRegisterDriver (TASK_NAME::TEST );
+	return (hostTestResult ("switchboard_timer_test" ));
+}
@@ -0,0 +1,213 @@
+/**
+ * TimerQueueTest.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ * Sequencer/TimerQueue.h, on a simulated clock - messages come out in
+ * deadline order (ties in the order they went in), never early, and the
+ * jitter is how far the clock had got past each deadline. A reply taken
+ * out early (removeReply) leaves the rest in order.
+ */
+
+#include "Sequencer/TimerQueue.h"
+#include "HostTest.h"
+
+// The simulated clock moves on this much at a time
+#define TICK_USEC 250
+
+static uint32_t seed = 12345;
+
+static uint32_t nextRandom()
+{
+	seed = seed * 1103515245 + 12345;
+	return ((seed >> 8) & 0xFFFFFF);
+}
+
+
+static Message *timed(int order)
+{
+	return (Message::create_message (TASK_NAME::TEST, TASK_NAME::IDLER, 100, order, 0 ));
+}
+
+
+static void testOrder()
+{
+	TimerQueue *queue = new TimerQueue();
+	TIME_t deadlines[SWITCHBOARD_TIMER_QUEUE_SIZE];
+	TIME_t start = 1000000;
+	TIME_t deadline;
+
+	CHECK(!queue->nextDeadline (&deadline ));
+	CHECK(queue->popDue (start + 100000000 ) == nullptr);
+
+	// Random times in the next 20 msec - every fourth one the same as the last
+	TIME_t earliest = UINT64_MAX;
+	for (int idx = 0; idx < SWITCHBOARD_TIMER_QUEUE_SIZE; idx++)
+	{
+		deadlines[idx] = ((idx % 4) == 3) ? deadlines[idx - 1] : start + (nextRandom () % 20000);
+		if (deadlines[idx] < earliest) earliest = deadlines[idx];
+		CHECK(queue->insert (timed (idx ), deadlines[idx] ));
+	}
+	Message *extra = timed (-1 );
+	CHECK(!queue->insert (extra, start ));
+	delete extra;
+	CHECK_EQ(queue->size (), SWITCHBOARD_TIMER_QUEUE_SIZE);
+	CHECK(queue->nextDeadline (&deadline ));
+	CHECK_EQ(deadline, earliest);
+
+	// Run the clock, taking out whatever is due at each tick
+	TIME_t lastDeadline = 0;
+	int lastOrder = -1;
+	uint32_t expectMax = 0;
+	uint64_t expectTotal = 0;
+	int popped = 0;
+	for (TIME_t now = start; (now < start + 30000) && (popped < SWITCHBOARD_TIMER_QUEUE_SIZE); now += TICK_USEC)
+	{
+		Message *msg;
+		while ((msg = queue->popDue (now )) != nullptr)
+		{
+			TIME_t due = deadlines[msg->value];
+			CHECK(due <= now);
+			CHECK(due > now - TICK_USEC);
+			CHECK(due >= lastDeadline);
+			if (due == lastDeadline) CHECK(msg->value > lastOrder);
+			lastDeadline = due;
+			lastOrder = (int) msg->value;
+			if (now - due > expectMax) expectMax = (uint32_t) (now - due);
+			expectTotal += now - due;
+			popped++;
+			delete msg;
+		}
+		if (queue->nextDeadline (&deadline )) CHECK(deadline > now);
+	}
+	CHECK_EQ(popped, SWITCHBOARD_TIMER_QUEUE_SIZE);
+	CHECK_EQ(queue->size (), 0);
+
+	TimerJitterStats jitter;
+	queue->getJitter (&jitter );
+	CHECK_EQ(jitter.count, SWITCHBOARD_TIMER_QUEUE_SIZE);
+	CHECK_EQ(jitter.maxUsec, expectMax);
+	CHECK_EQ(jitter.totalUsec, expectTotal);
+	CHECK(jitter.minUsec <= jitter.maxUsec);
+	CHECK(jitter.maxUsec < TICK_USEC);
+
+	queue->resetJitter ();
+	queue->getJitter (&jitter );
+	CHECK_EQ(jitter.count, 0);
+	CHECK_EQ(jitter.totalUsec, 0);
+	delete queue;
+}
+
+
+/**
+ * Keep it busy - take out a few, put in a few more - for a long time,
+ * on a clock that jumps by random amounts.
+ */
+static void testChurn()
+{
+	TimerQueue *queue = new TimerQueue();
+	TIME_t now = 0;
+	int inserted = 0;
+	int popped = 0;
+
+	for (int round = 0; round < 20000; round++)
+	{
+		while ((queue->size () < SWITCHBOARD_TIMER_QUEUE_SIZE) && ((nextRandom () % 3) != 0))
+		{
+			TIME_t due = now + 1 + (nextRandom () % 5000);
+			// ('value' is the deadline, so we can check it when it comes out)
+			Message *msg = Message::create_message (TASK_NAME::TEST, TASK_NAME::IDLER, 100, (long) due, 0 );
+			CHECK(queue->insert (msg, due ));
+			inserted++;
+		}
+		now += nextRandom () % 1000;
+		// (one tick's messages come out earliest first)
+		TIME_t lastDue = 0;
+		Message *msg;
+		while ((msg = queue->popDue (now )) != nullptr)
+		{
+			CHECK((TIME_t) msg->value <= now);
+			CHECK((TIME_t) msg->value >= lastDue);
+			lastDue = (TIME_t) msg->value;
+			popped++;
+			delete msg;
+		}
+	}
+	Message *msg;
+	while ((msg = queue->popAny ()) != nullptr)
+	{
+		CHECK((TIME_t) msg->value > now);
+		popped++;
+		delete msg;
+	}
+	CHECK_EQ(popped, inserted);
+
+	MessagePoolStats stats;
+	Message::getPoolStats (&stats );
+	CHECK_EQ(stats.inUse, 0);
+	delete queue;
+}
+
+
+/**
+ * Take replies out from all over the heap - what's left still comes out
+ * in order.
+ */
+static void testRemoveReply()
+{
+	const int REPLIES = SWITCHBOARD_TIMER_QUEUE_SIZE - 1;
+	TimerQueue *queue = new TimerQueue();
+	Message *request = timed (0 );
+	for (int idx = 0; idx < REPLIES; idx++)
+	{
+		request->corrId = (uint16_t) (idx + 1);
+		Message *reply = Message::create_reply (request, 0, 0 );
+		reply->value = (long) (1000 + (nextRandom () % 20000));
+		CHECK(queue->insert (reply, (TIME_t) reply->value ));
+	}
+	// (a timed message that isn't a reply is never taken)
+	request->corrId = 0;
+	CHECK(queue->insert (request, 500 ));
+	CHECK(queue->removeReply (0 ) == nullptr);
+	CHECK(queue->removeReply (REPLIES + 1 ) == nullptr);
+
+	int removed = 0;
+	for (int idx = 0; idx < REPLIES; idx += 3)
+	{
+		Message *reply = queue->removeReply ((uint16_t) (idx + 1) );
+		CHECK(reply != nullptr);
+		if (reply == nullptr) continue;
+		CHECK_EQ(reply->corrId, idx + 1);
+		CHECK(queue->removeReply ((uint16_t) (idx + 1) ) == nullptr);
+		removed++;
+		delete reply;
+	}
+	CHECK_EQ(queue->size (), (size_t) (SWITCHBOARD_TIMER_QUEUE_SIZE - removed));
+	CHECK(queue->popDue (500 ) == request);
+	delete request;
+
+	TIME_t lastDue = 0;
+	int left = 0;
+	Message *msg;
+	while ((msg = queue->popDue (UINT64_MAX / 2 )) != nullptr)
+	{
+		CHECK((TIME_t) msg->value >= lastDue);
+		CHECK(((msg->corrId - 1) % 3) != 0);
+		lastDue = (TIME_t) msg->value;
+		left++;
+		delete msg;
+	}
+	CHECK_EQ(left, REPLIES - removed);
+	delete queue;
+}
+
+
+int main()
+{
+	esp_log_level_set ("*", ESP_LOG_ERROR );
+	testOrder ();
+	testRemoveReply ();
+	testChurn ();
+	return (hostTestResult ("timer_queue_test" ));
+}
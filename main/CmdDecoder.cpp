@@ -23,6 +23,7 @@
 
  */
 #include <stdlib.h>
+#include <stdio.h>
 #include <strings.h>
 #include <string.h>
 #include <ctype.h>
@@ -30,7 +31,10 @@
 #include "Sequencer/Message.h"
 #include "Sequencer/SwitchBoard.h"
 #include "Sequencer/DeviceDef.h"
+#include "Sequencer/SwitchBoardBench.h"
 #include "SndPlayer.h"
+#include "audio/PlaybackClock.h"
+#include "audio/AssetIndex.h"
 #include "config.h"
 #include "Parameters/RmNvs.h"
 #include "Stepper/StepperDriver.h"
@@ -185,6 +189,16 @@ void CmdDecoder::help() {
 	postResponse("   Get: Absolute, Relative, Lower, Upper, Time", RESPONSE_MORE);
 	postResponse("   Set: Home, Lower, Upper, Ramp",  RESPONSE_MORE);
 	postResponse("   Rotate: Absolute, Relative, Home, Lower, Upper",  RESPONSE_MORE);
+	postResponse(" stats [reset] - SwitchBoard delivery statistics (times in usec)", RESPONSE_MORE);
+	postResponse(" bench [n] - time n (1000) messages with 1, 2 and 4 senders", RESPONSE_MORE);
+	postResponse(" audio [reset] - audio pipeline buffer statistics", RESPONSE_MORE);
+	postResponse(" prescan - make the eye/jaw tracks for the clips (when stopped)", RESPONSE_MORE);
+	postResponse(" clips - list the clips, and the playlist", RESPONSE_MORE);
+	postResponse(" play <clip> - play a clip now;  enqueue <clip> - play it next;  next - skip", RESPONSE_MORE);
+	postResponse("   (<clip> is the ID from 'clips', or the file name)", RESPONSE_MORE);
+	postResponse(" seek <msec> [clip] - play from there (this clip, or that one)", RESPONSE_MORE);
+	postResponse(" cue [n [set]] - list the cue points, go to cue n, or set it to here", RESPONSE_MORE);
+	postResponse(" sfx <clip> [volume%] - play a clip over the music (100%)", RESPONSE_MORE);
 	postResponse("  ",RESPONSE_OK);
 }
 
@@ -311,6 +325,57 @@ void CmdDecoder::dispatchCommand (int tokCount, char *tokens[])
 	{
 		stepperCommands (tokCount, tokens );
 
+	}	else if (ISCMD("BENCH" )) // BENCH <message count>
+	{
+		if (requireArgs (tokCount, tokens, 2, &val, nullptr ))
+		{
+			runBench (val );
+		}
+
+	}	else if (ISCMD("AUDIO" )) // AUDIO RESET
+	{
+		if ((tokCount == 2) && ISSUBCMD("RESET" ))
+		{
+			SndPlayer::resetPipelineStats ();
+			postResponse ("OK", RESPONSE_OK );
+		}
+		else
+		{
+			postResponse ("Usage: audio [reset]", RESPONSE_SYNTAX );
+		}
+
+	}	else if (ISCMD("PLAY" )) // PLAY <clip>
+	{
+		clipCommand (tokCount, tokens, SND_EVENT_PLAYER_PLAY );
+
+	}	else if (ISCMD("ENQUEUE" )) // ENQUEUE <clip>
+	{
+		clipCommand (tokCount, tokens, SND_EVENT_PLAYER_ENQUEUE );
+
+	}	else if (ISCMD("SEEK" )) // SEEK <msec> [clip]
+	{
+		seekCommand (tokCount, tokens );
+
+	}	else if (ISCMD("CUE" )) // CUE <n> [SET]
+	{
+		cueCommand (tokCount, tokens );
+
+	}	else if (ISCMD("SFX" )) // SFX <clip> [volume%]
+	{
+		sfxCommand (tokCount, tokens );
+
+	}	else if (ISCMD("STATS" )) // STATS RESET
+	{
+		if ((tokCount == 2) && ISSUBCMD("RESET" ))
+		{
+			SwitchBoard::resetStats ();
+			postResponse ("OK", RESPONSE_OK );
+		}
+		else
+		{
+			postResponse ("Usage: stats [reset]", RESPONSE_SYNTAX );
+		}
+
 	} else	{
 		ESP_LOGD(TAG, "Dispatch - unknown command" );
 		postResponse ("UNKNOWN COMMAND", RESPONSE_UNKNOWN );
@@ -333,6 +398,15 @@ void CmdDecoder::noArguments(int tokCount, char *tokens[])
 	} else if (ISCMD("SHOW")) { // ignore garbage, if any
 		showCurSettings();
 
+	} else if (ISCMD("STATS")) {
+		showStats();
+
+	} else if (ISCMD("AUDIO")) {
+		showAudioStats();
+
+	} else if (ISCMD("BENCH")) {
+		runBench(1000);
+
 	} else if (ISCMD("COMMIT")) {
 		RmNvs::commit();
 		postResponse("OK", RESPONSE_OK);
@@ -347,6 +421,27 @@ void CmdDecoder::noArguments(int tokCount, char *tokens[])
 		SwitchBoard::send(msg);
 		postResponse("OK", RESPONSE_OK);
 
+	} else if (ISCMD("PRESCAN")) {
+		msg=Message::create_message(TASK_NAME::WAVEFILE, senderTaskName, SND_EVENT_PLAYER_PRESCAN, 0, 0, nullptr);
+		SwitchBoard::send(msg);
+		postResponse("OK", RESPONSE_OK);
+
+	} else if (ISCMD("PLAY")) { // (same as RUN)
+		msg=Message::create_message(TASK_NAME::WAVEFILE, senderTaskName, SND_EVENT_PLAYER_START, 0, 0, nullptr);
+		SwitchBoard::send(msg);
+		postResponse("OK", RESPONSE_OK);
+
+	} else if (ISCMD("NEXT")) {
+		msg=Message::create_message(TASK_NAME::WAVEFILE, senderTaskName, SND_EVENT_PLAYER_NEXT, 0, 0, nullptr);
+		SwitchBoard::send(msg);
+		postResponse("OK", RESPONSE_OK);
+
+	} else if (ISCMD("CLIPS")) {
+		showClips();
+
+	} else if (ISCMD("CUE")) {
+		showCues();
+
 	} else if (ISCMD("STOP")) {
 		msg=Message::create_message(TASK_NAME::WAVEFILE, senderTaskName, SND_EVENT_PLAYER_REWIND, 0, 0, nullptr);
 		SwitchBoard::send(msg);
@@ -427,6 +522,326 @@ void CmdDecoder::showCurSettings() {
 }
 
 
+/*
+ * Output the SwitchBoard statistics (STATS)
+ *   - the totals, then one line for each destination that has had
+ *     any traffic. Times are in usec. The percentiles come from the
+ *     histogram buckets, so 'p99<64' means 99% took less than 64 usec.
+ */
+void CmdDecoder::showStats() {
+	char line[120];
+	MessagePoolStats pool;
+	TimerJitterStats jitter;
+
+	snprintf (line, sizeof(line), "queue hw=%u drops=%u coalesced=%u",
+			SwitchBoard::getQueueHighWater (), SwitchBoard::getDropCount (),
+			SwitchBoard::getCoalescedCount () );
+	postResponse (line, RESPONSE_MORE );
+
+	Message::getPoolStats (&pool );
+	snprintf (line, sizeof(line), "pool in use=%u/%u hw=%u allocs=%u exhausted=%u bad frees=%u",
+			pool.inUse, pool.capacity, pool.highWater, pool.allocCount, pool.exhaustedCount,
+			pool.badFreeCount );
+	postResponse (line, RESPONSE_MORE );
+
+	SwitchBoard::getTimerJitter (&jitter );
+	snprintf (line, sizeof(line), "timed n=%u late min=%u avg=%u max=%u",
+			jitter.count, jitter.minUsec,
+			(jitter.count == 0) ? 0 : (uint32_t) (jitter.totalUsec / jitter.count),
+			jitter.maxUsec );
+	postResponse (line, RESPONSE_MORE );
+
+#ifdef SWITCHBOARD_STATS
+	RouteStats route;
+	for (int idx = 0; idx < NO_OF_TASK_NAMES; idx++)
+	{
+		TASK_NAME task = static_cast<TASK_NAME> (idx );
+		SwitchBoard::getRouteStats (task, &route );
+		if ((route.delivered == 0) && (route.dropped == 0)) continue;
+		snprintf (line, sizeof(line),
+				"%s n=%u drop=%u hw=%u lat p50<%u p99<%u max=%u cb p50<%u p99<%u max=%u",
+				SwitchBoardStats::taskName (task ), route.delivered, route.dropped,
+				route.queueHighWater,
+				SwitchBoardStats::percentile (route.latency, 50 ),
+				SwitchBoardStats::percentile (route.latency, 99 ), route.latencyMaxUsec,
+				SwitchBoardStats::percentile (route.callback, 50 ),
+				SwitchBoardStats::percentile (route.callback, 99 ), route.callbackMaxUsec );
+		postResponse (line, RESPONSE_MORE );
+	}
+#else
+	postResponse ("(per-destination stats need SWITCHBOARD_STATS in config.h)", RESPONSE_MORE );
+#endif
+	postResponse ("END", RESPONSE_OK );
+}
+
+
+/*
+ * Output the audio pipeline statistics (AUDIO)
+ *   ring depths (now/most/size), and how often each stage had to wait.
+ */
+void CmdDecoder::showAudioStats() {
+	char line[120];
+	AudioPipelineStats stats;
+	SndPlayer::getPipelineStats (&stats );
+
+	snprintf (line, sizeof(line), "read window %u/%u/%u bytes  pcm ring %u/%u/%u  (now/most/size)",
+			stats.readDepth, stats.readHighWater, stats.readCapacity,
+			stats.pcmDepth, stats.pcmHighWater, stats.pcmCapacity );
+	postResponse (line, RESPONSE_MORE );
+	snprintf (line, sizeof(line), "reader stalls=%u  decoder underruns=%u stalls=%u  output underruns=%u",
+			stats.readerStalls, stats.decoderUnderruns, stats.decoderStalls, stats.outputUnderruns );
+	postResponse (line, RESPONSE_MORE );
+	snprintf (line, sizeof(line), "bytes read=%u (%u per read)  frames decoded=%u (%u usec each)",
+			stats.bytesRead, (stats.readCalls == 0) ? 0 : stats.bytesRead / stats.readCalls,
+			stats.framesDecoded,
+			(stats.framesDecoded == 0) ? 0 : (uint32_t) (stats.decodeUsec / stats.framesDecoded) );
+	postResponse (line, RESPONSE_MORE );
+	PlaybackPosition pos;
+	PlaybackClock::read (&pos );
+	snprintf (line, sizeof(line), "clock: %s  played=%u written=%u samples  position=%u msec",
+			pos.running ? "running" : "stopped", pos.samplesPlayed, pos.samplesWritten, pos.positionMsec );
+	postResponse (line, RESPONSE_MORE );
+	snprintf (line, sizeof(line), "output frames: direct=%u converted=%u  latency=%u usec (%u x %u frames)",
+			stats.outputDirect, stats.outputConverted, stats.outputLatencyUsec,
+			stats.dmaBufCount, stats.dmaBufLen );
+	postResponse (line, RESPONSE_MORE );
+	snprintf (line, sizeof(line), "output %u Hz  resampling from %u Hz  frames=%u (%u usec per 1000)",
+			stats.outputHz, stats.resampleFromHz, stats.framesResampled,
+			(stats.framesResampled == 0) ? 0 :
+					(uint32_t) (stats.resampleUsec * 1000 / stats.framesResampled) );
+	postResponse (line, RESPONSE_MORE );
+	uint32_t measured = stats.sfxStarted - stats.sfxLoaded;
+	snprintf (line, sizeof(line), "effects: playing=%u started=%u (%u loaded first, last %u msec) rejected=%u dropped=%u",
+			stats.sfxVoices, stats.sfxStarted, stats.sfxLoaded, stats.sfxLoadUsec / 1000,
+			stats.sfxRejected, stats.sfxDropped );
+	postResponse (line, RESPONSE_MORE );
+	snprintf (line, sizeof(line), "effect latency: last=%u avg=%u max=%u usec  mixed frames=%u (%u usec per 1000)",
+			stats.sfxLatencyUsec,
+			(measured == 0) ? 0 : (uint32_t) (stats.sfxLatencyTotalUsec / measured),
+			stats.sfxLatencyMaxUsec, stats.framesMixed,
+			(stats.framesMixed == 0) ? 0 : (uint32_t) (stats.mixUsec * 1000 / stats.framesMixed) );
+	postResponse (line, RESPONSE_MORE );
+	postResponse ("END", RESPONSE_OK );
+}
+
+
+/*
+ * PLAY or ENQUEUE a clip - by its ID, or its file name.
+ */
+void CmdDecoder::clipCommand(int tokCount, char *tokens[], int event) {
+	if (tokCount != 2)
+	{
+		postResponse ("Usage: play|enqueue <clip>", RESPONSE_SYNTAX );
+		return;
+	}
+
+	long int clip = clipArg (tokens[1] );
+	if (clip < 0) return;
+
+	Message *msg = Message::create_message (TASK_NAME::WAVEFILE, senderTaskName,
+			event, clip, 0, nullptr );
+	SwitchBoard::send (msg );
+	postResponse ("OK", RESPONSE_OK );
+}
+
+
+/*
+ * A clip - by its ID, or its file name.
+ * @return the clip ID, or -1 (and the error has been posted).
+ */
+long int CmdDecoder::clipArg(const char *token) {
+	char *endptr;
+	long int clip = strtol (token, &endptr, 10 );
+	if (*endptr != '\0') clip = AssetIndex::find (token );
+	if (AssetIndex::get (clip ) == nullptr)
+	{
+		postResponse ("ERROR - no such clip (see 'clips')", RESPONSE_COMMAND_ERRR );
+		return (-1);
+	}
+	return (clip);
+}
+
+
+/*
+ * SEEK <msec> [clip] - play from 'msec' in this clip (or the one given).
+ */
+void CmdDecoder::seekCommand(int tokCount, char *tokens[]) {
+	char *endptr;
+	if ((tokCount != 2) && (tokCount != 3))
+	{
+		postResponse ("Usage: seek <msec> [clip]", RESPONSE_SYNTAX );
+		return;
+	}
+	long int msec = strtol (tokens[1], &endptr, 10 );
+	if ((*endptr != '\0') || (msec < 0))
+	{
+		postResponse ("Invalid time (msec)", RESPONSE_SYNTAX );
+		return;
+	}
+	long int clip = -1;
+	if (tokCount == 3)
+	{
+		clip = clipArg (tokens[2] );
+		if (clip < 0) return;
+	}
+
+	Message *msg = Message::create_message (TASK_NAME::WAVEFILE, senderTaskName,
+			SND_EVENT_PLAYER_SEEK, msec, clip, nullptr );
+	SwitchBoard::send (msg );
+	postResponse ("OK", RESPONSE_OK );
+}
+
+
+/*
+ * SFX <clip> [volume%] - play a clip over the music (only while it is playing).
+ */
+void CmdDecoder::sfxCommand(int tokCount, char *tokens[]) {
+	char *endptr;
+	if ((tokCount != 2) && (tokCount != 3))
+	{
+		postResponse ("Usage: sfx <clip> [volume%]", RESPONSE_SYNTAX );
+		return;
+	}
+	long int volume = 100;
+	if (tokCount == 3)
+	{
+		volume = strtol (tokens[2], &endptr, 10 );
+		if ((*endptr != '\0') || (volume < 0) || (volume > 200))
+		{
+			postResponse ("Invalid volume (0...200%)", RESPONSE_SYNTAX );
+			return;
+		}
+	}
+	long int clip = clipArg (tokens[1] );
+	if (clip < 0) return;
+
+	Message *msg = Message::create_message (TASK_NAME::WAVEFILE, senderTaskName,
+			SND_EVENT_PLAYER_SFX, clip, volume, nullptr );
+	SwitchBoard::send (msg );
+	postResponse ("OK", RESPONSE_OK );
+}
+
+
+/*
+ * CUE <n>     - go to cue point n
+ * CUE <n> SET - make cue point n where we are now
+ */
+void CmdDecoder::cueCommand(int tokCount, char *tokens[]) {
+	char *endptr;
+	long int cue = strtol (tokens[1], &endptr, 10 );
+	if ((*endptr != '\0') || (cue < 0) || (cue >= CUE_MAX))
+	{
+		postResponse ("Invalid cue point number", RESPONSE_SYNTAX );
+		return;
+	}
+
+	int event = SND_EVENT_PLAYER_CUE;
+	if ((tokCount == 3) && (0 == strcasecmp (tokens[2], "SET" )))
+	{
+		event = SND_EVENT_PLAYER_SETCUE;
+	}
+	else if (tokCount != 2)
+	{
+		postResponse ("Usage: cue <n> [set]", RESPONSE_SYNTAX );
+		return;
+	}
+	else
+	{
+		CuePoint point;
+		if (!SndPlayer::getCue (cue, &point ))
+		{
+			postResponse ("ERROR - that cue point isn't set", RESPONSE_COMMAND_ERRR );
+			return;
+		}
+	}
+
+	Message *msg = Message::create_message (TASK_NAME::WAVEFILE, senderTaskName,
+			event, cue, 0, nullptr );
+	SwitchBoard::send (msg );
+	postResponse ("OK", RESPONSE_OK );
+}
+
+
+/*
+ * List the cue points (CUE).
+ */
+void CmdDecoder::showCues() {
+	char line[80];
+	CuePoint point;
+
+	for (int cue = 0; cue < CUE_MAX; cue++ )
+	{
+		if (!SndPlayer::getCue (cue, &point )) continue;
+		const Asset *asset = AssetIndex::get (point.clip );
+		snprintf (line, sizeof(line), "%d: clip %d (%s) at %u.%03u s", cue, point.clip,
+				(asset == nullptr) ? "?" : asset->name, point.msec / 1000, point.msec % 1000 );
+		postResponse (line, RESPONSE_MORE );
+	}
+	postResponse ("END", RESPONSE_OK );
+}
+
+
+/*
+ * List the clips (CLIPS), what is playing, and the playlist.
+ */
+void CmdDecoder::showClips() {
+	char line[120];
+	int ids[PLAYLIST_MAX];
+
+	for (int id = 0; id < AssetIndex::count (); id++ )
+	{
+		const Asset *asset = AssetIndex::get (id );
+		snprintf (line, sizeof(line), "%3d  %-32s %u bytes", id, asset->name, asset->size );
+		postResponse (line, RESPONSE_MORE );
+	}
+
+	int playing = SndPlayer::getCurrentClip ();
+	uint32_t msec = 0;
+	SndPlayer::getPosition (&playing, &msec );
+	int count = SndPlayer::getPlaylist (ids, PLAYLIST_MAX );
+	int len = snprintf (line, sizeof(line), "playing: %d at %u.%03u s  next:", playing,
+			msec / 1000, msec % 1000 );
+	for (int idx = 0; (idx < count) && (len < (int) sizeof(line) - 5); idx++ )
+	{
+		len += snprintf (&line[len], sizeof(line) - len, " %d", ids[idx] );
+	}
+	postResponse (line, RESPONSE_MORE );
+	postResponse ("END", RESPONSE_OK );
+}
+
+
+/*
+ * Run the SwitchBoard benchmark (BENCH) with 1, 2 and 4 senders,
+ *   sharing 'total' messages between them.
+ */
+void CmdDecoder::runBench(long int total) {
+	static const int producers[] = { 1, 2, 4 };
+	char line[120];
+	BenchResult result;
+
+	if ((total < 4) || (total > BENCH_MAX_MESSAGES))
+	{
+		snprintf (line, sizeof(line), "Message count must be 4...%d", BENCH_MAX_MESSAGES );
+		postResponse (line, RESPONSE_SYNTAX );
+		return;
+	}
+
+	for (int idx = 0; idx < (int) (sizeof(producers) / sizeof(producers[0])); idx++)
+	{
+		if (!SwitchBoardBench::run (producers[idx], total / producers[idx], &result ))
+		{
+			postResponse ("Benchmark failed - see log", RESPONSE_COMMAND_ERRR );
+			return;
+		}
+		snprintf (line, sizeof(line), "senders=%d got=%u/%u drop=%u msg/s=%u p50=%u p99=%u max=%u",
+				producers[idx], result.received, result.sent, result.dropped,
+				result.msgsPerSec, result.p50Usec, result.p99Usec, result.maxUsec );
+		postResponse (line, RESPONSE_MORE );
+	}
+	postResponse ("END", RESPONSE_OK );
+}
+
+
 /**
  * This will handle any 'set *' command...
  * it is called from dispaychCommand, which has already identified
@@ -686,11 +1101,40 @@ void CmdDecoder::stepperCommands (int tokCount, char *tokens[])
 	//ESP_LOGD(TAG,"stepperCommand: sender is %d",( static_cast<int> (senderTaskName)));
 
 	msg=Message::create_message(destination, senderTaskName, EVENT_STEPPER_EXECUTE_CMD, 0, 0, cmdBuf);
-	SwitchBoard::send(msg);
+	Responder respond = responder();
+	uint16_t corrId = SwitchBoard::request(msg,
+			[this, respond](const Message *reply) { stepperReply(respond, reply); },
+			CMD_REPLY_TIMEOUT_MS);
+	if (corrId == 0)
+	{
+		postResponse ("ERROR - too many commands in progress", RESPONSE_COMMAND_ERRR );
+	}
 	return;
 }
 
 
+/**
+ * The reply to a stepper command (or a timeout) - pass it on to the
+ * client that sent the command.
+ * (Called on the SwitchBoard task)
+ */
+void CmdDecoder::stepperReply(const Responder &respond, const Message *reply)
+{
+	if (reply->event == EVENT_ACTION_TIMEOUT)
+	{
+		respond ("ERROR - no reply from driver", RESPONSE_COMMAND_ERRR );
+	}
+	else if (strlen (reply->text() ) < 1)
+	{   // Assume a good response
+		respond ("OK", RESPONSE_OK );
+	}
+	else
+	{
+		respond (reply->text(), RESPONSE_OK );
+	}
+}
+
+
 /**
  * After a device processes a command from the command decoder, it may respond back
  * with a text message indicating its status. (At this time, only the stepper driver
@@ -716,14 +1160,14 @@ void CmdDecoder::callBack (const Message *msg)
 		switch (msg->event)
 		{
 			case (EVENT_STEPPER_EXECUTE_CMD):
-				if (strlen (msg->text ) < 1)
+				if (strlen (msg->text() ) < 1)
 				{
 					// Assume a good response
 					postResponse ("OK", RESPONSE_OK );
 				}
 				else
 				{
-					postResponse (msg->text, RESPONSE_OK );
+					postResponse (msg->text(), RESPONSE_OK );
 				}
 				break;
 
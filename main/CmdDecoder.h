@@ -9,6 +9,7 @@
  *
  * A separate instance is used for each input stream.
  */
+#include <functional>
 #include "freertos/FreeRTOS.h"
 #include "freertos/queue.h"
 #include "freertos/semphr.h"
@@ -23,6 +24,8 @@
 // Max length of a command line
 #define CMD_BUF_MAX_LEN 160
 #define MAX_ARGUMENT_COUNT 10
+// How long to wait for a driver to reply to a command
+#define CMD_REPLY_TIMEOUT_MS 2000
 /**
  * 'more' means we need more data. 'reply' means there
  * is a reply to the message. Messages are kept in a
@@ -42,6 +45,8 @@ public:
 		RESPONSE_MORE            // There is more to follow this statement...
 		};
 typedef responseStatus_enum responseStatus_t;
+// Sends a response to one client (see 'responder')
+typedef std::function<void (const char *respTxt, responseStatus_t respcode)> Responder;
 	CmdDecoder (TASK_NAME myId);
 	virtual ~CmdDecoder ();
 	void addEOLtoBuffer(void);
@@ -58,6 +63,17 @@ typedef responseStatus_enum responseStatus_t;
 	 *
 	 */
 	virtual void postResponse(const char *respTxt,  responseStatus_t respcode)=0;
+	/*
+	 * Replies to requests (e.g.: stepper commands) arrive later, on another
+	 * task, when another client may be talking to us. 'responder' returns
+	 * something that sends to the client that sent the current command - it
+	 * holds its own copy of whatever it needs to find that client.
+	 * The default is for a stream with only one client.
+	 */
+	virtual Responder responder()
+	{
+		return ([this](const char *respTxt, responseStatus_t respcode) { postResponse (respTxt, respcode ); });
+	}
 
 protected:
 	void parseCommand();
@@ -77,6 +93,17 @@ private:
 
 	int getIntArg(int tokNo, char *tokens[], int minVal, int maxVal);
 	void showCurSettings();
+	void showStats();
+	void runBench(long int total);
+	void showAudioStats();
+	void showClips();
+	void clipCommand(int tokCount, char *tokens[], int event);
+	long int clipArg(const char *token);
+	void seekCommand(int tokCount, char *tokens[]);
+	void cueCommand(int tokCount, char *tokens[]);
+	void sfxCommand(int tokCount, char *tokens[]);
+	void showCues();
+	void stepperReply(const Responder &respond, const Message *reply);
 	void setCommands (int tokCount, char *tokens[]);
 	bool requireArgs(int tokenCount, char *tokens[],  int required, long int *arg1, long int *arg2);
 };
@@ -8,6 +8,12 @@
  * The address and socket are retrieved from the RmNvs system.
  * If we disconnect from the hub, the WiFi class will call
  * vTaskDelete on us.
+ *
+ * Replies that arrive later (to stepper commands - see 'responder') come
+ * on the SwitchBoard task, which mustn't wait for the network. They are
+ * queued, and our task sends them: while any may still arrive (for
+ * CMD_REPLY_TIMEOUT_MS after the last command that will get one),
+ * 'recvfrom' gives up every UDP_REPLY_POLL_MSEC to look for them.
  */
 
 #include "../config.h"
@@ -37,11 +43,16 @@ const static char *TAG="...UDPSERVER";
 UDPServer::UDPServer (TASK_NAME devId):CmdDecoder (devId)
 {
 	sock = -1;
+	memset (&source_addr, 0, sizeof(source_addr) );
+	replyQueue = xQueueCreate (UDP_REPLY_QUEUE_SIZE, sizeof(QueuedReply) );
+	lastResponder = 0;
+	receiveTimeout = 0;
 }
 
 UDPServer::~UDPServer() {
 	if (sock >=0 ) close(sock);
 	sock = -1;
+	vQueueDelete (replyQueue );
 }
 
 /**
@@ -64,6 +75,7 @@ void UDPServer::startListenTask(void *param)
 		dest_addr.sin_port = htons( RmNvs::get_int(RMNVS_CMD_PORT) );
 		ip_protocol = IPPROTO_IP;
 		me->sock = socket (addr_family, SOCK_DGRAM, ip_protocol );
+		me->receiveTimeout = 0;
 		if (me->sock < 0)
 		{
 			ESP_LOGE(TAG, "Unable to create socket: errno %d", errno );
@@ -104,11 +116,18 @@ void UDPServer::UDP_Server_handleCommmands() {
 	char addr_str[128];
 	// The actual server...
 	while (1) {
-		ESP_LOGI(TAG, "Waiting for data");
+		sendQueuedReplies();
+		bool repliesDue = (xTaskGetTickCount() - lastResponder)
+				< pdMS_TO_TICKS(CMD_REPLY_TIMEOUT_MS + UDP_REPLY_POLL_MSEC);
+		setReceiveTimeout(repliesDue ? UDP_REPLY_POLL_MSEC : 0);
+		if (!repliesDue) ESP_LOGI(TAG, "Waiting for data");
 		socklen_t socklen = sizeof(source_addr);
 		int len = recvfrom(sock, rx_buffer, sizeof(rx_buffer) - 1, 0,
 				(struct sockaddr*) &source_addr, &socklen);
 
+		if ((len < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK))) {
+			continue;  // Nothing yet - look for replies
+		}
 		// Error occurred during receiving
 		if (len < 0) {
 			ESP_LOGE(TAG, "recvfrom failed: errno %d", errno);
@@ -148,6 +167,69 @@ void UDPServer::UDP_Server_handleCommmands() {
  *
  */
 void UDPServer::postResponse (const char *respTxt, responseStatus_t respcode)
+{
+	sendResponse (&source_addr, respTxt, respcode );
+}
+
+
+/**
+ * Something to send a response to the client that sent the current
+ * command - for replies that arrive later (on another task), when
+ * 'source_addr' may be somebody else. It keeps its own copy of the address.
+ *
+ * It never waits: the reply is queued for our task to send (if the queue
+ * is full, the reply is dropped).
+ */
+CmdDecoder::Responder UDPServer::responder ()
+{
+	struct sockaddr_storage dest = source_addr;
+	lastResponder = xTaskGetTickCount ();
+	return ([this, dest](const char *respTxt, responseStatus_t respcode) {
+		QueuedReply reply;
+		reply.dest = dest;
+		reply.respcode = respcode;
+		strncpy (reply.text, respTxt, sizeof(reply.text) - 1 );
+		reply.text[sizeof(reply.text) - 1] = '\0';
+		if (xQueueSend (replyQueue, &reply, 0 ) != pdTRUE)
+		{
+			ESP_LOGW(TAG, "Reply queue full - dropped \"%s\"", reply.text );
+		}
+	});
+}
+
+
+/**
+ * Send the replies that other tasks have queued (see 'responder').
+ */
+void UDPServer::sendQueuedReplies ()
+{
+	QueuedReply reply;
+	while (xQueueReceive (replyQueue, &reply, 0 ) == pdTRUE)
+	{
+		sendResponse (&reply.dest, reply.text, reply.respcode );
+	}
+}
+
+
+/**
+ * How long 'recvfrom' waits for a command (0 is for ever).
+ */
+void UDPServer::setReceiveTimeout (uint32_t msec)
+{
+	if (msec == receiveTimeout) return;
+	struct timeval timeout;
+	timeout.tv_sec = msec / 1000;
+	timeout.tv_usec = (msec % 1000) * 1000;
+	if (setsockopt (sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout) ) < 0)
+	{
+		ESP_LOGE(TAG, "Unable to set the receive timeout: errno %d", errno );
+		return;
+	}
+	receiveTimeout = msec;
+}
+
+
+void UDPServer::sendResponse (const struct sockaddr_storage *dest, const char *respTxt, responseStatus_t respcode)
 {
 	char tmpbuf[128];
 	int txtLen=strlen(respTxt)+2;
@@ -166,7 +248,7 @@ void UDPServer::postResponse (const char *respTxt, responseStatus_t respcode)
 	while (err <= 0)
 	{
 		err = sendto (sock, tmpbuf, txtLen, 0,
-				(struct sockaddr*) &source_addr, sizeof(source_addr) );
+				(struct sockaddr*) dest, sizeof(*dest) );
 		vTaskDelay(1); // Allow wifi to run
 
 		if (err < 0)
@@ -17,6 +17,7 @@
 #include <string.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/queue.h"
 #include "esp_system.h"
 #include "esp_wifi.h"
 #include "esp_event.h"
@@ -29,6 +30,12 @@
 #include <lwip/netdb.h>
 #include "../Sequencer/DeviceDef.h"
 
+// Replies to requests waiting to be sent (see 'responder')
+#define UDP_REPLY_QUEUE_SIZE 4
+#define UDP_REPLY_MAX_LEN 128
+// While replies may still arrive, look for them this often
+#define UDP_REPLY_POLL_MSEC 20
+
 class UDPServer: public CmdDecoder
 {
 public:
@@ -41,7 +48,22 @@ private:
 	int sock;
 	void UDP_Server_handleCommmands ();
 	void postResponse(const char *respTxt, responseStatus_t respcode) ;
+	Responder responder();
+	void sendResponse(const struct sockaddr_storage *dest, const char *respTxt, responseStatus_t respcode);
+	void setReceiveTimeout(uint32_t msec);
+	void sendQueuedReplies();
 	struct sockaddr_storage source_addr; // Who sent us a message?
+
+	// A reply from another task - sent by ours, so nobody else waits for the network
+	struct QueuedReply
+	{
+		struct sockaddr_storage dest;
+		responseStatus_t respcode;
+		char text[UDP_REPLY_MAX_LEN];
+	};
+	QueueHandle_t replyQueue;
+	TickType_t lastResponder;  // When we last handed out a responder
+	uint32_t receiveTimeout;   // What the socket's is set to (msec - 0 is forever)
 };
 
 #endif /* MAIN_NETWORK_UDPSERVER_H_ */
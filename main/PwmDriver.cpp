@@ -91,6 +91,10 @@ PwmDriver::PwmDriver (const char *name) :
 #ifdef INCLUDE_FAST
 	ESP_LOGD(TAG, "Register EYES and EYEDIR");
 	SwitchBoard::registerDriver (TASK_NAME::EYES, this );
+	// Only the latest eye setting matters - let the SwitchBoard coalesce them.
+	SwitchBoard::registerStateEvent (TASK_NAME::EYES, EVENT_ACTION_SETVALUE );
+	SwitchBoard::registerStateEvent (TASK_NAME::EYES, EVENT_ACTION_SETLEFT );
+	SwitchBoard::registerStateEvent (TASK_NAME::EYES, EVENT_ACTION_SETRIGHT );
 	maxLedDuty = std::floor (((1 << LED_DUTY_RES_BITS) - 1) );
 	ESP_LOGI(TAG, "...Calculated maxLedDuty factor: %d ", maxLedDuty );
 	ESP_LOGI(TAG, "");
@@ -101,6 +105,7 @@ PwmDriver::PwmDriver (const char *name) :
 	ESP_LOGD(TAG, "PwmDriver initialization - CH_JAW is %d", ch_jaw);
 	maxServoDuty = std::floor(((1<<SERVO_DUTY_RES_BITS)-1) );
 	SwitchBoard::registerDriver (TASK_NAME::JAW, this);
+	SwitchBoard::registerStateEvent (TASK_NAME::JAW, EVENT_ACTION_SETVALUE );
 	ESP_LOGI(TAG, "Calculated maxServoDuty factor: %d ", maxServoDuty);
 
 	// Our hardware sets PWM from 0 to maxServoDuty (about 8k).
@@ -135,6 +140,12 @@ PwmDriver::~PwmDriver ()
 }
 
 
+// Which channels were changed by 'setFromMessage'
+// (so 'updateChannels' knows what to update).
+#define TOUCH_LEFT_EYE  0x01
+#define TOUCH_RIGHT_EYE 0x02
+#define TOUCH_JAW       0x04
+
 /**
  * Called when we need to change a device.
  * EVENTS are defined in the header.
@@ -147,22 +158,51 @@ PwmDriver::~PwmDriver ()
  *
  */
 void PwmDriver::callBack (const Message *msg)
+{
+	updateChannels (setFromMessage (msg ) );
+}
+
+
+/**
+ * Called (in batch mode) with several messages at once.
+ * We set all of the duty cycles first, then update each
+ * channel that changed just once - the last value wins.
+ */
+void PwmDriver::callBackBatch (const Message * const *msgs, size_t count)
+{
+	int touched = 0;
+	for (size_t idx = 0; idx < count; idx++)
+	{
+		touched |= setFromMessage (msgs[idx] );
+	}
+	updateChannels (touched );
+}
+
+
+/**
+ * Set the duty cycle(s) requested by a message - but don't
+ * update the hardware (see 'updateChannels').
+ * @param msg - the message
+ * @return a mask of the TOUCH_xxx bits for the channels we set.
+ */
+int PwmDriver::setFromMessage (const Message *msg)
 {
 	uint32_t duty;
+	int touched = 0;
 	switch (msg->event)
 	{
 		case (EVENT_ACTION_SETLEFT):
 				duty=msg->value;
 				duty = interpEyes.interp(duty);
 				ledc_set_duty (LEDC_HIGH_SPEED_MODE, ch_Left_eye, duty );
-				ledc_update_duty (LEDC_HIGH_SPEED_MODE, ch_Left_eye );
+				touched |= TOUCH_LEFT_EYE;
 			break;
 
 		case(EVENT_ACTION_SETRIGHT):
 				duty=msg->value;
 				duty = interpEyes.interp(duty);
 				ledc_set_duty (LEDC_HIGH_SPEED_MODE, ch_right_eye, duty );
-				ledc_update_duty (LEDC_HIGH_SPEED_MODE, ch_right_eye );
+				touched |= TOUCH_RIGHT_EYE;
 			break;
 
 		case (EVENT_ACTION_SETVALUE):
@@ -180,8 +220,7 @@ void PwmDriver::callBack (const Message *msg)
 				// TODO: Factor in EYEDIR
 				ledc_set_duty (LEDC_HIGH_SPEED_MODE, ch_right_eye, duty );
 				ledc_set_duty (LEDC_HIGH_SPEED_MODE, ch_Left_eye, duty);
-				ledc_update_duty (LEDC_HIGH_SPEED_MODE, ch_right_eye );
-				ledc_update_duty (LEDC_HIGH_SPEED_MODE, ch_Left_eye );
+				touched |= (TOUCH_LEFT_EYE | TOUCH_RIGHT_EYE);
 
 				if (msg->event == EVENT_ACTION_SETDIR) {
 					// TODO: NOT implemented.
@@ -200,7 +239,7 @@ void PwmDriver::callBack (const Message *msg)
 //						msg->value, duty);
 
 				ledc_set_duty (LEDC_LOW_SPEED_MODE, ch_jaw, duty);
-				ledc_update_duty (LEDC_LOW_SPEED_MODE, ch_jaw );
+				touched |= TOUCH_JAW;
 			}
 #endif
 			break;
@@ -208,6 +247,28 @@ void PwmDriver::callBack (const Message *msg)
 		default:
 			break;
 	}  // End of switch
+	return (touched);
+}
+
+
+/**
+ * Push the new duty cycle(s) out to the hardware.
+ * @param touched - mask of TOUCH_xxx bits (from 'setFromMessage')
+ */
+void PwmDriver::updateChannels (int touched)
+{
+	if (touched & TOUCH_RIGHT_EYE)
+	{
+		ledc_update_duty (LEDC_HIGH_SPEED_MODE, ch_right_eye );
+	}
+	if (touched & TOUCH_LEFT_EYE)
+	{
+		ledc_update_duty (LEDC_HIGH_SPEED_MODE, ch_Left_eye );
+	}
+	if (touched & TOUCH_JAW)
+	{
+		ledc_update_duty (LEDC_LOW_SPEED_MODE, ch_jaw );
+	}
 }
 
 /**
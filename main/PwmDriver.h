@@ -30,6 +30,7 @@ public:
 	ledc_channel_t	ch_right_eye; // assigned during init
 	ledc_channel_t	ch_jaw;
 	void callBack(const Message *msg);
+	void callBackBatch(const Message * const *msgs, size_t count);
 	inline int getMaxLedDuty()   {return (maxLedDuty);}
 	inline int getMaxServoDuty() {return (maxServoDuty); }
 	char *devName;
@@ -40,6 +41,8 @@ private:
 	int servo_min;
 	int servo_max;
 	void timerSetup();
+	int  setFromMessage(const Message *msg);
+	void updateChannels(int touched);
 	static bool alreadyInited;
 	Interpolate interpJaw;
 	Interpolate interpEyes;
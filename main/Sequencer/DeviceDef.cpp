@@ -26,3 +26,18 @@ DeviceDef::~DeviceDef ()
 {
 	// TODO Auto-generated destructor stub
 }
+
+
+/**
+ * Deliver several messages at once. Unless the driver overrides
+ * this, we just deliver them one at a time, in order.
+ * @param msgs  - the messages.
+ * @param count - how many there are.
+ */
+void DeviceDef::callBackBatch(const Message * const *msgs, size_t count)
+{
+	for (size_t idx = 0; idx < count; idx++)
+	{
+		callBack(msgs[idx]);
+	}
+}
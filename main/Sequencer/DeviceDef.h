@@ -14,7 +14,15 @@
  *    This is called by the sequencer when an event is supposed to happen.
  *    The msg is only valid for the duration of the call - when the callback returns,
  *    it will be 'freed'.
+ *
+ * CALLBACKBATCH:
+ *    When the SwitchBoard is in batch mode, and several messages for the same
+ *    driver are queued back-to-back, they are handed over in one call (in the
+ *    order they were sent). The default just calls 'callBack' for each one -
+ *    override it if the driver can do better (e.g.: one hardware update for
+ *    the whole batch). The same 'freed' rule applies to every message.
  */
+#include <stddef.h>
 #include "Message.h"
 #ifndef MAIN_SEQUENCER_DEVICEDEF_H_
 #define MAIN_SEQUENCER_DEVICEDEF_H_
@@ -26,6 +34,7 @@ public:
 	char *devName; // Pointer to the name of this driver.
 	virtual ~DeviceDef () ;
 	virtual void callBack(const Message *msg)=0;
+	virtual void callBackBatch(const Message * const *msgs, size_t count);
 };
 
 #endif /* MAIN_SEQUENCER_DEVICEDEF_H_ */
@@ -6,41 +6,98 @@
  *
  */
 
+#include <new>
 #include "Message.h"
+#include "MessagePool.h"
+#include "../config.h"
 #include "esp_log.h"
 #include "string.h"
+#include <stdlib.h>
 
 static const char *TAG="MESSAGE";
 
+// Where all messages come from.
+static MessagePool<sizeof(Message), MESSAGE_POOL_SIZE> msgPool;
+
 Message::Message ()
 {
 	// TODO Auto-generated constructor stub
 	event = EVENT_ACTION_NONE;
 	destination=TASK_NAME::IDLER;
 	response=TASK_NAME::IDLER;
+	payloadType=PAYLOAD_TYPE::NONE;
+	flags=0;
+	payloadLen=0;
 	value = 0L;
 	rate  = 0L;
-	bzero(text, sizeof(text));
+	corrId = 0;
+#ifdef SWITCHBOARD_STATS
+	sentAt = 0;
+#endif
+	payload.heapText=nullptr;
 }
 
 
 Message::~Message ()
 {
 	//	ESP_LOGD(TAG, "Message delete has been called");
-	// TODO Auto-generated destructor stub
+	freePayload();
 }
 
 /**
  * Copy constructor
+ * We only copy as much of the payload as is used. Anything
+ * on the heap is duplicated (so each copy owns its own).
  */
 Message::Message (const Message &oldObj)
 {
 	destination = oldObj.destination;
 	event       = oldObj.event;
 	response    = oldObj.response;
+	payloadType = PAYLOAD_TYPE::NONE;
+	flags       = oldObj.flags;
+	payloadLen  = 0;
 	value       = oldObj.value;
 	rate        = oldObj.rate;
-	memcpy(text, oldObj.text, sizeof(text));
+	corrId      = oldObj.corrId;
+#ifdef SWITCHBOARD_STATS
+	sentAt      = oldObj.sentAt;
+#endif
+	payload.heapText = nullptr;
+
+	switch (oldObj.payloadType)
+	{
+		case (PAYLOAD_TYPE::INLINE_TEXT):
+		case (PAYLOAD_TYPE::HEAP_TEXT):
+			setText(oldObj.text());
+			break;
+
+		case (PAYLOAD_TYPE::HEAP_DATA):
+			payload.heapData = malloc(oldObj.payloadLen);
+			if (payload.heapData != nullptr)
+			{
+				memcpy(payload.heapData, oldObj.payload.heapData, oldObj.payloadLen);
+				payloadType = PAYLOAD_TYPE::HEAP_DATA;
+				payloadLen  = oldObj.payloadLen;
+			}
+			break;
+
+		default:
+			break;
+	}
+}
+
+/**
+ * 'event' is 16 bits in the message. An event that doesn't fit would
+ * quietly turn into some other event - that is a bug, so stop here.
+ */
+static void checkEvent(int _event)
+{
+	if ((_event < INT16_MIN) || (_event > INT16_MAX))
+	{
+		ESP_LOGE(TAG, "Event %d does not fit in a message (16 bits)", _event);
+		abort();
+	}
 }
 
 /**
@@ -48,27 +105,204 @@ Message::Message (const Message &oldObj)
  * time in the future.
  * @param _target - who to send message to
  * @param _from   - who task is this from?
- * @param _event  - What event?
+ * @param _event  - What event? (Must fit in an int16_t)
  * @param _value  - the first argument for this event
  * @param _rate   - the second argument for this event
  * @param  txt    - If non-null, then this null-terminated text
- *                  is copied into the message. Max length 64.
+ *                  is copied into the message. Max length MSG_MAX_TEXT_SIZE-1.
  *
  */
 Message *Message::create_message(
 		TASK_NAME _target,	TASK_NAME _from, int _event,
 		long int _value, long int _rate, const char *txt) {
+	checkEvent(_event);
 	Message *m=new Message();
 	m->destination= _target;
 	m->response = _from;
 	m->event    = _event;
 	m->value    = _value;
 	m->rate     = _rate;
-	bzero(m->text, sizeof(m->text));
 	if ((txt != nullptr)&&(*txt!='\0'))
 	{
 		ESP_LOGD(TAG,"message text length is %u. Message is:%s", strlen(txt), txt);
-		strncpy(m->text, txt, sizeof(m->text)-1);
+		m->setText(txt);
+	}
+	return(m);
+}
+
+
+/**
+ * Factory to create the reply to a message.
+ * The reply goes back to whoever sent 'request', and carries the same
+ * event and correlation ID - so if it was sent with SwitchBoard::request,
+ * the reply goes to the requester's reply handler.
+ * @param request - the message we are replying to.
+ * @param _value  - the first argument of the reply
+ * @param _rate   - the second argument of the reply
+ * @param  txt    - If non-null, text to copy into the reply.
+ */
+Message *Message::create_reply(const Message *request,
+		long int _value, long int _rate, const char *txt) {
+	Message *m=create_message(request->response, request->destination,
+			request->event, _value, _rate, txt);
+	m->corrId = request->corrId;
+	m->flags |= MSG_FLAG_REPLY;
+	return(m);
+}
+
+
+/**
+ * Factory to create a message carrying a buffer of bytes.
+ * The data is copied (to the heap), and freed with the message.
+ * @param _target - who to send message to
+ * @param _from   - who task is this from?
+ * @param _event  - What event? (Must fit in an int16_t)
+ * @param data    - the bytes to send
+ * @param len     - how many bytes (max 65535)
+ */
+Message *Message::create_data_message(TASK_NAME _target, TASK_NAME _from,
+		int _event, const void *data, size_t len) {
+	checkEvent(_event);
+	Message *m=new Message();
+	m->destination= _target;
+	m->response = _from;
+	m->event    = _event;
+	if ((data != nullptr) && (len > 0) && (len <= UINT16_MAX))
+	{
+		m->payload.heapData = malloc(len);
+		if (m->payload.heapData == nullptr)
+		{
+			ESP_LOGE(TAG, "create_data_message: Failed to allocate %u bytes", len);
+		}
+		else
+		{
+			memcpy(m->payload.heapData, data, len);
+			m->payloadType = PAYLOAD_TYPE::HEAP_DATA;
+			m->payloadLen  = len;
+		}
 	}
 	return(m);
 }
+
+
+/**
+ * @return the text of this message - never null. (Empty if there is no text).
+ */
+const char *Message::text() const {
+	switch (payloadType)
+	{
+		case (PAYLOAD_TYPE::INLINE_TEXT):
+			return(payload.inlineText);
+
+		case (PAYLOAD_TYPE::HEAP_TEXT):
+			return(payload.heapText);
+
+		default:
+			return("");
+	}
+}
+
+
+/**
+ * @return the data buffer of this message, or nullptr if there isn't one.
+ */
+const void *Message::data() const {
+	return((payloadType == PAYLOAD_TYPE::HEAP_DATA) ? payload.heapData : nullptr);
+}
+
+
+/**
+ * Copy text into the payload - inline if it fits, otherwise on the heap.
+ * (The payload must be empty).
+ */
+void Message::setText(const char *txt) {
+	size_t len = strnlen(txt, MSG_MAX_TEXT_SIZE-1);
+	if (len < MSG_INLINE_TEXT_SIZE)
+	{
+		memcpy(payload.inlineText, txt, len);
+		payload.inlineText[len] = '\0';
+		payloadType = PAYLOAD_TYPE::INLINE_TEXT;
+	}
+	else
+	{
+		payload.heapText = (char *) malloc(len+1);
+		if (payload.heapText == nullptr)
+		{
+			ESP_LOGE(TAG, "Failed to allocate %u bytes for message text", len+1);
+			return;
+		}
+		memcpy(payload.heapText, txt, len);
+		payload.heapText[len] = '\0';
+		payloadType = PAYLOAD_TYPE::HEAP_TEXT;
+	}
+	payloadLen = len;
+}
+
+
+/**
+ * Release anything the payload holds on the heap.
+ */
+void Message::freePayload() {
+	if ((payloadType == PAYLOAD_TYPE::HEAP_TEXT) || (payloadType == PAYLOAD_TYPE::HEAP_DATA))
+	{
+		free(payload.heapData);
+	}
+	payloadType = PAYLOAD_TYPE::NONE;
+	payloadLen = 0;
+	payload.heapText = nullptr;
+}
+
+
+/**
+ * Allocate a message from the pool.
+ * If the pool is empty, we fall back to the heap (and complain).
+ */
+void *Message::operator new(size_t size)
+{
+	void *ptr = msgPool.alloc();
+	if (ptr == nullptr)
+	{
+		MessagePoolStats stats;
+		msgPool.getStats(&stats);
+		// Don't flood the log - just the first time, then every so often.
+		if ((stats.exhaustedCount % 1000) == 1)
+		{
+			ESP_LOGW(TAG, "Message pool exhausted (%u times) - using the heap",
+					stats.exhaustedCount);
+		}
+		ptr = ::operator new(size);
+	}
+	return(ptr);
+}
+
+
+/**
+ * Return a message to the pool - or to the heap if that's where it came from.
+ */
+void Message::operator delete(void *ptr)
+{
+	if (ptr == nullptr) return;
+	if (! msgPool.free(ptr))
+	{
+		::operator delete(ptr);
+	}
+}
+
+
+/**
+ * Report the message pool counters (in use, high water mark,
+ * and how often it ran dry).
+ */
+void Message::getPoolStats(MessagePoolStats *stats)
+{
+	msgPool.getStats(stats);
+}
+
+
+/**
+ * Reset the message pool high water mark and counters.
+ */
+void Message::resetPoolStats()
+{
+	msgPool.resetStats();
+}
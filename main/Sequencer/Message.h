@@ -17,13 +17,16 @@
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "MessagePool.h"
+#include "../config.h"
 
+// Time, in microseconds since boot (i.e.: esp_timer_get_time() )
 typedef uint64_t TIME_t;
 
 // These are the known tasks, and their index
 // LAST is not a real task - its a means of determining the highest numbered
 //     entry in the TASK_NAME enum.
-enum class TASK_NAME
+enum class TASK_NAME : uint8_t
 {
 	IDLER = 0, WAVEFILE, EYES, JAW, NODD, ROTATE, TEST, UDP, MOTIONSEQ, LAST
 };
@@ -53,30 +56,118 @@ enum class TASK_NAME
 // the driver.
 #define EVENT_ACTION_SETVALUE 3
 
+// A reply to a request (see SwitchBoard::request) did not arrive in time.
+// The reply handler gets a message with this event instead of the reply.
+#define EVENT_ACTION_TIMEOUT 4
+
+// Message flags
+#define MSG_FLAG_REPLY 0x01   // This is a reply to the request with the same 'corrId'
+
+// What (if anything) a message carries beyond 'value' and 'rate'.
+enum class PAYLOAD_TYPE : uint8_t
+{
+	NONE = 0,     // Just the integers
+	INLINE_TEXT,  // Short text, stored in the message itself
+	HEAP_TEXT,    // Longer text, stored on the heap
+	HEAP_DATA     // A buffer of bytes, stored on the heap
+};
+
+// Text up to this length (including the terminating null) is kept in the
+// message itself - longer text goes on the heap.
+#define MSG_INLINE_TEXT_SIZE 16
+
+// Text is truncated to this length (including the terminating null)
+#define MSG_MAX_TEXT_SIZE 128
+
+// The size of everything before the payload, on the ESP32. 18 bytes of
+// fields, padded to 20 for the (pointer aligned) payload. SWITCHBOARD_STATS
+// adds a 4 byte time stamp.
+#ifdef SWITCHBOARD_STATS
+#define MSG_HEADER_SIZE 24
+#else
+#define MSG_HEADER_SIZE 20
+#endif
+
+/**
+ * The message layout is a MSG_HEADER_SIZE byte header, followed by the
+ * payload. Most messages (jaw, eyes, player control) only use the integers
+ * in the header. Short text is stored 'inline' in the payload, anything
+ * else is on the heap, and the payload holds the pointer.
+ *
+ * NOTE: The header is 4 bytes more than the 16 we were aiming at - that is
+ *       'corrId' (and the padding after it). Check the static_assert below
+ *       before adding anything.
+ *
+ * NOTE: Don't add virtual functions - there is no vtable, and messages
+ *       are not sub-classed.
+ */
 class Message
 {
 public:
 
-	virtual ~Message ();
+	~Message ();
 	Message(const Message &oldObj); // Copy Constructor
+	// (No assignment - both would own the same heap payload)
+	Message &operator=(const Message &) = delete;
 	TASK_NAME destination;          // Who to deliver this message to
 	TASK_NAME response;             // IF this is a info request, respond to  this destination
 	                                // IF this is a response, the originator of the response message.
+	PAYLOAD_TYPE payloadType;       // What is in 'payload'
+	uint8_t  flags;      // MSG_FLAG_xxx
+	int16_t  event;      // A 'valid' event for the device. If the device receives
+	                     // an invalid event, ignore it. If this is a response, this
+	                     // is the message type of the requesting message.
+	uint16_t payloadLen; // Length of the text (not including the null), or the data.
+	long int value;      //  The value we want to set (as defined by the event)
+	long int rate;       // An indication of how fast this should happen.
+	uint16_t corrId;     // Correlation ID - matches a reply to its request.
+	                     // Zero if this is not part of a request/reply.
+#ifdef SWITCHBOARD_STATS
+	uint32_t sentAt;     // When SwitchBoard::send was called (see SwitchBoardStats.h)
+#endif
 
 	// This message to send simple messages, with no response
 	static Message *create_message(TASK_NAME target, TASK_NAME from,
 			int _event, long int val, long int rate, const char *txt=nullptr);
+	// (events must fit in 16 bits - anything else is a bug, and aborts)
+	// A reply to 'request' - to whoever sent it, with the same event and corrId
+	static Message *create_reply(const Message *request,
+			long int val, long int rate, const char *txt=nullptr);
+	// This sends a buffer of bytes (copied into the message)
+	static Message *create_data_message(TASK_NAME target, TASK_NAME from,
+			int _event, const void *data, size_t len);
 
-	int event;           // A 'valid' event for the device. If the device receives
-	                     // an invalid event, ignore it. If this is a response, this
-	                     // is the message type of the requesting message.
-	long int value;      //  The value we want to set (as defined by the event)
-	long int rate;       // An indication of how fast this should happen.
-	char text[128];       // Up to 128 bytes null-terminated text.
+	// Messages come from a fixed size pool (see MessagePool.h), NOT
+	// the heap - unless the pool is exhausted.
+	static void *operator new(size_t size);
+	static void operator delete(void *ptr);
+	static void getPoolStats(MessagePoolStats *stats);
+	static void resetPoolStats();
+
+	// The text - always null terminated (empty if there is no text).
+	const char *text() const;
+	// The data buffer (nullptr if none), and its length.
+	const void *data() const;
+	size_t dataLen() const { return (payloadLen); }
 
 protected:
 	Message ();
 
+private:
+	union
+	{
+		char inlineText[MSG_INLINE_TEXT_SIZE];
+		char *heapText;
+		void *heapData;
+	} payload;
+
+	void setText(const char *txt);
+	void freePayload();
 };
 
+// (Only checked where long and pointers are 32 bits - on the host they are 64)
+static_assert((sizeof(long) != 4) || (sizeof(void *) != 4)
+		|| (sizeof(Message) == MSG_HEADER_SIZE + MSG_INLINE_TEXT_SIZE),
+		"Message has changed size - see MSG_HEADER_SIZE");
+
 #endif /* MAIN_SEQUENCER_MESSAGE_H_ */
@@ -0,0 +1,190 @@
+/**
+ * MessagePool.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ * A fixed-size, lock-free pool of memory blocks. Message uses this
+ * (via its own 'new' and 'delete' operators) so that the eye and jaw
+ * updates from the player don't hit the heap several hundred times
+ * a second.
+ *
+ * Free blocks are kept on a free list that is linked by block index.
+ * The head of the list is a single 32 bit word - the low 16 bits are
+ * the index of the first free block, the high 16 bits are a 'tag' that
+ * is bumped on every change. The tag keeps the compare-and-swap from
+ * being fooled when a block is popped and pushed back while another
+ * task is part way through a pop (the 'ABA' problem).
+ *
+ * If the pool is empty, alloc returns nullptr and counts the failure.
+ * It is up to the caller to fall back to the heap.
+ *
+ * Each block also has an 'allocated' flag, so freeing a block twice (or
+ * freeing a pointer into the middle of one) is caught and counted - it
+ * would otherwise put the block on the free list twice, and hand it out
+ * to two owners.
+ *
+ * NOTE: Everything here is plain C++ (std::atomic) - there are no
+ *       FreeRTOS calls, so it can be built and tested on a host.
+ */
+
+#ifndef MAIN_SEQUENCER_MESSAGEPOOL_H_
+#define MAIN_SEQUENCER_MESSAGEPOOL_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+// Counters reported by the pool.
+struct MessagePoolStats
+{
+	uint32_t capacity;       // How many blocks in the pool
+	uint32_t inUse;          // How many blocks are currently allocated
+	uint32_t highWater;      // The most blocks ever allocated at one time
+	uint32_t allocCount;     // Total number of successful allocations
+	uint32_t exhaustedCount; // Number of times the pool was empty
+	uint32_t badFreeCount;   // Blocks freed twice (or not the start of a block)
+};
+
+template <size_t BLOCK_SIZE, uint16_t BLOCK_COUNT>
+class MessagePool
+{
+public:
+	static_assert(BLOCK_COUNT > 0 && BLOCK_COUNT < 0xFFFF,
+			"MessagePool: BLOCK_COUNT must be between 1 and 65534");
+
+	MessagePool ()
+	{
+		for (uint16_t idx = 0; idx < BLOCK_COUNT; idx++)
+		{
+			nextFree[idx].store ((idx + 1 < BLOCK_COUNT) ? idx + 1 : NIL, std::memory_order_relaxed );
+			allocated[idx].store (false, std::memory_order_relaxed );
+		}
+		head.store (0, std::memory_order_relaxed );
+		inUse.store (0, std::memory_order_relaxed );
+		highWater.store (0, std::memory_order_relaxed );
+		allocCount.store (0, std::memory_order_relaxed );
+		exhaustedCount.store (0, std::memory_order_relaxed );
+		badFreeCount.store (0, std::memory_order_relaxed );
+	}
+
+	/**
+	 * Take a block from the free list.
+	 * @return pointer to the block, or nullptr if the pool is empty.
+	 */
+	void *alloc ()
+	{
+		uint32_t oldHead = head.load (std::memory_order_acquire );
+		uint32_t newHead;
+		uint16_t idx;
+		do
+		{
+			idx = oldHead & 0xFFFF;
+			if (idx == NIL)
+			{
+				exhaustedCount.fetch_add (1, std::memory_order_relaxed );
+				return (nullptr);
+			}
+			newHead = nextTag (oldHead ) | nextFree[idx].load (std::memory_order_relaxed );
+		} while (!head.compare_exchange_weak (oldHead, newHead,
+				std::memory_order_acquire, std::memory_order_acquire ));
+
+		allocated[idx].store (true, std::memory_order_relaxed );
+		allocCount.fetch_add (1, std::memory_order_relaxed );
+		uint32_t now = inUse.fetch_add (1, std::memory_order_relaxed ) + 1;
+		uint32_t hw = highWater.load (std::memory_order_relaxed );
+		while ((now > hw) && !highWater.compare_exchange_weak (hw, now, std::memory_order_relaxed ))
+		{
+			// 'hw' was reloaded by the failed exchange - try again
+		}
+		return (storage[idx].bytes);
+	}
+
+	/**
+	 * Return a block to the free list.
+	 * @param ptr - a block previously returned by 'alloc'.
+	 * @return true if the block belonged to this pool, false otherwise
+	 *         (in which case nothing is done). A block that is already
+	 *         free is counted, and left alone - but it is still ours,
+	 *         so the answer is true.
+	 */
+	bool free (void *ptr)
+	{
+		if (!owns (ptr )) return (false);
+		size_t offset = (uint8_t*) ptr - storage[0].bytes;
+		uint16_t idx = (uint16_t) (offset / sizeof(Block));
+		if (((offset % sizeof(Block)) != 0)
+				|| !allocated[idx].exchange (false, std::memory_order_relaxed ))
+		{
+			badFreeCount.fetch_add (1, std::memory_order_relaxed );
+			return (true);
+		}
+
+		uint32_t oldHead = head.load (std::memory_order_relaxed );
+		uint32_t newHead;
+		do
+		{
+			nextFree[idx].store (oldHead & 0xFFFF, std::memory_order_relaxed );
+			newHead = nextTag (oldHead ) | idx;
+		} while (!head.compare_exchange_weak (oldHead, newHead,
+				std::memory_order_release, std::memory_order_relaxed ));
+
+		inUse.fetch_sub (1, std::memory_order_relaxed );
+		return (true);
+	}
+
+	/**
+	 * Is this pointer one of our blocks?
+	 */
+	bool owns (const void *ptr) const
+	{
+		const uint8_t *p = (const uint8_t*) ptr;
+		return ((p >= storage[0].bytes) && (p < storage[0].bytes + sizeof(storage)));
+	}
+
+	void getStats (MessagePoolStats *stats) const
+	{
+		stats->capacity       = BLOCK_COUNT;
+		stats->inUse          = inUse.load (std::memory_order_relaxed );
+		stats->highWater      = highWater.load (std::memory_order_relaxed );
+		stats->allocCount     = allocCount.load (std::memory_order_relaxed );
+		stats->exhaustedCount = exhaustedCount.load (std::memory_order_relaxed );
+		stats->badFreeCount   = badFreeCount.load (std::memory_order_relaxed );
+	}
+
+	// Reset the high water mark (to the current usage) and the counters.
+	void resetStats ()
+	{
+		highWater.store (inUse.load (std::memory_order_relaxed ), std::memory_order_relaxed );
+		allocCount.store (0, std::memory_order_relaxed );
+		exhaustedCount.store (0, std::memory_order_relaxed );
+		badFreeCount.store (0, std::memory_order_relaxed );
+	}
+
+private:
+	static const uint16_t NIL = 0xFFFF;
+
+	// Bump the tag (upper 16 bits) of a head value, leaving the index zero.
+	static inline uint32_t nextTag (uint32_t oldHead)
+	{
+		return ((oldHead + 0x10000) & 0xFFFF0000);
+	}
+
+	// One block, rounded up so every block is suitably aligned.
+	struct Block
+	{
+		alignas(8) uint8_t bytes[(BLOCK_SIZE + 7) & ~((size_t) 7)];
+	};
+
+	Block storage[BLOCK_COUNT];
+	std::atomic<uint16_t> nextFree[BLOCK_COUNT];
+	std::atomic<bool> allocated[BLOCK_COUNT];
+	std::atomic<uint32_t> head;
+	std::atomic<uint32_t> inUse;
+	std::atomic<uint32_t> highWater;
+	std::atomic<uint32_t> allocCount;
+	std::atomic<uint32_t> exhaustedCount;
+	std::atomic<uint32_t> badFreeCount;
+};
+
+#endif /* MAIN_SEQUENCER_MESSAGEPOOL_H_ */
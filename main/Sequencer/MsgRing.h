@@ -0,0 +1,152 @@
+/**
+ * MsgRing.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ * A bounded, lock-free ring buffer. Any number of tasks may push,
+ * and (although it is safe for more than one task to pop) in our
+ * usage only the SwitchBoard delivery task pops - except when a
+ * sender discards the oldest entry to make room (DROP_OLDEST).
+ *
+ * Each cell carries a sequence number that tells a producer or
+ * consumer whether the cell is ready for it. Producers claim a cell
+ * by advancing 'enqPos' with a compare-and-swap, fill it, and then
+ * publish it by bumping the cell's sequence number. The consumer does
+ * the mirror image with 'deqPos'. (This is Dmitry Vyukov's bounded
+ * queue.)
+ *
+ * This does NOT block or wake anybody - that is up to the user (see
+ * SwitchBoard.cpp). Everything here is plain C++ (std::atomic), so it
+ * can be built and tested on a host.
+ *
+ * CAPACITY must be a power of two.
+ */
+
+#ifndef MAIN_SEQUENCER_MSGRING_H_
+#define MAIN_SEQUENCER_MSGRING_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+template <typename T, uint32_t CAPACITY>
+class MsgRing
+{
+public:
+	static_assert((CAPACITY >= 2) && ((CAPACITY & (CAPACITY - 1)) == 0),
+			"MsgRing: CAPACITY must be a power of 2");
+
+	MsgRing ()
+	{
+		for (uint32_t idx = 0; idx < CAPACITY; idx++)
+		{
+			cells[idx].seq.store (idx, std::memory_order_relaxed );
+		}
+		enqPos.store (0, std::memory_order_relaxed );
+		deqPos.store (0, std::memory_order_relaxed );
+		highWater.store (0, std::memory_order_relaxed );
+	}
+
+	/**
+	 * Add an entry to the ring.
+	 * @param item - what to add.
+	 * @return true if added, false if the ring is full.
+	 */
+	bool tryPush (const T &item)
+	{
+		Cell *cell;
+		uint32_t pos = enqPos.load (std::memory_order_relaxed );
+		while (true)
+		{
+			cell = &cells[pos & (CAPACITY - 1)];
+			uint32_t seq = cell->seq.load (std::memory_order_acquire );
+			int32_t diff = (int32_t) (seq - pos);
+			if (diff == 0)
+			{   // Cell is free - try to claim it
+				if (enqPos.compare_exchange_weak (pos, pos + 1, std::memory_order_relaxed ))
+					break;
+			}
+			else if (diff < 0)
+			{   // Cell still holds an unread entry - we are full
+				return (false);
+			}
+			else
+			{   // Somebody else claimed it - catch up
+				pos = enqPos.load (std::memory_order_relaxed );
+			}
+		}
+		cell->data = item;
+		cell->seq.store (pos + 1, std::memory_order_release );
+
+		uint32_t depth = pos + 1 - deqPos.load (std::memory_order_relaxed );
+		uint32_t hw = highWater.load (std::memory_order_relaxed );
+		while ((depth > hw) && (depth <= CAPACITY)
+				&& !highWater.compare_exchange_weak (hw, depth, std::memory_order_relaxed ))
+		{
+			// 'hw' was reloaded by the failed exchange - try again
+		}
+		return (true);
+	}
+
+	/**
+	 * Remove the oldest entry from the ring.
+	 * @param item - where to put the entry.
+	 * @return true if an entry was removed, false if the ring was empty.
+	 */
+	bool tryPop (T *item)
+	{
+		Cell *cell;
+		uint32_t pos = deqPos.load (std::memory_order_relaxed );
+		while (true)
+		{
+			cell = &cells[pos & (CAPACITY - 1)];
+			uint32_t seq = cell->seq.load (std::memory_order_acquire );
+			int32_t diff = (int32_t) (seq - (pos + 1));
+			if (diff == 0)
+			{   // Cell has been published - try to claim it
+				if (deqPos.compare_exchange_weak (pos, pos + 1, std::memory_order_relaxed ))
+					break;
+			}
+			else if (diff < 0)
+			{   // Nothing there yet - we are empty
+				return (false);
+			}
+			else
+			{   // Somebody else took it - catch up
+				pos = deqPos.load (std::memory_order_relaxed );
+			}
+		}
+		*item = cell->data;
+		cell->seq.store (pos + CAPACITY, std::memory_order_release );
+		return (true);
+	}
+
+	// Approximate number of entries (exact if nobody is pushing or popping).
+	uint32_t size () const
+	{
+		uint32_t depth = enqPos.load (std::memory_order_relaxed ) - deqPos.load (std::memory_order_relaxed );
+		return ((depth > CAPACITY) ? CAPACITY : depth);
+	}
+
+	bool empty () const { return (size () == 0); }
+	uint32_t capacity () const { return (CAPACITY); }
+
+	// The deepest the ring has been since the last reset
+	uint32_t getHighWater () const { return (highWater.load (std::memory_order_relaxed )); }
+	void resetHighWater () { highWater.store (size (), std::memory_order_relaxed ); }
+
+private:
+	struct Cell
+	{
+		std::atomic<uint32_t> seq;
+		T data;
+	};
+
+	Cell cells[CAPACITY];
+	std::atomic<uint32_t> enqPos;
+	std::atomic<uint32_t> deqPos;
+	std::atomic<uint32_t> highWater;
+};
+
+#endif /* MAIN_SEQUENCER_MSGRING_H_ */
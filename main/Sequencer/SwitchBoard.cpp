@@ -9,6 +9,57 @@
  *
  * The locking protects the driverList from changes while we
  * are trying to deliver messages.
+ *
+ * STATE EVENTS:
+ *    Some events (e.g.: 'set the jaw to x') describe a state - only the
+ * latest one matters. A driver can register these with 'registerStateEvent'.
+ * Each registered (destination, event) pair gets a 'mailbox' that holds the
+ * latest undelivered message. Only the first send puts an entry in the
+ * queue - later sends just replace what is in the mailbox (and are counted
+ * as 'coalesced'). The latest value is delivered when that entry reaches
+ * the head of the queue. All other events are delivered first-in, first-out.
+ *
+ * DELIVERY TASKS:
+ *    Normally every callBack runs on the SwitchBoard task, one after the
+ * other. A driver can instead be registered with its own delivery task
+ * (pinned to the core of its choice). Its messages are moved to its 'inbox',
+ * and its own task calls its callBack - so a slow driver doesn't hold up
+ * the others. Messages from one sender to one destination are still
+ * delivered in the order they were sent (there is only one path from the
+ * queue to the inbox, and both are first-in, first-out).
+ *    When an inbox is full, the SwitchBoard task waits for room - with the
+ * lock given up, so the driver's callBack can still (de)register. A driver
+ * task's callBack must not wait for the SwitchBoard either, so its sends
+ * never BLOCK (as for callBacks on the SwitchBoard task, a full queue
+ * drops them). De-registering waits until the driver's task has finished.
+ *
+ * TIMED DELIVERY:
+ *    'sendAt' holds a message until a given time (in microseconds since
+ * boot), then delivers it as usual. All of the waiting messages are kept in
+ * one TimerQueue, with a single esp_timer set for the earliest of them -
+ * so the drivers don't each need their own timers. The timer just wakes
+ * the delivery task, which takes the due messages itself: the esp_timer
+ * task is shared by everybody (the playback clock, ...), so it must never
+ * wait for room in the queue.
+ *
+ * REQUESTS AND REPLIES:
+ *    'request' sends a message that expects a reply. It gets a correlation
+ * ID (corrId) and a slot in the 'pending' table, and the caller's reply
+ * handler is kept there. The driver answers with Message::create_reply,
+ * which copies the corrId and marks the message as a reply. The delivery
+ * task hands replies straight to the waiting handler - the low bits of the
+ * corrId are the slot number, so matching is just an index and a compare
+ * (the high bits change each time a slot is reused, so a late reply can't
+ * be mistaken for the answer to a newer request). Each request also
+ * 'sendAt's a timeout reply - whichever arrives first frees the slot. A
+ * real reply also takes the timeout out of the TimerQueue (so answered
+ * requests don't fill it up with timeouts that are still to come); one
+ * that is already on its way is thrown away when it arrives.
+ *
+ * STATISTICS:
+ *    With SWITCHBOARD_STATS defined, 'send' time stamps each message, and
+ * every delivery records how long the message waited and how long the
+ * callBack took (see SwitchBoardStats.h, and 'getRouteStats').
  */
 
 #include <vector>
@@ -27,19 +78,39 @@
 #include "Message.h"
 #include "DeviceDef.h"
 #include "SwitchBoard.h"
+#include "SwitchBoardStats.h"
 
 using namespace std;
 
-#define xBlockTime 10000
-
 static const char *TAG="SWITCHBOARD:";
 bool volatile SwitchBoard::firstTimeThrough=true;
 
 // Store pointers to messages (we DONT copy the message itself!)
-QueueHandle_t SwitchBoard::msgQueue=xQueueCreate( 10, sizeof(Message *));
+MsgRing<SwitchBoard::QueueEntry, SWITCHBOARD_QUEUE_SIZE> SwitchBoard::msgQueue;
+
+// Mailboxes for 'state' events. Entries are only ever added, and
+// 'mailboxCount' is bumped after the entry is filled in, so 'send'
+// can search them without taking the lock.
+SwitchBoard::Mailbox SwitchBoard::mailboxes[SWITCHBOARD_MAX_MAILBOXES];
+std::atomic<int> SwitchBoard::mailboxCount(0);
+std::atomic<uint32_t> SwitchBoard::coalescedCount(0);
+volatile OVERFLOW_POLICY SwitchBoard::overflowPolicy=SWITCHBOARD_OVERFLOW_POLICY;
+volatile bool SwitchBoard::batchMode=SWITCHBOARD_BATCH_DELIVERY;
+std::atomic<uint32_t> SwitchBoard::dropCount(0);
+std::atomic<bool> SwitchBoard::timerDue(false);
+
+// Senders waiting for room in the queue (OVERFLOW_POLICY::BLOCK) sleep
+// on this semaphore. The delivery task gives it after each message it
+// removes, but only while somebody is waiting.
+std::atomic<uint32_t> SwitchBoard::blockedSenders(0);
+SemaphoreHandle_t SwitchBoard::queueSpaceSemaphore=nullptr;
+StaticSemaphore_t SwitchBoard::queueSpaceSemaphoreBuffer;
 
 TaskHandle_t SwitchBoard::MessengerTaskId;
 DeviceDef *SwitchBoard::driverList[NO_OF_TASK_NAMES];
+SwitchBoard::DriverInbox *SwitchBoard::inboxList[NO_OF_TASK_NAMES];
+// The driver delivery tasks - so 'send' can tell one is calling it, without the lock
+std::atomic<TaskHandle_t> SwitchBoard::inboxTasks[NO_OF_TASK_NAMES];
 
 
 SemaphoreHandle_t SwitchBoard::sequencer_semaphore=nullptr;
@@ -47,6 +118,26 @@ StaticSemaphore_t SwitchBoard::sequencer_semaphore_buffer;
 #define TAKE_LOCK xSemaphoreTake( sequencer_semaphore, portMAX_DELAY)
 #define GIVE_LOCK xSemaphoreGive( sequencer_semaphore)
 
+// Messages waiting for their delivery time. Protected by 'timer_semaphore'.
+TimerQueue SwitchBoard::timerQueue;
+esp_timer_handle_t SwitchBoard::deliveryTimer=nullptr;
+SemaphoreHandle_t SwitchBoard::timer_semaphore=nullptr;
+StaticSemaphore_t SwitchBoard::timer_semaphore_buffer;
+#define TAKE_TIMER_LOCK xSemaphoreTake( timer_semaphore, portMAX_DELAY)
+#define GIVE_TIMER_LOCK xSemaphoreGive( timer_semaphore)
+
+
+// Requests waiting for a reply. Protected by 'pending_semaphore'.
+SwitchBoard::PendingRequest SwitchBoard::pending[SWITCHBOARD_MAX_PENDING];
+uint16_t SwitchBoard::pendingGeneration=0;
+SemaphoreHandle_t SwitchBoard::pending_semaphore=nullptr;
+StaticSemaphore_t SwitchBoard::pending_semaphore_buffer;
+#define TAKE_PENDING_LOCK xSemaphoreTake( pending_semaphore, portMAX_DELAY)
+#define GIVE_PENDING_LOCK xSemaphoreGive( pending_semaphore)
+
+static_assert((SWITCHBOARD_MAX_PENDING & (SWITCHBOARD_MAX_PENDING - 1)) == 0,
+		"SWITCHBOARD_MAX_PENDING must be a power of 2");
+
 
 SwitchBoard::SwitchBoard ()
 {
@@ -65,13 +156,19 @@ SwitchBoard::~SwitchBoard ()
  *   It waits for a message(s) to be queued, and
  * delivers them to the appropriate task.
  *
+ * In batch mode, each time we wake we drain everything that is
+ * queued (SWITCHBOARD_BATCH_MAX at a time) and deliver it with a
+ * single take of the driver-table lock. Otherwise we deliver one
+ * message per lock.
+ *
  * It should be run as a separate task - it never returns.
  *
  * The argument is not used (it is ignored)
  */
 void SwitchBoard::runDelivery(void *xxx) {
 
-	Message *thisMsg=nullptr;
+	Message *batch[SWITCHBOARD_BATCH_MAX];
+	QueueEntry entry;
 	ESP_LOGD(TAG, "runDelivery started!");
 	//GIVE_LOCK;
 	if (! firstTimeThrough)
@@ -81,38 +178,162 @@ void SwitchBoard::runDelivery(void *xxx) {
 	}
 
 	sequencer_semaphore = xSemaphoreCreateBinary( );
+	queueSpaceSemaphore = xSemaphoreCreateCountingStatic(SWITCHBOARD_QUEUE_SIZE, 0,
+			&queueSpaceSemaphoreBuffer);
+	timer_semaphore = xSemaphoreCreateMutexStatic(&timer_semaphore_buffer);
+	pending_semaphore = xSemaphoreCreateMutexStatic(&pending_semaphore_buffer);
+	esp_timer_create_args_t timer_cfg={};
+	timer_cfg.callback=&timerCallback;
+	timer_cfg.arg=nullptr;
+	timer_cfg.name="switchboard";
+	timer_cfg.dispatch_method=ESP_TIMER_TASK;
+	ESP_ERROR_CHECK(esp_timer_create(&timer_cfg, &deliveryTimer));
+
 	MessengerTaskId = xTaskGetCurrentTaskHandle ();
 	GIVE_LOCK;
 	firstTimeThrough=false;  // Now open for buisness
 
 	while(true)
 	{
-		while ( 0 == uxQueueMessagesWaiting(msgQueue))
-		{  // Wait for 'send' to queue a message
-			if (0==ulTaskNotifyTake (true, xBlockTime )) {
+		size_t limit = (batchMode) ? SWITCHBOARD_BATCH_MAX : 1;
+		size_t count = 0;
+		size_t popped = 0;
+		// Timed messages that are due go first (see timerCallback)
+		if (timerDue.exchange(false))
+		{
+			count = takeDue(batch, limit);
+		}
+		while ((count < limit) && msgQueue.tryPop(&entry))
+		{
+			popped++;
+			batch[count] = takeEntry(entry);
+			if (batch[count] != nullptr) count++;
+		}
+
+		// A reply (or timeout) for a request goes to its handler, not a driver.
+		size_t kept = 0;
+		for (size_t idx = 0; idx < count; idx++)
+		{
+			if ((batch[idx]->flags & MSG_FLAG_REPLY) && (batch[idx]->corrId != 0))
+			{
+				completeRequest(batch[idx]);
+				delete batch[idx];
 				continue;
 			}
+			batch[kept++] = batch[idx];
+		}
+		count = kept;
+
+		// We just made room - wake up senders if any are waiting for it.
+		uint32_t waiting = blockedSenders.load();
+		for (size_t idx = 0; (idx < popped) && (idx < waiting); idx++)
+		{
+			xSemaphoreGive(queueSpaceSemaphore);
+		}
+
+		if (count == 0)
+		{  // Nothing to deliver - sleep until 'send' (or the timer) notifies us.
+			// (No timeout - they always notify AFTER the message is queued,
+			//  and the notification count is kept until we take it.)
+			if ((popped == 0) && !timerDue.load()) ulTaskNotifyTake (pdTRUE, portMAX_DELAY );
+			continue;
 		}
 
-//		ESP_LOGD(TAG, "About to pop message");
-		xQueueReceive( msgQueue, &thisMsg, 1);
-//		ESP_LOGD(TAG, "Past POP. thisMsg is at %p", thisMsg);
 		TAKE_LOCK;
-		int devIdx = TASK_IDX(thisMsg->destination );
+		deliverBatch(batch, count);
+		GIVE_LOCK;
 
-		if (driverList[devIdx] != nullptr)
-			{
-				driverList[devIdx]->callBack (thisMsg );
-			}
-			else
+		// (Anything handed to a driver's inbox was set to nullptr)
+		for (size_t idx = 0; idx < count; idx++)
+		{
+			delete batch[idx];
+		}
+	} // end of while(true)
+}
+
+
+/**
+ * Deliver a batch of messages, in order. Consecutive messages
+ * for the same driver are handed over in a single 'callBackBatch'.
+ * Messages for a driver with its own delivery task are moved to
+ * its inbox - and their entry in 'batch' is set to nullptr (the
+ * driver's task will delete them).
+ *
+ * The caller must hold the lock.
+ *
+ * @param batch - the messages to deliver.
+ * @param count - how many messages.
+ */
+void SwitchBoard::deliverBatch(Message **batch, size_t count) {
+	size_t first = 0;
+	while (first < count)
+	{
+		DeviceDef *driver = driverList[TASK_IDX(batch[first]->destination)];
+		DriverInbox *inbox = inboxList[TASK_IDX(batch[first]->destination)];
+		size_t last = first + 1;
+		while ((last < count) && (driverList[TASK_IDX(batch[last]->destination)] == driver)
+				&& (inboxList[TASK_IDX(batch[last]->destination)] == inbox))
+		{
+			last++;
+		}
+
+		if (driver == nullptr)
+		{
+			for (size_t idx = first; idx < last; idx++)
 			{
 				ESP_LOGE(TAG,
 						"SeqLoop - ignored message for undefined device %d",
-						TASK_IDX(thisMsg->destination) );
+						TASK_IDX(batch[idx]->destination) );
+				SB_STATS_DROP(batch[idx]);
 			}
-		GIVE_LOCK;
-		delete thisMsg;
-	} // end of while(true)
+		}
+		else if (inbox != nullptr)
+		{   // (If the driver goes while we wait for room, the rest are dropped)
+			for (size_t idx = first; idx < last; idx++)
+			{
+				if (routeToInbox (batch[idx] ))
+				{
+					batch[idx] = nullptr;
+				}
+				else
+				{
+					SB_STATS_DROP(batch[idx]);
+				}
+			}
+		}
+		else
+		{
+			dispatch(driver, &batch[first], last - first);
+		}
+		first = last;
+	}
+}
+
+
+/**
+ * Hand messages to a driver - 'callBack' for one, 'callBackBatch' for more.
+ * (With SWITCHBOARD_STATS, this is where the delivery is timed. The time
+ * for a batch is shared equally between its messages.)
+ */
+void SwitchBoard::dispatch(DeviceDef *driver, Message **msgs, size_t count) {
+#ifdef SWITCHBOARD_STATS
+	uint32_t start = SwitchBoardStats::now();
+#endif
+	if (count == 1)
+	{
+		driver->callBack (msgs[0] );
+	}
+	else
+	{
+		driver->callBackBatch (msgs, count );
+	}
+#ifdef SWITCHBOARD_STATS
+	uint32_t each = (SwitchBoardStats::now() - start) / count;
+	for (size_t idx = 0; idx < count; idx++)
+	{
+		SwitchBoardStats::recordDelivery(msgs[idx]->destination, start - msgs[idx]->sentAt, each);
+	}
+#endif
 }
 
 
@@ -133,12 +354,497 @@ void SwitchBoard::send(Message *msg) {
 		abort();
 	}
 
-	//TAKE_LOCK;
-//	ESP_LOGD(TAG, "::Sending message. Addr is %p", msg);
-	xQueueSend(msgQueue, (void *) &msg, 1);
-//	ESP_LOGD(TAG, "::send   Message sent");
+	SB_STATS_STAMP(msg);
+	QueueEntry entry = { msg, -1 };
+	int box = findMailbox(msg);
+	if (box >= 0)
+	{   // A 'state' event. If there is already one waiting, just replace it -
+		// it's entry in the queue will deliver this one instead.
+		Message *old = mailboxes[box].pending.exchange(msg);
+		if (old != nullptr)
+		{
+			coalescedCount.fetch_add(1);
+			delete old;
+			return;
+		}
+		entry.msg = nullptr;
+		entry.mailbox = box;
+	}
+
+	queueEntry(entry);
 	xTaskNotifyGive (MessengerTaskId);
+}
 
+
+/**
+ * Add an entry to the queue, following the overflow policy if it is full.
+ * (The caller notifies the delivery task.)
+ */
+void SwitchBoard::queueEntry(QueueEntry entry) {
+	bool queued = msgQueue.tryPush(entry);
+	while (! queued)
+	{  // The queue is full...
+		OVERFLOW_POLICY policy = overflowPolicy;
+		if ((policy == OVERFLOW_POLICY::BLOCK) && ((xTaskGetCurrentTaskHandle () == MessengerTaskId)
+				|| isInboxTask (xTaskGetCurrentTaskHandle () )))
+		{   // The delivery task (i.e.: a driver's callBack) can't wait for itself!
+			// Nor can a driver's own task - the SwitchBoard may be waiting
+			// for it to make room in its inbox.
+			policy = OVERFLOW_POLICY::DROP_NEWEST;
+		}
+
+		if (policy == OVERFLOW_POLICY::DROP_NEWEST)
+		{
+			dropEntry(entry);
+			return;
+		}
+
+		if (policy == OVERFLOW_POLICY::DROP_OLDEST)
+		{
+			QueueEntry oldest;
+			if (msgQueue.tryPop(&oldest))
+			{
+				dropEntry(oldest);
+			}
+		}
+		else
+		{   // BLOCK. Say we are waiting, THEN check again - the delivery task
+			// may have made room before it could see us.
+			blockedSenders.fetch_add(1);
+			queued = msgQueue.tryPush(entry);
+			if (! queued)
+			{
+				xTaskNotifyGive (MessengerTaskId);   // Make sure it is awake
+				xSemaphoreTake(queueSpaceSemaphore, portMAX_DELAY);
+			}
+			blockedSenders.fetch_sub(1);
+			if (queued) break;
+		}
+		queued = msgQueue.tryPush(entry);
+	}
+}
+
+
+/**
+ * Find the mailbox for this message - if it is a 'state' event.
+ * @return the mailbox index, or -1 if it is an ordinary message.
+ */
+int SwitchBoard::findMailbox(const Message *msg) {
+	int count = mailboxCount.load(std::memory_order_acquire);
+	for (int idx = 0; idx < count; idx++)
+	{
+		if ((mailboxes[idx].destination == msg->destination)
+				&& (mailboxes[idx].event == msg->event))
+		{
+			return(idx);
+		}
+	}
+	return(-1);
+}
+
+
+/**
+ * Turn a queue entry back into the message to deliver.
+ * For a 'state' event this empties the mailbox, so the next
+ * send of that event will queue a new entry.
+ * @return the message - or nullptr if there is nothing to deliver.
+ */
+Message *SwitchBoard::takeEntry(QueueEntry entry) {
+	if (entry.msg != nullptr) return(entry.msg);
+	return(mailboxes[entry.mailbox].pending.exchange(nullptr));
+}
+
+
+/**
+ * Throw away a queue entry (and its message).
+ */
+void SwitchBoard::dropEntry(QueueEntry entry) {
+	Message *msg = takeEntry(entry);
+	if (msg != nullptr) dropMessage(msg);
+}
+
+
+/**
+ * Send a message at a particular time in the future.
+ *
+ * As with 'send', the message is no longer available to the caller
+ * when this returns.
+ *
+ * @param msg - a pointer to the message to deliver.
+ * @param deliverAtUsec - when to send it, in microseconds since boot
+ *           (i.e.: esp_timer_get_time() ). If this has already passed,
+ *           the message is sent immediately.
+ * @return false if the timer queue was full (the message was dropped).
+ */
+bool SwitchBoard::sendAt(Message *msg, TIME_t deliverAtUsec) {
+	if (firstTimeThrough) {
+		ESP_LOGE(TAG, "::sendAt ERROR: sendAt called before SwitchBoard::runDelivery was run");
+		delete msg;
+		abort();
+	}
+
+	if (deliverAtUsec <= (TIME_t) esp_timer_get_time())
+	{
+		send(msg);
+		return(true);
+	}
+
+	TAKE_TIMER_LOCK;
+	TIME_t earliest = 0;
+	bool wasEmpty = ! timerQueue.nextDeadline(&earliest);
+	if (! timerQueue.insert(msg, deliverAtUsec))
+	{
+		GIVE_TIMER_LOCK;
+		ESP_LOGW(TAG, "sendAt: timer queue full - increase SWITCHBOARD_TIMER_QUEUE_SIZE");
+		dropMessage(msg);
+		return(false);
+	}
+
+	// Only need to touch the timer if this is now the earliest message.
+	if (wasEmpty || (deliverAtUsec < earliest))
+	{
+		armTimer();
+	}
+	GIVE_TIMER_LOCK;
+	return(true);
+}
+
+
+/**
+ * Send a message that expects a reply.
+ *
+ * The driver should answer with Message::create_reply. The reply (or, if
+ * none arrives within 'timeoutMsec', an EVENT_ACTION_TIMEOUT message) is
+ * given to 'onReply' on the SwitchBoard task - NOT to the requester's
+ * callBack. 'onReply' is called exactly once if this succeeds.
+ *
+ * As with 'send', the message is no longer available to the caller
+ * when this returns.
+ *
+ * @param msg         - the request. Its corrId is filled in here.
+ * @param onReply     - what to do with the reply.
+ * @param timeoutMsec - how long to wait for the reply.
+ * @return the correlation ID - or zero if there was no room for another
+ *         request (the message is dropped, and 'onReply' is never called).
+ */
+uint16_t SwitchBoard::request(Message *msg, ReplyHandler onReply, uint32_t timeoutMsec) {
+	if (firstTimeThrough) {
+		ESP_LOGE(TAG, "::request ERROR: request called before SwitchBoard::runDelivery was run");
+		delete msg;
+		abort();
+	}
+
+	TAKE_PENDING_LOCK;
+	int slot = -1;
+	for (int idx = 0; idx < SWITCHBOARD_MAX_PENDING; idx++)
+	{
+		if (pending[idx].corrId == 0)
+		{
+			slot = idx;
+			break;
+		}
+	}
+	if (slot < 0)
+	{
+		GIVE_PENDING_LOCK;
+		ESP_LOGW(TAG, "request: too many requests waiting - increase SWITCHBOARD_MAX_PENDING");
+		dropMessage(msg);
+		return(0);
+	}
+
+	// Low bits are the slot, high bits change every time (never zero).
+	uint16_t corrId;
+	do
+	{
+		corrId = (uint16_t) ((++pendingGeneration * SWITCHBOARD_MAX_PENDING) + slot);
+	} while (corrId == 0);
+	pending[slot].corrId = corrId;
+	pending[slot].handler = onReply;
+	GIVE_PENDING_LOCK;
+
+	msg->corrId = corrId;
+	msg->flags &= ~MSG_FLAG_REPLY;
+	Message *timeout = Message::create_reply(msg, 0, 0, nullptr);
+	timeout->event = EVENT_ACTION_TIMEOUT;
+	if (! sendAt(timeout, (TIME_t) esp_timer_get_time() + ((TIME_t) timeoutMsec * 1000)))
+	{   // Without a timeout, the slot might never be freed.
+		releasePending(slot);
+		dropMessage(msg);
+		return(0);
+	}
+
+	send(msg);
+	return(corrId);
+}
+
+
+/**
+ * Give a reply to the handler that is waiting for it - if any.
+ * (Runs on the delivery task. The caller deletes the reply.)
+ * @return false if nobody was waiting (it was late, or a duplicate).
+ */
+bool SwitchBoard::completeRequest(Message *reply) {
+	int slot = reply->corrId & (SWITCHBOARD_MAX_PENDING - 1);
+	TAKE_PENDING_LOCK;
+	if (pending[slot].corrId != reply->corrId)
+	{
+		GIVE_PENDING_LOCK;
+		ESP_LOGD(TAG, "Discarded reply %u (event %d) - nobody waiting", reply->corrId, reply->event);
+		return(false);
+	}
+	ReplyHandler handler = std::move(pending[slot].handler);
+	pending[slot].handler = nullptr;
+	pending[slot].corrId = 0;
+	GIVE_PENDING_LOCK;
+
+	if (reply->event != EVENT_ACTION_TIMEOUT)
+	{   // The timeout isn't needed now
+		TAKE_TIMER_LOCK;
+		Message *timeout = timerQueue.removeReply(reply->corrId);
+		if (timeout != nullptr) armTimer();
+		GIVE_TIMER_LOCK;
+		delete timeout;
+	}
+
+	// (Without the lock - the handler may well make another request.)
+	if (handler) handler(reply);
+	return(true);
+}
+
+
+/**
+ * Free a pending request slot, without calling its handler.
+ */
+void SwitchBoard::releasePending(int slot) {
+	TAKE_PENDING_LOCK;
+	pending[slot].handler = nullptr;
+	pending[slot].corrId = 0;
+	GIVE_PENDING_LOCK;
+}
+
+
+/**
+ * Set the timer for the earliest waiting message (if any).
+ * The caller must hold the timer lock.
+ */
+void SwitchBoard::armTimer() {
+	TIME_t deliverAt;
+	esp_timer_stop(deliveryTimer);  // (An error just means it wasn't running)
+	if (! timerQueue.nextDeadline(&deliverAt)) return;
+
+	TIME_t now = esp_timer_get_time();
+	uint64_t delay = (deliverAt > now) ? (deliverAt - now) : 1;
+	esp_timer_start_once(deliveryTimer, delay);
+}
+
+
+/**
+ * The esp_timer callback - something is due, so wake the delivery task
+ * (it takes the messages - see takeDue). This never waits: every other
+ * esp_timer user shares this task.
+ */
+void SwitchBoard::timerCallback(void *arg) {
+	timerDue.store(true);
+	xTaskNotifyGive (MessengerTaskId);
+}
+
+
+/**
+ * Take the timed messages that are due (up to 'limit' of them), and set
+ * the timer for the next one. Only the delivery task calls this.
+ *
+ * A due 'state' event replaces one that is still waiting in its mailbox
+ * (just as 'send' would do) - otherwise it goes in the batch.
+ *
+ * @return how many messages were put in 'batch'.
+ */
+size_t SwitchBoard::takeDue(Message **batch, size_t limit) {
+	size_t count = 0;
+	Message *msg;
+	TAKE_TIMER_LOCK;
+	TIME_t now = esp_timer_get_time();
+	while ((count < limit) && ((msg = timerQueue.popDue(now)) != nullptr))
+	{
+		SB_STATS_STAMP(msg);
+		int box = findMailbox(msg);
+		if (box >= 0)
+		{   // (Only we take from a mailbox, so whatever we replace is ours)
+			Message *old = mailboxes[box].pending.load();
+			while ((old != nullptr) && !mailboxes[box].pending.compare_exchange_weak(old, msg))
+			{
+				// 'old' was reloaded - try again
+			}
+			if (old != nullptr)
+			{
+				coalescedCount.fetch_add(1);
+				delete old;
+				continue;
+			}
+		}
+		batch[count++] = msg;
+	}
+	if (count == limit)
+	{   // There may be more - come back for them
+		timerDue.store(true);
+	}
+	else
+	{
+		armTimer();
+	}
+	GIVE_TIMER_LOCK;
+	return(count);
+}
+
+
+/**
+ * Report how late timed messages have been sent (see sendAt).
+ */
+void SwitchBoard::getTimerJitter(TimerJitterStats *stats) {
+	TAKE_TIMER_LOCK;
+	timerQueue.getJitter(stats);
+	GIVE_TIMER_LOCK;
+}
+
+
+void SwitchBoard::resetTimerJitter() {
+	TAKE_TIMER_LOCK;
+	timerQueue.resetJitter();
+	GIVE_TIMER_LOCK;
+}
+
+
+/**
+ * Throw away a message that we could not queue, and count it.
+ */
+void SwitchBoard::dropMessage(Message *msg) {
+	SB_STATS_DROP(msg);
+	uint32_t drops = dropCount.fetch_add(1) + 1;
+	// Don't flood the log - just the first time, then every so often.
+	if ((drops % 100) == 1)
+	{
+		ESP_LOGW(TAG, "Queue full - dropped message for device %d (%u dropped so far)",
+				TASK_IDX(msg->destination), drops);
+	}
+	delete msg;
+}
+
+
+/**
+ * Set what 'send' does when the queue is full.
+ * @param policy - BLOCK, DROP_OLDEST or DROP_NEWEST.
+ */
+void SwitchBoard::setOverflowPolicy(OVERFLOW_POLICY policy) {
+	overflowPolicy = policy;
+}
+
+
+/**
+ * Turn batch delivery on or off (see runDelivery).
+ * @param enable - true for batch mode.
+ */
+void SwitchBoard::setBatchMode(bool enable) {
+	batchMode = enable;
+}
+
+
+/**
+ * Register a 'state' event - one where only the latest value matters.
+ * If one of these is sent while an earlier one (with the same destination
+ * and event) is still waiting to be delivered, the earlier one is thrown
+ * away, and the new one is delivered in its place.
+ *
+ * @param destination - the driver the event is sent to.
+ * @param event       - the event.
+ */
+void SwitchBoard::registerStateEvent(TASK_NAME destination, int event) {
+	TAKE_LOCK;
+	int count = mailboxCount.load();
+	for (int idx = 0; idx < count; idx++)
+	{
+		if ((mailboxes[idx].destination == destination) && (mailboxes[idx].event == event))
+		{   // Already registered
+			GIVE_LOCK;
+			return;
+		}
+	}
+
+	if (count >= SWITCHBOARD_MAX_MAILBOXES)
+	{
+		ESP_LOGE(TAG, "registerStateEvent: No room for device %d event %d - increase SWITCHBOARD_MAX_MAILBOXES",
+				TASK_IDX(destination), event);
+		GIVE_LOCK;
+		return;
+	}
+
+	mailboxes[count].destination = destination;
+	mailboxes[count].event = event;
+	mailboxes[count].pending.store(nullptr);
+	mailboxCount.store(count + 1, std::memory_order_release);
+	GIVE_LOCK;
+}
+
+
+/**
+ * @return how many state events were replaced by a newer one before
+ *         they could be delivered.
+ */
+uint32_t SwitchBoard::getCoalescedCount() {
+	return(coalescedCount.load());
+}
+
+
+/**
+ * @return the number of messages thrown away because the queue was full.
+ */
+uint32_t SwitchBoard::getDropCount() {
+	return(dropCount.load());
+}
+
+
+/**
+ * @return the most messages that have been waiting in the queue at one time.
+ */
+uint32_t SwitchBoard::getQueueHighWater() {
+	return(msgQueue.getHighWater());
+}
+
+
+#ifdef SWITCHBOARD_STATS
+/**
+ * Get the delivery statistics for one destination.
+ * The queue high water is for the driver's inbox if it has its own
+ * delivery task - otherwise it is the (shared) SwitchBoard queue.
+ */
+void SwitchBoard::getRouteStats(TASK_NAME destination, RouteStats *stats) {
+	SwitchBoardStats::getRoute(destination, stats);
+	TAKE_LOCK;
+	DriverInbox *inbox = inboxList[TASK_IDX(destination )];
+	stats->queueHighWater = (inbox != nullptr) ? inbox->ring.getHighWater() : msgQueue.getHighWater();
+	GIVE_LOCK;
+}
+#endif
+
+
+/**
+ * Reset all of the counters - drops, coalesced messages, queue high
+ * water marks, the message pool and timer statistics, and (with
+ * SWITCHBOARD_STATS) the per-destination statistics.
+ */
+void SwitchBoard::resetStats() {
+	dropCount.store(0);
+	coalescedCount.store(0);
+	msgQueue.resetHighWater();
+	Message::resetPoolStats();
+	resetTimerJitter();
+#ifdef SWITCHBOARD_STATS
+	SwitchBoardStats::reset();
+#endif
+	TAKE_LOCK;
+	for (int idx = 0; idx < NO_OF_TASK_NAMES; idx++)
+	{
+		if (inboxList[idx] != nullptr) inboxList[idx]->ring.resetHighWater();
+	}
+	GIVE_LOCK;
 }
 
 
@@ -166,33 +872,291 @@ void SwitchBoard::registerDriver(TASK_NAME driverName, DeviceDef *me) {
 		ESP_LOGD(TAG, "De-register old driver for %d", TASK_IDX(driverName) );
 		driverList[targIdx] = nullptr;
 	}
+	DriverInbox *oldInbox = releaseInbox(targIdx);
 	driverList[targIdx]=me;
 	GIVE_LOCK;
+	waitForInbox(oldInbox);
 	return;
 }
 
 
+/**
+ * This registers a driver that gets its own delivery task. The SwitchBoard
+ * moves the driver's messages to its inbox, and the new task (pinned to
+ * 'core') calls the driver's callBack/callBackBatch. If the same driver
+ * is registered under more than one name, they share one inbox and task
+ * (so its callBack is never called from two tasks at once).
+ *
+ * NOTE: The callBack runs on the driver's task, NOT the SwitchBoard's.
+ *
+ * @param driverName - the TASK_NAME entry for this driver
+ * @param me - pointer to the DeviceDef instance to register.
+ * @param core - which core to run the delivery task on.
+ */
+void SwitchBoard::registerDriver(TASK_NAME driverName, DeviceDef *me, BaseType_t core) {
+	TAKE_LOCK;
+	if (firstTimeThrough) {
+		ESP_LOGE(TAG, "ERROR: registerDriver called before SwitchBoard::runDelivery was run");
+		GIVE_LOCK;
+		abort();
+	}
+
+	ESP_LOGD(TAG, "Driver %d is being registered with its own task on core %d",
+			static_cast<int>(driverName), core);
+	int targIdx=static_cast<int>(driverName);
+	DriverInbox *oldInbox = releaseInbox(targIdx);
+
+	// Already have a task for this driver?
+	DriverInbox *inbox = nullptr;
+	for (int idx = 0; idx < NO_OF_TASK_NAMES; idx++)
+	{
+		if ((inboxList[idx] != nullptr) && (inboxList[idx]->driver == me))
+		{
+			inbox = inboxList[idx];
+			break;
+		}
+	}
+
+	if (inbox == nullptr)
+	{
+		inbox = new DriverInbox();
+		inbox->driver   = me;
+		inbox->refCount = 0;
+		inbox->running.store(true);
+		inbox->freeOnExit = false;
+		inbox->routerWaiting.store(false);
+		inbox->exited = xSemaphoreCreateBinaryStatic(&inbox->exitedBuffer);
+		char taskName[16];
+		snprintf(taskName, sizeof(taskName), "SBInbox%d", targIdx);
+		if (pdPASS != xTaskCreatePinnedToCore(inboxTask, taskName, SWITCHBOARD_INBOX_STACK,
+				inbox, SWITCHBOARD_INBOX_PRIORITY, &inbox->task, core))
+		{
+			ESP_LOGE(TAG, "Failed to create delivery task for driver %d - using the SwitchBoard task",
+					targIdx);
+			delete inbox;
+			inbox = nullptr;
+		}
+		else
+		{   // (There can't be more inboxes than names, so there is always a slot)
+			for (int idx = 0; idx < NO_OF_TASK_NAMES; idx++)
+			{
+				if (inboxTasks[idx].load() == nullptr)
+				{
+					inboxTasks[idx].store(inbox->task);
+					break;
+				}
+			}
+		}
+	}
+
+	if (inbox != nullptr)
+	{
+		inbox->refCount++;
+	}
+	inboxList[targIdx]=inbox;
+	driverList[targIdx]=me;
+	GIVE_LOCK;
+	waitForInbox(oldInbox);
+}
+
+
+/**
+ * Move a message to its driver's inbox, and wake the driver's task. If the
+ * inbox is full, we wait for the driver's task to make room (so nothing is
+ * lost, and the order is kept). We give up the lock while we wait - so the
+ * driver's callBack can take it - and look the inbox up again afterwards.
+ *
+ * The caller must hold the lock.
+ *
+ * @return false if the driver was de-registered while we waited (the
+ *         message was not taken - the caller throws it away).
+ */
+bool SwitchBoard::routeToInbox(Message *msg) {
+	int targIdx = TASK_IDX(msg->destination);
+	DriverInbox *inbox = inboxList[targIdx];
+	while ((inbox != nullptr) && ! inbox->ring.tryPush(msg))
+	{   // Say we are waiting, THEN check again - the task may have
+		// made room before it could see us.
+		inbox->routerWaiting.store(true);
+		if (inbox->ring.tryPush(msg))
+		{
+			break;
+		}
+		xTaskNotifyGive (inbox->task );
+		GIVE_LOCK;
+		// (The driver's task notifies us when it takes something out. A
+		//  'send' may wake us too - then we just look again.)
+		ulTaskNotifyTake (pdTRUE, portMAX_DELAY );
+		TAKE_LOCK;
+		// (Don't touch the old one - it may have been freed)
+		inbox = inboxList[targIdx];
+	}
+	if (inbox == nullptr) return(false);
+
+	inbox->routerWaiting.store(false);
+	xTaskNotifyGive (inbox->task );
+	return(true);
+}
+
+
+/**
+ * Stop using an inbox for this TASK_NAME. If nobody else uses it,
+ * its task is told to quit (it throws away anything left in the inbox).
+ *
+ * The caller must hold the lock - and, once it has given it, pass what
+ * this returns to waitForInbox.
+ *
+ * @return the inbox whose task is quitting - or nullptr if there isn't
+ *         one (or it is the task calling us, which can't wait for itself).
+ */
+SwitchBoard::DriverInbox *SwitchBoard::releaseInbox(int targIdx) {
+	DriverInbox *inbox = inboxList[targIdx];
+	if (inbox == nullptr) return(nullptr);
+
+	inboxList[targIdx] = nullptr;
+	if (--inbox->refCount > 0) return(nullptr);
+
+	// A driver de-registering itself, from its own callBack
+	inbox->freeOnExit = (xTaskGetCurrentTaskHandle () == inbox->task);
+	inbox->running.store(false);
+	xTaskNotifyGive (inbox->task );
+	return((inbox->freeOnExit) ? nullptr : inbox);
+}
+
+
+/**
+ * Wait for a driver's task to finish (see releaseInbox), then free its
+ * inbox. After this, the driver's callBack will not be called again.
+ *
+ * The caller must NOT hold the lock (the callBack may be waiting for it).
+ */
+void SwitchBoard::waitForInbox(DriverInbox *inbox) {
+	if (inbox == nullptr) return;
+	xSemaphoreTake(inbox->exited, portMAX_DELAY);
+	freeInbox(inbox);
+}
+
+
+/**
+ * Throw away anything left in an inbox (the task has finished), and free it.
+ */
+void SwitchBoard::freeInbox(DriverInbox *inbox) {
+	Message *msg;
+	while (inbox->ring.tryPop(&msg))
+	{
+		delete msg;
+	}
+	for (int idx = 0; idx < NO_OF_TASK_NAMES; idx++)
+	{
+		TaskHandle_t task = inbox->task;
+		if (inboxTasks[idx].compare_exchange_strong(task, nullptr)) break;
+	}
+	delete inbox;
+}
+
+
+/**
+ * Is this one of the driver delivery tasks?
+ */
+bool SwitchBoard::isInboxTask(TaskHandle_t task) {
+	for (int idx = 0; idx < NO_OF_TASK_NAMES; idx++)
+	{
+		if (inboxTasks[idx].load() == task) return(true);
+	}
+	return(false);
+}
+
+
+/**
+ * The delivery task for a driver registered with its own task.
+ * It waits for messages in its inbox, and delivers them (in batches,
+ * if batch mode is on).
+ * @param arg - pointer to the DriverInbox.
+ */
+void SwitchBoard::inboxTask(void *arg) {
+	DriverInbox *inbox = (DriverInbox *) arg;
+	Message *batch[SWITCHBOARD_BATCH_MAX];
+
+	while (inbox->running.load())
+	{
+		size_t limit = (batchMode) ? SWITCHBOARD_BATCH_MAX : 1;
+		size_t count = 0;
+		while ((count < limit) && inbox->ring.tryPop(&batch[count]))
+		{
+			count++;
+		}
+
+		if (count == 0)
+		{  // Sleep until the SwitchBoard gives us something.
+			ulTaskNotifyTake (pdTRUE, portMAX_DELAY );
+			continue;
+		}
+
+		if (inbox->routerWaiting.load())
+		{
+			xTaskNotifyGive (MessengerTaskId );
+		}
+
+		dispatch(inbox->driver, batch, count);
+
+		for (size_t idx = 0; idx < count; idx++)
+		{
+			delete batch[idx];
+		}
+	}
+
+	// De-registered. Outstanding messages are not delivered. (The
+	// SwitchBoard may be waiting for room - it will find the inbox gone.)
+	xTaskNotifyGive (MessengerTaskId );
+	if (inbox->freeOnExit)
+	{
+		freeInbox(inbox);
+	}
+	else
+	{   // Whoever de-registered us frees it (don't touch it after this)
+		xSemaphoreGive(inbox->exited);
+	}
+	vTaskDelete(nullptr);
+}
+
+
 /**
  * This removes a driver from the list of known drivers.
- * Any outstanding messages will not be delivered.
+ * Any outstanding messages will not be delivered. If the driver has its
+ * own task, this waits for the task to finish (unless it is that task
+ * calling) - so the driver can be deleted as soon as this returns.
  * @param driverName - the name of the type of driver to delete.
  */
 void SwitchBoard::deRegisterDriver(TASK_NAME driverName) {
 	TAKE_LOCK;
 	ESP_LOGD(TAG, "Driver %d is being DE-registered", static_cast<int>(driverName));
 	driverList[TASK_IDX(driverName )] = nullptr;
+	DriverInbox *inbox = releaseInbox(TASK_IDX(driverName ));
 	GIVE_LOCK;
+	waitForInbox(inbox);
+}
+
+/**
+ * Has runDelivery set up? (Until it has, send, registerDriver... abort.)
+ */
+bool SwitchBoard::isRunning() {
+	return (!firstTimeThrough);
+}
+
+/**
+ * Is there a driver for this destination? (Lets a sender skip messages
+ * that nobody would get.)
+ */
+bool SwitchBoard::isRegistered(TASK_NAME driverName) {
+	return (driverList[TASK_IDX(driverName )] != nullptr);
 }
 
 /**
  * This empties the queue
  */
 void SwitchBoard::flush() {
-	Message *msg=nullptr;
-	// TAKE_LOCK;
-	while (0 != uxQueueMessagesWaiting(msgQueue)) {
-		xQueueReceive(msgQueue, msg, 0);
-		delete msg;
+	QueueEntry entry;
+	while (msgQueue.tryPop(&entry)) {
+		delete takeEntry(entry);
 	}
-	// GIVE_LOCK;
 }
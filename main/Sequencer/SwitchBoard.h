@@ -10,6 +10,7 @@
 #define MAIN_SWITCHBOARD_H_
 
 #include <functional>
+#include <atomic>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
@@ -19,7 +20,27 @@
 
 #include "../config.h"
 #include "Message.h"
+#include "MsgRing.h"
+#include "TimerQueue.h"
 #include "DeviceDef.h"
+#include "SwitchBoardStats.h"
+
+// What 'send' does when the message queue is full:
+//   BLOCK       - wait for the delivery task to make room.
+//   DROP_OLDEST - throw away the oldest queued message to make room.
+//   DROP_NEWEST - throw away the message being sent.
+// Dropped messages are deleted (not leaked!) and counted.
+enum class OVERFLOW_POLICY
+{
+	BLOCK = 0, DROP_OLDEST, DROP_NEWEST
+};
+
+// Called with the reply to a request - or with an EVENT_ACTION_TIMEOUT
+// message if no reply arrived in time. Runs on the SwitchBoard task, and
+// the message is deleted when it returns (just like a callBack).
+// It must not block - everybody's messages wait while it runs. Anything
+// slow (like sending on a socket) should be handed to another task.
+typedef std::function<void (const Message *reply)> ReplyHandler;
 
 class SwitchBoard
 {
@@ -28,20 +49,115 @@ public:
 	virtual ~SwitchBoard ();
 	static void runDelivery(void *);
 	static void send(Message *msg);
+	static bool sendAt(Message *msg, TIME_t deliverAtUsec);
+	static uint16_t request(Message *msg, ReplyHandler onReply, uint32_t timeoutMsec);
+	static void getTimerJitter(TimerJitterStats *stats);
+	static void resetTimerJitter();
 	static void registerDriver(TASK_NAME driverName, DeviceDef *me);
+	static void registerDriver(TASK_NAME driverName, DeviceDef *me, BaseType_t core);
 	static void deRegisterDriver(TASK_NAME driverName);
+	static bool isRegistered(TASK_NAME driverName);
+	static bool isRunning();
 	static void flush();
+	static void setOverflowPolicy(OVERFLOW_POLICY policy);
+	static void setBatchMode(bool enable);
+	static void registerStateEvent(TASK_NAME destination, int event);
+	static uint32_t getCoalescedCount();
+	static uint32_t getDropCount();
+	static uint32_t getQueueHighWater();
+	static void resetStats();
+#ifdef SWITCHBOARD_STATS
+	static void getRouteStats(TASK_NAME destination, RouteStats *stats);
+#endif
 
 protected:
 	SwitchBoard ();
 
 private:
+	// What is actually queued. Normally 'msg' is the message. For a 'state'
+	// event, 'msg' is null and 'mailbox' says where to find the latest value.
+	struct QueueEntry
+	{
+		Message *msg;
+		int mailbox;
+	};
+
+	// Holds the latest (not yet delivered) message for one (destination, event).
+	struct Mailbox
+	{
+		TASK_NAME destination;
+		int event;
+		std::atomic<Message *> pending;
+	};
+
+	// A driver with its own delivery task. The SwitchBoard task just moves
+	// its messages here, and the driver's task calls its callBack.
+	struct DriverInbox
+	{
+		MsgRing<Message *, SWITCHBOARD_INBOX_SIZE> ring;
+		DeviceDef *driver;
+		TaskHandle_t task;
+		int refCount;                    // How many TASK_NAMEs deliver here
+		std::atomic<bool> running;       // false tells the task to quit
+		bool freeOnExit;                 // The task frees the inbox itself (nobody waits)
+		std::atomic<bool> routerWaiting; // SwitchBoard is waiting for room
+		SemaphoreHandle_t exited;        // Given by the task when it is done
+		StaticSemaphore_t exitedBuffer;
+	};
+
 	static volatile bool firstTimeThrough;
 	static DeviceDef *driverList[NO_OF_TASK_NAMES];
-	static QueueHandle_t msgQueue;
+	static DriverInbox *inboxList[NO_OF_TASK_NAMES];
+	static MsgRing<QueueEntry, SWITCHBOARD_QUEUE_SIZE> msgQueue;
+	static Mailbox mailboxes[SWITCHBOARD_MAX_MAILBOXES];
+	static std::atomic<int> mailboxCount;
+	static std::atomic<uint32_t> coalescedCount;
+	static volatile OVERFLOW_POLICY overflowPolicy;
+	static volatile bool batchMode;
+	static std::atomic<uint32_t> dropCount;
+	static std::atomic<bool> timerDue;
+	static std::atomic<uint32_t> blockedSenders;
+	static SemaphoreHandle_t queueSpaceSemaphore;
+	static StaticSemaphore_t queueSpaceSemaphoreBuffer;
 	static TaskHandle_t MessengerTaskId;
+	static std::atomic<TaskHandle_t> inboxTasks[NO_OF_TASK_NAMES];
 	static SemaphoreHandle_t sequencer_semaphore;
 	static StaticSemaphore_t sequencer_semaphore_buffer;
+
+	static void queueEntry(QueueEntry entry);
+	static int findMailbox(const Message *msg);
+	static Message *takeEntry(QueueEntry entry);
+	static void dropEntry(QueueEntry entry);
+	static void dropMessage(Message *msg);
+	static void timerCallback(void *arg);
+	static size_t takeDue(Message **batch, size_t limit);
+	static bool routeToInbox(Message *msg);
+	static DriverInbox *releaseInbox(int targIdx);
+	static void waitForInbox(DriverInbox *inbox);
+	static void freeInbox(DriverInbox *inbox);
+	static bool isInboxTask(TaskHandle_t task);
+	static void inboxTask(void *arg);
+	static void armTimer();
+
+	// A request waiting for its reply. 'corrId' is zero if the slot is free.
+	struct PendingRequest
+	{
+		uint16_t corrId;
+		ReplyHandler handler;
+	};
+	static PendingRequest pending[SWITCHBOARD_MAX_PENDING];
+	static uint16_t pendingGeneration;
+	static SemaphoreHandle_t pending_semaphore;
+	static StaticSemaphore_t pending_semaphore_buffer;
+	static bool completeRequest(Message *reply);
+	static void releasePending(int slot);
+
+	static TimerQueue timerQueue;
+	static esp_timer_handle_t deliveryTimer;
+	static SemaphoreHandle_t timer_semaphore;
+	static StaticSemaphore_t timer_semaphore_buffer;
+	static void deliverBatch(Message **batch, size_t count);
+	static void dispatch(DeviceDef *driver, Message **msgs, size_t count);
 };
 
 #endif /* MAIN_SWITCHBOARD_H_ */
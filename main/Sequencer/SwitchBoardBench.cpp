@@ -0,0 +1,168 @@
+/**
+ * SwitchBoardBench.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+#include "../config.h"
+#include "SwitchBoard.h"
+#include "SwitchBoardBench.h"
+
+static const char *TAG="BENCH:";
+
+// How long to wait for stragglers after the producers are done
+#define BENCH_DRAIN_TIMEOUT_MS 2000
+
+static inline uint32_t benchNow()
+{
+	return ((uint32_t) esp_timer_get_time());
+}
+
+
+SwitchBoardBench::SwitchBoardBench () : DeviceDef("Bench")
+{
+	latencies = nullptr;
+	expected = 0;
+	received.store(0);
+	lastDelivery = 0;
+	perProducer = 0;
+	done = xSemaphoreCreateBinaryStatic(&doneBuffer);
+	finished = xSemaphoreCreateCountingStatic(BENCH_MAX_PRODUCERS, 0, &finishedBuffer);
+}
+
+
+/**
+ * The sink - record how long each message took to get here.
+ * (Only the SwitchBoard task calls this.)
+ */
+void SwitchBoardBench::callBack(const Message *msg) {
+	if (msg->event != EVENT_BENCH_PING) return;
+
+	uint32_t now = benchNow();
+	uint32_t idx = received.load();
+	if (idx < expected)
+	{
+		latencies[idx] = now - (uint32_t) msg->value;
+	}
+	lastDelivery = now;
+	if (received.fetch_add(1) + 1 == expected)
+	{
+		xSemaphoreGive(done);
+	}
+}
+
+
+/**
+ * A producer - wait for the starting gun, then send as fast as we can.
+ */
+void SwitchBoardBench::producerTask(void *arg) {
+	SwitchBoardBench *sink = (SwitchBoardBench *) arg;
+	ulTaskNotifyTake (pdTRUE, portMAX_DELAY );
+
+	for (int idx = 0; idx < sink->perProducer; idx++)
+	{
+		SwitchBoard::send(Message::create_message(TASK_NAME::TEST, TASK_NAME::TEST,
+				EVENT_BENCH_PING, (long int) benchNow(), 0));
+	}
+	xSemaphoreGive(sink->finished);
+	vTaskDelete(nullptr);
+}
+
+
+/**
+ * Run one benchmark.
+ *
+ * This blocks the caller until the run is over (normally well under a second).
+ *
+ * @param producers   - how many tasks send at once (1...BENCH_MAX_PRODUCERS).
+ * @param perProducer - how many messages each one sends.
+ * @param result      - where to put the results.
+ * @return false if the parameters are out of range, or we ran out of memory.
+ */
+bool SwitchBoardBench::run(int producers, int perProducer, BenchResult *result) {
+	memset(result, 0, sizeof(*result));
+	if ((producers < 1) || (producers > BENCH_MAX_PRODUCERS) || (perProducer < 1)
+			|| (producers * perProducer > BENCH_MAX_MESSAGES))
+	{
+		return (false);
+	}
+
+	SwitchBoardBench *sink = new SwitchBoardBench();
+	sink->expected = producers * perProducer;
+	sink->perProducer = perProducer;
+	sink->latencies = (uint32_t *) malloc(sink->expected * sizeof(uint32_t));
+	if (sink->latencies == nullptr)
+	{
+		ESP_LOGE(TAG, "No memory for %u latencies", sink->expected);
+		delete sink;
+		return (false);
+	}
+
+	SwitchBoard::registerDriver(TASK_NAME::TEST, sink);
+	uint32_t dropsBefore = SwitchBoard::getDropCount();
+
+	TaskHandle_t tasks[BENCH_MAX_PRODUCERS];
+	int started = 0;
+	for (int idx = 0; idx < producers; idx++)
+	{
+		if (pdPASS == xTaskCreate(&producerTask, "bench", 3072, sink,
+				uxTaskPriorityGet(nullptr), &tasks[started]))
+		{
+			started++;
+		}
+	}
+	if (started < producers)
+	{
+		ESP_LOGW(TAG, "Only started %d of %d producers", started, producers);
+		sink->expected = started * perProducer;
+	}
+
+	uint32_t start = benchNow();
+	for (int idx = 0; idx < started; idx++)
+	{
+		xTaskNotifyGive(tasks[idx]);
+	}
+	for (int idx = 0; idx < started; idx++)
+	{
+		xSemaphoreTake(sink->finished, portMAX_DELAY);
+	}
+	if ((sink->expected > 0)
+			&& (pdTRUE != xSemaphoreTake(sink->done, pdMS_TO_TICKS(BENCH_DRAIN_TIMEOUT_MS))))
+	{
+		ESP_LOGW(TAG, "Only %u of %u messages arrived", sink->received.load(), sink->expected);
+	}
+	// (Once this returns, the SwitchBoard won't call the sink again)
+	SwitchBoard::deRegisterDriver(TASK_NAME::TEST);
+
+	uint32_t count = std::min(sink->received.load(), sink->expected);
+	result->sent = sink->expected;
+	result->received = count;
+	result->dropped = SwitchBoard::getDropCount() - dropsBefore;
+	if (count > 0)
+	{
+		std::sort(sink->latencies, sink->latencies + count);
+		result->elapsedUsec = sink->lastDelivery - start;
+		if (result->elapsedUsec > 0)
+		{
+			result->msgsPerSec = (uint32_t) ((uint64_t) count * 1000000 / result->elapsedUsec);
+		}
+		result->p50Usec = sink->latencies[(count - 1) * 50 / 100];
+		result->p99Usec = sink->latencies[(count - 1) * 99 / 100];
+		result->maxUsec = sink->latencies[count - 1];
+	}
+
+	free(sink->latencies);
+	delete sink;
+	return (true);
+}
@@ -0,0 +1,73 @@
+/**
+ * SwitchBoardBench.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ * A throughput and latency benchmark for the SwitchBoard, run on the
+ * board itself (see the 'bench' command).
+ *
+ * 'producers' tasks each send 'perProducer' messages, as fast as they can,
+ * to a sink driver registered as TASK_NAME::TEST. Each message carries the
+ * time it was sent, and the sink records how long it took to arrive. We
+ * report messages/second (first send to last delivery), and the 50th and
+ * 99th percentile send-to-callBack latency.
+ *
+ * NOTE: This borrows TASK_NAME::TEST for the duration of the run - don't
+ *       run it while something else is registered there. Messages are
+ *       real messages, so run it with the player stopped if you want
+ *       numbers that don't depend on what the skull is doing.
+ */
+
+#ifndef MAIN_SEQUENCER_SWITCHBOARDBENCH_H_
+#define MAIN_SEQUENCER_SWITCHBOARDBENCH_H_
+
+#include <stdint.h>
+#include <atomic>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "Message.h"
+#include "DeviceDef.h"
+
+// The event the producers send to the sink.
+#define EVENT_BENCH_PING 100
+
+// The most producer tasks, and the most messages in one run.
+#define BENCH_MAX_PRODUCERS 8
+#define BENCH_MAX_MESSAGES 4000
+
+struct BenchResult
+{
+	uint32_t sent;          // Messages sent
+	uint32_t received;      // Messages delivered to the sink
+	uint32_t dropped;       // SwitchBoard drops during the run
+	uint32_t elapsedUsec;   // First send to last delivery
+	uint32_t msgsPerSec;
+	uint32_t p50Usec;       // Send to callBack latency
+	uint32_t p99Usec;
+	uint32_t maxUsec;
+};
+
+class SwitchBoardBench : public DeviceDef
+{
+public:
+	static bool run(int producers, int perProducer, BenchResult *result);
+	void callBack(const Message *msg);
+
+private:
+	SwitchBoardBench ();
+	static void producerTask(void *arg);
+
+	uint32_t *latencies;             // One per expected message
+	uint32_t expected;
+	std::atomic<uint32_t> received;
+	uint32_t lastDelivery;
+	int perProducer;
+	SemaphoreHandle_t done;          // Given when the last message arrives
+	StaticSemaphore_t doneBuffer;
+	SemaphoreHandle_t finished;      // Given by each producer when it is done
+	StaticSemaphore_t finishedBuffer;
+};
+
+#endif /* MAIN_SEQUENCER_SWITCHBOARDBENCH_H_ */
@@ -0,0 +1,117 @@
+/**
+ * SwitchBoardStats.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ */
+
+#include <string.h>
+#include "../config.h"
+#include "SwitchBoardStats.h"
+
+#ifdef SWITCHBOARD_STATS
+
+RouteStats SwitchBoardStats::routes[NO_OF_TASK_NAMES];
+std::atomic<uint32_t> SwitchBoardStats::drops[NO_OF_TASK_NAMES];
+
+// Names for the report - in TASK_NAME order.
+static const char *taskNames[NO_OF_TASK_NAMES] = {
+		"IDLER", "WAVEFILE", "EYES", "JAW", "NODD", "ROTATE", "TEST", "UDP", "MOTIONSEQ"
+};
+
+
+/**
+ * Which histogram bucket does this time fall in?
+ */
+int SwitchBoardStats::bucketOf(uint32_t usec) {
+	int bucket = 31 - __builtin_clz (usec | 1);   // floor(log2(usec))
+	return ((bucket < SB_STATS_BUCKETS) ? bucket : SB_STATS_BUCKETS - 1);
+}
+
+
+/**
+ * Record one delivered message.
+ * @param destination  - who it was for.
+ * @param latencyUsec  - how long it waited from 'send' until the callBack.
+ * @param callbackUsec - how long the callBack took.
+ */
+void SwitchBoardStats::recordDelivery(TASK_NAME destination, uint32_t latencyUsec, uint32_t callbackUsec) {
+	RouteStats *route = &routes[TASK_IDX(destination )];
+	route->delivered++;
+	route->latency[bucketOf(latencyUsec )]++;
+	route->callback[bucketOf(callbackUsec )]++;
+	if (latencyUsec > route->latencyMaxUsec) route->latencyMaxUsec = latencyUsec;
+	if (callbackUsec > route->callbackMaxUsec) route->callbackMaxUsec = callbackUsec;
+}
+
+
+/**
+ * Record a message that was thrown away. (This may be called from
+ * any task - so it is counted separately, and atomically).
+ */
+void SwitchBoardStats::recordDrop(TASK_NAME destination) {
+	drops[TASK_IDX(destination )].fetch_add (1, std::memory_order_relaxed );
+}
+
+
+/**
+ * Get a copy of the statistics for one destination.
+ * ('queueHighWater' is left at zero - the SwitchBoard knows its queues.)
+ */
+void SwitchBoardStats::getRoute(TASK_NAME destination, RouteStats *stats) {
+	*stats = routes[TASK_IDX(destination )];
+	stats->dropped = drops[TASK_IDX(destination )].load (std::memory_order_relaxed );
+	stats->queueHighWater = 0;
+}
+
+
+void SwitchBoardStats::reset() {
+	for (int idx = 0; idx < NO_OF_TASK_NAMES; idx++)
+	{
+		memset (&routes[idx], 0, sizeof(routes[idx]) );
+		drops[idx].store (0, std::memory_order_relaxed );
+	}
+}
+
+
+/**
+ * The largest time (usec) that can be in a bucket.
+ * (The last bucket has no limit - we return UINT32_MAX)
+ */
+uint32_t SwitchBoardStats::bucketLimit(int bucket) {
+	if (bucket >= SB_STATS_BUCKETS - 1) return (UINT32_MAX);
+	return ((2u << bucket) - 1);
+}
+
+
+/**
+ * Estimate a percentile from a histogram - the upper limit of the
+ * bucket that holds it.
+ * @param hist - the histogram (SB_STATS_BUCKETS entries).
+ * @param pct  - which percentile (e.g.: 50, 99).
+ * @return the time, in usec - or zero if the histogram is empty.
+ */
+uint32_t SwitchBoardStats::percentile(const uint32_t *hist, int pct) {
+	uint32_t total = 0;
+	for (int idx = 0; idx < SB_STATS_BUCKETS; idx++) total += hist[idx];
+	if (total == 0) return (0);
+
+	uint64_t wanted = ((uint64_t) total * pct + 99) / 100;  // round up
+	uint64_t seen = 0;
+	for (int idx = 0; idx < SB_STATS_BUCKETS; idx++)
+	{
+		seen += hist[idx];
+		if (seen >= wanted) return (bucketLimit(idx ));
+	}
+	return (UINT32_MAX);
+}
+
+
+const char *SwitchBoardStats::taskName(TASK_NAME task) {
+	int idx = TASK_IDX(task );
+	if ((idx < 0) || (idx >= NO_OF_TASK_NAMES)) return ("?");
+	return (taskNames[idx]);
+}
+
+#endif /* SWITCHBOARD_STATS */
@@ -0,0 +1,86 @@
+/**
+ * SwitchBoardStats.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ * Per-destination (TASK_NAME) delivery statistics for the SwitchBoard:
+ *   - how long messages wait between 'send' and their callBack (latency),
+ *   - how long the callBack takes,
+ *   - how many messages were dropped,
+ *   - and (filled in by SwitchBoard::getRouteStats) the queue high water.
+ *
+ * Times are kept in histograms with power-of-two buckets: bucket 0 is
+ * under 2 usec, bucket 1 is 2-3 usec, bucket 2 is 4-7 usec ... and the
+ * last bucket is everything from 2^(SB_STATS_BUCKETS-1) usec up.
+ *
+ * All of this only exists if SWITCHBOARD_STATS is defined (see config.h).
+ * Otherwise the SB_STATS_xxx macros below are empty, and Message doesn't
+ * carry a time stamp.
+ *
+ * NOTE: Each route is only updated by the task that delivers to it, and
+ *       the counters are not locked - so a 'reset' or a read that happens
+ *       during a delivery may be off by one. That's good enough here.
+ */
+
+#ifndef MAIN_SEQUENCER_SWITCHBOARDSTATS_H_
+#define MAIN_SEQUENCER_SWITCHBOARDSTATS_H_
+
+#include <stdint.h>
+#include "../config.h"
+#include "Message.h"
+
+#ifdef SWITCHBOARD_STATS
+
+#include <atomic>
+#include "esp_timer.h"
+
+#define SB_STATS_BUCKETS 16
+
+// A copy of the statistics for one destination.
+struct RouteStats
+{
+	uint32_t delivered;                  // Messages handed to the callBack
+	uint32_t dropped;                    // Messages thrown away (queue full, no driver...)
+	uint32_t queueHighWater;             // Deepest queue (inbox, if it has one) since reset
+	uint32_t latencyMaxUsec;             // Longest wait from 'send' to callBack
+	uint32_t callbackMaxUsec;            // Longest callBack (per message)
+	uint32_t latency[SB_STATS_BUCKETS];  // Histogram of wait times
+	uint32_t callback[SB_STATS_BUCKETS]; // Histogram of callBack times
+};
+
+class SwitchBoardStats
+{
+public:
+	// The time stamp clock - microseconds (wraps after about 71 minutes,
+	// which is fine for differences).
+	static inline uint32_t now() { return ((uint32_t) esp_timer_get_time()); }
+	static inline void stamp(Message *msg) { msg->sentAt = now(); }
+
+	static void recordDelivery(TASK_NAME destination, uint32_t latencyUsec, uint32_t callbackUsec);
+	static void recordDrop(TASK_NAME destination);
+	static void getRoute(TASK_NAME destination, RouteStats *stats);
+	static void reset();
+
+	// Upper limit (usec) of a bucket, and an estimate of the 'pct' percentile.
+	static uint32_t bucketLimit(int bucket);
+	static uint32_t percentile(const uint32_t *hist, int pct);
+	static const char *taskName(TASK_NAME task);
+
+private:
+	static RouteStats routes[NO_OF_TASK_NAMES];
+	static std::atomic<uint32_t> drops[NO_OF_TASK_NAMES];
+	static int bucketOf(uint32_t usec);
+};
+
+#define SB_STATS_STAMP(_msg_)  SwitchBoardStats::stamp(_msg_)
+#define SB_STATS_DROP(_msg_)   SwitchBoardStats::recordDrop((_msg_)->destination)
+
+#else
+
+#define SB_STATS_STAMP(_msg_)
+#define SB_STATS_DROP(_msg_)
+
+#endif /* SWITCHBOARD_STATS */
+
+#endif /* MAIN_SEQUENCER_SWITCHBOARDSTATS_H_ */
@@ -0,0 +1,160 @@
+/**
+ * TimerQueue.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ */
+
+#include "../config.h"
+#include "TimerQueue.h"
+
+TimerQueue::TimerQueue ()
+{
+	count = 0;
+	nextSeq = 0;
+	resetJitter ();
+}
+
+
+/**
+ * Does 'a' come out of the queue before 'b'?
+ */
+bool TimerQueue::before (const Entry &a, const Entry &b)
+{
+	if (a.deliverAt != b.deliverAt) return (a.deliverAt < b.deliverAt);
+	return ((int32_t) (a.seq - b.seq) < 0);
+}
+
+
+/**
+ * Add a message to the queue.
+ * @param msg       - the message.
+ * @param deliverAt - when to deliver it.
+ * @return true if added, false if the queue is full.
+ */
+bool TimerQueue::insert (Message *msg, TIME_t deliverAt)
+{
+	if (count >= SWITCHBOARD_TIMER_QUEUE_SIZE) return (false);
+
+	Entry entry = { deliverAt, nextSeq++, msg };
+	size_t idx = count++;
+	while (idx > 0)
+	{   // sift up
+		size_t parent = (idx - 1) / 2;
+		if (!before (entry, heap[parent] )) break;
+		heap[idx] = heap[parent];
+		idx = parent;
+	}
+	heap[idx] = entry;
+	return (true);
+}
+
+
+/**
+ * Take out the earliest message - if it is due.
+ * @param now - the current time.
+ * @return the message, or nullptr if nothing is due yet.
+ */
+Message *TimerQueue::popDue (TIME_t now)
+{
+	if ((count == 0) || (heap[0].deliverAt > now)) return (nullptr);
+
+	uint32_t late = (uint32_t) (now - heap[0].deliverAt);
+	if (late < jitter.minUsec) jitter.minUsec = late;
+	if (late > jitter.maxUsec) jitter.maxUsec = late;
+	jitter.totalUsec += late;
+	jitter.count++;
+	return (removeAt (0 ));
+}
+
+
+/**
+ * Take out the earliest message, due or not (use this to empty the queue).
+ * @return the message, or nullptr if the queue is empty.
+ */
+Message *TimerQueue::popAny ()
+{
+	if (count == 0) return (nullptr);
+	return (removeAt (0 ));
+}
+
+
+/**
+ * Take out the reply with this corrId (whenever it is due). The jitter
+ * isn't counted - it was never delivered.
+ * @param corrId - what 'request' gave the reply.
+ * @return the message, or nullptr if there is no such reply waiting.
+ */
+Message *TimerQueue::removeReply (uint16_t corrId)
+{
+	for (size_t idx = 0; idx < count; idx++)
+	{
+		const Message *msg = heap[idx].msg;
+		if ((msg->corrId == corrId) && ((msg->flags & MSG_FLAG_REPLY) != 0))
+		{
+			return (removeAt (idx ));
+		}
+	}
+	return (nullptr);
+}
+
+
+/**
+ * When is the next message due?
+ * @param deliverAt - where to put the time.
+ * @return false if the queue is empty.
+ */
+bool TimerQueue::nextDeadline (TIME_t *deliverAt) const
+{
+	if (count == 0) return (false);
+	*deliverAt = heap[0].deliverAt;
+	return (true);
+}
+
+
+/**
+ * Remove the entry at 'idx', and fix up the heap - the last entry takes
+ * its place, and moves up or down to wherever it belongs.
+ */
+Message *TimerQueue::removeAt (size_t idx)
+{
+	Message *msg = heap[idx].msg;
+	Entry last = heap[--count];
+	if (idx == count) return (msg);
+
+	while (idx > 0)
+	{   // sift up (it may be earlier than the one it replaces)
+		size_t parent = (idx - 1) / 2;
+		if (!before (last, heap[parent] )) break;
+		heap[idx] = heap[parent];
+		idx = parent;
+	}
+	while (true)
+	{   // sift down
+		size_t child = 2 * idx + 1;
+		if (child >= count) break;
+		if ((child + 1 < count) && before (heap[child + 1], heap[child] )) child++;
+		if (!before (heap[child], last )) break;
+		heap[idx] = heap[child];
+		idx = child;
+	}
+	heap[idx] = last;
+	return (msg);
+}
+
+
+void TimerQueue::getJitter (TimerJitterStats *stats) const
+{
+	*stats = jitter;
+	if (stats->count == 0) stats->minUsec = 0;
+}
+
+
+void TimerQueue::resetJitter ()
+{
+	jitter.count = 0;
+	jitter.minUsec = UINT32_MAX;
+	jitter.maxUsec = 0;
+	jitter.totalUsec = 0;
+}
@@ -0,0 +1,70 @@
+/**
+ * TimerQueue.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ * A fixed size priority queue (binary min-heap) of messages, ordered by
+ * the time they are to be delivered. Messages with the same delivery
+ * time come out in the order they were added.
+ *
+ * This knows nothing about clocks or tasks - the caller passes in the
+ * current time, and does any locking. (SwitchBoard::sendAt uses this with
+ * esp_timer; on a host it can be driven with a simulated clock).
+ *
+ * It also keeps track of how late each message was when it was taken
+ * out (the 'jitter').
+ *
+ * 'removeReply' takes out a waiting reply before it is due - the timeout
+ * for a request that has been answered (see SwitchBoard::request), so it
+ * doesn't hold a place in the queue for the rest of its wait.
+ */
+
+#ifndef MAIN_SEQUENCER_TIMERQUEUE_H_
+#define MAIN_SEQUENCER_TIMERQUEUE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "../config.h"
+#include "Message.h"
+
+// Delivery jitter - how late timed messages were, in microseconds.
+struct TimerJitterStats
+{
+	uint32_t count;      // How many timed messages were delivered
+	uint32_t minUsec;    // The least late
+	uint32_t maxUsec;    // The most late
+	uint64_t totalUsec;  // Sum of all - divide by 'count' for the average
+};
+
+class TimerQueue
+{
+public:
+	TimerQueue ();
+	bool insert (Message *msg, TIME_t deliverAt);
+	Message *popDue (TIME_t now);
+	bool nextDeadline (TIME_t *deliverAt) const;
+	Message *popAny ();
+	Message *removeReply (uint16_t corrId);
+	size_t size () const { return (count); }
+	void getJitter (TimerJitterStats *stats) const;
+	void resetJitter ();
+
+private:
+	struct Entry
+	{
+		TIME_t deliverAt;
+		uint32_t seq;     // Breaks ties - earlier 'insert' first
+		Message *msg;
+	};
+
+	Entry heap[SWITCHBOARD_TIMER_QUEUE_SIZE];
+	size_t count;
+	uint32_t nextSeq;
+	TimerJitterStats jitter;
+
+	static bool before (const Entry &a, const Entry &b);
+	Message *removeAt (size_t idx);
+};
+
+#endif /* MAIN_SEQUENCER_TIMERQUEUE_H_ */
@@ -14,10 +14,14 @@
 #include "Sequencer/DeviceDef.h"
 #include <freertos/task.h>
 #include "esp_log.h"
+#include "esp_timer.h"
 #include <driver/gpio.h>
 #include <errno.h>
 #include "audio/DACOutput.h"
 #include "audio/I2SOutput.h"
+#include "audio/PlaybackClock.h"
+#include "audio/AssetIndex.h"
+#include "audio/SeekIndex.h"
 #include "Sequencer/Message.h"
 #include "Sequencer/SwitchBoard.h"
 
@@ -25,62 +29,190 @@
 #include "SndPlayer.h"
 #include "PwmDriver.h"
 
-// 8000 samples is aprox 1 second.
-#define NOTIFYINTERVAL 8000
 #define ENABLE_JAW
 #define ENABLE_EYES
 #define ENABLE_PWM (defined(ENABLE_JAW) || defined (ENABLE_EYES))
 
-#define MINIMP3_IMPLEMENTATION
-#define MINIMP3_ONLY_MP3
-#define MINIMP3_NO_STDIO
-#include "audio/minimp3.h"
+#include "audio/Decoders.h"
+#include "audio/Resampler.h"
+#include "audio/Mixer.h"
+#include "audio/SfxBank.h"
 
 static const char *TAG = "SOUND:";
 
+/*
+ * The pipeline stages sleep until they are notified - there is no polling.
+ * Whenever one of them changes something another may be waiting for, it
+ * notifies that one:
+ *   reader  -> decoder  data in the window, the end of the clip, handoff
+ *                       NEXT or END
+ *   decoder -> reader   room in the window (consume), handoff WANTED
+ *   decoder -> player   a frame published (PLAYER_NOTIFY_FRAME)
+ *   player  -> decoder  a frame released
+ *   stopPipeline -> both  stopStages
+ * A waiter always checks again after it wakes, and a notification given
+ * before it waits isn't lost (it is still pending) - so a stage can't sleep
+ * through a change. Nor can two wait on each other: a full window holds
+ * more than AUDIO_WINDOW_GUARD, and a full ring has frames to play.
+ * Anything new that a stage waits for needs its notify.
+ */
+static_assert(AUDIO_READ_WINDOW_SIZE - AUDIO_READ_CHUNK_SIZE >= AUDIO_WINDOW_GUARD,
+		"The reader could wait for room while the decoder waits for a frame's worth");
+
+/*
+ * The pipeline counters. Each one is written by one task: the reader's by
+ * the reader, the decoder's by the decoder, and the rest by the player -
+ * except 'sfxRejected', which 'callBack' counts on the SwitchBoard task,
+ * so it is kept apart (and atomic).
+ *
+ * So resetPipelineStats (on whatever task asks) doesn't zero them itself:
+ * it counts the reset in 'statsResets' and notifies the player. Each task
+ * zeroes its own counters when it sees a reset it hasn't done yet - the
+ * player does the reader's and decoder's too, when they aren't running.
+ * (getPipelineStats is just a copy - very rarely, it may catch one of the
+ * 64 bit totals half way through being added to.)
+ */
+static AudioPipelineStats pipeStats;
+static std::atomic<uint32_t> sfxRejected(0);
+static std::atomic<uint32_t> statsResets(0);
+static uint32_t readerResets = 0;   // The resets each has done
+static uint32_t decoderResets = 0;
+static uint32_t playerResets = 0;
+
+
+// Is there a reset that hasn't been done? (Then it is done now.)
+static bool resetDue(uint32_t *done)
+{
+	uint32_t asked = statsResets.load ();
+	if (*done == asked) return (false);
+	*done = asked;
+	return (true);
+}
+
+
+static void resetReaderStats()
+{
+	if (!resetDue (&readerResets )) return;
+	pipeStats.readerStalls = 0;
+	pipeStats.readCalls = 0;
+	pipeStats.bytesRead = 0;
+}
+
+
+static void resetDecoderStats()
+{
+	if (!resetDue (&decoderResets )) return;
+	pipeStats.decoderUnderruns = 0;
+	pipeStats.decoderStalls = 0;
+	pipeStats.framesDecoded = 0;
+	pipeStats.decodeUsec = 0;
+}
+
+// There is only one player - this is it (for getPipelineStats)
+static SndPlayer *thePlayer = nullptr;
+
 SndPlayer::SndPlayer (const char *_name) :
 		DeviceDef (_name )
 {
 	runState = PLAYER_IDLE;
+	requestedState = PLAYER_IDLE;
+	lastPressUsec = 0;
 	myTask = nullptr;
-	eye_scale=1;
-	jaw_scale=1;
+	envTrack = new EnvelopeTrack();
+	eyeEnv.configure (ENV_MODE, EYE_ATTACK_MSEC, EYE_RELEASE_MSEC, EYE_AVG_SIZE );
+	jawEnv.configure (ENV_MODE, JAW_ATTACK_MSEC, JAW_RELEASE_MSEC, JAW_AVG_SIZE );
+	prescanOk = false;
+
+	// The rings are big - they live on the heap.
+	readWindow = new StreamWindow<AUDIO_READ_WINDOW_SIZE, AUDIO_WINDOW_GUARD>();
+	pcmRing = new SpscRing<PcmFrame, AUDIO_PCM_RING_SIZE>();
+	output = nullptr;
+	resampler = new Resampler();
+	mixer = new Mixer();
+	sfxBank = new SfxBank();
+	sfxRing = new SpscRing<SfxTrigger, SFX_TRIGGER_QUEUE>();
+	sfxStartCount = 0;
+	readerTask = nullptr;
+	decoderTask = nullptr;
+	stagesRunning = false;
+	fp = nullptr;
+	readerClip = -1;
+	nextFp = nullptr;
+	nextClip = -1;
+	handoff.store (HANDOFF_NONE );
+	currentClip = -1;
+	dropQueued = false;
+	seekWantClip = -1;
+	seekWantMsec = 0;
+	for (int cue = 0; cue < CUE_MAX; cue++ )
+	{
+		cues[cue].clip = -1;
+		cues[cue].msec = 0;
+	}
+	indexPath = nullptr;
+	indexOk = false;
+	seekSkipFrames = 0;
+	seekFromSample = 0;
+	seekToSample = 0;
+	clipStartSample = 0;
+	stopStages = false;
+	stageDone = xSemaphoreCreateCountingStatic (2, 0, &stageDoneBuffer );
+	thePlayer = this;
 }
 
 SndPlayer::~SndPlayer ()
 {
-
+	delete readWindow;
+	delete envTrack;
+	delete pcmRing;
+	delete resampler;
+	delete mixer;
+	delete sfxBank;
+	delete sfxRing;
+	if (thePlayer == this) thePlayer = nullptr;
 }
 
 /**
  * This checks for a button push, or for
- * a command thru the 'device' callback
+ * a command thru the 'device' callback.
+ *
+ * Both of them notify our task, so there is no polling: we can check
+ * without waiting (while playing), or sleep until something happens
+ * (idle or paused).
+ * @param wait - how long to wait for something (0 - don't wait at all)
  */
-void SndPlayer::checkForCommand ()
+void SndPlayer::checkForCommand (TickType_t wait)
 {
-	uint32_t status;
-	static bool lastState = false;
-	bool curState;
+	uint32_t bits;
 
-	if (pdPASS == xTaskNotifyWait (0, 0, &status, 1 ))
+	if (pdPASS != xTaskNotifyWait (0, UINT32_MAX, &bits, wait ))
 	{
-		// Turn 'status' into run state.
-		runState = (Player_State) status;
-		ESP_LOGD(TAG, " See remote command %d", runState);
 		return;
 	}
 
-	/*  Check button press. Remeber we configured
-	 *  negative logic - 0 is button pressed.
-	 *
-	 *  This routine debounces the button so we
-	 *  only respond to (1) A press (ignore releases)
-	 *  and (2) Not too close together
+	if (bits & PLAYER_NOTIFY_COMMAND)
+	{
+		// Turn the request into run state.
+		runState = requestedState;
+		ESP_LOGD(TAG, " See remote command %d", runState);
+	}
+
+	if (bits & PLAYER_NOTIFY_STATS)
+	{
+		resetPlayerStats ();
+		if (!stagesRunning)
+		{	// (nobody else is counting)
+			resetReaderStats ();
+			resetDecoderStats ();
+		}
+	}
+
+	/*  Check button press. The interrupt only sees presses
+	 *  (negative logic - 0 is button pressed), and ignores
+	 *  any too close together.
 	 */
-	curState = !gpio_get_level (GPIO_NUM_0 );
-//	ESP_LOGD(TAG, "Switch state is %d, last state %d.", curState, lastState );
-	if ((curState == true) && (lastState == false))
-	{ // Only on transition from off to on...
+	if (bits & PLAYER_NOTIFY_BUTTON)
+	{
 		ESP_LOGD(TAG, "See button press!");
 		switch (runState)
 		{
@@ -104,12 +236,29 @@ void SndPlayer::checkForCommand ()
 			default:
 				runState = PLAYER_REWIND; // Unknown command!
 		}
-
-	}   // end of 'if state changed'
-	lastState = curState;
+	}
 	return;
 }
 
+
+/**
+ * The button interrupt - debounce it, and tell the player.
+ */
+void IRAM_ATTR SndPlayer::buttonIsr (void *_me)
+{
+	SndPlayer *me = (SndPlayer*) _me;
+	BaseType_t woken = pdFALSE;
+
+	int64_t now = esp_timer_get_time ();
+	if ((now - me->lastPressUsec) < (BUTTON_DEBOUNCE_MSEC * 1000LL)) return;
+	me->lastPressUsec = now;
+
+	if (me->myTask == nullptr) return;
+	xTaskNotifyFromISR (me->myTask, PLAYER_NOTIFY_BUTTON, eSetBits, &woken );
+	if (woken) portYIELD_FROM_ISR();
+}
+
+
 /**
  * Decode - and cause to implement - any external
  * messages.
@@ -121,117 +270,252 @@ void SndPlayer::callBack (const Message *msg)
 		case (SND_EVENT_PLAYER_START):
 			if ((runState == PLAYER_IDLE) || (runState == PLAYER_PAUSED))
 			{
-				xTaskNotify (myTask, PLAYER_RUNNING, eSetValueWithOverwrite );
+				requestState (PLAYER_RUNNING );
 			}
 			break;
 
 		case (SND_EVENT_PLAYER_PAUSE):
 			if (runState == PLAYER_RUNNING)
 			{
-				xTaskNotify (myTask, PLAYER_PAUSED, eSetValueWithOverwrite );
+				requestState (PLAYER_PAUSED );
+			}
+			break;
+
+		case (SND_EVENT_PLAYER_PRESCAN):
+			if (runState == PLAYER_IDLE)
+			{
+				requestState (PLAYER_PRESCAN );
 			}
 			break;
 
 		case (SND_EVENT_PLAYER_REWIND): // rewind is also stop!
 			if ((runState == PLAYER_RUNNING) || (runState == PLAYER_PAUSED))
 			{
-				xTaskNotify (myTask, PLAYER_REWIND, eSetValueWithOverwrite );
+				requestState (PLAYER_REWIND );
+			}
+			break;
+
+		case (SND_EVENT_PLAYER_PLAY): // Play this clip now
+			if (AssetIndex::get (msg->value ) == nullptr)
+			{
+				ESP_LOGW(TAG, "No clip %ld", msg->value );
+				break;
+			}
+			playlist.clear ();
+			dropQueued = true;
+			playlist.enqueue (msg->value );
+			if ((runState == PLAYER_RUNNING) || (runState == PLAYER_PAUSED))
+			{
+				requestState (PLAYER_SKIP );
+			}
+			else if (runState == PLAYER_IDLE)
+			{
+				requestState (PLAYER_RUNNING );
+			}
+			break;
+
+		case (SND_EVENT_PLAYER_NEXT):
+			if ((runState == PLAYER_RUNNING) || (runState == PLAYER_PAUSED))
+			{
+				requestState (PLAYER_SKIP );
+			}
+			break;
+
+		case (SND_EVENT_PLAYER_ENQUEUE): // Play this clip after the others
+			if (AssetIndex::get (msg->value ) == nullptr)
+			{
+				ESP_LOGW(TAG, "No clip %ld", msg->value );
+			}
+			else if (!playlist.enqueue (msg->value ))
+			{
+				ESP_LOGW(TAG, "Playlist full - clip %ld not added", msg->value );
+			}
+			break;
+
+		case (SND_EVENT_PLAYER_SEEK):
+			requestSeek ((msg->rate < 0) ? currentClip : msg->rate, msg->value );
+			break;
+
+		case (SND_EVENT_PLAYER_CUE):
+			if ((msg->value < 0) || (msg->value >= CUE_MAX) || (cues[msg->value].clip < 0))
+			{
+				ESP_LOGW(TAG, "No cue point %ld", msg->value );
+				break;
+			}
+			requestSeek (cues[msg->value].clip, cues[msg->value].msec );
+			break;
+
+		case (SND_EVENT_PLAYER_SETCUE):
+			if ((msg->value < 0) || (msg->value >= CUE_MAX))
+			{
+				ESP_LOGW(TAG, "No cue point %ld", msg->value );
+			}
+			else if (!getPosition (&cues[msg->value].clip, &cues[msg->value].msec ))
+			{
+				ESP_LOGW(TAG, "Not playing - cue point %ld not set", msg->value );
+				cues[msg->value].clip = -1;
+			}
+			break;
+
+		case (SND_EVENT_PLAYER_SFX): // Play this clip over the music
+		{
+			SfxTrigger *trigger = sfxRing->claim ();
+			if (AssetIndex::get (msg->value ) == nullptr)
+			{
+				ESP_LOGW(TAG, "No clip %ld", msg->value );
+				sfxRejected++;
+			}
+			else if (runState != PLAYER_RUNNING)
+			{
+				ESP_LOGW(TAG, "Not playing - effect %ld not started", msg->value );
+				sfxRejected++;
+			}
+			else if (trigger == nullptr)
+			{
+				ESP_LOGW(TAG, "Too many effects waiting - effect %ld not started", msg->value );
+				sfxRejected++;
+			}
+			else
+			{
+				trigger->clip = msg->value;
+				trigger->gain = (int32_t) (msg->rate * MIXER_UNITY_GAIN / 100);
+				trigger->loaded = false;
+#ifdef SWITCHBOARD_STATS
+				trigger->sentAt = msg->sentAt;  // (so it includes the delivery)
+#else
+				trigger->sentAt = (uint32_t) esp_timer_get_time ();
+#endif
+				sfxRing->publish ();
 			}
 			break;
+		}
 	}  // END OF CASE
 	return;
 }
 
 /**
- * This is where we actually play the music.
- * It is also responsible for sending control
- * info to the eyes and jaw.
- * If the 'prescan' mode is true, then we only read
- * the file without doing any actual output or control, collecting
- * min/max (scaling) info as we go.
+ * Play 'clip' from 'msec' - now if we are playing, or start playing.
+ * @param clip - -1 for the clip we are playing (or the usual one)
+ */
+void SndPlayer::requestSeek (int clip, uint32_t msec)
+{
+	if (clip < 0) clip = defaultClip ();
+	if (AssetIndex::get (clip ) == nullptr)
+	{
+		ESP_LOGW(TAG, "No clip %d", clip );
+		return;
+	}
+	seekWantMsec = msec;
+	seekWantClip = clip;
+	if ((runState == PLAYER_RUNNING) || (runState == PLAYER_PAUSED))
+	{
+		requestState (PLAYER_SEEK );
+	}
+	else if (runState == PLAYER_IDLE)
+	{
+		requestState (PLAYER_RUNNING );
+	}
+}
+
+/**
+ * Ask the player task to change state (from another task).
+ */
+void SndPlayer::requestState (Player_State state)
+{
+	requestedState = state;
+	xTaskNotify (myTask, PLAYER_NOTIFY_COMMAND, eSetBits );
+}
+
+/**
+ * This is where we actually play the music - the OUTPUT stage of the pipeline.
+ *
+ * The file is read by 'readerStage' and decoded by 'decoderStage' (each on
+ * its own task - the decoder on ASSIGN_MUSIC_CORE). They are connected to
+ * each other, and to us, by single-producer/single-consumer rings - so the
+ * flash reads and the decoding overlap with the DMA output. Here we just
+ * take decoded frames, send control info to the eyes and jaw, and write
+ * the samples to the output (which blocks until the DMA has room). Mono
+ * frames are written as they are - never widened to stereo here.
  *
- * This is static - a pointer to the current instance
- * is passed in as the argument
- * @param output_ptr - points to the audio output device. Ignored if prescan is true.
- * @param prescan    - if True, then we only scan the file for max/min average, and
- *                     exit immediatly, without doing any eye or jaw movement or audio
- *                     output (output_ptr is ignored, should be nullptr in this case).
+ * We also handle the player state (start, pause, rewind...). The reader and
+ * decoder are started when we begin the playlist, and stopped at the end of
+ * it (or when we are told to stop or skip). Between clips they keep going -
+ * the next clip is opened and decoded while the last frames of this one are
+ * still playing, so there is no gap. The output stays at one rate (the first
+ * clip's, or AUDIO_OUTPUT_RATE) - clips at other rates go through the
+ * resampler - so it is only restarted if the number of channels changes.
  *
+ * Sound effects ('sfx' - see SND_EVENT_PLAYER_SFX) are mixed over the music
+ * here too, just before it is written (see 'writeOutput').
+ *
+ * @param output_ptr - points to the audio output device.
  */
 
 void SndPlayer::playMusic (void *output_ptr)
 {
-	Output *output = (Output*) output_ptr;
+	output = (Output*) output_ptr;
 	int eye_avg = 0;
-	int eye_avg_cnt = 0;
 	int jaw_avg = 0;
-	int jaw_avg_cnt = 0;
+	uint16_t levels[MINIMP3_MAX_SAMPLES_PER_FRAME / EYE_AVG_SIZE + 1];
+	int levelCnt;
 	bool is_output_started = false;
 	long int totalSamples=0;
-
-#if defined(ENABLE_JAW) || defined (ENABLE_EYES)
 	Message *msg;
-#endif
-
-	// setup for the mp3 decoded
-	short *pcm = (short*) malloc (
-			sizeof(short) * MINIMP3_MAX_SAMPLES_PER_FRAME );
-	uint8_t *input_buf = (uint8_t*) malloc (BUFFER_SIZE );
-	if (!pcm)
-	{
-		ESP_LOGE("main", "Failed to allocate pcm memory" );
-	}
-
-	if (!input_buf)
-	{
-		ESP_LOGE("main", "Failed to allocate input_buf memory" );
-	}
-
-
 
 	while (1) // WAITING TO START READING THE FILE
 	{
 		is_output_started = false;
-		checkForCommand ();
+		// Nothing to do until we are told - so sleep until then.
+		checkForCommand ((runState == PLAYER_IDLE) ? portMAX_DELAY : 0 );
 
 		if (runState == PLAYER_IDLE)
 		{
-			vTaskDelay (100 / portTICK_PERIOD_MS );
 			continue;
 		}
 
-		// mp3 decoder state
-		mp3dec_t mp3d = { };
-		mp3dec_init (&mp3d );
-		mp3dec_frame_info_t info = { };
-
-		// keep track of how much data we have buffered, need to read and decoded
-		int to_read = BUFFER_SIZE;
-		int buffered = 0;
-		int decoded = 0;
-		is_output_started = false;
+		if (runState == PLAYER_PRESCAN)
+		{
+			prescan ();
+			runState = PLAYER_IDLE;
+			continue;
+		}
 
-		// this assumes that you have uploaded the mp3 file to the SPIFFS
-		errno = 0;
-		FILE *fp = fopen (SOURCE_FILE_NAME, "r" );
-		if (!fp)
+		if (!startPipeline ())
 		{
-			ESP_LOGE("main", "Failed to open file. Error %d (%s)", errno,
-					strerror(errno) );
 			runState = PLAYER_IDLE;
 			continue;
 		}
 		totalSamples=0;
+		eyeEnv.reset ();
+		jawEnv.reset ();
+		resampler->reset ();
+		// (no effects left over from last time)
+		mixer->reset ();
+		while (sfxRing->peek () != nullptr) sfxRing->release ();
+
+		int blockPos = 0;
+		uint32_t blockNo = 0;
+		int outputHz = 0;
+		int outputChannels = 0;
+		currentClip = -1;
+		// Where the first frame is in its clip (if we were told to seek)
+		uint32_t clockFrom = seekToSample;
 
 		while (1) // PLAY THIS FILE
 		{
-			checkForCommand ();
+			resetPlayerStats ();
+			// Don't wait while playing - but sleep while paused.
+			checkForCommand ((runState == PLAYER_PAUSED) ? portMAX_DELAY : 0 );
 			if (runState == PLAYER_PAUSED)
 			{
-				vTaskDelay (100 / portTICK_PERIOD_MS );
 				continue;
 			}
 
+			if ((runState == PLAYER_REWIND) || (runState == PLAYER_SKIP) || (runState == PLAYER_SEEK))
+			{	// We've been told to stop
+				break;
+			}
+
 #ifdef VOLUME_CONTROL
   auto adc_value = float(adc1_get_raw(VOLUME_CONTROL)) / 4096.0f;
   // make the actual volume match how people hear
@@ -239,118 +523,201 @@ void SndPlayer::playMusic (void *output_ptr)
   output->set_volume(adc_value * adc_value);
 #endif
 
-			// read in the data that is needed to top up the buffer
-			size_t n = fread (input_buf + buffered, 1, to_read, fp );
-
-			// feed the watchdog
-			vTaskDelay (pdMS_TO_TICKS(1 ) );
-
-			//ESP_LOGI("main", "Read %d bytes\n", n );
-			buffered += n;
-
-			if ((runState == PLAYER_REWIND) || (buffered == 0))
+			// get the next decoded frame
+			PcmFrame *frame = pcmRing->peek ();
+			if (frame == nullptr)
 			{
-				// Either we've been told to stop, or have reached the end of the file
-				// AND processed all the buffered data.
-				output->stop ();
-				is_output_started = false;
-				fclose (fp );
-				runState = PLAYER_IDLE;
-				break;
+				// The decoder hasn't kept up. (Before we start, this is just filling up.)
+				// Wait for it to tell us (or for a command).
+				if (is_output_started) pipeStats.outputUnderruns++;
+				checkForCommand (portMAX_DELAY );
+				continue;
 			}
 
-			// decode the next frame
-			int samples = mp3dec_decode_frame (&mp3d, input_buf, buffered, pcm,
-					&info );
+			if (frame->samples == 0)
+			{	// End of the playlist
+				pcmRing->release ();
+				break;
+			}
 
-			// we've processed this may bytes from the buffered data
-			buffered -= info.frame_bytes;
+			int samples = frame->samples;
+			int16_t *pcm = frame->pcm;
 
-			// shift the remaining data to the front of the buffer
-			memmove (input_buf, input_buf + info.frame_bytes, buffered );
+			if (frame->clip != currentClip)
+			{	// The first frame of the next clip
+				currentClip = frame->clip;
+				const Asset *asset = AssetIndex::get (currentClip );
+				ESP_LOGI(TAG, "Playing clip %d (%s)", currentClip, (asset == nullptr) ? "?" : asset->name );
 
-			// we need to top up the buffer from the file
-			to_read = info.frame_bytes;
-			if (samples > 0)
-			{
-				// if we haven't started the output yet we can do it now as we now know the sample rate and number of channels
-				if ( !is_output_started )
+				// Use the precomputed levels if we have them.
+				blockPos = 0;
+				blockNo = 0;
+				if ((asset != nullptr) && envTrack->open (asset->path ))
 				{
-					output->start (info.hz );
-					is_output_started = true;
+					ESP_LOGI(TAG, "Using the envelope track (%u blocks)", envTrack->info().blockCount );
+					if (clockFrom > 0)
+					{	// We started part way through
+						envTrack->seek (clockFrom / EYE_AVG_SIZE );
+						blockPos = clockFrom % EYE_AVG_SIZE;
+						blockNo = clockFrom / EYE_AVG_SIZE;
+					}
 				}
 
-				// if we've decoded a frame of mono samples convert it to stereo by duplicating the left channel
-				// we can do this in place as our samples buffer has enough space
-				// AUDIO
-				if (info.channels == 1)
+				// Only restart the output if it has to change
+				if (is_output_started && (frame->channels != outputChannels))
 				{
-					for (int i = samples - 1; i >= 0; i-- )
-					{
-						pcm[i * 2] = pcm[i];
-						pcm[i * 2 - 1] = pcm[i];
-					}
+					output->stop ();
+					is_output_started = false;
 				}
+				eyeEnv.setSampleRate (frame->hz );
+				jawEnv.setSampleRate (frame->hz );
 
-				// TODO: EVERY n SAMPLES, notify the action_sequencer to check for nod or rot
-				//     actions.
-				if (0==(totalSamples % NOTIFYINTERVAL))
+				// Where this clip starts on the playback clock (a new clock starts
+				// at the clip's own position)
+				clipStartSample = 0;
+				if (is_output_started)
 				{
-					// TODO: SEND NOTIFY MESSAGES TO MOTIONSEQUENCER
+					PlaybackPosition pos;
+					PlaybackClock::read (&pos );
+					clipStartSample = pos.samplesWritten;
 				}
-				// This is where we do the averaging
-				for (int i = 0; i < (samples * 2); i += 2 )
-				{
-					eye_avg += abs (pcm[i] );
-					eye_avg_cnt++;
-
-					// EYE MOTION
-					if (eye_avg_cnt >= EYE_AVG_SIZE)
-					{
-						eye_avg /= EYE_AVG_SIZE;
-#ifdef ENABLE_EYES
-						eye_avg = map(eye_avg, 0, 3200, 0, 1000);
-						msg = Message::create_message (TASK_NAME::EYES,
-									TASK_NAME::IDLER, EVENT_ACTION_SETVALUE,
-									eye_avg * 10, eye_avg * 10, nullptr );
-							SwitchBoard::send (msg );
-#endif
-						eye_avg = 0;
-						eye_avg_cnt = 0;
-					}
+			}
 
+			// if we haven't started the output yet we can do it now as we now know the sample rate and number of channels
+			if ( !is_output_started )
+			{
+				outputHz = (AUDIO_OUTPUT_RATE > 0) ? AUDIO_OUTPUT_RATE : frame->hz;
+				outputChannels = frame->channels;
+				output->start (outputHz, outputChannels );
+				is_output_started = true;
+				pipeStats.outputHz = outputHz;
+				// (the clock counts output samples)
+				PlaybackClock::start (outputHz, output->get_latency_usec (),
+						(uint32_t) ((uint64_t) clockFrom * outputHz / frame->hz) );
+				clockFrom = 0;
+			}
 
-					// JAW MOTION
-					jaw_avg += abs (pcm[i] );
-					jaw_avg_cnt++;
+			// A different rate from the output? (Between clips at the same rate,
+			// the resampler just carries on - so no click.)
+			if (!resampler->matches (frame->hz, outputHz, frame->channels ))
+			{
+				resampler->configure (frame->hz, outputHz, frame->channels, AUDIO_RESAMPLE_QUALITY );
+				pipeStats.resampleFromHz = resampler->active () ? frame->hz : 0;
+			}
 
-					if (jaw_avg_cnt >= JAW_AVG_SIZE)
+			if (envTrack->isOpen ())
+			{	// Take the levels from the track - one block at a time.
+				blockPos += samples;
+				while (blockPos >= EYE_AVG_SIZE)
+				{
+					EnvBlock block;
+					blockPos -= EYE_AVG_SIZE;
+					if (!envTrack->next (&block ))
 					{
-						jaw_avg /= jaw_avg_cnt;
+						envTrack->close ();
+						break;
+					}
+					const EnvTrackHeader &hdr = envTrack->info ();
+#ifdef ENABLE_EYES
+					eye_avg = map(block.eye, 0, hdr.eyePeak, 0, 1000);
+					msg = Message::create_message (TASK_NAME::EYES,
+								TASK_NAME::IDLER, EVENT_ACTION_SETVALUE,
+								eye_avg * 10, eye_avg * 10, nullptr );
+					SwitchBoard::send (msg );
+#endif
 #ifdef ENABLE_JAW
-						jaw_avg = map(jaw_avg, 0, 3200, 0, 1000);
+					if ((++blockNo % hdr.jawBlocks) == 0)
+					{
+						jaw_avg = map(block.jaw, 0, hdr.jawPeak, 0, 1000);
 						msg = Message::create_message (TASK_NAME::JAW,
 									TASK_NAME::IDLER, EVENT_ACTION_SETVALUE,
 									jaw_avg, 0, nullptr );
 						SwitchBoard::send (msg );
-
-#endif
-						jaw_avg = 0;
-						jaw_avg_cnt = 0;
 					}
+#endif
+				}
+			}
+			else
+			{	// No track - follow the levels as we go (left channel)
+#ifdef ENABLE_EYES
+				levelCnt = eyeEnv.process (pcm, samples, frame->channels, levels,
+						sizeof(levels) / sizeof(levels[0]) );
+				for (int i = 0; i < levelCnt; i++ )
+				{
+					eye_avg = map(levels[i], 0, ENV_FULL_SCALE, 0, 1000);
+					msg = Message::create_message (TASK_NAME::EYES,
+								TASK_NAME::IDLER, EVENT_ACTION_SETVALUE,
+								eye_avg * 10, eye_avg * 10, nullptr );
+					SwitchBoard::send (msg );
+				}
+#endif
+#ifdef ENABLE_JAW
+				levelCnt = jawEnv.process (pcm, samples, frame->channels, levels,
+						sizeof(levels) / sizeof(levels[0]) );
+				for (int i = 0; i < levelCnt; i++ )
+				{
+					jaw_avg = map(levels[i], 0, ENV_FULL_SCALE, 0, 1000);
+					msg = Message::create_message (TASK_NAME::JAW,
+								TASK_NAME::IDLER, EVENT_ACTION_SETVALUE,
+								jaw_avg, 0, nullptr );
+					SwitchBoard::send (msg );
+				}
+#endif
+			}
 
+			// write the decoded samples to the I2S output (mono goes as it is -
+			// the output sends it to both sides)
+			if (resampler->active ())
+			{	// At the output rate - a block at a time
+				const int16_t *block;
+				int frames;
+				TIME_t start = esp_timer_get_time ();
+				resampler->push (pcm, samples );
+				while ((frames = resampler->pull (&block )) > 0)
+				{
+					pipeStats.resampleUsec += esp_timer_get_time () - start;
+					pipeStats.framesResampled += frames;
+					startEffects (outputHz );
+					writeOutput (block, frames, frame->channels );
+					start = esp_timer_get_time ();
+				}
+			}
+			else
+			{	// (in short blocks - so an effect can start part way through)
+				for (int done = 0; done < samples; done += MIXER_BLOCK )
+				{
+					int frames = (samples - done < MIXER_BLOCK) ? samples - done : MIXER_BLOCK;
+					startEffects (outputHz );
+					writeOutput (&pcm[done * frame->channels], frames, frame->channels );
 				}
+			}
 
-				// write the decoded samples to the I2S output
-				output->write (pcm, samples );
+			// Done with the frame - let the decoder have it back.
+			pcmRing->release ();
+			xTaskNotifyGive (decoderTask );
 
-				// keep track of how many samples we've decoded
-				decoded += samples;
-			}
-			// ESP_LOGI("main", "decoded %d samples\n", decoded);
+			// keep track of how many samples we've played
+			totalSamples += samples;
 
 		} // END of while PLAY THIS FILE
 
+		stopPipeline ();
+		envTrack->close ();
+		PlaybackClock::stop ();
+		if (is_output_started)
+		{
+			output->stop ();
+		}
+		currentClip = -1;
+
+		ESP_LOGI("main", "Finished playing (%ld samples)\n", totalSamples );
+		if (((runState == PLAYER_SKIP) && (playlist.size () > 0)) || (runState == PLAYER_SEEK))
+		{	// Straight on to the next clip (or the same one, somewhere else)
+			runState = PLAYER_RUNNING;
+			continue;
+		}
+		runState = PLAYER_IDLE;
+
 		msg = Message::create_message (TASK_NAME::EYES,
 											TASK_NAME::IDLER, EVENT_ACTION_SETVALUE,
 											0, 0, nullptr );
@@ -359,15 +726,866 @@ void SndPlayer::playMusic (void *output_ptr)
 											TASK_NAME::IDLER, EVENT_ACTION_SETVALUE,
 											0, 0, nullptr );
 		SwitchBoard::send(msg);
-
-		ESP_LOGI("main", "Finished playing file\n" );
-		fclose (fp );
 	}  // END of WAITING TO START READING THE FILE
 	ESP_LOGD(TAG, "*******************************OOPS - should not return!***************");
 
 	return;
 }
 
+
+/**
+ * Start the sound effects that have been asked for (see SND_EVENT_PLAYER_SFX)
+ * - on the next block we write.
+ *
+ * An effect that isn't loaded yet is loaded first (see SfxBank.h). It waits
+ * at the front of the queue until then - and so do any after it, so they
+ * still start in the order they were asked for.
+ */
+void SndPlayer::startEffects (int outputHz)
+{
+	SfxTrigger *trigger;
+	while ((trigger = sfxRing->peek ()) != nullptr)
+	{
+		SfxSound *sound = sfxBank->find (trigger->clip, outputHz );
+		if (sound == nullptr)
+		{	// Load it, if nothing else is loading
+			if (sfxBank->loading ()) return;
+			if (sfxBank->load (trigger->clip, outputHz, mixer ))
+			{
+				trigger->loaded = true;
+				return;
+			}
+			pipeStats.sfxDropped++;
+			sfxRing->release ();
+			continue;
+		}
+
+		int state = sound->state.load (std::memory_order_acquire );
+		if (state == SFX_LOADING) return;
+		if (state == SFX_READY)
+		{
+			mixer->start (sound->pcm, sound->frames, trigger->gain );
+			sfxBank->touch (sound );
+			pipeStats.sfxStarted++;
+			if (trigger->loaded)
+			{
+				pipeStats.sfxLoaded++;
+				pipeStats.sfxLoadUsec = sfxBank->lastLoadUsec ();
+			}
+			else if (sfxStartCount < MIXER_VOICES)
+			{
+				sfxSentAt[sfxStartCount++] = trigger->sentAt;
+			}
+		}
+		else
+		{	// (it can be tried again next time)
+			pipeStats.sfxDropped++;
+			sfxBank->forget (sound );
+		}
+		sfxRing->release ();
+	}
+}
+
+
+/**
+ * Mix in the sound effects (if any are playing), write a block to the
+ * output, and move the playback clock on.
+ *
+ * The latency of an effect is from when it was asked for, to when the
+ * first sample of this block is heard (the clock works that out - from
+ * what is queued in the DMA buffers).
+ */
+void SndPlayer::writeOutput (const int16_t *pcm, int frames, int channels)
+{
+	if (mixer->active () > 0)
+	{
+		TIME_t start = esp_timer_get_time ();
+		pcm = mixer->mix (pcm, frames, channels );
+		pipeStats.mixUsec += esp_timer_get_time () - start;
+		pipeStats.framesMixed += frames;
+	}
+	pipeStats.sfxVoices = mixer->active ();
+
+	uint32_t blockStart = 0;
+	if (sfxStartCount > 0)
+	{
+		PlaybackPosition pos;
+		PlaybackClock::read (&pos );
+		blockStart = pos.samplesWritten;
+	}
+
+	output->write (pcm, frames, channels );
+	// (this also tells the motion sequencer where we are)
+	PlaybackClock::advance (frames );
+
+	if (sfxStartCount > 0)
+	{
+		uint32_t heard = (uint32_t) PlaybackClock::whenHeard (blockStart );
+		for (int idx = 0; idx < sfxStartCount; idx++ )
+		{
+			uint32_t latency = heard - sfxSentAt[idx];
+			pipeStats.sfxLatencyUsec = latency;
+			pipeStats.sfxLatencyTotalUsec += latency;
+			if (latency > pipeStats.sfxLatencyMaxUsec) pipeStats.sfxLatencyMaxUsec = latency;
+		}
+		ESP_LOGD(TAG, "Effect latency %u usec", pipeStats.sfxLatencyUsec );
+		sfxStartCount = 0;
+	}
+}
+
+
+/**
+ * Take the next clip from the playlist, and open it. (Clips that can't be
+ * opened are skipped.)
+ * @param file - set to the open file, or nullptr if there are no more clips.
+ * @param clip - set to its clip ID.
+ * @param format - set to what kind of sound file it is.
+ * @return false if there are no more clips.
+ */
+bool SndPlayer::openClip (FILE **file, int *clip, AudioFormat *format)
+{
+	int id;
+	*file = nullptr;
+	while (playlist.dequeue (&id ))
+	{
+		if (openAsset (id, file, format ))
+		{
+			*clip = id;
+			return (true);
+		}
+	}
+	return (false);
+}
+
+
+/**
+ * Open a clip, and find out what kind of sound file it is (the file is
+ * left at the start of the sound).
+ */
+bool SndPlayer::openAsset (int id, FILE **file, AudioFormat *format)
+{
+	const Asset *asset = AssetIndex::get (id );
+	*file = nullptr;
+	if (asset == nullptr) return (false);
+
+	errno = 0;
+	*file = fopen (asset->path, "r" );
+	if (*file == nullptr)
+	{
+		ESP_LOGE(TAG, "Failed to open %s. Error %d (%s)", asset->path, errno,
+				strerror(errno) );
+		return (false);
+	}
+	if (!Decoder::probe (*file, format ))
+	{
+		ESP_LOGE(TAG, "Can't play %s", asset->path );
+		fclose (*file );
+		*file = nullptr;
+		return (false);
+	}
+	return (true);
+}
+
+
+/**
+ * The clip RUN plays if the playlist is empty.
+ */
+int SndPlayer::defaultClip ()
+{
+	int id = AssetIndex::find (SOURCE_FILE_NAME );
+	return ((id < 0) ? 0 : id);
+}
+
+
+/**
+ * Get ready to play 'clip' from 'msec' - move its file ('fp') to the
+ * nearest seek point before, and tell the decoder how much to throw away.
+ * If it has no seek index, make one now (once). If we can't seek, we just
+ * play it from the start.
+ */
+void SndPlayer::seekTo (int clip, uint32_t msec)
+{
+	const Asset *asset = AssetIndex::get (clip );
+	SeekPoint point;
+	uint32_t target;
+
+	bool found = SeekIndex::lookup (asset->path, msec, &point, &target );
+	if (!found)
+	{
+		ESP_LOGI(TAG, "Making the seek index for %s", asset->name );
+		found = buildSeekIndex (asset->path )
+				&& SeekIndex::lookup (asset->path, msec, &point, &target );
+	}
+	if (!found || (0 != fseek (fp, point.offset, SEEK_SET )))
+	{
+		ESP_LOGW(TAG, "Can't seek in %s - playing from the start", asset->name );
+		fseek (fp, readerFormat.dataStart, SEEK_SET );
+		return;
+	}
+	startOffset = point.offset;
+	seekSkipFrames = point.skipFrames;
+	seekFromSample = point.sample;
+	seekToSample = target;
+	ESP_LOGI(TAG, "Seek to %u msec: byte %u, skip %d frames + %u samples", msec,
+			point.offset, seekSkipFrames, target - point.sample );
+}
+
+
+/**
+ * Open the first clip, and start the reader and decoder stages.
+ * @return false if no clip could be opened, or the tasks not started.
+ */
+bool SndPlayer::startPipeline ()
+{
+	seekSkipFrames = 0;
+	seekFromSample = 0;
+	seekToSample = 0;
+	dropQueued = false;
+
+	int clip = seekWantClip;
+	seekWantClip = -1;
+	if (clip >= 0)
+	{	// Told to play this clip, from part way through
+		if (!openAsset (clip, &fp, &readerFormat ))
+		{
+			return (false);
+		}
+		readerClip = clip;
+		startOffset = readerFormat.dataStart;
+		seekTo (clip, seekWantMsec );
+	}
+	else
+	{
+		// RUN with nothing in the playlist plays the usual file.
+		if (playlist.size () == 0)
+		{
+			playlist.enqueue (defaultClip () );
+		}
+
+		// this assumes that you have uploaded the mp3 files to the SPIFFS
+		if (!openClip (&fp, &readerClip, &readerFormat ))
+		{
+			ESP_LOGE("main", "Failed to open any clip" );
+			return (false);
+		}
+		startOffset = readerFormat.dataStart;
+	}
+
+	// Nobody is using the rings now - so they can be emptied.
+	readWindow->reset ();
+	pcmRing->reset ();
+	nextFp = nullptr;
+	handoff.store (HANDOFF_NONE );
+	stopStages = false;
+
+	// The decoder first - the reader notifies it.
+	if (pdPASS != xTaskCreatePinnedToCore (&decoderStage, "Decoder", AUDIO_DECODER_STACK,
+			this, AUDIO_STAGE_PRIORITY, &decoderTask, ASSIGN_MUSIC_CORE ))
+	{
+		ESP_LOGE(TAG, "Failed to start the decoder task" );
+		fclose (fp );
+		fp = nullptr;
+		return (false);
+	}
+
+	if (pdPASS != xTaskCreate (&readerStage, "Reader", AUDIO_READER_STACK,
+			this, AUDIO_STAGE_PRIORITY, &readerTask ))
+	{
+		ESP_LOGE(TAG, "Failed to start the reader task" );
+		stopStages = true;
+		xTaskNotifyGive (decoderTask );
+		xSemaphoreTake (stageDone, portMAX_DELAY );
+		fclose (fp );
+		fp = nullptr;
+		return (false);
+	}
+	stagesRunning = true;
+	return (true);
+}
+
+
+/**
+ * Stop the reader and decoder (wherever they are), and close the files.
+ * Any clips the reader took from the playlist, but we didn't get to, go
+ * back on it (unless the playlist has been replaced).
+ */
+void SndPlayer::stopPipeline ()
+{
+	stopStages = true;
+	xTaskNotifyGive (readerTask );
+	xTaskNotifyGive (decoderTask );
+	xSemaphoreTake (stageDone, portMAX_DELAY );
+	xSemaphoreTake (stageDone, portMAX_DELAY );
+	stagesRunning = false;
+	if (!dropQueued)
+	{
+		if (nextFp != nullptr) playlist.requeue (nextClip );
+		if ((currentClip >= 0) && (readerClip != currentClip)) playlist.requeue (readerClip );
+	}
+	if (fp != nullptr) fclose (fp );
+	fp = nullptr;
+	if (nextFp != nullptr) fclose (nextFp );
+	nextFp = nullptr;
+}
+
+
+/**
+ * Called by the reader and decoder when they are finished. We wait to be
+ * told to stop (so nobody notifies a task that no longer exists), then quit.
+ */
+void SndPlayer::waitForStop ()
+{
+	while (!stopStages)
+	{
+		ulTaskNotifyTake (pdTRUE, portMAX_DELAY );
+	}
+	xSemaphoreGive (stageDone );
+	vTaskDelete (nullptr );
+}
+
+
+/**
+ * The READER stage - read the clip in big blocks, straight into the
+ * decoder's input window.
+ *
+ * At the end of a clip we open the next one from the playlist straight
+ * away, then wait for the decoder to finish this one (HANDOFF_WANTED).
+ * Neither of us is using the window then, so we empty it, start reading
+ * the next clip, and tell the decoder (HANDOFF_NEXT) - or that there is
+ * nothing more (HANDOFF_END).
+ */
+void SndPlayer::readerStage (void *_me)
+{
+	SndPlayer *me = (SndPlayer*) _me;
+
+	while (!me->stopStages)
+	{
+		resetReaderStats ();
+		if (me->fp == nullptr)
+		{	// Finished the clip - wait for the decoder to finish it too.
+			if (me->handoff.load (std::memory_order_acquire ) != HANDOFF_WANTED)
+			{
+				ulTaskNotifyTake (pdTRUE, portMAX_DELAY );
+				continue;
+			}
+			if (me->nextFp == nullptr)
+			{
+				me->handoff.store (HANDOFF_END, std::memory_order_release );
+				xTaskNotifyGive (me->decoderTask );
+				break;
+			}
+			me->readWindow->reset ();
+			me->fp = me->nextFp;
+			me->readerClip = me->nextClip;
+			me->readerFormat = me->nextFormat;
+			me->nextFp = nullptr;
+			me->handoff.store (HANDOFF_NEXT, std::memory_order_release );
+			xTaskNotifyGive (me->decoderTask );
+			continue;
+		}
+
+		size_t space;
+		uint8_t *dest = me->readWindow->writePtr (&space );
+		if (space < AUDIO_READ_CHUNK_SIZE)
+		{	// Full - wait for the decoder to use some.
+			pipeStats.readerStalls++;
+			ulTaskNotifyTake (pdTRUE, portMAX_DELAY );
+			continue;
+		}
+
+		size_t len = fread (dest, 1, AUDIO_READ_CHUNK_SIZE, me->fp );
+		pipeStats.readCalls++;
+		pipeStats.bytesRead += len;
+		me->readWindow->commitWrite (len );
+		if (len < AUDIO_READ_CHUNK_SIZE)
+		{	// End of the clip - get the next one ready.
+			me->readWindow->setEof ();
+			xTaskNotifyGive (me->decoderTask );
+			fclose (me->fp );
+			me->fp = nullptr;
+			me->openClip (&me->nextFp, &me->nextClip, &me->nextFormat );
+			continue;
+		}
+		xTaskNotifyGive (me->decoderTask );
+	}
+	me->waitForStop ();
+}
+
+
+/**
+ * The DECODER stage - turn the clips into PCM frames. The decoder (MP3,
+ * ADPCM or PCM - see Decoder.h) reads straight from the input window, and
+ * decodes straight into the output ring.
+ * A frame of zero samples marks the end of the playlist.
+ *
+ * After a seek, the first clip starts at a seek point: we throw away its
+ * 'seekSkipFrames' (they only fill the bit reservoir), then whole frames,
+ * then the start of a frame - so the first sample we pass on is the one
+ * at 'seekToSample'.
+ */
+void SndPlayer::decoderStage (void *_me)
+{
+	SndPlayer *me = (SndPlayer*) _me;
+	int clip = me->readerClip;
+	int skipFrames = me->seekSkipFrames;
+	uint32_t position = me->seekFromSample;
+	uint32_t target = me->seekToSample;
+
+	// decoder state
+	Decoders decoders;
+	Decoder *decoder = decoders.start (&me->readerFormat, me->startOffset );
+	DecodeInfo info = { };
+
+	while (!me->stopStages)
+	{
+		resetDecoderStats ();
+		// What do we have from the file? (Check for the end FIRST - see StreamWindow.h)
+		bool eof = me->readWindow->eofSeen ();
+		size_t buffered;
+		const uint8_t *input = me->readWindow->readPtr (&buffered );
+
+		// Wait until there is enough for any frame (unless that's all there is)
+		if (!eof && (buffered < AUDIO_WINDOW_GUARD))
+		{
+			pipeStats.decoderUnderruns++;
+			ulTaskNotifyTake (pdTRUE, portMAX_DELAY );
+			continue;
+		}
+
+		// somewhere to put the samples
+		PcmFrame *frame;
+		while (((frame = me->pcmRing->claim ()) == nullptr) && !me->stopStages)
+		{
+			pipeStats.decoderStalls++;
+			ulTaskNotifyTake (pdTRUE, portMAX_DELAY );
+		}
+		if (frame == nullptr) break;  // Told to stop
+
+		// decode the next frame
+		int samples = 0;
+		info.bytes = 0;
+		if (buffered > 0)
+		{
+			TIME_t start = esp_timer_get_time ();
+			samples = decoder->decode (input, buffered, frame->pcm, &info );
+			pipeStats.decodeUsec += esp_timer_get_time () - start;
+		}
+
+		if (info.bytes == 0)
+		{	// Nothing more can be decoded - and the reader is done. End of the clip.
+			me->handoff.store (HANDOFF_WANTED, std::memory_order_release );
+			xTaskNotifyGive (me->readerTask );
+			int next;
+			while (((next = me->handoff.load (std::memory_order_acquire )) == HANDOFF_WANTED)
+					&& !me->stopStages)
+			{
+				ulTaskNotifyTake (pdTRUE, portMAX_DELAY );
+			}
+			if (next == HANDOFF_NEXT)
+			{	// On to the next clip (the frame we claimed is still ours)
+				me->handoff.store (HANDOFF_NONE, std::memory_order_relaxed );
+				clip = me->readerClip;
+				skipFrames = 0;
+				position = 0;
+				target = 0;
+				decoder = decoders.start (&me->readerFormat, me->readerFormat.dataStart );
+				continue;
+			}
+			if (next == HANDOFF_WANTED) break;  // Told to stop
+
+			// That was the last one
+			frame->samples = 0;
+			me->pcmRing->publish ();
+			xTaskNotify (me->myTask, PLAYER_NOTIFY_FRAME, eSetBits );
+			break;
+		}
+
+		// we've processed this may bytes from the buffered data
+		me->readWindow->consume (info.bytes );
+		xTaskNotifyGive (me->readerTask );
+
+		// Still getting to where we seeked to? (the frame is still ours)
+		if (skipFrames > 0)
+		{
+			skipFrames--;
+			continue;
+		}
+		if ((samples > 0) && (position < target))
+		{
+			if (position + samples <= target)
+			{
+				position += samples;
+				continue;
+			}
+			int drop = target - position;
+			memmove (frame->pcm, &frame->pcm[drop * info.channels],
+					(samples - drop) * info.channels * sizeof(int16_t) );
+			samples -= drop;
+			position = target;
+		}
+
+		if (samples > 0)
+		{
+			frame->clip = clip;
+			frame->samples = samples;
+			frame->channels = info.channels;
+			frame->hz = info.hz;
+			me->pcmRing->publish ();
+			xTaskNotify (me->myTask, PLAYER_NOTIFY_FRAME, eSetBits );
+			pipeStats.framesDecoded++;
+		}
+	}
+
+	me->waitForStop ();
+}
+
+
+/**
+ * PRESCAN - decode every clip once (without playing it), and write
+ * the eye and jaw levels to its envelope track (see EnvelopeTrack.h),
+ * and make its seek index (see SeekIndex.h).
+ *
+ * This runs on its own task (minimp3 needs a big stack), while we wait.
+ * The pipeline must be stopped - we borrow its input window.
+ * @return false if any of them failed.
+ */
+bool SndPlayer::prescan ()
+{
+	prescanOk = false;
+	if (pdPASS != xTaskCreatePinnedToCore (&prescanTask, "Prescan", AUDIO_DECODER_STACK,
+			this, AUDIO_STAGE_PRIORITY, nullptr, ASSIGN_MUSIC_CORE ))
+	{
+		ESP_LOGE(TAG, "Failed to start the prescan task" );
+		return (false);
+	}
+	xSemaphoreTake (stageDone, portMAX_DELAY );
+	return (prescanOk);
+}
+
+
+void SndPlayer::prescanTask (void *_me)
+{
+	SndPlayer *me = (SndPlayer*) _me;
+	bool ok = false;
+
+	int16_t *pcm = (int16_t*) malloc (sizeof(int16_t) * MINIMP3_MAX_SAMPLES_PER_FRAME );
+	if (pcm != nullptr)
+	{
+		ok = true;
+		for (int id = 0; id < AssetIndex::count (); id++ )
+		{
+			ok = prescanFile (me, AssetIndex::get (id )->path, pcm ) && ok;
+			ok = indexFile (me, AssetIndex::get (id )->path ) && ok;
+		}
+		// (no index? - at least do the usual file)
+		if (AssetIndex::count () == 0) ok = prescanFile (me, SOURCE_FILE_NAME, pcm );
+	}
+	me->prescanOk = ok;
+
+	free (pcm );
+	me->readWindow->reset ();
+	xSemaphoreGive (me->stageDone );
+	vTaskDelete (nullptr );
+}
+
+
+bool SndPlayer::prescanFile (SndPlayer *me, const char *path, int16_t *pcm)
+{
+	uint16_t eyeLevels[MINIMP3_MAX_SAMPLES_PER_FRAME / EYE_AVG_SIZE + 1];
+	uint16_t jawLevels[MINIMP3_MAX_SAMPLES_PER_FRAME / EYE_AVG_SIZE + 1];
+	EnvelopeTrack track;
+
+	// The same followers as playing - but the jaw level is kept for every
+	// block too (the player uses every 'jawBlocks'th one).
+	EnvelopeFollower eyeEnv;
+	EnvelopeFollower jawEnv;
+	eyeEnv.configure (ENV_MODE, EYE_ATTACK_MSEC, EYE_RELEASE_MSEC, EYE_AVG_SIZE );
+	jawEnv.configure (ENV_MODE, JAW_ATTACK_MSEC, JAW_RELEASE_MSEC, EYE_AVG_SIZE );
+	bool started = false;
+
+	errno = 0;
+	FILE *in = fopen (path, "r" );
+	if (in == nullptr)
+	{
+		ESP_LOGE(TAG, "Prescan: can't open %s. Error %d (%s)", path, errno,
+				strerror(errno) );
+		return (false);
+	}
+
+	AudioFormat format;
+	if (!Decoder::probe (in, &format ))
+	{
+		ESP_LOGE(TAG, "Can't play %s", path );
+		fclose (in );
+		return (false);
+	}
+	Decoders decoders;
+	Decoder *decoder = decoders.start (&format, format.dataStart );
+	DecodeInfo info = { };
+	me->readWindow->reset ();
+
+	while (1)
+	{
+		// top up the window (we are both the reader and the decoder here)
+		size_t space;
+		uint8_t *dest;
+		while (!me->readWindow->eofSeen ()
+				&& ((dest = me->readWindow->writePtr (&space )), (space >= AUDIO_READ_CHUNK_SIZE)))
+		{
+			size_t len = fread (dest, 1, AUDIO_READ_CHUNK_SIZE, in );
+			me->readWindow->commitWrite (len );
+			if (len < AUDIO_READ_CHUNK_SIZE) me->readWindow->setEof ();
+		}
+
+		size_t buffered;
+		const uint8_t *input = me->readWindow->readPtr (&buffered );
+		if (buffered == 0) break;
+		int samples = decoder->decode (input, buffered, pcm, &info );
+		if (info.bytes == 0) break;
+		me->readWindow->consume (info.bytes );
+		if (samples <= 0) continue;
+
+		if (!started)
+		{
+			if (!track.create (path, info.hz )) break;
+			eyeEnv.setSampleRate (info.hz );
+			jawEnv.setSampleRate (info.hz );
+			started = true;
+		}
+
+		// Same intervals for both - so they give the same number of levels
+		int count = eyeEnv.process (pcm, samples, info.channels, eyeLevels,
+				sizeof(eyeLevels) / sizeof(eyeLevels[0]) );
+		jawEnv.process (pcm, samples, info.channels, jawLevels,
+				sizeof(jawLevels) / sizeof(jawLevels[0]) );
+		for (int i = 0; i < count; i++ )
+		{
+			track.add (eyeLevels[i], jawLevels[i] );
+		}
+		vTaskDelay (1 ); // Let everyone else run
+	}
+	fclose (in );
+	return (started && track.finish ());
+}
+
+
+/**
+ * Make the seek index for one file - on its own task, like the prescan
+ * (minimp3 needs a big stack, even just to find the frames).
+ * The pipeline must be stopped - we borrow its input window.
+ */
+bool SndPlayer::buildSeekIndex (const char *path)
+{
+	indexOk = false;
+	indexPath = path;
+	if (pdPASS != xTaskCreatePinnedToCore (&indexTask, "Indexer", AUDIO_DECODER_STACK,
+			this, AUDIO_STAGE_PRIORITY, nullptr, ASSIGN_MUSIC_CORE ))
+	{
+		ESP_LOGE(TAG, "Failed to start the index task" );
+		return (false);
+	}
+	xSemaphoreTake (stageDone, portMAX_DELAY );
+	return (indexOk);
+}
+
+
+void SndPlayer::indexTask (void *_me)
+{
+	SndPlayer *me = (SndPlayer*) _me;
+	me->indexOk = indexFile (me, me->indexPath );
+	me->readWindow->reset ();
+	xSemaphoreGive (me->stageDone );
+	vTaskDelete (nullptr );
+}
+
+
+/**
+ * Find every frame in a file (from the headers - nothing is decoded), and
+ * write its seek index.
+ */
+bool SndPlayer::indexFile (SndPlayer *me, const char *path)
+{
+	SeekIndex index;
+	bool started = false;
+	int frames = 0;
+
+	errno = 0;
+	FILE *in = fopen (path, "r" );
+	if (in == nullptr)
+	{
+		ESP_LOGE(TAG, "Index: can't open %s. Error %d (%s)", path, errno,
+				strerror(errno) );
+		return (false);
+	}
+
+	AudioFormat format;
+	if (!Decoder::probe (in, &format ))
+	{
+		ESP_LOGE(TAG, "Can't play %s", path );
+		fclose (in );
+		return (false);
+	}
+	Decoders decoders;
+	Decoder *decoder = decoders.start (&format, format.dataStart );
+	uint32_t offset = format.dataStart;
+	DecodeInfo info = { };
+	me->readWindow->reset ();
+
+	while (1)
+	{
+		// top up the window (as the prescan does)
+		size_t space;
+		uint8_t *dest;
+		while (!me->readWindow->eofSeen ()
+				&& ((dest = me->readWindow->writePtr (&space )), (space >= AUDIO_READ_CHUNK_SIZE)))
+		{
+			size_t len = fread (dest, 1, AUDIO_READ_CHUNK_SIZE, in );
+			me->readWindow->commitWrite (len );
+			if (len < AUDIO_READ_CHUNK_SIZE) me->readWindow->setEof ();
+		}
+
+		size_t buffered;
+		const uint8_t *input = me->readWindow->readPtr (&buffered );
+		if (buffered == 0) break;
+		// (no pcm buffer - just find the frame, and how many samples it has)
+		int samples = decoder->decode (input, buffered, nullptr, &info );
+		if (info.bytes == 0) break;
+		me->readWindow->consume (info.bytes );
+
+		if (samples > 0)
+		{
+			if (!started)
+			{
+				if (!index.create (path, info.hz, decoder->hasReservoir () )) break;
+				started = true;
+			}
+			index.add (offset, info.bytes, samples );
+			if ((++frames % 64) == 0) vTaskDelay (1 ); // Let everyone else run
+		}
+		offset += info.bytes;
+	}
+	fclose (in );
+	return (started && index.finish ());
+}
+
+
+/**
+ * Where we are in the clip we are playing (what is being heard now).
+ * @return false if nothing is playing.
+ */
+bool SndPlayer::getPosition (int *clip, uint32_t *msec)
+{
+	if (thePlayer == nullptr) return (false);
+	int playing = thePlayer->currentClip;
+	PlaybackPosition pos;
+	PlaybackClock::read (&pos );
+	if ((playing < 0) || !pos.running || (pos.sampleRate == 0)) return (false);
+
+	// (the last clip may still be finishing)
+	int32_t into = (int32_t) (pos.samplesPlayed - thePlayer->clipStartSample);
+	if (into < 0) into = 0;
+	*clip = playing;
+	*msec = (uint32_t) ((uint64_t) into * 1000 / pos.sampleRate);
+	return (true);
+}
+
+
+/**
+ * @return false if there is no such cue point, or it isn't set.
+ */
+bool SndPlayer::getCue (int cue, CuePoint *point)
+{
+	if ((thePlayer == nullptr) || (cue < 0) || (cue >= CUE_MAX)) return (false);
+	*point = thePlayer->cues[cue];
+	return (point->clip >= 0);
+}
+
+
+/**
+ * The clips waiting in the playlist (first one first).
+ * @return how many were put in 'ids'.
+ */
+int SndPlayer::getPlaylist (int *ids, int maxIds)
+{
+	if (thePlayer == nullptr) return (0);
+	return (thePlayer->playlist.list (ids, maxIds ));
+}
+
+
+// The clip being played (-1 if none)
+int SndPlayer::getCurrentClip ()
+{
+	if (thePlayer == nullptr) return (-1);
+	return (thePlayer->currentClip);
+}
+
+
+/**
+ * Get the pipeline counters (see AudioPipelineStats).
+ */
+void SndPlayer::getPipelineStats (AudioPipelineStats *stats)
+{
+	*stats = pipeStats;
+	stats->sfxRejected = sfxRejected.load ();
+	if (thePlayer != nullptr)
+	{
+		stats->readDepth = thePlayer->readWindow->size ();
+		stats->readHighWater = thePlayer->readWindow->getHighWater ();
+		stats->readCapacity = thePlayer->readWindow->capacity ();
+		stats->pcmDepth = thePlayer->pcmRing->size ();
+		stats->pcmHighWater = thePlayer->pcmRing->getHighWater ();
+		stats->pcmCapacity = thePlayer->pcmRing->capacity ();
+		if (thePlayer->output != nullptr)
+		{
+			stats->outputDirect = thePlayer->output->get_frames_direct ();
+			stats->outputConverted = thePlayer->output->get_frames_converted ();
+			stats->outputLatencyUsec = thePlayer->output->get_latency_usec ();
+			stats->dmaBufCount = thePlayer->output->get_geometry ().buf_count;
+			stats->dmaBufLen = thePlayer->output->get_geometry ().buf_len;
+		}
+	}
+}
+
+
+/**
+ * Zero the pipeline counters - each task does its own (see pipeStats).
+ */
+void SndPlayer::resetPipelineStats ()
+{
+	sfxRejected.store (0 );
+	statsResets++;
+	if (thePlayer != nullptr)
+	{
+		thePlayer->readWindow->resetHighWater ();
+		thePlayer->pcmRing->resetHighWater ();
+		if (thePlayer->myTask != nullptr) xTaskNotify (thePlayer->myTask, PLAYER_NOTIFY_STATS, eSetBits );
+	}
+}
+
+
+/**
+ * Zero the player's counters (and the output's), if there is a reset it
+ * hasn't done. (On the player task.)
+ */
+void SndPlayer::resetPlayerStats ()
+{
+	if (!resetDue (&playerResets )) return;
+	pipeStats.outputUnderruns = 0;
+	pipeStats.framesResampled = 0;
+	pipeStats.resampleUsec = 0;
+	pipeStats.sfxStarted = 0;
+	pipeStats.sfxLoaded = 0;
+	pipeStats.sfxDropped = 0;
+	pipeStats.sfxLoadUsec = 0;
+	pipeStats.sfxLatencyUsec = 0;
+	pipeStats.sfxLatencyMaxUsec = 0;
+	pipeStats.sfxLatencyTotalUsec = 0;
+	pipeStats.framesMixed = 0;
+	pipeStats.mixUsec = 0;
+	if (output != nullptr) output->reset_counters ();
+}
+
+
 /**
  * This does a short test of the jaw motion and the eyes.
  *
@@ -427,6 +1645,7 @@ void SndPlayer::startPlayerTask (void *_me)
 #else
 	output = new DACOutput ();
 #endif
+	output->set_latency_policy (AUDIO_LATENCY_POLICY );
 
 #ifdef I2S_SPEAKDER_SD_PIN
 	// if you I2S amp has a SD pin, you'll need to turn it on
@@ -435,11 +1654,25 @@ void SndPlayer::startPlayerTask (void *_me)
 #endif
 
 	// setup the button to trigger playback - see config.h for settings
-	gpio_set_direction (GPIO_BUTTON, GPIO_MODE_INPUT );
-	gpio_set_pull_mode (GPIO_BUTTON, GPIO_PULLUP_ONLY );
+	// (it interrupts us when pressed - it pulls the pin low)
+	me->myTask = xTaskGetCurrentTaskHandle ();
+	gpio_config_t button = { };
+	button.pin_bit_mask = 1ULL << GPIO_BUTTON;
+	button.mode = GPIO_MODE_INPUT;
+	button.pull_up_en = GPIO_PULLUP_ENABLE;
+	button.pull_down_en = GPIO_PULLDOWN_DISABLE;
+	button.intr_type = GPIO_INTR_NEGEDGE;
+	gpio_config (&button );
+	esp_err_t err = gpio_install_isr_service (0 );
+	if ((err != ESP_OK) && (err != ESP_ERR_INVALID_STATE)) // (already installed is fine)
+	{
+		ESP_LOGE(TAG, "Can't install the GPIO interrupt service - the button won't work" );
+	}
+	gpio_isr_handler_add (GPIO_BUTTON, &buttonIsr, me );
 
-	// initialize the file system
+	// initialize the file system - and find the clips
 	SPIFFS spiffs ("/fs" );
+	AssetIndex::build (ASSET_DIR );
 
 #ifdef VOLUME_CONTROL
   // set up the ADC for reading the volume control
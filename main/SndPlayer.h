@@ -8,8 +8,24 @@
 
 #ifndef MAIN_SNDPLAYER_H_
 #define MAIN_SNDPLAYER_H_
+#include <stdio.h>
+#include <atomic>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "config.h"
+#include "audio/SpscRing.h"
+#include "audio/StreamWindow.h"
+#include "audio/EnvelopeTrack.h"
+#include "audio/EnvelopeFollower.h"
+#include "audio/Playlist.h"
+#include "audio/Decoder.h"
+#include "audio/minimp3.h"
+
+class Output;
+class Resampler;
+class Mixer;
+class SfxBank;
 
 
 // These are commands that can be sent to this device
@@ -17,16 +33,105 @@
 #define SND_EVENT_PLAYER_START 101
 #define SND_EVENT_PLAYER_PAUSE 102
 #define SND_EVENT_PLAYER_REWIND 103
+#define SND_EVENT_PLAYER_PRESCAN 104   // Make the envelope tracks (when idle)
+#define SND_EVENT_PLAYER_PLAY    105   // Play clip 'value' now (clears the playlist)
+#define SND_EVENT_PLAYER_NEXT    106   // Skip to the next clip in the playlist
+#define SND_EVENT_PLAYER_ENQUEUE 107   // Add clip 'value' to the playlist
+#define SND_EVENT_PLAYER_SEEK    108   // Play from 'value' msec into clip 'rate' (-1: this one)
+#define SND_EVENT_PLAYER_CUE     109   // Go to cue point 'value'
+#define SND_EVENT_PLAYER_SETCUE  110   // Make cue point 'value' where we are now
+#define SND_EVENT_PLAYER_SFX     111   // Play clip 'value' over the music, at 'rate' % volume
 // also uses EVENT_ACTION_SETVALUE to set volume
 
-const int BUFFER_SIZE = 1024;
+// Why the player task was woken (task notification bits)
+#define PLAYER_NOTIFY_COMMAND 0x01   // 'requestedState' was set
+#define PLAYER_NOTIFY_BUTTON  0x02   // The button was pressed
+#define PLAYER_NOTIFY_FRAME   0x04   // The decoder has a frame for us
+#define PLAYER_NOTIFY_STATS   0x08   // resetPipelineStats was called
 
 
 enum Player_State {
 	PLAYER_IDLE,    // Nothin happening. Waiting to start
 	PLAYER_RUNNING, // We are playing a file
 	PLAYER_PAUSED,  // We paused - file is still open
-	PLAYER_REWIND   // We need to stop and close the file.
+	PLAYER_REWIND,  // We need to stop and close the file.
+	PLAYER_PRESCAN, // Make the envelope tracks for the clips (see EnvelopeTrack.h)
+	PLAYER_SKIP,    // Stop this clip, and go straight on to the next one
+	PLAYER_SEEK     // Stop, and start again from 'seekWantMsec' in 'seekWantClip'
+};
+
+// A place to go back to - see SND_EVENT_PLAYER_CUE
+struct CuePoint
+{
+	int clip;       // -1 if not set
+	uint32_t msec;  // from the start of the clip
+};
+
+// A sound effect to start - from 'callBack' to the output stage
+struct SfxTrigger
+{
+	int clip;
+	int32_t gain;       // Q15 (see audio/Mixer.h)
+	uint32_t sentAt;    // When it was asked for (usec - low 32 bits)
+	bool loaded;        // It had to be loaded first
+};
+
+// Passing the input window from one clip to the next (see readerStage)
+enum Clip_Handoff {
+	HANDOFF_NONE,    // Reading / decoding a clip
+	HANDOFF_WANTED,  // The decoder has finished the clip - what next?
+	HANDOFF_NEXT,    // The reader has started the next clip
+	HANDOFF_END      // There is no next clip
+};
+
+// One decoded frame, on its way from the decoder to the output.
+// Zero samples marks the end of the file.
+struct PcmFrame
+{
+	int clip;        // Clip ID (see AssetIndex.h)
+	int samples;     // Samples per channel
+	int channels;
+	int hz;
+	int16_t pcm[MINIMP3_MAX_SAMPLES_PER_FRAME];
+};
+
+// Counters for tuning the pipeline buffer sizes.
+struct AudioPipelineStats
+{
+	uint32_t readDepth;        // Bytes of the file waiting for the decoder (now)
+	uint32_t readHighWater;    //   ... the most there have been
+	uint32_t readCapacity;
+	uint32_t pcmDepth;         // Decoded frames waiting for the output (now)
+	uint32_t pcmHighWater;     //   ... the most there have been
+	uint32_t pcmCapacity;
+	uint32_t readerStalls;     // Reader found the window full (good - we are ahead)
+	uint32_t decoderUnderruns; // Decoder had to wait for the file
+	uint32_t decoderStalls;    // Decoder found the frame ring full (good - we are ahead)
+	uint32_t outputUnderruns;  // Output had nothing to play (an audible gap!)
+	uint32_t bytesRead;
+	uint32_t readCalls;        // How many 'fread's (bytesRead / readCalls = bytes per read)
+	uint32_t framesDecoded;
+	uint64_t decodeUsec;       // Time spent decoding (decodeUsec / framesDecoded = per frame)
+	uint32_t outputDirect;     // Frames the driver took straight from the decoder
+	uint32_t outputConverted;  // Frames converted (volume, DAC format) on the way
+	uint32_t outputLatencyUsec; // From writing a sample to hearing it
+	uint32_t dmaBufCount;      // The output DMA buffers
+	uint32_t dmaBufLen;        //   (frames each)
+	uint32_t outputHz;         // The output's sample rate
+	uint32_t resampleFromHz;   // The clip's, if it is being resampled (0 if not)
+	uint32_t framesResampled;  // Output frames the resampler made
+	uint64_t resampleUsec;     //   ... and the time it took
+	uint32_t sfxVoices;        // Sound effects playing (now)
+	uint32_t sfxStarted;       // Sound effects started
+	uint32_t sfxLoaded;        //   ... that had to be loaded first (not in the latency)
+	uint32_t sfxRejected;      // Not started - not playing, or too many waiting
+	uint32_t sfxDropped;       //   ... couldn't be loaded
+	uint32_t sfxLoadUsec;      // How long the last load took
+	uint32_t sfxLatencyUsec;   // From asking for an effect to hearing it (the last one)
+	uint32_t sfxLatencyMaxUsec; //   ... the longest
+	uint64_t sfxLatencyTotalUsec; //  ... all of them (for the average)
+	uint32_t framesMixed;      // Output frames with effects mixed in
+	uint64_t mixUsec;          //   ... and the time it took
 };
 
 class SndPlayer : DeviceDef
@@ -40,13 +145,93 @@ public:
 	void callBack(const Message *msg);
 	TaskHandle_t myTask;
 
+	static void getPipelineStats(AudioPipelineStats *stats);
+	static void resetPipelineStats();
+	static int getPlaylist(int *ids, int maxIds);
+	static int getCurrentClip();
+	static bool getPosition(int *clip, uint32_t *msec);
+	static bool getCue(int cue, CuePoint *point);
+
 private:
 	Player_State runState;
-	void checkForCommand();
+	volatile Player_State requestedState;  // From 'callBack' (another task)
+	volatile int64_t lastPressUsec;        // For the button interrupt
+	void checkForCommand(TickType_t wait);
+	static void buttonIsr(void *_me);
+	void requestState(Player_State state);
 	void testEyesAndJaws();
 
-	int eye_scale;
-	int jaw_scale;
+	// The eye and jaw levels - worked out as we play...
+	EnvelopeFollower eyeEnv;
+	EnvelopeFollower jawEnv;
+
+	// ...or precomputed for the file, if there are any.
+	EnvelopeTrack *envTrack;
+	bool prescan();
+	volatile bool prescanOk;
+	static void prescanTask(void *_me);
+	static bool prescanFile(SndPlayer *me, const char *path, int16_t *pcm);
+
+	// The clips to play (by ID), and the one we are playing (-1 if none)
+	Playlist playlist;
+	volatile int currentClip;
+	volatile bool dropQueued;   // The playlist was replaced - forget what the reader took
+	bool openClip(FILE **file, int *clip, AudioFormat *format);
+	bool openAsset(int id, FILE **file, AudioFormat *format);
+	static int defaultClip();
+
+	// Seeking. 'callBack' asks for a clip and time...
+	volatile int seekWantClip;     // -1: no seek
+	volatile uint32_t seekWantMsec;
+	CuePoint cues[CUE_MAX];
+	void requestSeek(int clip, uint32_t msec);
+	// ...'startPipeline' finds where to start reading (see SeekIndex.h)...
+	void seekTo(int clip, uint32_t msec);
+	bool buildSeekIndex(const char *path);
+	const char *indexPath;
+	volatile bool indexOk;
+	static void indexTask(void *_me);
+	static bool indexFile(SndPlayer *me, const char *path);
+	// ...and the decoder throws away frames until it gets there.
+	int seekSkipFrames;
+	uint32_t seekFromSample;
+	uint32_t seekToSample;
+	// Where the playing clip started, on the playback clock
+	volatile uint32_t clipStartSample;
+
+	// The pipeline stages. The output stage is 'playMusic' itself.
+	Output *output;
+	Resampler *resampler;          // (in the output stage)
+	Mixer *mixer;                  //  ""
+	SfxBank *sfxBank;              //  ""
+	SpscRing<SfxTrigger, SFX_TRIGGER_QUEUE> *sfxRing;  // From 'callBack'
+	uint32_t sfxSentAt[MIXER_VOICES]; // The effects started in this block...
+	int sfxStartCount;                //  ... (for the latency)
+	StreamWindow<AUDIO_READ_WINDOW_SIZE, AUDIO_WINDOW_GUARD> *readWindow;
+	SpscRing<PcmFrame, AUDIO_PCM_RING_SIZE> *pcmRing;
+	TaskHandle_t readerTask;
+	TaskHandle_t decoderTask;
+	FILE *fp;                      // The clip being read (reader)
+	int readerClip;
+	AudioFormat readerFormat;
+	uint32_t startOffset;          // Where in it the reader started
+	FILE *nextFp;                  // The next clip - opened early (reader)
+	int nextClip;
+	AudioFormat nextFormat;
+	std::atomic<int> handoff;      // Clip_Handoff
+	volatile bool stopStages;      // Tells the reader and decoder to quit
+	bool stagesRunning;            // (only the player task uses this)
+	SemaphoreHandle_t stageDone;   // Given by each stage as it quits
+	StaticSemaphore_t stageDoneBuffer;
+
+	void startEffects(int outputHz);
+	void resetPlayerStats();
+	void writeOutput(const int16_t *pcm, int frames, int channels);
+	bool startPipeline();
+	void stopPipeline();
+	static void readerStage(void *_me);
+	static void decoderStage(void *_me);
+	void waitForStop();
 };
 
 #endif /* MAIN_SNDPLAYER_H_ */
@@ -76,21 +76,18 @@ void StepperDriver::callBack (const Message *msg)
 			break;
 
 		default: // Should not happen!
-			resp = Message::create_message(msg->response, msg->destination,
-					msg->event, 0, 0, "Bad format, or unknown device !");
+			resp = Message::create_reply(msg, 0, 0, "Bad format, or unknown device !");
 			break;
 		}
 
 		// RUN the command on the target, return a appropriate response
-		const char *res = target->ExecuteCommand(msg->text);
-		ESP_LOGD(TAG, "Command:'%s'   response: '%s'", msg->text, res);
+		const char *res = target->ExecuteCommand(msg->text());
+		ESP_LOGD(TAG, "Command:'%s'   response: '%s'", msg->text(), res);
 
 		if ((res == nullptr) || (res[0] == '\0')) {   // no resp text means "OK"
-			resp = Message::create_message(msg->response, msg->destination,
-					msg->event, 0, 0, "OK");
+			resp = Message::create_reply(msg, 0, 0, "OK");
 		} else { // Something to report to caller...
-			resp = Message::create_message(msg->response, msg->destination,
-					msg->event, 0, 0, res);
+			resp = Message::create_reply(msg, 0, 0, res);
 		}
 
 		SwitchBoard::send(resp);
@@ -203,12 +200,14 @@ void StepperDriver::runTask(void *param) {
 
 	// initialize the controllers
 	me->rotControl = new StepperMotorController(UNIPOLAR, ROTATE_PINA, ROTATE_PINB, ROTATE_PINC,ROTATE_PIND, STEPPER_NO_LED);
-	SwitchBoard::registerDriver(TASK_NAME::ROTATE, me);
+	// Stepper commands can be slow - give them their own delivery task,
+	// so they don't hold up the jaw and eyes.
+	SwitchBoard::registerDriver(TASK_NAME::ROTATE, me, ASSIGN_STEPPER_CORE);
 	ESP_LOGI(TAG, "ROTATE is registered");
 
 	me->nodControl = new StepperMotorController(UNIPOLAR, NOD_PINA,    NOD_PINB,    NOD_PINC,   NOD_PIND,  STEPPER_NO_LED);
 	// Register us for action
-	SwitchBoard::registerDriver(TASK_NAME::NODD, me);
+	SwitchBoard::registerDriver(TASK_NAME::NODD, me, ASSIGN_STEPPER_CORE);
 	ESP_LOGI(TAG, "NODD is registered");
 
 	// Initialize the timer
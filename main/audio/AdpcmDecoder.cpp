@@ -0,0 +1,105 @@
+/**
+ * AdpcmDecoder.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ */
+
+#include <string.h>
+#include "AdpcmDecoder.h"
+
+static const int16_t stepTable[89] = {
+	7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+	50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+	253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+	1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+	3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487,
+	12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767 };
+
+static const int8_t indexTable[16] = {
+	-1, -1, -1, -1, 2, 4, 6, 8,
+	-1, -1, -1, -1, 2, 4, 6, 8 };
+
+// One 4 bit code -> the next sample
+static inline int16_t imaSample (int code, int *predictor, int *index)
+{
+	int step = stepTable[*index];
+	int diff = step >> 3;
+	if (code & 1) diff += step >> 2;
+	if (code & 2) diff += step >> 1;
+	if (code & 4) diff += step;
+	int pred = (code & 8) ? *predictor - diff : *predictor + diff;
+	if (pred > 32767) pred = 32767;
+	if (pred < -32768) pred = -32768;
+	*predictor = pred;
+
+	int idx = *index + indexTable[code];
+	if (idx < 0) idx = 0;
+	if (idx > 88) idx = 88;
+	*index = idx;
+	return ((int16_t) pred);
+}
+
+
+AdpcmDecoder::AdpcmDecoder ()
+{
+	memset (&fmt, 0, sizeof(fmt) );
+	remaining = 0;
+}
+
+
+void AdpcmDecoder::start (const AudioFormat *format, uint32_t offset)
+{
+	fmt = *format;
+	remaining = (offset < fmt.dataEnd) ? fmt.dataEnd - offset : 0;
+}
+
+
+/**
+ * Decode one block (the last one may be short).
+ */
+int AdpcmDecoder::decode (const uint8_t *input, size_t len, int16_t *pcm, DecodeInfo *info)
+{
+	int channels = fmt.channels;
+	info->channels = channels;
+	info->hz = fmt.hz;
+	info->bytes = 0;
+
+	if (len > remaining) len = remaining;
+	if (len > (size_t) fmt.blockAlign) len = fmt.blockAlign;
+	int headerBytes = 4 * channels;
+	if (len <= (size_t) headerBytes) return (0);  // The end
+
+	// 8 samples for each channel in each group
+	int groups = (len - headerBytes) / headerBytes;
+	int samples = 1 + groups * 8;
+	info->bytes = len;
+	remaining -= len;
+	if (pcm == nullptr) return (samples);
+
+	for (int ch = 0; ch < channels; ch++ )
+	{
+		const uint8_t *hdr = &input[ch * 4];
+		int predictor = (int16_t) (hdr[0] | (hdr[1] << 8));
+		int index = (hdr[2] > 88) ? 88 : hdr[2];
+		int16_t *out = &pcm[ch];
+		*out = (int16_t) predictor;
+		out += channels;
+
+		const uint8_t *data = &input[headerBytes + ch * 4];
+		for (int group = 0; group < groups; group++ )
+		{
+			for (int idx = 0; idx < 4; idx++ )
+			{	// (low 4 bits first)
+				uint8_t code = data[idx];
+				*out = imaSample (code & 0x0F, &predictor, &index );
+				out += channels;
+				*out = imaSample (code >> 4, &predictor, &index );
+				out += channels;
+			}
+			data += headerBytes;
+		}
+	}
+	return (samples);
+}
@@ -0,0 +1,38 @@
+/**
+ * AdpcmDecoder.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ * IMA (DVI) ADPCM in a WAV file - 4 bits a sample, so a quarter of the
+ * flash of 16 bit PCM, and decoding it is a table lookup and a few adds
+ * per sample (no multiplies, no floating point).
+ *
+ * The file is in blocks of 'blockAlign' bytes. Each block starts with a
+ * 4 byte header for each channel (the first sample, and the step index),
+ * then the rest of the samples, 4 bits each. Stereo takes turns - 4 bytes
+ * (8 samples) of the left, then 4 bytes of the right.
+ *
+ * Each block stands alone - so it can be started (seeked) at any block.
+ */
+
+#ifndef MAIN_AUDIO_ADPCMDECODER_H_
+#define MAIN_AUDIO_ADPCMDECODER_H_
+
+#include "Decoder.h"
+
+class AdpcmDecoder : public Decoder
+{
+public:
+	AdpcmDecoder ();
+
+	virtual void start(const AudioFormat *format, uint32_t offset);
+	virtual int decode(const uint8_t *input, size_t len, int16_t *pcm, DecodeInfo *info);
+	virtual const char *name() { return ("IMA-ADPCM"); }
+
+private:
+	AudioFormat fmt;
+	uint32_t remaining;  // Bytes of sound left in the file
+};
+
+#endif /* MAIN_AUDIO_ADPCMDECODER_H_ */
@@ -0,0 +1,113 @@
+/**
+ * AssetIndex.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "esp_log.h"
+#include "AssetIndex.h"
+
+static const char *TAG = "ASSETS:";
+
+Asset AssetIndex::assets[ASSET_INDEX_MAX];
+int AssetIndex::assetCount = 0;
+
+static int compareAssets (const void *a, const void *b)
+{
+	return (strcmp (((const Asset*) a)->name, ((const Asset*) b)->name ));
+}
+
+
+/**
+ * MP3 or WAV (see Decoder.h - which decoder it needs comes from what is
+ * in the file, not the name).
+ */
+bool AssetIndex::isSound (const char *name)
+{
+	const char *dot = strrchr (name, '.' );
+	return ((dot != nullptr)
+			&& ((0 == strcasecmp (dot, ".mp3" )) || (0 == strcasecmp (dot, ".wav" ))));
+}
+
+
+/**
+ * List the sound files in 'dir'.
+ * @return the number found.
+ */
+int AssetIndex::build (const char *dir)
+{
+	assetCount = 0;
+	DIR *dp = opendir (dir );
+	if (dp == nullptr)
+	{
+		ESP_LOGE(TAG, "Can't read the directory %s", dir );
+		return (0);
+	}
+
+	struct dirent *ent;
+	while ((ent = readdir (dp )) != nullptr)
+	{
+		if (!isSound (ent->d_name )) continue;
+		if (assetCount >= ASSET_INDEX_MAX)
+		{
+			ESP_LOGW(TAG, "Too many clips - increase ASSET_INDEX_MAX (skipped %s)", ent->d_name );
+			continue;
+		}
+
+		Asset *asset = &assets[assetCount];
+		if ((strlen (ent->d_name ) >= ASSET_NAME_LEN)
+				|| (snprintf (asset->path, ASSET_PATH_LEN, "%s/%s", dir, ent->d_name ) >= ASSET_PATH_LEN))
+		{
+			ESP_LOGW(TAG, "Name too long - skipped %s", ent->d_name );
+			continue;
+		}
+		strcpy (asset->name, ent->d_name );
+		struct stat st;
+		asset->size = (0 == stat (asset->path, &st )) ? (uint32_t) st.st_size : 0;
+		assetCount++;
+	}
+	closedir (dp );
+
+	qsort (assets, assetCount, sizeof(Asset), compareAssets );
+	for (int id = 0; id < assetCount; id++ )
+	{
+		ESP_LOGI(TAG, "Clip %d: %s (%u bytes)", id, assets[id].name, assets[id].size );
+	}
+	return (assetCount);
+}
+
+
+/**
+ * @return the clip, or nullptr if there is no such ID.
+ */
+const Asset *AssetIndex::get (int id)
+{
+	if ((id < 0) || (id >= assetCount)) return (nullptr);
+	return (&assets[id]);
+}
+
+
+/**
+ * Look up a clip by its full path, or its file name (with or without
+ * the extension).
+ * @return the clip ID, or -1.
+ */
+int AssetIndex::find (const char *name)
+{
+	size_t len = strlen (name );
+	for (int id = 0; id < assetCount; id++ )
+	{
+		const Asset *asset = &assets[id];
+		if ((0 == strcmp (asset->path, name )) || (0 == strcasecmp (asset->name, name ))) return (id);
+		if ((0 == strncasecmp (asset->name, name, len )) && (asset->name[len] == '.')) return (id);
+	}
+	return (-1);
+}
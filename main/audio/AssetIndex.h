@@ -0,0 +1,48 @@
+/**
+ * AssetIndex.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ * The sound clips on the file system, and their clip IDs.
+ *
+ * 'build' is called once at boot (after the file system is mounted). It
+ * lists the sound files in the directory, sorted by name - a clip's ID is
+ * its place in that list, so the IDs stay the same from one boot to the
+ * next (as long as the files don't change).
+ *
+ * After that it is only read - so no locking.
+ */
+
+#ifndef MAIN_AUDIO_ASSETINDEX_H_
+#define MAIN_AUDIO_ASSETINDEX_H_
+
+#include <stdint.h>
+#include "../config.h"
+
+#define ASSET_NAME_LEN 32
+#define ASSET_PATH_LEN 64
+
+struct Asset
+{
+	char name[ASSET_NAME_LEN];   // File name (no directory)
+	char path[ASSET_PATH_LEN];   // Full path - to open it
+	uint32_t size;               // bytes
+};
+
+class AssetIndex
+{
+public:
+	static int build(const char *dir);
+	static int count() { return (assetCount); }
+	static const Asset *get(int id);
+	static int find(const char *name);
+
+private:
+	static Asset assets[ASSET_INDEX_MAX];
+	static int assetCount;
+
+	static bool isSound(const char *name);
+};
+
+#endif /* MAIN_AUDIO_ASSETINDEX_H_ */
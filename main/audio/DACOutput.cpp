@@ -1,13 +1,25 @@
 #include "freertos/FreeRTOS.h"
 #include "esp_intr_alloc.h"
+#include <esp_log.h>
 #include "../audio/DACOutput.h"
 
+static const char *TAG = "DAC";
+
  DACOutput::DACOutput() : Output(I2S_NUM_0) {
+	 // DAC needs unsigned 16 bit samples
+	 m_format = SAMPLE_UNSIGNED_16;
 	 return;
  }
 
-void DACOutput::start(int sample_rate)
+void DACOutput::start(int sample_rate, int channels)
 {
+    // the built in DAC always gets both channels - write_mono fills in
+    // both sides as it converts the samples (no separate widening pass)
+    m_channels = 2;
+    m_geometry = plan(sample_rate, m_channels, m_policy);
+    ESP_LOGI(TAG, "%d Hz, %d channel(s): %d DMA buffers of %d frames - %u usec latency",
+             sample_rate, m_channels, m_geometry.buf_count, m_geometry.buf_len, m_geometry.latency_usec);
+
     // i2s config for writing both channels of I2S
     i2s_config_t i2s_config = {
         .mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_TX | I2S_MODE_DAC_BUILT_IN),
@@ -16,8 +28,8 @@ void DACOutput::start(int sample_rate)
         .channel_format = I2S_CHANNEL_FMT_RIGHT_LEFT,
         .communication_format = I2S_COMM_FORMAT_STAND_I2S,
         .intr_alloc_flags = ESP_INTR_FLAG_LEVEL1,
-        .dma_buf_count = 4,
-        .dma_buf_len = 1024,
+        .dma_buf_count = m_geometry.buf_count,
+        .dma_buf_len = m_geometry.buf_len,
         .use_apll = false,
         .tx_desc_auto_clear = true,
         .fixed_mclk = 0,
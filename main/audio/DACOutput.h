@@ -10,7 +10,8 @@ class DACOutput : public Output
 public:
     // DAC can only be used with I2S_NUM_0 - no argument!
 	DACOutput();
-    void start(int sample_rate);
+    void start(int sample_rate, int channels = 2);
+    // (not used - convert_block does this for SAMPLE_UNSIGNED_16)
     virtual uint16_t process_sample(int16_t sample)
     {
         //return sample;
@@ -0,0 +1,120 @@
+/**
+ * Decoder.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ */
+
+#include <string.h>
+#include "esp_log.h"
+#include "../config.h"
+#include "minimp3.h"
+#include "Decoder.h"
+
+static const char *TAG = "DECODER:";
+
+#define WAVE_FORMAT_PCM       0x0001
+#define WAVE_FORMAT_IMA_ADPCM 0x0011
+
+static uint16_t get16 (const uint8_t *p)
+{
+	return ((uint16_t) (p[0] | (p[1] << 8)));
+}
+
+
+static uint32_t get32 (const uint8_t *p)
+{
+	return ((uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16)
+			| ((uint32_t) p[3] << 24));
+}
+
+
+/**
+ * Work out what kind of sound file this is (from the start of the file),
+ * and leave it ready to read the sound.
+ * Anything that isn't a RIFF/WAVE file is taken to be MP3.
+ * @return false if it is a WAV file we can't play.
+ */
+bool Decoder::probe (FILE *fp, AudioFormat *format)
+{
+	uint8_t head[12];
+	uint8_t chunk[8];
+	uint8_t fmt[20];
+
+	memset (format, 0, sizeof(AudioFormat) );
+	format->codec = CODEC_MP3;
+	format->dataEnd = UINT32_MAX;
+
+	if ((1 != fread (head, sizeof(head), 1, fp )) || (0 != memcmp (head, "RIFF", 4 ))
+			|| (0 != memcmp (&head[8], "WAVE", 4 )))
+	{	// (minimp3 skips any ID3 tag itself)
+		return (0 == fseek (fp, 0, SEEK_SET ));
+	}
+
+	// Find the 'fmt ' and 'data' chunks
+	bool haveFmt = false;
+	uint32_t pos = sizeof(head);
+	while (1 == fread (chunk, sizeof(chunk), 1, fp ))
+	{
+		uint32_t size = get32 (&chunk[4] );
+		pos += sizeof(chunk);
+		if (0 == memcmp (chunk, "fmt ", 4 ))
+		{
+			size_t len = (size < sizeof(fmt)) ? size : sizeof(fmt);
+			memset (fmt, 0, sizeof(fmt) );
+			if ((size < 16) || (len != fread (fmt, 1, len, fp ))) break;
+			haveFmt = true;
+		}
+		else if (0 == memcmp (chunk, "data", 4 ))
+		{
+			format->dataStart = pos;
+			format->dataEnd = pos + size;
+			break;
+		}
+		pos += size + (size & 1);  // (chunks are padded to even sizes)
+		if (0 != fseek (fp, pos, SEEK_SET )) break;
+	}
+	if (!haveFmt || (format->dataStart == 0))
+	{
+		ESP_LOGE(TAG, "WAV file without 'fmt ' or 'data'" );
+		return (false);
+	}
+
+	uint16_t tag = get16 (&fmt[0] );
+	format->channels = get16 (&fmt[2] );
+	format->hz = get32 (&fmt[4] );
+	format->blockAlign = get16 (&fmt[12] );
+	format->bitsPerSample = get16 (&fmt[14] );
+	bool ok = (format->channels == 1) || (format->channels == 2);
+	if (tag == WAVE_FORMAT_PCM)
+	{
+		format->codec = CODEC_PCM;
+		ok = ok && ((format->bitsPerSample == 8) || (format->bitsPerSample == 16))
+				&& (format->blockAlign == format->channels * format->bitsPerSample / 8);
+	}
+	else if (tag == WAVE_FORMAT_IMA_ADPCM)
+	{
+		// A 4 byte header for each channel, then 2 samples a byte - in groups
+		// of 4 bytes for each channel (so a block is a multiple of 4 * channels)
+		format->codec = CODEC_IMA_ADPCM;
+		format->samplesPerBlock = (format->blockAlign - 4 * format->channels) * 2
+				/ format->channels + 1;
+		ok = ok && (format->bitsPerSample == 4)
+				&& (format->blockAlign > 4 * format->channels)
+				&& ((format->blockAlign % (4 * format->channels)) == 0)
+				&& (format->blockAlign <= AUDIO_WINDOW_GUARD)
+				&& (format->samplesPerBlock * format->channels <= MINIMP3_MAX_SAMPLES_PER_FRAME);
+	}
+	else
+	{
+		ok = false;
+	}
+	if (!ok)
+	{
+		ESP_LOGE(TAG, "Can't play this WAV file (format %u, %d channels, %d bits, block %d)",
+				tag, format->channels, format->bitsPerSample, format->blockAlign );
+		return (false);
+	}
+	return (0 == fseek (fp, format->dataStart, SEEK_SET ));
+}
@@ -0,0 +1,73 @@
+/**
+ * Decoder.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ * The sound decoders - MP3 (minimp3), IMA-ADPCM and plain PCM (both in
+ * WAV files). The MP3 decoder is by far the heaviest thing we run: a clip
+ * that has to keep tight time with the motion can use a WAV instead, and
+ * trade some flash for most of the decoding time.
+ *
+ * Which one a clip uses comes from the file itself - 'probe' reads the
+ * start of the file (not the name).
+ *
+ * A decoder works one frame at a time, straight from the input window:
+ * 'decode' is given what is buffered (at least AUDIO_WINDOW_GUARD bytes,
+ * unless it is the end of the file), and says how many bytes it used.
+ * Using no bytes at all means the end of the sound.
+ */
+
+#ifndef MAIN_AUDIO_DECODER_H_
+#define MAIN_AUDIO_DECODER_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+enum Codec
+{
+	CODEC_MP3,
+	CODEC_PCM,       // WAV - 8 or 16 bit
+	CODEC_IMA_ADPCM  // WAV - 4 bit IMA (DVI) ADPCM
+};
+
+// What 'probe' found out about a file.
+struct AudioFormat
+{
+	Codec codec;
+	int channels;         // (MP3 - not known until it is decoded)
+	int hz;               //  ""
+	int bitsPerSample;    // PCM
+	int blockAlign;       // Bytes in a PCM sample frame, or an ADPCM block
+	int samplesPerBlock;  // ADPCM (per channel)
+	uint32_t dataStart;   // Where the sound starts in the file
+	uint32_t dataEnd;     //   ... and ends
+};
+
+// What 'decode' did.
+struct DecodeInfo
+{
+	int bytes;     // Input used (0 - there is no more)
+	int channels;
+	int hz;
+};
+
+class Decoder
+{
+public:
+	virtual ~Decoder () { }
+
+	// Start decoding the sound, from 'offset' in the file.
+	virtual void start(const AudioFormat *format, uint32_t offset) = 0;
+	// Decode one frame. With no 'pcm', just find it (for the seek index).
+	// @return samples (per channel) - 0 if it had none (or was skipped)
+	virtual int decode(const uint8_t *input, size_t len, int16_t *pcm, DecodeInfo *info) = 0;
+	// Does a frame use bytes from the frames before it? (see SeekIndex.h)
+	virtual bool hasReservoir() { return (false); }
+	virtual const char *name() = 0;
+
+	static bool probe(FILE *fp, AudioFormat *format);
+};
+
+#endif /* MAIN_AUDIO_DECODER_H_ */
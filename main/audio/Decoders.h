@@ -0,0 +1,34 @@
+/**
+ * Decoders.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ * One of each decoder (see Decoder.h) - a clip's format says which.
+ * These are big - they go on the stack of the task that decodes.
+ */
+
+#ifndef MAIN_AUDIO_DECODERS_H_
+#define MAIN_AUDIO_DECODERS_H_
+
+#include "Mp3Decoder.h"
+#include "PcmDecoder.h"
+#include "AdpcmDecoder.h"
+
+struct Decoders
+{
+	Mp3Decoder mp3;
+	PcmDecoder pcm;
+	AdpcmDecoder adpcm;
+
+	Decoder *start (const AudioFormat *format, uint32_t offset)
+	{
+		Decoder *decoder = &mp3;
+		if (format->codec == CODEC_PCM) decoder = &pcm;
+		else if (format->codec == CODEC_IMA_ADPCM) decoder = &adpcm;
+		decoder->start (format, offset );
+		return (decoder);
+	}
+};
+
+#endif /* MAIN_AUDIO_DECODERS_H_ */
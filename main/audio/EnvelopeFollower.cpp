@@ -0,0 +1,163 @@
+/**
+ * EnvelopeFollower.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ */
+
+#include <math.h>
+#include "EnvelopeFollower.h"
+
+EnvelopeFollower::EnvelopeFollower ()
+{
+	mode = ENV_PEAK;
+	attackMsec = 0;
+	releaseMsec = 0;
+	interval = 256;
+	attack = 65536;
+	release = 65536;
+	reset ();
+}
+
+
+/**
+ * @param mode        - ENV_PEAK or ENV_RMS
+ * @param attackMsec  - time constant while the level rises (0 = at once)
+ * @param releaseMsec - time constant while it falls
+ * @param interval    - samples per level from 'process'
+ * NOTE: call setSampleRate afterwards, to work out the coefficients.
+ */
+void EnvelopeFollower::configure (EnvMode _mode, uint32_t _attackMsec, uint32_t _releaseMsec,
+		uint32_t _interval)
+{
+	mode = _mode;
+	attackMsec = _attackMsec;
+	releaseMsec = _releaseMsec;
+	interval = (_interval > 0) ? _interval : 1;
+	reset ();
+}
+
+
+void EnvelopeFollower::setSampleRate (uint32_t hz)
+{
+	attack = coefficient (attackMsec, hz );
+	release = coefficient (releaseMsec, hz );
+}
+
+
+void EnvelopeFollower::reset ()
+{
+	env = 0;
+	phase = 0;
+}
+
+
+/**
+ * The Q16 coefficient for a time constant: 1 - e^(-1/(time * rate))
+ * (Only when the settings change - so floating point is fine here.)
+ */
+int32_t EnvelopeFollower::coefficient (uint32_t msec, uint32_t hz)
+{
+	if ((msec == 0) || (hz == 0)) return (65536);
+	float c = 1.0f - expf (-1000.0f / ((float) msec * (float) hz));
+	int32_t q = (int32_t) (c * 65536.0f + 0.5f);
+	return ((q < 1) ? 1 : q);
+}
+
+
+uint16_t EnvelopeFollower::isqrt (uint32_t val)
+{
+	uint32_t res = 0;
+	uint32_t bit = 1UL << 30;
+	while (bit > val) bit >>= 2;
+	while (bit != 0)
+	{
+		if (val >= res + bit)
+		{
+			val -= res + bit;
+			res = (res >> 1) + bit;
+		}
+		else
+		{
+			res >>= 1;
+		}
+		bit >>= 2;
+	}
+	return ((uint16_t) res);
+}
+
+
+/**
+ * The filter itself - every 'stride'th sample of 'count'.
+ * Both modes keep 'env' in 0...2^30, so the difference fits in 32 bits.
+ */
+template <EnvMode MODE>
+int32_t EnvelopeFollower::run (const int16_t *pcm, int count, int stride, int32_t env,
+		int32_t attack, int32_t release)
+{
+	for (int i = 0; i < count; i++ )
+	{
+		int32_t s = pcm[i * stride];
+		int32_t x;
+		if (MODE == ENV_PEAK)
+		{
+			int32_t sign = s >> 31;
+			x = ((s ^ sign) - sign) << 15;
+		}
+		else
+		{
+			x = s * s;
+		}
+		int32_t diff = x - env;
+		int32_t falling = diff >> 31;   // all ones if the level is dropping
+		int32_t coef = (release & falling) | (attack & ~falling);
+		env += (int32_t) (((int64_t) diff * coef) >> 16);
+	}
+	return (env);
+}
+
+
+/**
+ * Run a block of samples through the filter.
+ * @param pcm       - the samples
+ * @param samples   - how many (per channel)
+ * @param stride    - 1 for mono, 2 for stereo (the left channel is used)
+ * @param levels    - where to put the levels
+ * @param maxLevels - room in 'levels' - at least samples/interval + 1
+ * @return the number of levels put in 'levels'.
+ */
+int EnvelopeFollower::process (const int16_t *pcm, int samples, int stride, uint16_t *levels,
+		int maxLevels)
+{
+	int count = 0;
+	while (samples > 0)
+	{
+		int todo = interval - phase;
+		if (todo > samples) todo = samples;
+
+		if (mode == ENV_PEAK)
+			env = run<ENV_PEAK> (pcm, todo, stride, env, attack, release );
+		else
+			env = run<ENV_RMS> (pcm, todo, stride, env, attack, release );
+
+		pcm += todo * stride;
+		samples -= todo;
+		phase += todo;
+		if (phase >= interval)
+		{
+			phase = 0;
+			if (count < maxLevels) levels[count++] = level ();
+		}
+	}
+	return (count);
+}
+
+
+// The current level
+uint16_t EnvelopeFollower::level () const
+{
+	if (env <= 0) return (0);
+	if (mode == ENV_PEAK) return ((uint16_t) (env >> 15));
+	return (isqrt ((uint32_t) env ));
+}
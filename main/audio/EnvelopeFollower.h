@@ -0,0 +1,63 @@
+/**
+ * EnvelopeFollower.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ * Follows the loudness of the sound, to drive the eyes and the jaw.
+ *
+ * This is a one-pole filter on either abs(sample) (ENV_PEAK) or sample^2
+ * (ENV_RMS), with separate time constants for a rising level (attack) and
+ * a falling one (release) - so the jaw can snap open on a syllable and
+ * close more slowly, instead of jumping about with each block average.
+ *
+ * It is all integer (Q16 coefficients): the loop over a frame has no
+ * divides and no branches - attack or release is picked with a mask.
+ *
+ * A level comes out every 'interval' samples, however the samples arrive
+ * (decoded frames are 1152 samples - that doesn't have to line up).
+ * Levels are 0...32767, like abs(sample).
+ */
+
+#ifndef MAIN_AUDIO_ENVELOPEFOLLOWER_H_
+#define MAIN_AUDIO_ENVELOPEFOLLOWER_H_
+
+#include <stdint.h>
+
+enum EnvMode {
+	ENV_PEAK,   // Follow abs(sample)
+	ENV_RMS     // Follow sample^2 - the level is the square root of that
+};
+
+class EnvelopeFollower
+{
+public:
+	EnvelopeFollower ();
+
+	void configure(EnvMode mode, uint32_t attackMsec, uint32_t releaseMsec, uint32_t interval);
+	void setSampleRate(uint32_t hz);
+	void reset();
+
+	int process(const int16_t *pcm, int samples, int stride, uint16_t *levels, int maxLevels);
+
+	uint16_t level() const;
+	uint32_t getInterval() const { return (interval); }
+
+private:
+	EnvMode mode;
+	uint32_t attackMsec;
+	uint32_t releaseMsec;
+	uint32_t interval;     // Samples per level
+	uint32_t phase;        // Samples since the last level
+	int32_t attack;        // Coefficients (Q16)
+	int32_t release;
+	int32_t env;           // abs(sample) << 15, or sample^2
+
+	static int32_t coefficient(uint32_t msec, uint32_t hz);
+	static uint16_t isqrt(uint32_t val);
+	template <EnvMode MODE>
+	static int32_t run(const int16_t *pcm, int count, int stride, int32_t env,
+			int32_t attack, int32_t release);
+};
+
+#endif /* MAIN_AUDIO_ENVELOPEFOLLOWER_H_ */
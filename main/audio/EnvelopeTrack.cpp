@@ -0,0 +1,218 @@
+/**
+ * EnvelopeTrack.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ */
+
+#include <string.h>
+#include <sys/stat.h>
+#include "esp_log.h"
+#include "../config.h"
+#include "EnvelopeTrack.h"
+
+static const char *TAG = "ENVTRACK:";
+
+EnvelopeTrack::EnvelopeTrack ()
+{
+	fp = nullptr;
+	memset (&header, 0, sizeof(header) );
+	eyeSum = 0;
+	jawSum = 0;
+	bufCount = 0;
+	bufPos = 0;
+}
+
+
+EnvelopeTrack::~EnvelopeTrack ()
+{
+	close ();
+}
+
+
+/**
+ * The name of the track for a sound file - the same name, with '.env'
+ * instead of the extension.
+ */
+void EnvelopeTrack::trackName (const char *soundFile, char *name, size_t len)
+{
+	strncpy (name, soundFile, len - 5 );
+	name[len - 5] = '\0';
+	char *dot = strrchr (name, '.' );
+	char *slash = strrchr (name, '/' );
+	if ((dot != nullptr) && ((slash == nullptr) || (dot > slash))) *dot = '\0';
+	strcat (name, ".env" );
+}
+
+
+uint32_t EnvelopeTrack::fileSize (const char *fileName)
+{
+	struct stat st;
+	if (stat (fileName, &st ) != 0) return (0);
+	return ((uint32_t) st.st_size);
+}
+
+
+/**
+ * Start making a new track (replacing any old one).
+ * @param soundFile  - the sound file this is for.
+ * @param sampleRate - its sample rate.
+ * @return false if the track file could not be created.
+ */
+bool EnvelopeTrack::create (const char *soundFile, uint32_t sampleRate)
+{
+	char name[64];
+	close ();
+	trackName (soundFile, name, sizeof(name) );
+
+	memset (&header, 0, sizeof(header) );
+	header.magic = ENV_TRACK_MAGIC;
+	header.version = ENV_TRACK_VERSION;
+	header.blockSamples = EYE_AVG_SIZE;
+	header.jawBlocks = JAW_AVG_SIZE / EYE_AVG_SIZE;
+	header.sampleRate = sampleRate;
+	header.sourceSize = fileSize (soundFile );
+	eyeSum = 0;
+	jawSum = 0;
+	bufCount = 0;
+
+	fp = fopen (name, "w" );
+	if (fp == nullptr)
+	{
+		ESP_LOGE(TAG, "Can't create %s", name );
+		return (false);
+	}
+	// The header is written again (filled in) by 'finish'
+	if (1 != fwrite (&header, sizeof(header), 1, fp ))
+	{
+		close ();
+		return (false);
+	}
+	return (true);
+}
+
+
+/**
+ * Add the levels for the next block.
+ */
+bool EnvelopeTrack::add (uint16_t eye, uint16_t jaw)
+{
+	if (fp == nullptr) return (false);
+	buf[bufCount].eye = eye;
+	buf[bufCount].jaw = jaw;
+	bufCount++;
+
+	header.blockCount++;
+	eyeSum += eye;
+	jawSum += jaw;
+	if (eye > header.eyePeak) header.eyePeak = eye;
+	if (jaw > header.jawPeak) header.jawPeak = jaw;
+
+	if (bufCount >= ENV_TRACK_BUF_BLOCKS) return (flush ());
+	return (true);
+}
+
+
+bool EnvelopeTrack::flush ()
+{
+	bool ok = (bufCount == 0) || (bufCount == (int) fwrite (buf, sizeof(EnvBlock), bufCount, fp ));
+	bufCount = 0;
+	if (!ok) ESP_LOGE(TAG, "Write failed" );
+	return (ok);
+}
+
+
+/**
+ * Finished adding blocks - fill in the header, and close the track.
+ */
+bool EnvelopeTrack::finish ()
+{
+	if (fp == nullptr) return (false);
+	bool ok = flush ();
+	if (header.blockCount > 0)
+	{
+		header.eyeMean = (uint16_t) (eyeSum / header.blockCount);
+		header.jawMean = (uint16_t) (jawSum / header.blockCount);
+	}
+	ok = ok && (0 == fseek (fp, 0, SEEK_SET ));
+	ok = ok && (1 == fwrite (&header, sizeof(header), 1, fp ));
+	if (0 != fclose (fp )) ok = false;
+	fp = nullptr;
+
+	ESP_LOGI(TAG, "%s: %u blocks, eye peak %u mean %u, jaw peak %u mean %u",
+			ok ? "Track written" : "Track FAILED", header.blockCount,
+			header.eyePeak, header.eyeMean, header.jawPeak, header.jawMean );
+	return (ok);
+}
+
+
+/**
+ * Open the track for a sound file, to play it.
+ * @return false if there is no track, or it doesn't match the sound file
+ *         or the current settings.
+ */
+bool EnvelopeTrack::open (const char *soundFile)
+{
+	char name[64];
+	close ();
+	trackName (soundFile, name, sizeof(name) );
+
+	fp = fopen (name, "r" );
+	if (fp == nullptr) return (false);
+
+	bool ok = (1 == fread (&header, sizeof(header), 1, fp ));
+	ok = ok && (header.magic == ENV_TRACK_MAGIC) && (header.version == ENV_TRACK_VERSION);
+	ok = ok && (header.blockSamples == EYE_AVG_SIZE)
+			&& (header.jawBlocks == JAW_AVG_SIZE / EYE_AVG_SIZE);
+	ok = ok && (header.sourceSize == fileSize (soundFile ));
+	ok = ok && (header.eyePeak > 0) && (header.jawPeak > 0);
+	if (!ok)
+	{
+		ESP_LOGW(TAG, "Ignoring %s - out of date (run prescan again)", name );
+		close ();
+		return (false);
+	}
+	bufCount = 0;
+	bufPos = 0;
+	return (true);
+}
+
+
+/**
+ * Get the levels for the next block.
+ * @return false at the end of the track.
+ */
+bool EnvelopeTrack::next (EnvBlock *block)
+{
+	if (fp == nullptr) return (false);
+	if (bufPos >= bufCount)
+	{
+		bufCount = fread (buf, sizeof(EnvBlock), ENV_TRACK_BUF_BLOCKS, fp );
+		bufPos = 0;
+		if (bufCount <= 0) return (false);
+	}
+	*block = buf[bufPos++];
+	return (true);
+}
+
+
+/**
+ * Go to a block (to play from part way through the file).
+ * @return false if it is past the end.
+ */
+bool EnvelopeTrack::seek (uint32_t block)
+{
+	if (fp == nullptr) return (false);
+	bufCount = 0;
+	bufPos = 0;
+	if (block >= header.blockCount) return (false);
+	return (0 == fseek (fp, sizeof(header) + block * sizeof(EnvBlock), SEEK_SET ));
+}
+
+
+void EnvelopeTrack::close ()
+{
+	if (fp != nullptr) fclose (fp );
+	fp = nullptr;
+}
@@ -0,0 +1,95 @@
+/**
+ * EnvelopeTrack.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ * An envelope (control) track - the eye and jaw levels for a sound file,
+ * worked out ahead of time by a 'prescan' (see SndPlayer::prescan), and
+ * kept next to the sound file (DaysMono.mp3 -> DaysMono.env).
+ *
+ * While playing, SndPlayer reads the levels from here instead of averaging
+ * every sample - and because the track knows the loudest level in the whole
+ * file, it can scale the eyes and jaw the same way for every file.
+ *
+ * FILE FORMAT (little endian):
+ *    EnvTrackHeader
+ *    EnvBlock x blockCount  - one for every 'blockSamples' samples.
+ *
+ * A track is ignored (and the levels are worked out while playing, as
+ * before) if it is missing, if the sound file has changed size since it
+ * was made, or if EYE_AVG_SIZE or JAW_AVG_SIZE have changed. (Make it
+ * again after changing the ENV_... settings in config.h.)
+ */
+
+#ifndef MAIN_AUDIO_ENVELOPETRACK_H_
+#define MAIN_AUDIO_ENVELOPETRACK_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#define ENV_TRACK_MAGIC   0x56454B53   // "SKEV"
+#define ENV_TRACK_VERSION 2
+
+// How many blocks we read or write at a time
+#define ENV_TRACK_BUF_BLOCKS 64
+
+struct EnvTrackHeader
+{
+	uint32_t magic;
+	uint16_t version;
+	uint16_t blockSamples;  // Samples per block (EYE_AVG_SIZE)
+	uint16_t jawBlocks;     // Blocks per jaw update (JAW_AVG_SIZE / EYE_AVG_SIZE)
+	uint16_t reserved;
+	uint32_t sampleRate;
+	uint32_t blockCount;
+	uint32_t sourceSize;    // Size of the sound file, in bytes
+	uint16_t eyePeak;       // Loudest eye level in the file
+	uint16_t jawPeak;       // Loudest jaw level in the file
+	uint16_t eyeMean;       // Average eye level
+	uint16_t jawMean;       // Average jaw level
+};
+
+// The levels at the end of one block (see EnvelopeFollower.h).
+struct EnvBlock
+{
+	uint16_t eye;   // the eye follower
+	uint16_t jaw;   // the jaw follower (the player uses every 'jawBlocks'th one)
+};
+
+class EnvelopeTrack
+{
+public:
+	EnvelopeTrack ();
+	~EnvelopeTrack ();
+
+	static void trackName(const char *soundFile, char *name, size_t len);
+
+	// Making a track (prescan)
+	bool create(const char *soundFile, uint32_t sampleRate);
+	bool add(uint16_t eye, uint16_t jaw);
+	bool finish();
+
+	// Playing a track
+	bool open(const char *soundFile);
+	bool next(EnvBlock *block);
+	bool seek(uint32_t block);
+	void close();
+	bool isOpen() const { return (fp != nullptr); }
+	const EnvTrackHeader &info() const { return (header); }
+
+private:
+	FILE *fp;
+	EnvTrackHeader header;
+	uint64_t eyeSum;
+	uint64_t jawSum;
+	EnvBlock buf[ENV_TRACK_BUF_BLOCKS];
+	int bufCount;
+	int bufPos;
+
+	static uint32_t fileSize(const char *fileName);
+	bool flush();
+};
+
+#endif /* MAIN_AUDIO_ENVELOPETRACK_H_ */
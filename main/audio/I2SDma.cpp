@@ -0,0 +1,39 @@
+#include "../audio/I2SDma.h"
+
+#include <esp_log.h>
+
+static const char *TAG = "I2SDMA";
+
+// (see I2SDma.h - the driver won't let us at its DMA buffers)
+static int16_t staging[I2S_NUM_MAX][I2S_DMA_STAGING_BYTES / sizeof(int16_t)];
+static size_t leased[I2S_NUM_MAX];
+
+int16_t *i2s_dma_lease(i2s_port_t port, size_t bytes, size_t *granted, TickType_t ticks_to_wait)
+{
+  if ((port < I2S_NUM_0) || (port >= I2S_NUM_MAX))
+  {
+    *granted = 0;
+    return nullptr;
+  }
+  *granted = (bytes < I2S_DMA_STAGING_BYTES) ? bytes : I2S_DMA_STAGING_BYTES;
+  leased[port] = *granted;
+  return staging[port];
+}
+
+esp_err_t i2s_dma_commit(i2s_port_t port, size_t bytes)
+{
+  if ((port < I2S_NUM_0) || (port >= I2S_NUM_MAX) || (bytes > leased[port]))
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+  leased[port] = 0;
+  // this will block until there is room in the DMA buffers
+  size_t bytes_written = 0;
+  esp_err_t err = i2s_write(port, staging[port], bytes, &bytes_written, portMAX_DELAY);
+  if ((err == ESP_OK) && (bytes_written != bytes))
+  {
+    ESP_LOGE(TAG, "Did not write all bytes");
+    err = ESP_FAIL;
+  }
+  return err;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <freertos/FreeRTOS.h>
+#include <driver/i2s.h>
+
+/**
+ * Writing straight into the I2S DMA buffers - for code that can make its
+ * samples in the format the DMA wants (see Output::lease), so each sample
+ * is only written once:
+ *
+ *   buf = i2s_dma_lease(port, bytes, &granted, wait);  ...fill 'granted' bytes...
+ *   i2s_dma_commit(port, used);   // used <= granted
+ *
+ * 'granted' may be less than asked for - no more than is left in the DMA
+ * buffer being filled (and zero if the port isn't installed). Nothing else
+ * (i2s_write included) may write to the port until the lease is committed.
+ *
+ * On the host the shim leases from a simulated DMA ring, and counts what
+ * was written in place against what i2s_write copied in (see HostI2S.h).
+ * The IDF v4.2 driver keeps its DMA buffers to itself - on the ESP32 the
+ * lease is a staging buffer, and the commit copies it in with i2s_write.
+ */
+
+// the most the ESP32 version leases at once (256 stereo frames)
+#define I2S_DMA_STAGING_BYTES 1024
+
+int16_t *i2s_dma_lease(i2s_port_t port, size_t bytes, size_t *granted, TickType_t ticks_to_wait);
+esp_err_t i2s_dma_commit(i2s_port_t port, size_t bytes);
@@ -1,7 +1,10 @@
 #include "freertos/FreeRTOS.h"
 #include "esp_intr_alloc.h"
+#include <esp_log.h>
 #include "Output.h"
 #include "../audio/I2SOutput.h"
+
+static const char *TAG = "I2S";
 /*
  *  I2SOutput(i2s_port_t i2s_port, i2s_pin_config_t &i2s_pins);
  */
@@ -10,18 +13,25 @@ I2SOutput::I2SOutput(i2s_port_t i2s_port, i2s_pin_config_t &i2s_pins) : Output(i
 }
 
 
-void I2SOutput::start(int sample_rate)
+void I2SOutput::start(int sample_rate, int channels)
 {
+    // for a mono file only the left channel goes in the DMA buffers - the
+    // I2S hardware sends it to both sides, so we move half as much data
+    m_channels = (channels == 1) ? 1 : 2;
+    m_geometry = plan(sample_rate, m_channels, m_policy);
+    ESP_LOGI(TAG, "%d Hz, %d channel(s): %d DMA buffers of %d frames - %u usec latency",
+             sample_rate, m_channels, m_geometry.buf_count, m_geometry.buf_len, m_geometry.latency_usec);
+
     // i2s config for writing both channels of I2S
     i2s_config_t i2s_config = {
         .mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_TX),
         .sample_rate = sample_rate,
         .bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT,
-        .channel_format = I2S_CHANNEL_FMT_RIGHT_LEFT,
+        .channel_format = (m_channels == 1) ? I2S_CHANNEL_FMT_ONLY_LEFT : I2S_CHANNEL_FMT_RIGHT_LEFT,
         .communication_format = I2S_COMM_FORMAT_STAND_I2S,
         .intr_alloc_flags = ESP_INTR_FLAG_LEVEL1,
-        .dma_buf_count = 4,
-        .dma_buf_len = 1024,
+        .dma_buf_count = m_geometry.buf_count,
+        .dma_buf_len = m_geometry.buf_len,
         .use_apll = false,
         .tx_desc_auto_clear = true,
         .fixed_mclk = 0,
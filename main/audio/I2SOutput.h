@@ -12,5 +12,5 @@ private:
 
 public:
     I2SOutput(i2s_port_t i2s_port, i2s_pin_config_t &i2s_pins);
-    void start(int sample_rate);
+    void start(int sample_rate, int channels = 2);
 };
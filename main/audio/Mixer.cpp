@@ -0,0 +1,149 @@
+/**
+ * Mixer.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ */
+
+#include <string.h>
+#include "esp_log.h"
+#include "Mixer.h"
+
+static const char *TAG = "MIXER:";
+
+Mixer::Mixer ()
+{
+	reset ();
+}
+
+
+/**
+ * Stop all the voices.
+ */
+void Mixer::reset ()
+{
+	for (int idx = 0; idx < MIXER_VOICES; idx++ )
+	{
+		voices[idx].pcm = nullptr;
+		voices[idx].frames = 0;
+		voices[idx].pos = 0;
+		voices[idx].gain = 0;
+	}
+}
+
+
+int Mixer::start (const int16_t *pcm, int frames, int32_t gain)
+{
+	if (gain < 0) gain = 0;
+	if (gain > MIXER_MAX_GAIN) gain = MIXER_MAX_GAIN;
+
+	int use = 0;
+	for (int idx = 0; idx < MIXER_VOICES; idx++ )
+	{
+		if (voices[idx].pcm == nullptr)
+		{
+			use = idx;
+			break;
+		}
+		if (voices[idx].pos > voices[use].pos) use = idx;
+	}
+	if (voices[use].pcm != nullptr)
+	{
+		ESP_LOGD(TAG, "All voices busy - voice %d cut short", use );
+	}
+
+	voices[use].pcm = pcm;
+	voices[use].frames = frames;
+	voices[use].pos = 0;
+	voices[use].gain = gain;
+	return (use);
+}
+
+
+int Mixer::active () const
+{
+	int count = 0;
+	for (int idx = 0; idx < MIXER_VOICES; idx++ )
+	{
+		if (voices[idx].pcm != nullptr) count++;
+	}
+	return (count);
+}
+
+
+bool Mixer::uses (const int16_t *pcm) const
+{
+	for (int idx = 0; idx < MIXER_VOICES; idx++ )
+	{
+		if (voices[idx].pcm == pcm) return (true);
+	}
+	return (false);
+}
+
+
+/**
+ * Add the next 'frames' of one voice to the accumulator (to both sides,
+ * if it is stereo).
+ */
+template<int CHANNELS>
+void Mixer::addVoice (MixerVoice *voice, int frames)
+{
+	int count = voice->frames - voice->pos;
+	if (count > frames) count = frames;
+	const int16_t *__restrict in = &voice->pcm[voice->pos];
+	int32_t *__restrict sum = acc;
+	const int32_t gain = voice->gain;
+
+	for (int idx = 0; idx < count; idx++ )
+	{
+		int32_t sample = (in[idx] * gain) >> 15;
+		for (int ch = 0; ch < CHANNELS; ch++ )
+		{
+			sum[idx * CHANNELS + ch] += sample;
+		}
+	}
+
+	voice->pos += count;
+	if (voice->pos >= voice->frames) voice->pcm = nullptr;  // Finished
+}
+
+
+const int16_t *Mixer::mix (const int16_t *in, int frames, int channels)
+{
+	if (active () == 0) return (in);
+
+	int samples = frames * channels;
+	if (samples > MIXER_MAX_SAMPLES)
+	{
+		ESP_LOGE(TAG, "Too many samples to mix (%d) - not mixed", samples );
+		return (in);
+	}
+
+	// The music...
+	const int16_t *__restrict music = in;
+	int32_t *__restrict sum = acc;
+	for (int idx = 0; idx < samples; idx++ )
+	{
+		sum[idx] = music[idx];
+	}
+
+	// ...plus each voice...
+	for (int idx = 0; idx < MIXER_VOICES; idx++ )
+	{
+		if (voices[idx].pcm == nullptr) continue;
+		if (channels == 2) addVoice<2> (&voices[idx], frames );
+		else addVoice<1> (&voices[idx], frames );
+	}
+
+	// ...clipped back to 16 bits.
+	int16_t *__restrict dest = out;
+	for (int idx = 0; idx < samples; idx++ )
+	{
+		int32_t sample = sum[idx];
+		sample = (sample > 32767) ? 32767 : sample;
+		sample = (sample < -32768) ? -32768 : sample;
+		dest[idx] = (int16_t) sample;
+	}
+	return (out);
+}
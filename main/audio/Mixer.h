@@ -0,0 +1,79 @@
+/**
+ * Mixer.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ * Mixes short sounds (laughs, creaks... - see SfxBank.h) over the music,
+ * in the output stage, just before Output::write.
+ *
+ * There are MIXER_VOICES voices. Each one plays a mono sound, already at
+ * the output rate, once through, at its own gain (Q15). The music and the
+ * voices are added up in 32 bits, and only clipped back to 16 bits at the
+ * end - so two loud sounds together saturate, rather than wrap round.
+ *
+ * Each step is a plain loop over the whole block (music in, each voice in
+ * turn, clip out), on arrays that don't overlap - so a compiler that
+ * vectorizes can use SIMD for them. On the host gcc 12 only does at -O3:
+ * 4 voices take about half the time that they do at -O2 (host/bench/
+ * MixerBench.cpp). The ESP32 has no SIMD - it just gets tight loops.
+ *
+ * With no voices playing, 'mix' gives back the music as it is - no cost.
+ *
+ * Only the output stage uses it - no locking.
+ */
+
+#ifndef MAIN_AUDIO_MIXER_H_
+#define MAIN_AUDIO_MIXER_H_
+
+#include <stdint.h>
+#include "../config.h"
+#include "minimp3.h"
+
+// gain is Q15 - this is 1.0
+#define MIXER_UNITY_GAIN 32768
+// (any more, and a full scale sample times the gain won't fit in 32 bits)
+#define MIXER_MAX_GAIN   (2 * MIXER_UNITY_GAIN)
+
+// The most samples 'mix' takes at once (a decoded frame)
+#define MIXER_MAX_SAMPLES MINIMP3_MAX_SAMPLES_PER_FRAME
+// The player writes this many frames at a time, so an effect doesn't wait
+// for a whole decoded frame (72 msec at 8 kHz) before it can start.
+#define MIXER_BLOCK 256
+
+struct MixerVoice
+{
+	const int16_t *pcm;   // nullptr - not playing
+	int frames;
+	int pos;              // The next frame to play
+	int32_t gain;
+};
+
+class Mixer
+{
+public:
+	Mixer ();
+
+	void reset();
+	// Start a sound - on a free voice, or instead of the one that has
+	// played the longest. @return the voice
+	int start(const int16_t *pcm, int frames, int32_t gain);
+	// How many voices are playing
+	int active() const;
+	// Is a voice playing this sound? (so it can't be unloaded)
+	bool uses(const int16_t *pcm) const;
+
+	// Add the voices to 'frames' frames of music.
+	// @return the mixed samples (until the next 'mix'), or 'in' if no
+	//         voices are playing.
+	const int16_t *mix(const int16_t *in, int frames, int channels);
+
+private:
+	MixerVoice voices[MIXER_VOICES];
+	int32_t acc[MIXER_MAX_SAMPLES];
+	int16_t out[MIXER_MAX_SAMPLES];
+
+	template<int CHANNELS> void addVoice(MixerVoice *voice, int frames);
+};
+
+#endif /* MAIN_AUDIO_MIXER_H_ */
@@ -0,0 +1,35 @@
+/**
+ * Mp3Decoder.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ */
+
+#define MINIMP3_IMPLEMENTATION
+#define MINIMP3_ONLY_MP3
+#define MINIMP3_NO_STDIO
+#include "minimp3.h"
+#include "Mp3Decoder.h"
+
+Mp3Decoder::Mp3Decoder ()
+{
+	mp3dec_init (&mp3d );
+}
+
+
+void Mp3Decoder::start (const AudioFormat *format, uint32_t offset)
+{
+	mp3dec_init (&mp3d );
+}
+
+
+int Mp3Decoder::decode (const uint8_t *input, size_t len, int16_t *pcm, DecodeInfo *info)
+{
+	mp3dec_frame_info_t frame = { };
+	int samples = mp3dec_decode_frame (&mp3d, input, len, pcm, &frame );
+	info->bytes = frame.frame_bytes;
+	info->channels = frame.channels;
+	info->hz = frame.hz;
+	return (samples);
+}
@@ -0,0 +1,31 @@
+/**
+ * Mp3Decoder.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ * MP3 (layer III) - minimp3. This needs a big stack (about 16K of scratch
+ * space while decoding), even just to find the frames.
+ */
+
+#ifndef MAIN_AUDIO_MP3DECODER_H_
+#define MAIN_AUDIO_MP3DECODER_H_
+
+#include "Decoder.h"
+#include "minimp3.h"
+
+class Mp3Decoder : public Decoder
+{
+public:
+	Mp3Decoder ();
+
+	virtual void start(const AudioFormat *format, uint32_t offset);
+	virtual int decode(const uint8_t *input, size_t len, int16_t *pcm, DecodeInfo *info);
+	virtual bool hasReservoir() { return (true); }
+	virtual const char *name() { return ("MP3"); }
+
+private:
+	mp3dec_t mp3d;
+};
+
+#endif /* MAIN_AUDIO_MP3DECODER_H_ */
@@ -3,20 +3,16 @@
 
 #include <esp_log.h>
 #include <driver/i2s.h>
+#include "../audio/I2SDma.h"
 
 static const char *TAG = "OUT";
 
-// number of frames to try and send at once (a frame is a left and right sample)
-const int NUM_FRAMES_TO_SEND = 256;
-
 Output::Output(i2s_port_t i2s_port) : m_i2s_port(i2s_port)
 {
-  frames_buffer = (int16_t *)malloc(2 * sizeof(int16_t) * NUM_FRAMES_TO_SEND);
 }
 
 Output::~Output()
 {
-  free(frames_buffer);
 }
 
 void Output::stop()
@@ -26,29 +22,197 @@ void Output::stop()
   i2s_driver_uninstall(m_i2s_port);
 }
 
-void Output::write(int16_t *samples, int frames)
+// the target latency and fewest buffers for each LatencyPolicy
+static const struct
 {
-  // this will contain the prepared samples for sending to the I2S device
-  int frame_index = 0;
-  while (frame_index < frames)
+  int latency_msec;
+  int min_buffers;
+} latency_targets[] = {
+    {30, 3},  // LATENCY_LOW
+    {100, 4}, // LATENCY_BALANCED
+    {500, 4}, // LATENCY_THROUGHPUT
+};
+
+// the driver's limits
+const int MIN_DMA_BUF_LEN = 16;
+const int MAX_DMA_BUF_LEN = 1024;
+const int MAX_DMA_BUF_BYTES = 4092;
+const int MAX_DMA_BUF_COUNT = 128;
+
+/**
+ * Split the target latency for the policy into DMA buffers - as few as the
+ * policy allows, but no bigger than the driver can handle.
+ */
+DmaGeometry Output::plan(int sample_rate, int channels, LatencyPolicy policy)
+{
+  DmaGeometry geometry;
+  int max_len = MAX_DMA_BUF_BYTES / (channels * sizeof(int16_t));
+  if (max_len > MAX_DMA_BUF_LEN)
+    max_len = MAX_DMA_BUF_LEN;
+
+  int frames = sample_rate * latency_targets[policy].latency_msec / 1000;
+  int count = latency_targets[policy].min_buffers;
+  int len = (frames + count - 1) / count;
+  while ((len > max_len) && (count < MAX_DMA_BUF_COUNT))
   {
-    // fill up the frames buffer with the next NUM_FRAMES_TO_SEND frames
-    int frames_to_send = 0;
-    for (int i = 0; i < NUM_FRAMES_TO_SEND && frame_index < frames; i++)
+    count++;
+    len = (frames + count - 1) / count;
+  }
+  if (len > max_len)
+    len = max_len;
+  if (len < MIN_DMA_BUF_LEN)
+    len = MIN_DMA_BUF_LEN;
+
+  geometry.buf_count = count;
+  geometry.buf_len = len;
+  geometry.latency_usec = (uint32_t)((uint64_t)count * len * 1000000 / sample_rate);
+  return geometry;
+}
+
+void Output::set_volume(float volume)
+{
+  this->volume = volume;
+  int32_t gain = int32_t(volume * OUTPUT_UNITY_GAIN + 0.5f);
+  m_gain = (gain < 0) ? 0 : (gain > OUTPUT_MAX_GAIN) ? OUTPUT_MAX_GAIN : gain;
+}
+
+// -32768 * OUTPUT_MAX_GAIN is the biggest product - it must fit in the int32_t
+static_assert(-32768LL * OUTPUT_MAX_GAIN >= INT32_MIN, "OUTPUT_MAX_GAIN is too big for convert_kernel");
+
+/**
+ * The conversion kernel - gain (Q15), clip, and (for the DAC) offset.
+ * A plain loop with no calls or branches, so the compiler can unroll or
+ * vectorise it. One copy is made for each format / channel layout.
+ *   IN_STRIDE - 2 to take only the left of stereo samples
+ *   DUP       - write every sample twice (mono in, stereo out)
+ */
+template <bool UNSIGNED, int IN_STRIDE, bool DUP>
+static void convert_kernel(const int16_t *in, int16_t *out, int count, int32_t gain)
+{
+  for (int i = 0; i < count; i++)
+  {
+    int32_t v = (in[i * IN_STRIDE] * gain) >> 15;
+    v = (v < -32768) ? -32768 : (v > 32767) ? 32767 : v;
+    // flipping the top bit is the same as adding 32768 to make it unsigned
+    int16_t sample = UNSIGNED ? int16_t(v ^ 0x8000) : int16_t(v);
+    if (DUP)
     {
-      int left_sample = process_sample(volume * float(samples[frame_index * 2]));
-      int right_sample = process_sample(volume * float(samples[frame_index * 2 + 1]));
-      frames_buffer[i * 2] = left_sample;
-      frames_buffer[i * 2 + 1] = right_sample;
-      frames_to_send++;
-      frame_index++;
+      out[i * 2] = sample;
+      out[i * 2 + 1] = sample;
     }
-    // write data to the i2s peripheral - this will block until the data is sent
+    else
+    {
+      out[i] = sample;
+    }
+  }
+}
+
+template <bool UNSIGNED>
+static void convert_layout(const int16_t *in, int16_t *out, int frames, int in_channels,
+                           int out_channels, int32_t gain)
+{
+  if (in_channels == out_channels)
+    convert_kernel<UNSIGNED, 1, false>(in, out, frames * out_channels, gain);
+  else if (in_channels == 1)
+    convert_kernel<UNSIGNED, 1, true>(in, out, frames, gain);
+  else
+    convert_kernel<UNSIGNED, 2, false>(in, out, frames, gain);
+}
+
+void Output::convert_block(const int16_t *in, int16_t *out, int frames, int channels)
+{
+  switch (m_format)
+  {
+  case SAMPLE_SIGNED_16:
+    convert_layout<false>(in, out, frames, channels, m_channels, m_gain);
+    break;
+  case SAMPLE_UNSIGNED_16:
+    convert_layout<true>(in, out, frames, channels, m_channels, m_gain);
+    break;
+  default:
+    // the slow way - for outputs we don't have a kernel for
+    for (int i = 0; i < frames; i++)
+    {
+      for (int c = 0; c < m_channels; c++)
+      {
+        int16_t sample = in[i * channels + ((c < channels) ? c : 0)];
+        out[i * m_channels + c] = process_sample(volume * float(sample));
+      }
+    }
+    break;
+  }
+}
+
+/**
+ * Get somewhere to put up to 'frames' frames, already in the DMA format
+ * (m_channels samples per frame, see convert_block) - in the DMA buffers
+ * themselves if the driver allows it. Nothing else may be written until it
+ * is committed. Zero frames granted if the output isn't started.
+ */
+int16_t *Output::lease(int frames, int *granted)
+{
+  size_t frame_bytes = sizeof(int16_t) * m_channels;
+  size_t bytes = 0;
+  int16_t *buf = i2s_dma_lease(m_i2s_port, frames * frame_bytes, &bytes, portMAX_DELAY);
+  *granted = (buf == nullptr) ? 0 : (int)(bytes / frame_bytes);
+  m_leased = *granted;
+  return buf;
+}
+
+// Send the first 'frames' frames from the leased buffer
+void Output::commit(int frames)
+{
+  if (frames > m_leased)
+  {
+    ESP_LOGE(TAG, "Committed %d frames - only %d were leased", frames, m_leased);
+    frames = m_leased;
+  }
+  m_leased = 0;
+  if (frames <= 0)
+  {
+    return;
+  }
+  if (i2s_dma_commit(m_i2s_port, frames * sizeof(int16_t) * m_channels) != ESP_OK)
+  {
+    ESP_LOGE(TAG, "Could not commit %d frames", frames);
+    return;
+  }
+  m_frames_converted += frames;
+}
+
+void Output::write(const int16_t *samples, int frames, int channels)
+{
+  // if the samples are already what the DMA wants (signed, full volume, and
+  // the same channels) the driver can copy them straight from the decoder -
+  // that copy is the only time they are touched
+  if (is_passthrough(channels))
+  {
     size_t bytes_written = 0;
-    i2s_write(m_i2s_port, frames_buffer, frames_to_send * sizeof(int16_t) * 2, &bytes_written, portMAX_DELAY);
-    if (bytes_written != frames_to_send * sizeof(int16_t) * 2)
+    size_t bytes_to_send = frames * sizeof(int16_t) * channels;
+    i2s_write(m_i2s_port, samples, bytes_to_send, &bytes_written, portMAX_DELAY);
+    if (bytes_written != bytes_to_send)
     {
       ESP_LOGE(TAG, "Did not write all bytes");
     }
+    m_frames_direct += frames;
+    return;
+  }
+
+  // if the output was started mono the hardware sends each sample to both
+  // sides - otherwise convert_block puts it in both sides of the frame
+  int frame_index = 0;
+  while (frame_index < frames)
+  {
+    // convert the next frames straight into a leased buffer
+    int frames_to_send;
+    int16_t *out = lease(frames - frame_index, &frames_to_send);
+    if (frames_to_send == 0)
+    {
+      ESP_LOGE(TAG, "Output not started - %d frames dropped", frames - frame_index);
+      return;
+    }
+    convert_block(samples + frame_index * channels, out, frames_to_send, channels);
+    commit(frames_to_send);
+    frame_index += frames_to_send;
   }
 }
@@ -3,6 +3,38 @@
 #include <freertos/FreeRTOS.h>
 #include <driver/i2s.h>
 
+// What the output device wants in its DMA buffers
+enum SampleFormat
+{
+  SAMPLE_SIGNED_16,   // signed 16 bit - I2S
+  SAMPLE_UNSIGNED_16, // unsigned 16 bit (offset by 32768) - the built in DAC
+  SAMPLE_CUSTOM       // call process_sample for every sample (slow!)
+};
+
+// How much audio to keep queued up in the DMA buffers. Less is a shorter
+// delay from writing a sample to hearing it (and to the jaw moving with it),
+// more is fewer interrupts and more time before an underrun is heard.
+enum LatencyPolicy
+{
+  LATENCY_LOW,        // about 30 msec
+  LATENCY_BALANCED,   // about 100 msec
+  LATENCY_THROUGHPUT  // about 500 msec (what we used to have)
+};
+
+// The DMA buffers for a sample rate (see Output::plan)
+struct DmaGeometry
+{
+  int buf_count;
+  int buf_len;           // in frames
+  uint32_t latency_usec; // how long all the buffers take to play
+};
+
+// volume is Q15 - this is 1.0
+#define OUTPUT_UNITY_GAIN 32768
+// no more than 2.0 - so a sample times the gain still fits in 32 bits
+// (as in Mixer.h)
+#define OUTPUT_MAX_GAIN (2 * OUTPUT_UNITY_GAIN)
+
 /**
  * Base Class for both the DAC and I2S output
  **/
@@ -11,23 +43,62 @@ class Output
 protected:
   i2s_port_t m_i2s_port = I2S_NUM_0;
 
-  int16_t *frames_buffer;
   float volume = 1.0f;
+  int32_t m_gain = OUTPUT_UNITY_GAIN;
+  // channels in the DMA buffer - 1 if the hardware duplicates a mono channel
+  int m_channels = 2;
+  // set this in derived classes (if process_sample is overridden)
+  SampleFormat m_format = SAMPLE_SIGNED_16;
+  // how the frames got to the driver
+  uint32_t m_frames_direct = 0;
+  uint32_t m_frames_converted = 0;
+  LatencyPolicy m_policy = LATENCY_BALANCED;
+  // what 'start' set up
+  DmaGeometry m_geometry = {0, 0, 0};
+  // frames granted by the last 'lease' (and not yet committed)
+  int m_leased = 0;
 
 public:
   Output(i2s_port_t i2s_port);
   virtual ~Output();
-  virtual void start(int sample_rate) = 0;
+  // channels is what the file has - 1 or 2
+  virtual void start(int sample_rate, int channels = 2) = 0;
   void stop();
   // override this in derived classes to turn the sample into
   // something the output device expects - for the default case
-  // this is simply a pass through
+  // this is simply a pass through. Only used for SAMPLE_CUSTOM.
   virtual uint16_t process_sample(int16_t sample) { return sample; }
   // NOTE - a frame consists of both a left and a right sample
-  void write(int16_t *samples, int frames);
-  // set the volume between 0 and 4096
-  void set_volume(float volume)
+  void write(int16_t *samples, int frames) { write(samples, frames, 2); }
+  // a frame is one sample - it goes to both sides
+  void write_mono(const int16_t *samples, int frames) { write(samples, frames, 1); }
+  // a frame is 'channels' samples
+  void write(const int16_t *samples, int frames, int channels);
+  // turn 'frames' frames of 'channels' samples into what goes in the DMA buffers
+  void convert_block(const int16_t *in, int16_t *out, int frames, int channels);
+  // for code that can make its samples in the DMA format - straight into
+  // the DMA buffers, where the driver allows it (see I2SDma.h):
+  //   buf = lease(frames, &granted);  ...fill in 'granted' frames...  commit(granted);
+  // (granted may be fewer than asked for; commit may send fewer than were
+  // granted - never more)
+  int16_t *lease(int frames, int *granted);
+  void commit(int frames);
+  // true if samples like these can go to the driver just as they are
+  bool is_passthrough(int channels) const
   {
-    this->volume = volume;
+    return (m_format == SAMPLE_SIGNED_16) && (m_gain == OUTPUT_UNITY_GAIN) && (channels == m_channels);
   }
+  int channels() const { return m_channels; }
+  uint32_t get_frames_direct() const { return m_frames_direct; }
+  uint32_t get_frames_converted() const { return m_frames_converted; }
+  void reset_counters() { m_frames_direct = 0; m_frames_converted = 0; }
+  // work out the DMA buffers for a sample rate
+  static DmaGeometry plan(int sample_rate, int channels, LatencyPolicy policy);
+  // takes effect at the next 'start'
+  void set_latency_policy(LatencyPolicy policy) { m_policy = policy; }
+  // the delay from 'write' to the speaker, when the buffers are full (0 if not started)
+  uint32_t get_latency_usec() const { return m_geometry.latency_usec; }
+  const DmaGeometry &get_geometry() const { return m_geometry; }
+  // set the volume - 1.0 is as it is (up to 2.0)
+  void set_volume(float volume);
 };
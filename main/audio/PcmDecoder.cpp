@@ -0,0 +1,50 @@
+/**
+ * PcmDecoder.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ */
+
+#include <string.h>
+#include "PcmDecoder.h"
+
+PcmDecoder::PcmDecoder ()
+{
+	memset (&fmt, 0, sizeof(fmt) );
+	remaining = 0;
+}
+
+
+void PcmDecoder::start (const AudioFormat *format, uint32_t offset)
+{
+	fmt = *format;
+	remaining = (offset < fmt.dataEnd) ? fmt.dataEnd - offset : 0;
+}
+
+
+int PcmDecoder::decode (const uint8_t *input, size_t len, int16_t *pcm, DecodeInfo *info)
+{
+	info->channels = fmt.channels;
+	info->hz = fmt.hz;
+
+	if (len > remaining) len = remaining;
+	int samples = len / fmt.blockAlign;
+	if (samples > PCM_FRAME_SAMPLES) samples = PCM_FRAME_SAMPLES;
+	info->bytes = samples * fmt.blockAlign;
+	remaining -= info->bytes;
+	if (pcm == nullptr) return (samples);
+
+	if (fmt.bitsPerSample == 16)
+	{	// (WAV is little endian - like us)
+		memcpy (pcm, input, info->bytes );
+	}
+	else
+	{	// 8 bit is unsigned
+		for (int idx = 0; idx < info->bytes; idx++ )
+		{
+			pcm[idx] = (int16_t) ((input[idx] - 128) << 8);
+		}
+	}
+	return (samples);
+}
@@ -0,0 +1,35 @@
+/**
+ * PcmDecoder.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ * Plain PCM in a WAV file (8 bit unsigned, or 16 bit signed). There is
+ * nothing to decode - 16 bit samples are just copied - so it costs almost
+ * nothing, but takes 2 bytes of flash for every sample.
+ */
+
+#ifndef MAIN_AUDIO_PCMDECODER_H_
+#define MAIN_AUDIO_PCMDECODER_H_
+
+#include "Decoder.h"
+
+// Samples (per channel) in a 'frame' - so a stereo 16 bit frame is no
+// more than AUDIO_WINDOW_GUARD bytes.
+#define PCM_FRAME_SAMPLES 576
+
+class PcmDecoder : public Decoder
+{
+public:
+	PcmDecoder ();
+
+	virtual void start(const AudioFormat *format, uint32_t offset);
+	virtual int decode(const uint8_t *input, size_t len, int16_t *pcm, DecodeInfo *info);
+	virtual const char *name() { return ("PCM"); }
+
+private:
+	AudioFormat fmt;
+	uint32_t remaining;  // Bytes of sound left in the file
+};
+
+#endif /* MAIN_AUDIO_PCMDECODER_H_ */
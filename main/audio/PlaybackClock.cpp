@@ -0,0 +1,212 @@
+/**
+ * PlaybackClock.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ */
+
+#include "esp_timer.h"
+#include "../config.h"
+#include "../Sequencer/SwitchBoard.h"
+#include "../MotionSequencer.h"
+#include "PlaybackClock.h"
+
+std::atomic<uint32_t> PlaybackClock::seq(0);
+std::atomic<bool> PlaybackClock::running(false);
+std::atomic<uint32_t> PlaybackClock::sampleRate(0);
+std::atomic<uint32_t> PlaybackClock::latencyUsec(0);
+std::atomic<uint32_t> PlaybackClock::latencyFrames(0);
+std::atomic<uint32_t> PlaybackClock::written(0);
+std::atomic<uint32_t> PlaybackClock::queued(0);
+std::atomic<uint32_t> PlaybackClock::anchor(0);
+uint32_t PlaybackClock::nextTick = 0;
+
+// usec - wraps after about 71 minutes, which is fine for differences.
+inline uint32_t PlaybackClock::now32 ()
+{
+	return ((uint32_t) esp_timer_get_time ());
+}
+
+
+/**
+ * Samples played at time 'at': everything written, less what was still
+ * queued at the anchor time - plus what has played since then.
+ */
+uint32_t PlaybackClock::played (uint32_t written, uint32_t queued, uint32_t anchor,
+		uint32_t rate, uint32_t at)
+{
+	uint32_t elapsed = at - anchor;
+	uint64_t since = (uint64_t) elapsed * rate / 1000000;
+	if (since > queued) since = queued;   // Ran out (paused, or the decoder is behind)
+	return (written - queued + (uint32_t) since);
+}
+
+
+void PlaybackClock::beginWrite ()
+{
+	seq.store (seq.load (std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+	std::atomic_thread_fence (std::memory_order_release );
+}
+
+
+void PlaybackClock::endWrite ()
+{
+	seq.fetch_add (1, std::memory_order_release );
+}
+
+
+/**
+ * The output has been started (so we know its rate and latency).
+ * @param fromSample - where in the sound we are starting (after a seek)
+ */
+void PlaybackClock::start (uint32_t rate, uint32_t latency, uint32_t fromSample)
+{
+	beginWrite ();
+	running.store (true, std::memory_order_relaxed );
+	sampleRate.store (rate, std::memory_order_relaxed );
+	latencyUsec.store (latency, std::memory_order_relaxed );
+	latencyFrames.store ((uint32_t) ((uint64_t) latency * rate / 1000000), std::memory_order_relaxed );
+	written.store (fromSample, std::memory_order_relaxed );
+	queued.store (0, std::memory_order_relaxed );
+	anchor.store (now32 (), std::memory_order_relaxed );
+	endWrite ();
+
+	// The first tick at or after where we start
+	uint32_t tickSamples = rate * PLAYBACK_TICK_MSEC / 1000;
+	nextTick = (tickSamples == 0) ? fromSample :
+			(fromSample + tickSamples - 1) / tickSamples * tickSamples;
+}
+
+
+/**
+ * 'samples' more have just been written to the output.
+ */
+void PlaybackClock::advance (uint32_t samples)
+{
+	uint32_t at = now32 ();
+	uint32_t w = written.load (std::memory_order_relaxed );
+	uint32_t rate = sampleRate.load (std::memory_order_relaxed );
+	uint32_t p = played (w, queued.load (std::memory_order_relaxed ),
+			anchor.load (std::memory_order_relaxed ), rate, at );
+
+	// 'write' only returns when these are in the DMA buffers - so no more
+	// than the buffers hold can be waiting.
+	w += samples;
+	uint32_t q = w - p;
+	uint32_t maxQueued = latencyFrames.load (std::memory_order_relaxed );
+	if (q > maxQueued) q = maxQueued;
+
+	beginWrite ();
+	written.store (w, std::memory_order_relaxed );
+	queued.store (q, std::memory_order_relaxed );
+	anchor.store (at, std::memory_order_relaxed );
+	endWrite ();
+
+	publishTicks ();
+}
+
+
+void PlaybackClock::stop ()
+{
+	beginWrite ();
+	running.store (false, std::memory_order_relaxed );
+	endWrite ();
+}
+
+
+/**
+ * Get a consistent copy of the clock. Lock-free - any task may call this.
+ */
+void PlaybackClock::read (PlaybackPosition *pos)
+{
+	uint32_t s1, s2;
+	uint32_t w, q, a;
+	do
+	{
+		s1 = seq.load (std::memory_order_acquire );
+		pos->running = running.load (std::memory_order_relaxed );
+		pos->sampleRate = sampleRate.load (std::memory_order_relaxed );
+		pos->latencyUsec = latencyUsec.load (std::memory_order_relaxed );
+		w = written.load (std::memory_order_relaxed );
+		q = queued.load (std::memory_order_relaxed );
+		a = anchor.load (std::memory_order_relaxed );
+		std::atomic_thread_fence (std::memory_order_acquire );
+		s2 = seq.load (std::memory_order_relaxed );
+	} while ((s1 & 1) || (s1 != s2));
+
+	pos->samplesWritten = w;
+	pos->samplesPlayed = played (w, q, a, pos->sampleRate, now32 () );
+	pos->positionMsec = (pos->sampleRate == 0) ? 0 :
+			(uint32_t) ((uint64_t) pos->samplesPlayed * 1000 / pos->sampleRate);
+}
+
+
+uint32_t PlaybackClock::samplesPlayed ()
+{
+	PlaybackPosition pos;
+	read (&pos );
+	return (pos.samplesPlayed);
+}
+
+
+uint32_t PlaybackClock::positionMsec ()
+{
+	PlaybackPosition pos;
+	read (&pos );
+	return (pos.positionMsec);
+}
+
+
+/**
+ * When a sample will be (or was) heard.
+ * @return microseconds since boot, like esp_timer_get_time()
+ */
+TIME_t PlaybackClock::whenHeard (uint32_t sample)
+{
+	uint32_t s1, s2;
+	uint32_t w, q, a, rate;
+	do
+	{
+		s1 = seq.load (std::memory_order_acquire );
+		rate = sampleRate.load (std::memory_order_relaxed );
+		w = written.load (std::memory_order_relaxed );
+		q = queued.load (std::memory_order_relaxed );
+		a = anchor.load (std::memory_order_relaxed );
+		std::atomic_thread_fence (std::memory_order_acquire );
+		s2 = seq.load (std::memory_order_relaxed );
+	} while ((s1 & 1) || (s1 != s2));
+
+	// The first queued sample starts playing at the anchor time
+	int32_t ahead = (int32_t) (sample - (w - q));
+	int64_t offset = (rate == 0) ? 0 : (int64_t) ahead * 1000000 / rate;
+	int64_t now = esp_timer_get_time ();
+	int32_t sinceAnchor = (int32_t) ((uint32_t) now - a);
+	return ((TIME_t) (now - sinceAnchor + offset));
+}
+
+
+/**
+ * Send MOTION_SEQ_TIME for every tick in what has been written so far -
+ * each one timed for when it is heard.
+ */
+void PlaybackClock::publishTicks ()
+{
+	uint32_t rate = sampleRate.load (std::memory_order_relaxed );
+	uint32_t tickSamples = rate * PLAYBACK_TICK_MSEC / 1000;
+	if (tickSamples == 0) return;
+
+	uint32_t w = written.load (std::memory_order_relaxed );
+	bool listening = SwitchBoard::isRegistered (TASK_NAME::MOTIONSEQ );
+	while ((int32_t) (w - nextTick) >= 0)
+	{
+		if (listening)
+		{
+			Message *msg = Message::create_message (TASK_NAME::MOTIONSEQ, TASK_NAME::WAVEFILE,
+					MOTION_SEQ_TIME, nextTick, (uint32_t) ((uint64_t) nextTick * 1000 / rate ),
+					nullptr );
+			SwitchBoard::sendAt (msg, whenHeard (nextTick ) );
+		}
+		nextTick += tickSamples;
+	}
+}
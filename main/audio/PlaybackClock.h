@@ -0,0 +1,84 @@
+/**
+ * PlaybackClock.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ * Where the sound is up to - for anything that has to keep in time with it
+ * (the motion sequencer, the eyes...).
+ *
+ * The player calls 'start' when it starts the output (at 'fromSample', if it
+ * was told to seek), and 'advance' each
+ * time 'Output::write' returns. Samples that have been written are still
+ * in the DMA buffers for a while, so the clock keeps:
+ *   - samples written,
+ *   - how many of those were still queued at the time of the last write
+ *     (the 'anchor' - a time from esp_timer_get_time),
+ * and works out samples PLAYED from how long it has been since then. So
+ * the position moves smoothly between writes, and lags the writes by the
+ * real output latency.
+ *
+ * Any task can 'read' the clock, without locks: it is a sequence lock.
+ * The player (the only writer) makes 'seq' odd while it changes things,
+ * and even again after. A reader copies everything, and tries again if
+ * 'seq' was odd or changed while it was copying.
+ *
+ * Every PLAYBACK_TICK_MSEC (config.h) of sound, a MOTION_SEQ_TIME message
+ * is sent to the motion sequencer (if there is one) - with SwitchBoard::sendAt,
+ * timed for when that sample is heard. 'value' is the sample number and
+ * 'rate' is the position in milliseconds.
+ */
+
+#ifndef MAIN_AUDIO_PLAYBACKCLOCK_H_
+#define MAIN_AUDIO_PLAYBACKCLOCK_H_
+
+#include <stdint.h>
+#include <atomic>
+#include "../Sequencer/Message.h"
+
+// A consistent copy of the clock
+struct PlaybackPosition
+{
+	bool running;
+	uint32_t sampleRate;
+	uint32_t latencyUsec;     // The output latency (buffers full)
+	uint32_t samplesWritten;  // Given to the output
+	uint32_t samplesPlayed;   // Heard (about) - now
+	uint32_t positionMsec;    // samplesPlayed, in milliseconds
+};
+
+class PlaybackClock
+{
+public:
+	// PLAYER
+	static void start(uint32_t sampleRate, uint32_t latencyUsec, uint32_t fromSample = 0);
+	static void advance(uint32_t samples);
+	static void stop();
+
+	// ANYONE
+	static void read(PlaybackPosition *pos);
+	static uint32_t samplesPlayed();
+	static uint32_t positionMsec();
+	static TIME_t whenHeard(uint32_t sample);
+
+private:
+	static std::atomic<uint32_t> seq;
+	static std::atomic<bool> running;
+	static std::atomic<uint32_t> sampleRate;
+	static std::atomic<uint32_t> latencyUsec;
+	static std::atomic<uint32_t> latencyFrames;
+	static std::atomic<uint32_t> written;
+	static std::atomic<uint32_t> queued;     // Not yet played, at 'anchor'
+	static std::atomic<uint32_t> anchor;     // usec (low 32 bits)
+
+	static uint32_t nextTick;   // Player only
+
+	static inline uint32_t now32();
+	static uint32_t played(uint32_t written, uint32_t queued, uint32_t anchor,
+			uint32_t rate, uint32_t at);
+	static void beginWrite();
+	static void endWrite();
+	static void publishTicks();
+};
+
+#endif /* MAIN_AUDIO_PLAYBACKCLOCK_H_ */
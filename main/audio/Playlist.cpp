@@ -0,0 +1,113 @@
+/**
+ * Playlist.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ */
+
+#include "Playlist.h"
+
+#define TAKE_LIST_LOCK xSemaphoreTake( lock, portMAX_DELAY)
+#define GIVE_LIST_LOCK xSemaphoreGive( lock )
+
+Playlist::Playlist ()
+{
+	head = 0;
+	count = 0;
+	lock = xSemaphoreCreateMutexStatic (&lockBuffer );
+}
+
+
+/**
+ * Add a clip to the end.
+ * @return false if the list is full.
+ */
+bool Playlist::enqueue (int id)
+{
+	TAKE_LIST_LOCK;
+	if (count >= PLAYLIST_MAX)
+	{
+		GIVE_LIST_LOCK;
+		return (false);
+	}
+	ids[(head + count) % PLAYLIST_MAX] = id;
+	count++;
+	GIVE_LIST_LOCK;
+	return (true);
+}
+
+
+/**
+ * Take the first clip.
+ * @return false if the list is empty.
+ */
+bool Playlist::dequeue (int *id)
+{
+	TAKE_LIST_LOCK;
+	if (count == 0)
+	{
+		GIVE_LIST_LOCK;
+		return (false);
+	}
+	*id = ids[head];
+	head = (head + 1) % PLAYLIST_MAX;
+	count--;
+	GIVE_LIST_LOCK;
+	return (true);
+}
+
+
+/**
+ * Put a clip back at the front (it was taken, but not played).
+ * @return false if the list is full.
+ */
+bool Playlist::requeue (int id)
+{
+	TAKE_LIST_LOCK;
+	if (count >= PLAYLIST_MAX)
+	{
+		GIVE_LIST_LOCK;
+		return (false);
+	}
+	head = (head + PLAYLIST_MAX - 1) % PLAYLIST_MAX;
+	ids[head] = id;
+	count++;
+	GIVE_LIST_LOCK;
+	return (true);
+}
+
+
+void Playlist::clear ()
+{
+	TAKE_LIST_LOCK;
+	head = 0;
+	count = 0;
+	GIVE_LIST_LOCK;
+}
+
+
+int Playlist::size ()
+{
+	TAKE_LIST_LOCK;
+	int result = count;
+	GIVE_LIST_LOCK;
+	return (result);
+}
+
+
+/**
+ * Copy the waiting clip IDs (first one first).
+ * @return how many were copied.
+ */
+int Playlist::list (int *out, int maxIds)
+{
+	TAKE_LIST_LOCK;
+	int result = (count < maxIds) ? count : maxIds;
+	for (int idx = 0; idx < result; idx++ )
+	{
+		out[idx] = ids[(head + idx) % PLAYLIST_MAX];
+	}
+	GIVE_LIST_LOCK;
+	return (result);
+}
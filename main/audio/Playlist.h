@@ -0,0 +1,41 @@
+/**
+ * Playlist.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ * The clips waiting to be played (by clip ID - see AssetIndex.h), first in,
+ * first out.
+ *
+ * Commands add to it (on the SwitchBoard task) and the player's reader
+ * takes from it, so it has a mutex. It is only touched once per clip.
+ */
+
+#ifndef MAIN_AUDIO_PLAYLIST_H_
+#define MAIN_AUDIO_PLAYLIST_H_
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "../config.h"
+
+class Playlist
+{
+public:
+	Playlist ();
+
+	bool enqueue(int id);
+	bool dequeue(int *id);
+	bool requeue(int id);
+	void clear();
+	int size();
+	int list(int *ids, int maxIds);
+
+private:
+	int ids[PLAYLIST_MAX];
+	int head;   // Next to dequeue
+	int count;
+	SemaphoreHandle_t lock;
+	StaticSemaphore_t lockBuffer;
+};
+
+#endif /* MAIN_AUDIO_PLAYLIST_H_ */
@@ -0,0 +1,217 @@
+/**
+ * Resampler.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ */
+
+#include <string.h>
+#include <math.h>
+#include "esp_log.h"
+#include "Resampler.h"
+
+static const char *TAG = "RESAMPLE:";
+
+// Taps, phases and how close to the lower Nyquist rate the filter goes,
+// for each ResampleQuality.
+static const struct
+{
+	int taps;
+	int phases;
+	float rolloff;
+} presets[] = {
+	{ 2, 256, 1.0f },
+	{ 8, 64, 0.90f },
+	{ 16, 128, 0.94f } };
+
+Resampler::Resampler ()
+{
+	configure (1, 1, 1, RESAMPLE_FAST );
+}
+
+
+/**
+ * Set the rates, and work out the taps. (Floating point - but only here.)
+ */
+void Resampler::configure (int _inRate, int _outRate, int _channels, ResampleQuality quality)
+{
+	inRate = _inRate;
+	outRate = _outRate;
+	channels = (_channels == 2) ? 2 : 1;
+	taps = presets[quality].taps;
+	phases = presets[quality].phases;
+	phaseMul = (uint32_t) (((uint64_t) phases << 32) / outRate);
+	stepWhole = inRate / outRate;
+	stepRem = inRate % outRate;
+	stride = RESAMPLE_WORK / channels;
+
+	// Going down, cut off below the new Nyquist rate.
+	float cutoff = presets[quality].rolloff;
+	if (outRate < inRate) cutoff = cutoff * outRate / inRate;
+	int before = taps / 2 - 1;   // Input samples before the output time
+
+	for (int phase = 0; phase < phases; phase++ )
+	{
+		int16_t *row = &coef[phase * taps];
+		float frac = (float) phase / phases;
+		float h[RESAMPLE_MAX_TAPS];
+		float sum = 0.0f;
+		for (int tap = 0; tap < taps; tap++ )
+		{
+			float d = (tap - before) - frac;  // From the output time, in input samples
+			if (taps == 2)
+			{	// Linear
+				h[tap] = 1.0f - fabsf (d );
+			}
+			else
+			{	// Windowed (Blackman) sinc
+				float x = cutoff * d * (float) M_PI;
+				float sinc = (fabsf (x ) < 1e-6f) ? 1.0f : sinf (x ) / x;
+				float w = (float) M_PI * d / (taps / 2);
+				h[tap] = sinc * (0.42f + 0.5f * cosf (w ) + 0.08f * cosf (2.0f * w ));
+			}
+			sum += h[tap];
+		}
+
+		// Each row adds up to the same (just under 1.0) - so no ripple in the level
+		int total = 0;
+		int biggest = 0;
+		for (int tap = 0; tap < taps; tap++ )
+		{
+			row[tap] = (int16_t) lrintf (h[tap] / sum * 32767.0f );
+			total += row[tap];
+			if (row[tap] > row[biggest]) biggest = tap;
+		}
+		row[biggest] += 32767 - total;
+	}
+	reset ();
+
+	if (inRate != outRate)
+	{
+		ESP_LOGI(TAG, "%d -> %d Hz, %d channel(s), %d taps x %d phases", inRate, outRate,
+				channels, taps, phases );
+	}
+}
+
+
+/**
+ * Forget the input so far (start of a new sound).
+ */
+void Resampler::reset ()
+{
+	memset (work, 0, sizeof(work) );
+	have = taps / 2 - 1;  // (silence before the first sample)
+	pos = have;
+	rem = 0;
+}
+
+
+/**
+ * Add the next input - only when 'pull' has taken everything it can.
+ */
+void Resampler::push (const int16_t *in, int frames)
+{
+	// Drop what we don't need any more (going down a lot, that can be
+	// more than we have - the rest is dropped next time)
+	int drop = pos - (taps / 2 - 1);
+	if (drop > have) drop = have;
+	if (drop > 0)
+	{
+		for (int ch = 0; ch < channels; ch++ )
+		{
+			memmove (&work[ch * stride], &work[ch * stride + drop], (have - drop) * sizeof(int16_t) );
+		}
+		have -= drop;
+		pos -= drop;
+	}
+
+	if (have + frames > stride)
+	{
+		ESP_LOGE(TAG, "Too much input (%d frames) - some lost", frames );
+		frames = stride - have;
+	}
+
+	// One channel at a time
+	int16_t *dest = &work[have];
+	if (channels == 1)
+	{
+		memcpy (dest, in, frames * sizeof(int16_t) );
+	}
+	else
+	{
+		for (int idx = 0; idx < frames; idx++ )
+		{
+			dest[idx] = in[idx * 2];
+			dest[stride + idx] = in[idx * 2 + 1];
+		}
+	}
+	have += frames;
+}
+
+
+/**
+ * The filter itself - as many output frames as the input allows (up to
+ * 'maxFrames').
+ */
+template<int TAPS, int CHANNELS>
+int Resampler::run (int maxFrames)
+{
+	const int after = TAPS / 2;        // Input samples after the output time
+	const int before = TAPS / 2 - 1;
+	int count = 0;
+
+	while ((count < maxFrames) && (pos + after < have))
+	{
+		const int16_t *row = &coef[(int) (((uint64_t) rem * phaseMul) >> 32) * TAPS];
+		for (int ch = 0; ch < CHANNELS; ch++ )
+		{
+			const int16_t *in = &work[ch * stride + pos - before];
+			int32_t acc = 1 << 14;
+			for (int tap = 0; tap < TAPS; tap++ )
+			{
+				acc += in[tap] * row[tap];
+			}
+			acc >>= 15;
+			if (acc > 32767) acc = 32767;
+			if (acc < -32768) acc = -32768;
+			out[count * CHANNELS + ch] = (int16_t) acc;
+		}
+		count++;
+
+		pos += stepWhole;
+		rem += stepRem;
+		if (rem >= (uint32_t) outRate)
+		{
+			rem -= outRate;
+			pos++;
+		}
+	}
+	return (count);
+}
+
+
+/**
+ * Get the next block of output.
+ * @param block - set to the samples (interleaved, like the input)
+ * @return how many frames - 0 if it needs more input.
+ */
+int Resampler::pull (const int16_t **block)
+{
+	*block = out;
+	switch ((taps * 2) + channels)
+	{
+		case (2 * 2 + 1):
+			return (run<2, 1> (RESAMPLE_BLOCK ));
+		case (2 * 2 + 2):
+			return (run<2, 2> (RESAMPLE_BLOCK ));
+		case (8 * 2 + 1):
+			return (run<8, 1> (RESAMPLE_BLOCK ));
+		case (8 * 2 + 2):
+			return (run<8, 2> (RESAMPLE_BLOCK ));
+		case (16 * 2 + 1):
+			return (run<16, 1> (RESAMPLE_BLOCK ));
+		default:
+			return (run<16, 2> (RESAMPLE_BLOCK ));
+	}
+}
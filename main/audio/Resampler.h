@@ -0,0 +1,89 @@
+/**
+ * Resampler.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ * A streaming sample rate converter - between the decoder and the output,
+ * so the output can stay at one rate whatever rate the clips are. (Starting
+ * the I2S driver again for each clip means a gap, and some amps only take
+ * one rate.)
+ *
+ * It is a polyphase FIR filter, all fixed point: the taps for 'phases'
+ * points between two input samples are worked out once (in 'configure'),
+ * as Q15. Each output sample is one row of taps times the input samples
+ * around it - a straight run of 16 bit multiply-adds, the same length every
+ * time, on samples that are kept one channel at a time (so the loops are
+ * easy for the compiler to unroll, or use SIMD/MAC instructions on).
+ *
+ * The output time steps through the input in whole input samples plus a
+ * remainder counted in 1/outRate's - so it never drifts, however long it runs.
+ *
+ * Quality (see ResampleQuality) is the number of taps: more taps cut the
+ * aliasing and images, but cost more multiply-adds for every output sample.
+ *
+ *    push(pcm, frames)                       - one decoded frame, then
+ *    while ((n = pull(&block)) > 0) {...}    - RESAMPLE_BLOCK frames at a time
+ */
+
+#ifndef MAIN_AUDIO_RESAMPLER_H_
+#define MAIN_AUDIO_RESAMPLER_H_
+
+#include <stdint.h>
+#include "minimp3.h"
+
+enum ResampleQuality
+{
+	RESAMPLE_FAST,      // Linear - 2 taps (some dull/metallic edges)
+	RESAMPLE_BALANCED,  // 8 taps, 64 phases
+	RESAMPLE_BEST       // 16 taps, 128 phases
+};
+
+#define RESAMPLE_MAX_TAPS   16
+// The biggest table of taps (BEST - 128 phases x 16 taps)
+#define RESAMPLE_MAX_COEFS  2048
+// Frames we give back at a time
+#define RESAMPLE_BLOCK      256
+// The input we hold - what is left of the last push, and the next one
+#define RESAMPLE_WORK       (2 * RESAMPLE_MAX_TAPS + MINIMP3_MAX_SAMPLES_PER_FRAME)
+
+class Resampler
+{
+public:
+	Resampler ();
+
+	void configure(int inRate, int outRate, int channels, ResampleQuality quality);
+	void reset();
+	// true if the rates are different (if not, don't use it)
+	bool active() const { return (inRate != outRate); }
+	bool matches(int _inRate, int _outRate, int _channels) const
+	{
+		return ((inRate == _inRate) && (outRate == _outRate) && (channels == _channels));
+	}
+
+	void push(const int16_t *in, int frames);
+	int pull(const int16_t **out);
+
+private:
+	int inRate;
+	int outRate;
+	int channels;
+	int taps;
+	int phases;
+	uint32_t phaseMul;    // (remainder * phaseMul) >> 32 = the phase
+	int stepWhole;        // Input samples per output sample...
+	uint32_t stepRem;     //   ... and 1/outRate's
+
+	int stride;           // Each channel's space in 'work'
+	int have;             // Input samples (per channel) in 'work'
+	int pos;              // The input sample the next output is after...
+	uint32_t rem;         //   ... and how far after it (in 1/outRate's)
+
+	int16_t coef[RESAMPLE_MAX_COEFS];
+	int16_t work[RESAMPLE_WORK];
+	int16_t out[RESAMPLE_BLOCK * 2];
+
+	template<int TAPS, int CHANNELS> int run(int maxFrames);
+};
+
+#endif /* MAIN_AUDIO_RESAMPLER_H_ */
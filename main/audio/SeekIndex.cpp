@@ -0,0 +1,214 @@
+/**
+ * SeekIndex.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ */
+
+#include <string.h>
+#include <sys/stat.h>
+#include "esp_log.h"
+#include "SeekIndex.h"
+
+static const char *TAG = "SEEKINDEX:";
+
+SeekIndex::SeekIndex ()
+{
+	fp = nullptr;
+	memset (&header, 0, sizeof(header) );
+	frameCount = 0;
+	reservoir = true;
+	bufCount = 0;
+}
+
+
+SeekIndex::~SeekIndex ()
+{
+	close ();
+}
+
+
+/**
+ * The name of the index for a sound file - the same name, with '.idx'
+ * instead of the extension.
+ */
+void SeekIndex::indexName (const char *soundFile, char *name, size_t len)
+{
+	strncpy (name, soundFile, len - 5 );
+	name[len - 5] = '\0';
+	char *dot = strrchr (name, '.' );
+	char *slash = strrchr (name, '/' );
+	if ((dot != nullptr) && ((slash == nullptr) || (dot > slash))) *dot = '\0';
+	strcat (name, ".idx" );
+}
+
+
+uint32_t SeekIndex::fileSize (const char *fileName)
+{
+	struct stat st;
+	if (stat (fileName, &st ) != 0) return (0);
+	return ((uint32_t) st.st_size);
+}
+
+
+/**
+ * Start making a new index (replacing any old one).
+ * @param reservoir - false if every frame can be decoded on its own.
+ * @return false if the index file could not be created.
+ */
+bool SeekIndex::create (const char *soundFile, uint32_t sampleRate, bool _reservoir)
+{
+	char name[64];
+	close ();
+	indexName (soundFile, name, sizeof(name) );
+
+	memset (&header, 0, sizeof(header) );
+	header.magic = SEEK_INDEX_MAGIC;
+	header.version = SEEK_INDEX_VERSION;
+	header.stride = SEEK_INDEX_STRIDE;
+	header.sampleRate = sampleRate;
+	header.sourceSize = fileSize (soundFile );
+	frameCount = 0;
+	reservoir = _reservoir;
+	bufCount = 0;
+
+	fp = fopen (name, "w" );
+	if (fp == nullptr)
+	{
+		ESP_LOGE(TAG, "Can't create %s", name );
+		return (false);
+	}
+	// The header is written again (filled in) by 'finish'
+	if (1 != fwrite (&header, sizeof(header), 1, fp ))
+	{
+		close ();
+		return (false);
+	}
+	return (true);
+}
+
+
+/**
+ * Add the next frame.
+ * @param offset     - where we started looking for it in the file
+ * @param frameBytes - how far that moved us on
+ * @param samples    - the samples it makes (per channel)
+ */
+bool SeekIndex::add (uint32_t offset, int frameBytes, int samples)
+{
+	if (fp == nullptr) return (false);
+
+	if ((frameCount % SEEK_INDEX_STRIDE) == 0)
+	{	// Go back far enough to fill the reservoir
+		SeekPoint *point = &buf[bufCount];
+		point->sample = header.totalSamples;
+		point->offset = offset;
+		point->skipFrames = 0;
+		point->reserved = 0;
+		int have = 0;
+		for (uint32_t back = 1; reservoir && (back <= frameCount) && (back < SEEK_HISTORY)
+				&& (have < SEEK_RESERVOIR_BYTES); back++ )
+		{
+			int idx = (frameCount - back) % SEEK_HISTORY;
+			point->offset = histOffset[idx];
+			point->skipFrames = back;
+			if (histBytes[idx] > SEEK_FRAME_OVERHEAD) have += histBytes[idx] - SEEK_FRAME_OVERHEAD;
+		}
+		bufCount++;
+		header.pointCount++;
+	}
+
+	histOffset[frameCount % SEEK_HISTORY] = offset;
+	histBytes[frameCount % SEEK_HISTORY] = frameBytes;
+	frameCount++;
+	header.totalSamples += samples;
+
+	if (bufCount >= SEEK_INDEX_BUF_POINTS) return (flush ());
+	return (true);
+}
+
+
+bool SeekIndex::flush ()
+{
+	bool ok = (bufCount == 0) || (bufCount == (int) fwrite (buf, sizeof(SeekPoint), bufCount, fp ));
+	bufCount = 0;
+	if (!ok) ESP_LOGE(TAG, "Write failed" );
+	return (ok);
+}
+
+
+/**
+ * Finished adding frames - fill in the header, and close the index.
+ */
+bool SeekIndex::finish ()
+{
+	if (fp == nullptr) return (false);
+	bool ok = flush ();
+	ok = ok && (0 == fseek (fp, 0, SEEK_SET ));
+	ok = ok && (1 == fwrite (&header, sizeof(header), 1, fp ));
+	if (0 != fclose (fp )) ok = false;
+	fp = nullptr;
+
+	ESP_LOGI(TAG, "%s: %u frames, %u points, %u samples",
+			ok ? "Index written" : "Index FAILED", frameCount, header.pointCount,
+			header.totalSamples );
+	return (ok);
+}
+
+
+void SeekIndex::close ()
+{
+	if (fp != nullptr) fclose (fp );
+	fp = nullptr;
+}
+
+
+/**
+ * Find where to start, to play a sound file from 'msec'.
+ * @param point  - set to the last point at or before 'msec'.
+ * @param target - set to the sample at 'msec' (per channel, from the start)
+ * @return false if there is no index, or it doesn't match the sound file.
+ */
+bool SeekIndex::lookup (const char *soundFile, uint32_t msec, SeekPoint *point,
+		uint32_t *target)
+{
+	char name[64];
+	SeekIndexHeader hdr;
+	indexName (soundFile, name, sizeof(name) );
+
+	FILE *in = fopen (name, "r" );
+	if (in == nullptr) return (false);
+
+	bool ok = (1 == fread (&hdr, sizeof(hdr), 1, in ));
+	ok = ok && (hdr.magic == SEEK_INDEX_MAGIC) && (hdr.version == SEEK_INDEX_VERSION);
+	ok = ok && (hdr.sourceSize == fileSize (soundFile )) && (hdr.pointCount > 0);
+	if (!ok)
+	{
+		ESP_LOGW(TAG, "Ignoring %s - out of date", name );
+		fclose (in );
+		return (false);
+	}
+
+	uint32_t want = (uint32_t) ((uint64_t) msec * hdr.sampleRate / 1000);
+	if (want > hdr.totalSamples) want = hdr.totalSamples;
+
+	// The last point at or before 'want' (the first is at 0)
+	uint32_t lo = 0;
+	uint32_t hi = hdr.pointCount - 1;
+	SeekPoint probe;
+	while (ok && (lo < hi))
+	{
+		uint32_t mid = (lo + hi + 1) / 2;
+		ok = (0 == fseek (in, sizeof(hdr) + mid * sizeof(SeekPoint), SEEK_SET ))
+				&& (1 == fread (&probe, sizeof(probe), 1, in ));
+		if (probe.sample <= want) lo = mid;
+		else hi = mid - 1;
+	}
+	ok = ok && (0 == fseek (in, sizeof(hdr) + lo * sizeof(SeekPoint), SEEK_SET ))
+			&& (1 == fread (point, sizeof(SeekPoint), 1, in ));
+	fclose (in );
+
+	*target = want;
+	return (ok);
+}
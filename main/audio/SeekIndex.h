@@ -0,0 +1,106 @@
+/**
+ * SeekIndex.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ * A seek index for a sound file - where to start reading (and decoding) it,
+ * to play from part way through. Kept next to the sound file, like the
+ * envelope track (DaysMono.mp3 -> DaysMono.idx).
+ *
+ * There is a point every SEEK_INDEX_STRIDE frames. An MP3 frame can use up
+ * to 511 bytes of the frames before it (the 'bit reservoir'), so a point
+ * does not start at its own frame: it starts a few frames earlier (enough
+ * to fill the reservoir), and says how many frames to decode and throw away
+ * before the one it is for. (WAV frames - see Decoder.h - stand alone.)
+ *
+ * The index is made by SndPlayer (from the frame headers - no decoding), in
+ * the prescan, or the first time a file without one is seeked.
+ *
+ * FILE FORMAT (little endian):
+ *    SeekIndexHeader
+ *    SeekPoint x pointCount  - in order, the first one at sample 0.
+ *
+ * Finding a point is a binary search in the file - no need to load it.
+ */
+
+#ifndef MAIN_AUDIO_SEEKINDEX_H_
+#define MAIN_AUDIO_SEEKINDEX_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#define SEEK_INDEX_MAGIC   0x58494B53   // "SKIX"
+#define SEEK_INDEX_VERSION 1
+
+// How many frames between points (1152 samples each at 44.1k is about 0.2s)
+#define SEEK_INDEX_STRIDE 8
+
+// The bit reservoir - and the most of a frame that is not main data
+// (header, CRC, side info).
+#define SEEK_RESERVOIR_BYTES 511
+#define SEEK_FRAME_OVERHEAD  38
+
+// How many frames back we remember (enough to cover the reservoir with the
+// smallest frames)
+#define SEEK_HISTORY 16
+
+// How many points we write at a time
+#define SEEK_INDEX_BUF_POINTS 32
+
+struct SeekIndexHeader
+{
+	uint32_t magic;
+	uint16_t version;
+	uint16_t stride;        // Frames per point
+	uint32_t sampleRate;
+	uint32_t pointCount;
+	uint32_t totalSamples;  // (per channel)
+	uint32_t sourceSize;    // Size of the sound file, in bytes
+};
+
+struct SeekPoint
+{
+	uint32_t sample;      // The first sample of the frame it is for (per channel)
+	uint32_t offset;      // Where to start reading the file
+	uint16_t skipFrames;  // Frames to decode and throw away, to get to 'sample'
+	uint16_t reserved;
+};
+
+class SeekIndex
+{
+public:
+	SeekIndex ();
+	~SeekIndex ();
+
+	static void indexName(const char *soundFile, char *name, size_t len);
+
+	// Making an index - 'add' every frame, in order.
+	bool create(const char *soundFile, uint32_t sampleRate, bool reservoir = true);
+	bool add(uint32_t offset, int frameBytes, int samples);
+	bool finish();
+
+	// Using it
+	static bool lookup(const char *soundFile, uint32_t msec, SeekPoint *point,
+			uint32_t *target);
+
+private:
+	FILE *fp;
+	SeekIndexHeader header;
+	uint32_t frameCount;
+	bool reservoir;   // Frames use the ones before (MP3)
+
+	// The last few frames - where they started, and how big they were
+	uint32_t histOffset[SEEK_HISTORY];
+	uint16_t histBytes[SEEK_HISTORY];
+
+	SeekPoint buf[SEEK_INDEX_BUF_POINTS];
+	int bufCount;
+
+	static uint32_t fileSize(const char *fileName);
+	bool flush();
+	void close();
+};
+
+#endif /* MAIN_AUDIO_SEEKINDEX_H_ */
@@ -0,0 +1,307 @@
+/**
+ * SfxBank.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "AssetIndex.h"
+#include "Decoders.h"
+#include "Resampler.h"
+#include "StreamWindow.h"
+#include "Mixer.h"
+#include "SfxBank.h"
+
+static const char *TAG = "SFX:";
+
+// The sound grows this many frames at a time, as it is decoded
+#define SFX_GROW_FRAMES 4096
+
+SfxBank::SfxBank ()
+{
+	for (int idx = 0; idx < SFX_SLOTS; idx++ )
+	{
+		sounds[idx].state.store (SFX_EMPTY );
+		sounds[idx].clip = -1;
+		sounds[idx].hz = 0;
+		sounds[idx].pcm = nullptr;
+		sounds[idx].frames = 0;
+		sounds[idx].lastUsed = 0;
+	}
+	useCount = 0;
+	loadSound = nullptr;
+	loadUsec = 0;
+}
+
+
+SfxBank::~SfxBank ()
+{
+	for (int idx = 0; idx < SFX_SLOTS; idx++ )
+	{
+		if (sounds[idx].state.load () != SFX_LOADING) free (sounds[idx].pcm );
+	}
+}
+
+
+/**
+ * The slot for a clip, at this rate - in any state.
+ * @return nullptr if it isn't there (or is at another rate).
+ */
+SfxSound *SfxBank::find (int clip, int hz)
+{
+	for (int idx = 0; idx < SFX_SLOTS; idx++ )
+	{
+		SfxSound *sound = &sounds[idx];
+		if ((sound->clip == clip) && (sound->hz == hz) && (sound->state.load (std::memory_order_acquire ) != SFX_EMPTY))
+		{
+			return (sound);
+		}
+	}
+	return (nullptr);
+}
+
+
+bool SfxBank::loading () const
+{
+	return ((loadSound != nullptr) && (loadSound->state.load (std::memory_order_acquire ) == SFX_LOADING));
+}
+
+
+/**
+ * Empty a slot (it must not be playing).
+ */
+void SfxBank::forget (SfxSound *sound)
+{
+	free (sound->pcm );
+	sound->pcm = nullptr;
+	sound->frames = 0;
+	sound->clip = -1;
+	sound->state.store (SFX_EMPTY, std::memory_order_release );
+}
+
+
+/**
+ * Start loading a clip (one at a time - see 'loading').
+ * @return false if there is no slot for it (all playing), or no task.
+ */
+bool SfxBank::load (int clip, int hz, const Mixer *mixer)
+{
+	if (loading ()) return (false);
+
+	// An empty slot - or the one used longest ago, that isn't playing
+	SfxSound *use = nullptr;
+	for (int idx = 0; idx < SFX_SLOTS; idx++ )
+	{
+		SfxSound *sound = &sounds[idx];
+		int state = sound->state.load (std::memory_order_acquire );
+		if ((state == SFX_EMPTY) || (state == SFX_FAILED))
+		{
+			use = sound;
+			break;
+		}
+		if (!mixer->uses (sound->pcm ) && ((use == nullptr) || (sound->lastUsed < use->lastUsed)))
+		{
+			use = sound;
+		}
+	}
+	if (use == nullptr)
+	{
+		ESP_LOGW(TAG, "No room for clip %d - all the effects are playing", clip );
+		return (false);
+	}
+
+	forget (use );
+	use->clip = clip;
+	use->hz = hz;
+	use->state.store (SFX_LOADING, std::memory_order_release );
+	loadSound = use;
+
+	// (below the pipeline stages - so it only uses the time they don't)
+	if (pdPASS != xTaskCreatePinnedToCore (&loadTask, "SfxLoader", AUDIO_DECODER_STACK,
+			this, AUDIO_STAGE_PRIORITY - 1, nullptr, ASSIGN_MUSIC_CORE ))
+	{
+		ESP_LOGE(TAG, "Failed to start the load task" );
+		use->state.store (SFX_FAILED, std::memory_order_release );
+		return (false);
+	}
+	return (true);
+}
+
+
+void SfxBank::loadTask (void *_me)
+{
+	SfxBank *me = (SfxBank*) _me;
+	SfxSound *sound = me->loadSound;
+	const Asset *asset = AssetIndex::get (sound->clip );
+
+	int64_t start = esp_timer_get_time ();
+	bool ok = (asset != nullptr) && loadFile (sound, asset->path );
+	me->loadUsec = (uint32_t) (esp_timer_get_time () - start);
+
+	if (ok)
+	{
+		ESP_LOGI(TAG, "Loaded clip %d (%s) - %d frames at %d Hz, in %u msec", sound->clip,
+				asset->name, sound->frames, sound->hz, me->loadUsec / 1000 );
+	}
+	sound->state.store (ok ? SFX_READY : SFX_FAILED, std::memory_order_release );
+	vTaskDelete (nullptr );
+}
+
+
+/**
+ * Add frames to the end of a sound (making it bigger if need be).
+ * @return false if it is full.
+ */
+static bool append (SfxSound *sound, int *capacity, int maxFrames, const int16_t *in, int frames)
+{
+	if (sound->frames + frames > maxFrames) frames = maxFrames - sound->frames;
+	if (sound->frames + frames > *capacity)
+	{
+		int want = *capacity + SFX_GROW_FRAMES;
+		if (want > maxFrames) want = maxFrames;
+		int16_t *bigger = (int16_t*) realloc (sound->pcm, want * sizeof(int16_t) );
+		if (bigger == nullptr)
+		{
+			ESP_LOGW(TAG, "Out of memory - the effect is cut short" );
+			return (false);
+		}
+		sound->pcm = bigger;
+		*capacity = want;
+	}
+	memcpy (&sound->pcm[sound->frames], in, frames * sizeof(int16_t) );
+	sound->frames += frames;
+	return (sound->frames < maxFrames);
+}
+
+
+/**
+ * Decode a clip into 'sound' - mono, at 'sound->hz'.
+ */
+bool SfxBank::loadFile (SfxSound *sound, const char *path)
+{
+	errno = 0;
+	FILE *in = fopen (path, "r" );
+	if (in == nullptr)
+	{
+		ESP_LOGE(TAG, "Can't open %s. Error %d (%s)", path, errno, strerror(errno) );
+		return (false);
+	}
+	AudioFormat format;
+	if (!Decoder::probe (in, &format ))
+	{
+		ESP_LOGE(TAG, "Can't play %s", path );
+		fclose (in );
+		return (false);
+	}
+
+	// (the pipeline is using its window - we need our own)
+	StreamWindow<AUDIO_READ_WINDOW_SIZE, AUDIO_WINDOW_GUARD> *window =
+			new StreamWindow<AUDIO_READ_WINDOW_SIZE, AUDIO_WINDOW_GUARD>();
+	int16_t *pcm = (int16_t*) malloc (sizeof(int16_t) * MINIMP3_MAX_SAMPLES_PER_FRAME );
+	Resampler *resampler = nullptr;
+	Decoders decoders;
+	Decoder *decoder = decoders.start (&format, format.dataStart );
+	DecodeInfo info = { };
+
+	int maxFrames = (int) ((int64_t) SFX_MAX_MSEC * sound->hz / 1000);
+	int capacity = 0;
+	bool full = false;
+	bool ok = (pcm != nullptr);
+
+	while (ok && !full)
+	{
+		// top up the window (as the prescan does)
+		size_t space;
+		uint8_t *dest;
+		while (!window->eofSeen ()
+				&& ((dest = window->writePtr (&space )), (space >= AUDIO_READ_CHUNK_SIZE)))
+		{
+			size_t len = fread (dest, 1, AUDIO_READ_CHUNK_SIZE, in );
+			window->commitWrite (len );
+			if (len < AUDIO_READ_CHUNK_SIZE) window->setEof ();
+		}
+
+		size_t buffered;
+		const uint8_t *input = window->readPtr (&buffered );
+		if (buffered == 0) break;
+		int samples = decoder->decode (input, buffered, pcm, &info );
+		if (info.bytes == 0) break;
+		window->consume (info.bytes );
+		if (samples <= 0) continue;
+
+		// Mono...
+		if (info.channels == 2)
+		{
+			for (int idx = 0; idx < samples; idx++ )
+			{
+				pcm[idx] = (int16_t) ((pcm[idx * 2] + pcm[idx * 2 + 1]) >> 1);
+			}
+		}
+
+		// ...at the output rate
+		if ((resampler == nullptr) && (info.hz != sound->hz))
+		{
+			resampler = new Resampler();
+			resampler->configure (info.hz, sound->hz, 1, AUDIO_RESAMPLE_QUALITY );
+		}
+		if (resampler == nullptr)
+		{
+			full = !append (sound, &capacity, maxFrames, pcm, samples );
+		}
+		else
+		{
+			const int16_t *block;
+			int frames;
+			resampler->push (pcm, samples );
+			while (!full && ((frames = resampler->pull (&block )) > 0))
+			{
+				full = !append (sound, &capacity, maxFrames, block, frames );
+			}
+		}
+		ok = (sound->pcm != nullptr);
+	}
+
+	if (ok && !full && (resampler != nullptr))
+	{	// The end of the sound is still in the filter - push some silence
+		const int16_t *block;
+		int frames;
+		memset (pcm, 0, RESAMPLE_MAX_TAPS * sizeof(int16_t) );
+		resampler->push (pcm, RESAMPLE_MAX_TAPS );
+		while (!full && ((frames = resampler->pull (&block )) > 0))
+		{
+			full = !append (sound, &capacity, maxFrames, block, frames );
+		}
+	}
+	if (full && (sound->frames == maxFrames))
+	{
+		ESP_LOGW(TAG, "%s is too long for an effect - only the first %d msec", path, SFX_MAX_MSEC );
+	}
+	if ((capacity > sound->frames) && (sound->frames > 0))
+	{	// Give back what we didn't use
+		int16_t *smaller = (int16_t*) realloc (sound->pcm, sound->frames * sizeof(int16_t) );
+		if (smaller != nullptr) sound->pcm = smaller;
+	}
+
+	delete resampler;
+	free (pcm );
+	delete window;
+	fclose (in );
+
+	if (!ok || (sound->frames == 0))
+	{
+		ESP_LOGE(TAG, "Can't load %s (no sound, or no memory)", path );
+		free (sound->pcm );
+		sound->pcm = nullptr;
+		sound->frames = 0;
+		return (false);
+	}
+	return (true);
+}
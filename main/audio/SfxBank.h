@@ -0,0 +1,76 @@
+/**
+ * SfxBank.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ * The sound effects (see Mixer.h) - clips that are kept in RAM, decoded,
+ * mixed down to mono and resampled to the output rate. So starting one is
+ * just pointing a voice at it.
+ *
+ * A clip is loaded the first time it is wanted - on its own task (decoding
+ * an MP3 needs a big stack, and takes far too long for the output stage).
+ * There are SFX_SLOTS of them, each up to SFX_MAX_MSEC long. When they are
+ * all full, the one used longest ago (and not playing) makes way.
+ *
+ * The output stage does everything except the loading:
+ *    sound = find(clip, hz);    - nullptr: not loaded, so...
+ *    load(clip, hz, mixer);     - ...start loading it
+ *    sound->state               - SFX_READY when it is loaded
+ * The load task only touches the one slot it is loading, and hands it back
+ * by setting 'state' (the output stage leaves a SFX_LOADING slot alone).
+ */
+
+#ifndef MAIN_AUDIO_SFXBANK_H_
+#define MAIN_AUDIO_SFXBANK_H_
+
+#include <stdint.h>
+#include <atomic>
+#include "../config.h"
+
+class Mixer;
+
+enum Sfx_State {
+	SFX_EMPTY,
+	SFX_LOADING,   // The load task has it
+	SFX_READY,
+	SFX_FAILED     // Couldn't load it (no file, no memory...)
+};
+
+struct SfxSound
+{
+	std::atomic<int> state;  // Sfx_State
+	int clip;
+	int hz;
+	int16_t *pcm;            // mono, at 'hz'
+	int frames;
+	uint32_t lastUsed;       // (for choosing one to unload)
+};
+
+class SfxBank
+{
+public:
+	SfxBank ();
+	~SfxBank ();
+
+	// OUTPUT STAGE
+	SfxSound *find(int clip, int hz);
+	bool load(int clip, int hz, const Mixer *mixer);
+	bool loading() const;
+	void touch(SfxSound *sound) { sound->lastUsed = ++useCount; }
+	void forget(SfxSound *sound);
+
+	// How long the last load took
+	uint32_t lastLoadUsec() const { return (loadUsec); }
+
+private:
+	SfxSound sounds[SFX_SLOTS];
+	uint32_t useCount;
+	SfxSound *loadSound;
+	volatile uint32_t loadUsec;
+
+	static void loadTask(void *_me);
+	static bool loadFile(SfxSound *sound, const char *path);
+};
+
+#endif /* MAIN_AUDIO_SFXBANK_H_ */
@@ -0,0 +1,111 @@
+/**
+ * SpscRing.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ * A lock-free ring of fixed size slots, for exactly one producer task and
+ * one consumer task. This connects the stages of the audio pipeline
+ * (see SndPlayer.cpp).
+ *
+ * The slots are used in place - nothing is copied in or out:
+ *   producer:  slot = claim();  ...fill it in...  publish();
+ *   consumer:  slot = peek();   ...use it...      release();
+ * claim() returns nullptr if the ring is full, peek() returns nullptr
+ * if it is empty. Neither one waits - that is up to the caller.
+ *
+ * 'head' is only written by the producer, and 'tail' only by the consumer,
+ * so no compare-and-swap is needed.
+ *
+ * CAPACITY must be a power of two.
+ */
+
+#ifndef MAIN_AUDIO_SPSCRING_H_
+#define MAIN_AUDIO_SPSCRING_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+template <typename T, uint32_t CAPACITY>
+class SpscRing
+{
+public:
+	static_assert((CAPACITY >= 2) && ((CAPACITY & (CAPACITY - 1)) == 0),
+			"SpscRing: CAPACITY must be a power of 2");
+
+	SpscRing ()
+	{
+		reset ();
+		highWater.store (0, std::memory_order_relaxed );
+	}
+
+	/**
+	 * PRODUCER: get the next free slot (it is not visible to the
+	 * consumer until 'publish' is called).
+	 * @return the slot, or nullptr if the ring is full.
+	 */
+	T *claim ()
+	{
+		uint32_t h = head.load (std::memory_order_relaxed );
+		if ((h - tail.load (std::memory_order_acquire )) >= CAPACITY) return (nullptr);
+		return (&slots[h & (CAPACITY - 1)]);
+	}
+
+	// PRODUCER: hand the claimed slot to the consumer.
+	void publish ()
+	{
+		uint32_t h = head.load (std::memory_order_relaxed ) + 1;
+		head.store (h, std::memory_order_release );
+		uint32_t depth = h - tail.load (std::memory_order_relaxed );
+		if (depth > highWater.load (std::memory_order_relaxed ))
+		{
+			highWater.store (depth, std::memory_order_relaxed );
+		}
+	}
+
+	/**
+	 * CONSUMER: get the oldest published slot.
+	 * @return the slot, or nullptr if the ring is empty.
+	 */
+	T *peek ()
+	{
+		uint32_t t = tail.load (std::memory_order_relaxed );
+		if (head.load (std::memory_order_acquire ) == t) return (nullptr);
+		return (&slots[t & (CAPACITY - 1)]);
+	}
+
+	// CONSUMER: finished with the slot from 'peek' - give it back.
+	void release ()
+	{
+		tail.store (tail.load (std::memory_order_relaxed ) + 1, std::memory_order_release );
+	}
+
+	// Number of published slots (exact if nobody is in the middle of a call).
+	uint32_t size () const
+	{
+		return (head.load (std::memory_order_acquire ) - tail.load (std::memory_order_acquire ));
+	}
+
+	bool empty () const { return (size () == 0); }
+	uint32_t capacity () const { return (CAPACITY); }
+
+	// The most slots that have been in use at once, since the last reset.
+	uint32_t getHighWater () const { return (highWater.load (std::memory_order_relaxed )); }
+	void resetHighWater () { highWater.store (size (), std::memory_order_relaxed ); }
+
+	// Empty the ring. ONLY when neither the producer nor the consumer is using it!
+	void reset ()
+	{
+		head.store (0, std::memory_order_relaxed );
+		tail.store (0, std::memory_order_relaxed );
+	}
+
+private:
+	T slots[CAPACITY];
+	std::atomic<uint32_t> head;   // Next slot to publish (producer)
+	std::atomic<uint32_t> tail;   // Next slot to release (consumer)
+	std::atomic<uint32_t> highWater;
+};
+
+#endif /* MAIN_AUDIO_SPSCRING_H_ */
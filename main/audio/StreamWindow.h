@@ -0,0 +1,145 @@
+/**
+ * StreamWindow.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: doug
+ *
+ * A byte ring for streaming a file from one task (the reader) to another
+ * (the decoder), without copying - and without the decoder ever seeing the
+ * ring 'wrap'.
+ *
+ * The reader reads straight into the ring, in big blocks. The decoder gets
+ * a pointer to the oldest unread byte, and a count of how many bytes follow
+ * it contiguously - so it can hand the pointer straight to minimp3.
+ *
+ * The trick: the buffer has an extra GUARD bytes after the end of the ring.
+ * Whenever the reader writes into the first GUARD bytes of the ring, it
+ * also copies them to the guard area. So starting anywhere in the ring,
+ * there are always at least GUARD contiguous bytes (if they have been read
+ * from the file) - enough for any MP3 frame. Only the first GUARD bytes of
+ * each trip around the ring are copied, instead of the whole buffer being
+ * shifted after every frame.
+ *
+ * (host/bench/StreamWindowBench.cpp: for DaysMono.mp3 that is 37 KB copied
+ *  instead of 1.7 MB. It saves memory bandwidth and the 1 KB buffer - the
+ *  time saved is small next to the decoding itself.)
+ *
+ * Like SpscRing: one producer, one consumer, no locks. 'head' is only
+ * written by the reader and 'tail' only by the decoder.
+ *
+ * SIZE must be a power of two, and the reader should read in blocks that
+ * divide SIZE (so every read fits before the end of the ring, and file
+ * offsets stay block aligned).
+ */
+
+#ifndef MAIN_AUDIO_STREAMWINDOW_H_
+#define MAIN_AUDIO_STREAMWINDOW_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <atomic>
+
+template <uint32_t SIZE, uint32_t GUARD>
+class StreamWindow
+{
+public:
+	static_assert((SIZE >= 2) && ((SIZE & (SIZE - 1)) == 0),
+			"StreamWindow: SIZE must be a power of 2");
+	static_assert(GUARD <= SIZE, "StreamWindow: GUARD must not be bigger than SIZE");
+
+	StreamWindow ()
+	{
+		reset ();
+		highWater.store (0, std::memory_order_relaxed );
+	}
+
+	/**
+	 * READER: where to put the next bytes from the file.
+	 * @param space - set to how many bytes may be written there.
+	 */
+	uint8_t *writePtr (size_t *space)
+	{
+		uint32_t h = head.load (std::memory_order_relaxed );
+		uint32_t free = SIZE - (h - tail.load (std::memory_order_acquire ));
+		uint32_t pos = h & (SIZE - 1);
+		uint32_t contig = SIZE - pos;
+		*space = (free < contig) ? free : contig;
+		return (&buf[pos]);
+	}
+
+	// READER: 'count' bytes have been written at 'writePtr'.
+	void commitWrite (size_t count)
+	{
+		uint32_t h = head.load (std::memory_order_relaxed );
+		uint32_t pos = h & (SIZE - 1);
+		if (pos < GUARD)
+		{   // Copy the start of the ring into the guard area
+			size_t mirror = GUARD - pos;
+			memcpy (&buf[SIZE + pos], &buf[pos], (count < mirror) ? count : mirror );
+		}
+		head.store (h + count, std::memory_order_release );
+
+		uint32_t depth = h + count - tail.load (std::memory_order_relaxed );
+		if (depth > highWater.load (std::memory_order_relaxed ))
+		{
+			highWater.store (depth, std::memory_order_relaxed );
+		}
+	}
+
+	// READER: there is no more data.
+	void setEof () { eof.store (true, std::memory_order_release ); }
+
+	/**
+	 * DECODER: has the reader finished?
+	 * NOTE: check this BEFORE calling 'readPtr' - then if it is true,
+	 *       'readPtr' is sure to see everything there is.
+	 */
+	bool eofSeen () const { return (eof.load (std::memory_order_acquire )); }
+
+	/**
+	 * DECODER: where the unread data is.
+	 * @param avail - set to how many bytes may be read from there.
+	 */
+	const uint8_t *readPtr (size_t *avail)
+	{
+		uint32_t t = tail.load (std::memory_order_relaxed );
+		uint32_t used = head.load (std::memory_order_acquire ) - t;
+		uint32_t pos = t & (SIZE - 1);
+		uint32_t contig = SIZE + GUARD - pos;
+		*avail = (used < contig) ? used : contig;
+		return (&buf[pos]);
+	}
+
+	// DECODER: finished with 'count' bytes from 'readPtr'.
+	void consume (size_t count)
+	{
+		tail.store (tail.load (std::memory_order_relaxed ) + count, std::memory_order_release );
+	}
+
+	// Bytes waiting to be read
+	uint32_t size () const
+	{
+		return (head.load (std::memory_order_acquire ) - tail.load (std::memory_order_acquire ));
+	}
+	uint32_t capacity () const { return (SIZE); }
+	uint32_t getHighWater () const { return (highWater.load (std::memory_order_relaxed )); }
+	void resetHighWater () { highWater.store (size (), std::memory_order_relaxed ); }
+
+	// Empty the window. ONLY when neither the reader nor the decoder is using it!
+	void reset ()
+	{
+		head.store (0, std::memory_order_relaxed );
+		tail.store (0, std::memory_order_relaxed );
+		eof.store (false, std::memory_order_relaxed );
+	}
+
+private:
+	alignas(4) uint8_t buf[SIZE + GUARD];
+	std::atomic<uint32_t> head;   // Bytes written, ever (reader)
+	std::atomic<uint32_t> tail;   // Bytes consumed, ever (decoder)
+	std::atomic<bool> eof;
+	std::atomic<uint32_t> highWater;
+};
+
+#endif /* MAIN_AUDIO_STREAMWINDOW_H_ */
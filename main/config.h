@@ -32,6 +32,8 @@ extern i2s_pin_config_t i2s_speaker_pins;
 
 // button - GPIO 0 is the built in button on most dev boards
 #define GPIO_BUTTON GPIO_NUM_0
+// presses closer together than this are ignored (switch bounce)
+#define BUTTON_DEBOUNCE_MSEC 250
 
 
 /* = = = = = = = = = == */
@@ -44,6 +46,80 @@ extern i2s_pin_config_t i2s_speaker_pins;
 
 #define SEQUENCER_PANIC_BACKLOG 5
 
+// How many messages are pre-allocated in the message pool.
+// (If we run out, messages come from the heap - slowly!)
+#define MESSAGE_POOL_SIZE 64
+
+// Depth of the SwitchBoard message queue. MUST be a power of 2.
+#define SWITCHBOARD_QUEUE_SIZE 32
+
+// What SwitchBoard::send does when the queue is full
+// (see OVERFLOW_POLICY in Sequencer/SwitchBoard.h)
+#define SWITCHBOARD_OVERFLOW_POLICY OVERFLOW_POLICY::BLOCK
+
+// If true, the SwitchBoard drains everything that is queued each time it
+// wakes, and delivers it with one take of the driver-table lock (see
+// DeviceDef::callBackBatch). At most SWITCHBOARD_BATCH_MAX at a time.
+#define SWITCHBOARD_BATCH_DELIVERY true
+#define SWITCHBOARD_BATCH_MAX 16
+
+// How many (destination, event) pairs can be registered as 'state' events.
+// A newer state event replaces one that has not been delivered yet.
+// (see SwitchBoard::registerStateEvent)
+#define SWITCHBOARD_MAX_MAILBOXES 8
+
+// How many messages can be waiting for a future delivery time
+// (see SwitchBoard::sendAt)
+#define SWITCHBOARD_TIMER_QUEUE_SIZE 32
+
+// Drivers registered with their own delivery task (see
+// SwitchBoard::registerDriver) get an inbox this deep (power of 2),
+// and a task with this stack size and priority.
+#define SWITCHBOARD_INBOX_SIZE 16
+#define SWITCHBOARD_INBOX_STACK 4096
+#define SWITCHBOARD_INBOX_PRIORITY 2
+
+// How many requests (SwitchBoard::request) can be waiting for a reply at
+// once. MUST be a power of 2.
+#define SWITCHBOARD_MAX_PENDING 16
+
+// Collect per-destination delivery statistics (latency and callBack time
+// histograms, drops, queue high water) - see the 'stats' command.
+// Comment this out to remove them (and the time stamp in each message).
+#define SWITCHBOARD_STATS
+
+
+// The audio pipeline (see SndPlayer.cpp):
+//     reader --(StreamWindow)--> decoder --(PCM frames)--> output/analysis
+// Sizes MUST be powers of 2. The decoder runs on ASSIGN_MUSIC_CORE,
+// and needs a big stack (minimp3 keeps its scratch area there).
+// The file is read in AUDIO_READ_CHUNK_SIZE blocks (a multiple of the
+// SPIFFS page size) into a window of AUDIO_READ_WINDOW_SIZE bytes.
+// AUDIO_WINDOW_GUARD is the largest MP3 frame we can decode.
+#define AUDIO_READ_CHUNK_SIZE  2048
+#define AUDIO_READ_WINDOW_SIZE 8192
+#define AUDIO_WINDOW_GUARD     2304
+#define AUDIO_PCM_RING_SIZE   4
+#define AUDIO_READER_STACK    4096
+#define AUDIO_DECODER_STACK   32768
+#define AUDIO_STAGE_PRIORITY  3
+// How much audio the output DMA buffers hold (see LatencyPolicy in
+// audio/Output.h) - this is also how far the sound lags the jaw messages.
+#define AUDIO_LATENCY_POLICY  LATENCY_LOW
+// The output's sample rate - 0 keeps the first clip's rate. Clips at any
+// other rate are resampled (see audio/Resampler.h), at this quality.
+#define AUDIO_OUTPUT_RATE     0
+#define AUDIO_RESAMPLE_QUALITY RESAMPLE_BALANCED
+// Sound effects over the music (see audio/Mixer.h and audio/SfxBank.h):
+// how many can play at once, how many are kept loaded (each up to
+// SFX_MAX_MSEC long), and how many 'sfx' commands can be waiting.
+#define MIXER_VOICES          4
+#define SFX_SLOTS             4
+#define SFX_MAX_MSEC          2000
+#define SFX_TRIGGER_QUEUE     8
+// How often the playback clock sends MOTION_SEQ_TIME (see audio/PlaybackClock.h)
+// - 0 to turn it off.
+#define PLAYBACK_TICK_MSEC    100
 
 /**
  * What file will we read from the FLASH?
@@ -51,6 +127,14 @@ extern i2s_pin_config_t i2s_speaker_pins;
  */
 #define SOURCE_FILE_NAME "/fs/DaysMono.mp3"
 
+// The clips (see audio/AssetIndex.h) - RUN plays SOURCE_FILE_NAME if the
+// playlist is empty.
+#define ASSET_DIR       "/fs"
+#define ASSET_INDEX_MAX 32
+#define PLAYLIST_MAX    16
+// How many cue points (places to 'seek' back to) we remember
+#define CUE_MAX         8
+
 // PIN Definitions
 #define ESP_LED_PIN 2
 
@@ -80,6 +164,19 @@ extern i2s_pin_config_t i2s_speaker_pins;
 #define PIN_JAW_SERVO    13
 #define JAW_AVG_SIZE 1024
 
+// How the eye and jaw levels follow the sound (see audio/EnvelopeFollower.h).
+// The eyes get a new level every EYE_AVG_SIZE samples, the jaw every
+// JAW_AVG_SIZE. ENV_FULL_SCALE is the level for fully bright / fully open.
+// (The follower holds on to the peaks, so its levels run about twice the
+// old block average - which was mapped from 3200. See
+// host/tests/EnvelopeFollowerTest.cpp.)
+#define ENV_MODE          ENV_RMS
+#define EYE_ATTACK_MSEC   5
+#define EYE_RELEASE_MSEC  60
+#define JAW_ATTACK_MSEC   10
+#define JAW_RELEASE_MSEC  150
+#define ENV_FULL_SCALE    6800
+
 /*
  * MAP - MACRO to re-map a number from one range to another.
  * @param x -    the number to be re-maped.
@@ -105,7 +105,8 @@ void app_main ()
 #ifdef ENABLE_SOUND
 	SndPlayer player ("Player" );
 
-	xTaskCreatePinnedToCore (player.startPlayerTask, "Player", 32768, &player,
+	// (The decoder has its own task and stack - see AUDIO_DECODER_STACK)
+	xTaskCreatePinnedToCore (player.startPlayerTask, "Player", 8192, &player,
 			2, &(player.myTask), ASSIGN_SWITCHBOARD_CORE );
 
 #endif